@@ -4,6 +4,8 @@
 #include "SirMetal/application/window.h"
 #include "SirMetal/core/event.h"
 #include "SirMetal/core/input.h"
+#include "SirMetal/core/memory/cpu/frameArena.h"
+#include "SirMetal/core/profiler.h"
 #include "SirMetal/engine.h"
 
 /*
@@ -38,6 +40,7 @@ Application::Application(const std::string &configFile) {
   // to handle the events.
   m_window->setEventCallback([this](Event &e) -> void { this->onEvent(e); });
 
+  SM_PROFILE_THREAD_NAME("main");
   m_engine = engineStartUp(engineConfig, m_window->getWindow());
   m_engine->m_window = m_window;
 
@@ -53,6 +56,8 @@ Application::~Application() {
 }
 void Application::run() {
   while (m_run) {
+    // closes the zones of the previous frame
+    SM_PROFILE_NEW_FRAME();
     m_window->onUpdate();
     m_engine->m_timings.newFrame();
     // TODO process queue event
@@ -73,6 +78,7 @@ void Application::run() {
     const int count = m_layerStack.count();
     Layer **layers = m_layerStack.begin();
     @autoreleasepool {
+      SM_PROFILE_SCOPE("layers update");
       for (int i = 0; i < count; ++i) {
         layers[i]->onUpdate();
       }
@@ -80,6 +86,8 @@ void Application::run() {
     // m_engine->m_renderingContext->endScene();
     // update input and actions to cache current input for next frame
     m_engine->m_inputManager->swapInputBuffers();
+    // nothing allocated in the scratch arenas outlives the frame
+    resetFrameArenas();
   }
   // lets clean up the layers, now is safe to free up resources
   const int count = m_layerStack.count();
@@ -1,5 +1,12 @@
 #pragma once
+#include <stdint.h>
+
 #include <chrono>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace SirMetal {
 typedef std::chrono::time_point<std::chrono::high_resolution_clock>
@@ -36,9 +43,12 @@ class Clock final {
   long long getDeltaFromOrigin() const;
 
   /*
-  This function implements a lock type sleep for the clock,
-  means it keeps the game stuck in a while loop until
-  is not ready to compute the next frame
+  This function holds the calling thread until the requested amount of time
+  has passed, for example to wait until is time to compute the next frame.
+  The bulk of the wait is an OS sleep, which frees the core, but an OS sleep
+  can wake up late, so it stops SLEEP_MARGIN before the end, yields the
+  thread until SPIN_MARGIN before the end, and only spins for the last few
+  microseconds.
   @param amount: how much to hold the sleep, the unit
                                   is related to the clock resolution,
                                   means if you have GAME_CLOCK_RESOLUTION at
@@ -106,14 +116,132 @@ long long Clock<T>::getDeltaFromOrigin() const {
   return duration;
 }
 
+// how early the OS sleep stops, it covers how late the OS can wake us up
+static constexpr std::chrono::microseconds SLEEP_MARGIN{1000};
+// from here to the end of the sleep the thread spins
+static constexpr std::chrono::microseconds SPIN_MARGIN{20};
+
 template <typename T>
 void Clock<T>::sleep(const long long amount) const {
-  const high_res_time_point t = now();
-  while (getDelta(t) < amount)
-    ;
-  {}
+  const high_res_time_point end = now() + T(amount);
+  auto remaining = end - now();
+  if (remaining > SLEEP_MARGIN) {
+    std::this_thread::sleep_for(remaining - SLEEP_MARGIN);
+  }
+  // yielding lets anything else ready to run have the core, if nothing is it
+  // returns straight away
+  while ((remaining = end - now()) > SPIN_MARGIN) {
+    std::this_thread::yield();
+  }
+  while (now() < end) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
 }
 // generating a game clock using the default resolution set in the constants
 using GAME_CLOCK_RESOLUTION = std::chrono::nanoseconds;
 typedef Clock<GAME_CLOCK_RESOLUTION> GameClock;
+
+/*
+Raw cpu timestamps, for instrumenting hot paths where even the chrono clock
+is too slow. Reading the counter is a single instruction, rdtsc on x86,
+cntvct_el0 on arm64, converting to nanoseconds is done only when the value is
+needed, and maps the ticks on the steady clock timeline.
+On x86 the tick rate is not known, it is calibrated against the steady clock
+the first time a conversion is needed, which takes CALIBRATION_TIME. The TSC
+is assumed invariant, true for any x86 cpu from the last decade. On arm64 the
+counter frequency is read from cntfrq_el0 and nothing needs calibrating.
+*/
+class CycleClock final {
+ public:
+  static constexpr std::chrono::milliseconds CALIBRATION_TIME{10};
+
+  struct Calibration {
+    double nanosecondsPerTick;
+    // the same instant on both clocks
+    uint64_t tickOrigin;
+    uint64_t nanosecondOrigin;
+  };
+
+  static inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return getSteadyNanoseconds();
+#endif
+  }
+
+  static const Calibration &getCalibration() {
+    static const Calibration calibration = calibrate();
+    return calibration;
+  }
+
+  // steady clock nanoseconds of a timestamp
+  static inline uint64_t toNanoseconds(const uint64_t ticks) {
+    const Calibration &calibration = getCalibration();
+    const auto delta = static_cast<int64_t>(ticks - calibration.tickOrigin);
+    return calibration.nanosecondOrigin +
+           static_cast<int64_t>(static_cast<double>(delta) *
+                                calibration.nanosecondsPerTick);
+  }
+  static inline uint64_t durationToNanoseconds(const uint64_t ticks) {
+    return static_cast<uint64_t>(static_cast<double>(ticks) *
+                                 getCalibration().nanosecondsPerTick);
+  }
+  static inline uint64_t nanosecondsToDuration(const uint64_t nanoseconds) {
+    return static_cast<uint64_t>(static_cast<double>(nanoseconds) /
+                                 getCalibration().nanosecondsPerTick);
+  }
+
+  static inline uint64_t getSteadyNanoseconds() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+ private:
+  // both clocks are read back to back, steady first and last, and the tick
+  // taken in the middle, so the error is half a steady clock read
+  static void sample(uint64_t &ticks, uint64_t &nanoseconds) {
+    const uint64_t before = getSteadyNanoseconds();
+    ticks = now();
+    const uint64_t after = getSteadyNanoseconds();
+    nanoseconds = before + (after - before) / 2;
+  }
+
+  static Calibration calibrate() {
+    Calibration calibration{};
+#if defined(__aarch64__)
+    uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    calibration.nanosecondsPerTick = 1e9 / static_cast<double>(frequency);
+    sample(calibration.tickOrigin, calibration.nanosecondOrigin);
+#elif defined(__x86_64__) || defined(__i386__)
+    uint64_t startTicks;
+    uint64_t startNanoseconds;
+    sample(startTicks, startNanoseconds);
+    std::this_thread::sleep_for(CALIBRATION_TIME);
+    uint64_t endTicks;
+    uint64_t endNanoseconds;
+    sample(endTicks, endNanoseconds);
+    calibration.nanosecondsPerTick =
+        static_cast<double>(endNanoseconds - startNanoseconds) /
+        static_cast<double>(endTicks - startTicks);
+    calibration.tickOrigin = endTicks;
+    calibration.nanosecondOrigin = endNanoseconds;
+#else
+    // the fallback counter is already in nanoseconds
+    calibration.nanosecondsPerTick = 1.0;
+#endif
+    return calibration;
+  }
+};
 }  // namespace BlackHole
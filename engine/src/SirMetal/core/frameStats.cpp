@@ -0,0 +1,323 @@
+#include "SirMetal/core/frameStats.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace SirMetal {
+
+namespace {
+uint64_t getRank(const double quantile, const uint64_t count) {
+  // nearest rank, 1 based
+  const double clamped = quantile < 0.0 ? 0.0 : (quantile > 1.0 ? 1.0 : quantile);
+  auto rank = static_cast<uint64_t>(ceil(clamped * static_cast<double>(count)));
+  return rank == 0 ? 1 : rank;
+}
+
+uint64_t getBucketMiddle(const uint32_t index) {
+  const uint64_t lowest = LogHistogram::getBucketLowestValue(index);
+  return lowest + (LogHistogram::getBucketHighestValue(index) - lowest) / 2;
+}
+
+bool writeString(const std::string &content, const char *path,
+                 const char *what) {
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    printf("[ERROR] Could not open %s to write the %s\n", path, what);
+    return false;
+  }
+  const size_t written = fwrite(content.data(), 1, content.size(), file);
+  fclose(file);
+  return written == content.size();
+}
+}  // namespace
+
+uint64_t LogHistogram::getValueAtQuantile(const double quantile) const {
+  uint64_t value = 0;
+  getValuesAtQuantiles(&quantile, 1, &value);
+  return value;
+}
+
+void LogHistogram::getValuesAtQuantiles(const double *quantiles,
+                                        const uint32_t count,
+                                        uint64_t *outValues) const {
+  if (m_count == 0) {
+    memset(outValues, 0, sizeof(uint64_t) * count);
+    return;
+  }
+  uint32_t current = 0;
+  uint64_t rank = getRank(quantiles[0], m_count);
+  uint64_t cumulative = 0;
+  for (uint32_t i = 0; (i < BUCKET_COUNT) & (current < count); ++i) {
+    cumulative += m_buckets[i];
+    // several quantiles can fall in the same bucket
+    while ((current < count) && (cumulative >= rank)) {
+      uint64_t value = getBucketMiddle(i);
+      value = value < m_min ? m_min : value;
+      value = value > m_max ? m_max : value;
+      outValues[current++] = value;
+      if (current < count) {
+        assert(quantiles[current] >= quantiles[current - 1]);
+        rank = getRank(quantiles[current], m_count);
+      }
+    }
+  }
+}
+
+uint64_t LogHistogram::getCountBelow(const uint64_t value) const {
+  const uint32_t index = getBucketIndex(value);
+  uint64_t count = 0;
+  for (uint32_t i = 0; i < index; ++i) {
+    count += m_buckets[i];
+  }
+  return count;
+}
+
+void LogHistogram::reset() {
+  memset(m_buckets, 0, sizeof(m_buckets));
+  m_count = 0;
+  m_sum = 0.0;
+  m_min = ~0ull;
+  m_max = 0;
+}
+
+void StreamingQuantile::reset(const double quantile) {
+  assert((quantile >= 0.0) & (quantile <= 1.0));
+  m_quantile = quantile;
+  m_count = 0;
+  for (int i = 0; i < 5; ++i) {
+    m_heights[i] = 0.0;
+    m_positions[i] = static_cast<double>(i + 1);
+  }
+  m_desiredPositions[0] = 1.0;
+  m_desiredPositions[1] = 1.0 + 2.0 * quantile;
+  m_desiredPositions[2] = 1.0 + 4.0 * quantile;
+  m_desiredPositions[3] = 3.0 + 2.0 * quantile;
+  m_desiredPositions[4] = 5.0;
+  m_increments[0] = 0.0;
+  m_increments[1] = quantile * 0.5;
+  m_increments[2] = quantile;
+  m_increments[3] = (1.0 + quantile) * 0.5;
+  m_increments[4] = 1.0;
+}
+
+void StreamingQuantile::record(const double value) {
+  // the first five values are kept sorted, they become the markers
+  if (m_count < 5) {
+    int i = static_cast<int>(m_count);
+    while ((i > 0) && (m_heights[i - 1] > value)) {
+      m_heights[i] = m_heights[i - 1];
+      --i;
+    }
+    m_heights[i] = value;
+    ++m_count;
+    return;
+  }
+  ++m_count;
+
+  // cell the value falls in, extremes are pushed out
+  int cell;
+  if (value < m_heights[0]) {
+    m_heights[0] = value;
+    cell = 0;
+  } else if (value >= m_heights[4]) {
+    m_heights[4] = value;
+    cell = 3;
+  } else {
+    cell = 0;
+    while (value >= m_heights[cell + 1]) {
+      ++cell;
+    }
+  }
+  for (int i = cell + 1; i < 5; ++i) {
+    m_positions[i] += 1.0;
+  }
+  for (int i = 0; i < 5; ++i) {
+    m_desiredPositions[i] += m_increments[i];
+  }
+
+  // middle markers off their desired position by one or more move by one,
+  // along the parabola through the neighbours if it stays monotonic
+  for (int i = 1; i < 4; ++i) {
+    const double offset = m_desiredPositions[i] - m_positions[i];
+    const bool moveUp =
+        (offset >= 1.0) & (m_positions[i + 1] - m_positions[i] > 1.0);
+    const bool moveDown =
+        (offset <= -1.0) & (m_positions[i - 1] - m_positions[i] < -1.0);
+    if (!(moveUp | moveDown)) {
+      continue;
+    }
+    const int direction = moveUp ? 1 : -1;
+    const double candidate = parabolic(i, direction);
+    if ((m_heights[i - 1] < candidate) & (candidate < m_heights[i + 1])) {
+      m_heights[i] = candidate;
+    } else {
+      m_heights[i] = linear(i, direction);
+    }
+    m_positions[i] += direction;
+  }
+}
+
+double StreamingQuantile::parabolic(const int i, const double direction) const {
+  const double *q = m_heights;
+  const double *n = m_positions;
+  return q[i] + direction / (n[i + 1] - n[i - 1]) *
+                    ((n[i] - n[i - 1] + direction) * (q[i + 1] - q[i]) /
+                         (n[i + 1] - n[i]) +
+                     (n[i + 1] - n[i] - direction) * (q[i] - q[i - 1]) /
+                         (n[i] - n[i - 1]));
+}
+
+double StreamingQuantile::linear(const int i, const int direction) const {
+  return m_heights[i] + direction * (m_heights[i + direction] - m_heights[i]) /
+                            (m_positions[i + direction] - m_positions[i]);
+}
+
+double StreamingQuantile::getValue() const {
+  if (m_count == 0) {
+    return 0.0;
+  }
+  if (m_count <= 5) {
+    // nearest rank on the sorted values
+    return m_heights[getRank(m_quantile, m_count) - 1];
+  }
+  return m_heights[2];
+}
+
+void FrameStats::recordFrame(const uint64_t frameTimeNS) {
+  // a spike is judged against the median of the frames before it
+  const double median = m_quantiles[0].getValue();
+  if ((m_quantiles[0].getCount() >= SPIKE_WARMUP_FRAMES) &&
+      (static_cast<double>(frameTimeNS) > median * SPIKE_MEDIAN_FACTOR)) {
+    ++m_spikeCount;
+  }
+  m_hitchCount += frameTimeNS > m_hitchThresholdNS ? 1 : 0;
+
+  m_histogram.record(frameTimeNS);
+  const auto value = static_cast<double>(frameTimeNS);
+  for (StreamingQuantile &quantile : m_quantiles) {
+    quantile.record(value);
+  }
+  m_recentMs.push(static_cast<float>(value * 1e-6));
+}
+
+void FrameStats::reset() {
+  m_histogram.reset();
+  for (uint32_t i = 0; i < TRACKED_QUANTILES_COUNT; ++i) {
+    m_quantiles[i].reset(TRACKED_QUANTILES[i]);
+  }
+  m_recentMs.clear();
+  m_hitchCount = 0;
+  m_spikeCount = 0;
+}
+
+FrameStatsSummary FrameStats::getSummary() const {
+  uint64_t values[TRACKED_QUANTILES_COUNT];
+  m_histogram.getValuesAtQuantiles(TRACKED_QUANTILES, TRACKED_QUANTILES_COUNT,
+                                   values);
+  return FrameStatsSummary{m_histogram.getCount(),
+                           m_histogram.getMin(),
+                           m_histogram.getMax(),
+                           m_histogram.getMean(),
+                           values[0],
+                           values[1],
+                           values[2],
+                           values[3],
+                           m_hitchCount,
+                           m_spikeCount};
+}
+
+FrameStats::RecentWindow FrameStats::getRecentWindow() const {
+  const OverridingRingBuffer<float>::View view = m_recentMs.getView();
+  if (view.count() == 0) {
+    return RecentWindow{0.0f, 0.0f, 0.0f};
+  }
+  RecentWindow window{view.first.data[0], view.first.data[0], 0.0f};
+  for (const OverridingRingBuffer<float>::Span &span :
+       {view.first, view.second}) {
+    for (uint32_t i = 0; i < span.count; ++i) {
+      const float v = span.data[i];
+      window.minMs = v < window.minMs ? v : window.minMs;
+      window.maxMs = v > window.maxMs ? v : window.maxMs;
+      window.averageMs += v;
+    }
+  }
+  window.averageMs /= static_cast<float>(view.count());
+  return window;
+}
+
+std::string frameStatsToJson(const FrameStats &stats) {
+  const FrameStatsSummary summary = stats.getSummary();
+  char buffer[512];
+  snprintf(buffer, sizeof(buffer),
+           "{\n\"frameCount\":%llu,\n\"minNS\":%llu,\n\"maxNS\":%llu,\n"
+           "\"meanNS\":%.1f,\n\"p50NS\":%llu,\n\"p95NS\":%llu,\n"
+           "\"p99NS\":%llu,\n\"p999NS\":%llu,\n\"hitchThresholdNS\":%llu,\n"
+           "\"hitchCount\":%llu,\n\"spikeCount\":%llu,\n\"histogram\":[",
+           static_cast<unsigned long long>(summary.frameCount),
+           static_cast<unsigned long long>(summary.minNS),
+           static_cast<unsigned long long>(summary.maxNS), summary.meanNS,
+           static_cast<unsigned long long>(summary.p50NS),
+           static_cast<unsigned long long>(summary.p95NS),
+           static_cast<unsigned long long>(summary.p99NS),
+           static_cast<unsigned long long>(summary.p999NS),
+           static_cast<unsigned long long>(stats.getHitchThreshold()),
+           static_cast<unsigned long long>(summary.hitchCount),
+           static_cast<unsigned long long>(summary.spikeCount));
+  std::string out{buffer};
+
+  // [lowestNS, highestNS, count] for every non empty bucket
+  const LogHistogram &histogram = stats.getHistogram();
+  bool first = true;
+  for (uint32_t i = 0; i < LogHistogram::BUCKET_COUNT; ++i) {
+    const uint64_t count = histogram.getBucketCount(i);
+    if (count == 0) {
+      continue;
+    }
+    snprintf(buffer, sizeof(buffer), "%s\n[%llu,%llu,%llu]", first ? "" : ",",
+             static_cast<unsigned long long>(
+                 LogHistogram::getBucketLowestValue(i)),
+             static_cast<unsigned long long>(
+                 LogHistogram::getBucketHighestValue(i)),
+             static_cast<unsigned long long>(count));
+    out += buffer;
+    first = false;
+  }
+  out += "\n]\n}\n";
+  return out;
+}
+
+std::string frameStatsToCsv(const FrameStats &stats) {
+  const LogHistogram &histogram = stats.getHistogram();
+  const auto total = static_cast<double>(histogram.getCount());
+  std::string out{"lowestNS,highestNS,count,cumulativeFraction\n"};
+  char buffer[128];
+  uint64_t cumulative = 0;
+  for (uint32_t i = 0; i < LogHistogram::BUCKET_COUNT; ++i) {
+    const uint64_t count = histogram.getBucketCount(i);
+    if (count == 0) {
+      continue;
+    }
+    cumulative += count;
+    snprintf(buffer, sizeof(buffer), "%llu,%llu,%llu,%.6f\n",
+             static_cast<unsigned long long>(
+                 LogHistogram::getBucketLowestValue(i)),
+             static_cast<unsigned long long>(
+                 LogHistogram::getBucketHighestValue(i)),
+             static_cast<unsigned long long>(count),
+             static_cast<double>(cumulative) / total);
+    out += buffer;
+  }
+  return out;
+}
+
+bool writeFrameStatsJson(const FrameStats &stats, const char *path) {
+  return writeString(frameStatsToJson(stats), path, "frame stats");
+}
+
+bool writeFrameStatsCsv(const FrameStats &stats, const char *path) {
+  return writeString(frameStatsToCsv(stats), path, "frame stats");
+}
+
+}  // namespace SirMetal
@@ -0,0 +1,189 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+
+#include "SirMetal/core/memory/cpu/overridingRingBuffer.h"
+
+// Frame time statistics, no dependency on the renderer or ImGui so they can be
+// collected in headless and soak runs and dumped at exit.
+// Two structures work together:
+// - LogHistogram, HDR style, every value ever recorded lands in a bucket with
+//   a bounded relative width, any quantile of the whole run can be read back
+//   with less than 0.4% error, used for the reports.
+// - StreamingQuantile, P² estimator (Jain & Chlamtac), five markers per
+//   quantile, O(1) to update and to read, used for the live values and to
+//   detect spikes against the running median without walking the histogram.
+namespace SirMetal {
+
+class LogHistogram final {
+ public:
+  // every power of two range is split in SUB_BUCKET_COUNT linear buckets,
+  // values below SUB_BUCKET_COUNT get a bucket each and are exact
+  static constexpr uint32_t SUB_BUCKET_BITS = 7;
+  static constexpr uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+  static constexpr uint32_t BUCKET_COUNT =
+      (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+  static uint32_t getBucketIndex(const uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+      return static_cast<uint32_t>(value);
+    }
+    const uint32_t highestBit = 63 - __builtin_clzll(value);
+    const uint32_t shift = highestBit - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_COUNT +
+           static_cast<uint32_t>((value >> shift) - SUB_BUCKET_COUNT);
+  }
+  static uint64_t getBucketLowestValue(const uint32_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+      return index;
+    }
+    const uint32_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t subBucket = index % SUB_BUCKET_COUNT;
+    return (SUB_BUCKET_COUNT + subBucket) << shift;
+  }
+  // inclusive, the last bucket ends at the largest uint64
+  static uint64_t getBucketHighestValue(const uint32_t index) {
+    const uint32_t shift =
+        index < SUB_BUCKET_COUNT ? 0 : index / SUB_BUCKET_COUNT - 1;
+    return getBucketLowestValue(index) + ((1ull << shift) - 1);
+  }
+
+  void record(const uint64_t value) {
+    ++m_buckets[getBucketIndex(value)];
+    ++m_count;
+    m_sum += static_cast<double>(value);
+    m_min = value < m_min ? value : m_min;
+    m_max = value > m_max ? value : m_max;
+  }
+
+  // nearest rank, the value is the middle of the bucket holding the rank
+  // clamped to the recorded range, 0 if nothing was recorded
+  uint64_t getValueAtQuantile(double quantile) const;
+  // same as calling getValueAtQuantile for every quantile, in a single walk
+  // of the buckets, the quantiles need to be sorted
+  void getValuesAtQuantiles(const double *quantiles, uint32_t count,
+                            uint64_t *outValues) const;
+  // how many values are in the buckets before the one of value
+  uint64_t getCountBelow(uint64_t value) const;
+
+  uint64_t getBucketCount(const uint32_t index) const {
+    return m_buckets[index];
+  }
+  uint64_t getCount() const { return m_count; }
+  uint64_t getMin() const { return m_count != 0 ? m_min : 0; }
+  uint64_t getMax() const { return m_max; }
+  double getMean() const {
+    return m_count != 0 ? m_sum / static_cast<double>(m_count) : 0.0;
+  }
+  void reset();
+
+ private:
+  uint64_t m_buckets[BUCKET_COUNT]{};
+  uint64_t m_count = 0;
+  double m_sum = 0.0;
+  uint64_t m_min = ~0ull;
+  uint64_t m_max = 0;
+};
+
+class StreamingQuantile final {
+ public:
+  explicit StreamingQuantile(double quantile = 0.5) { reset(quantile); }
+
+  void record(double value);
+  // estimate so far, exact up to five values, 0 if nothing was recorded
+  double getValue() const;
+  double getQuantile() const { return m_quantile; }
+  uint64_t getCount() const { return m_count; }
+  void reset(double quantile);
+
+ private:
+  double parabolic(int i, double direction) const;
+  double linear(int i, int direction) const;
+
+  double m_quantile;
+  uint64_t m_count;
+  // marker heights, actual and desired positions, and how much the desired
+  // positions move at every value
+  double m_heights[5];
+  double m_positions[5];
+  double m_desiredPositions[5];
+  double m_increments[5];
+};
+
+struct FrameStatsSummary {
+  uint64_t frameCount;
+  uint64_t minNS;
+  uint64_t maxNS;
+  double meanNS;
+  uint64_t p50NS;
+  uint64_t p95NS;
+  uint64_t p99NS;
+  uint64_t p999NS;
+  // frames longer than the hitch threshold
+  uint64_t hitchCount;
+  // frames longer than SPIKE_MEDIAN_FACTOR times the running median
+  uint64_t spikeCount;
+};
+
+class FrameStats final {
+ public:
+  static constexpr uint32_t RECENT_SAMPLES = 200;
+  // two missed vsyncs at 60hz
+  static constexpr uint64_t DEFAULT_HITCH_THRESHOLD_NS = 33333333;
+  static constexpr double SPIKE_MEDIAN_FACTOR = 2.0;
+  // the running median is too noisy to call spikes before this many frames
+  static constexpr uint64_t SPIKE_WARMUP_FRAMES = 32;
+  static constexpr uint32_t TRACKED_QUANTILES_COUNT = 4;
+  static constexpr double TRACKED_QUANTILES[TRACKED_QUANTILES_COUNT] = {
+      0.5, 0.95, 0.99, 0.999};
+
+  FrameStats() { reset(); }
+  FrameStats(const FrameStats &) = delete;
+  FrameStats &operator=(const FrameStats &) = delete;
+
+  void recordFrame(uint64_t frameTimeNS);
+  void reset();
+  void setHitchThreshold(const uint64_t thresholdNS) {
+    m_hitchThresholdNS = thresholdNS;
+  }
+  uint64_t getHitchThreshold() const { return m_hitchThresholdNS; }
+
+  // whole run, quantiles from the histogram
+  FrameStatsSummary getSummary() const;
+  // P² estimate of TRACKED_QUANTILES[index] in nanoseconds, O(1)
+  double getEstimatedQuantile(const uint32_t index) const {
+    return m_quantiles[index].getValue();
+  }
+  uint64_t getHitchCount() const { return m_hitchCount; }
+  uint64_t getSpikeCount() const { return m_spikeCount; }
+  const LogHistogram &getHistogram() const { return m_histogram; }
+
+  // the last RECENT_SAMPLES frame times in milliseconds, oldest first
+  OverridingRingBuffer<float>::View getRecentSamples() const {
+    return m_recentMs.getView();
+  }
+  struct RecentWindow {
+    float minMs;
+    float maxMs;
+    float averageMs;
+  };
+  RecentWindow getRecentWindow() const;
+
+ private:
+  LogHistogram m_histogram;
+  StreamingQuantile m_quantiles[TRACKED_QUANTILES_COUNT];
+  OverridingRingBuffer<float> m_recentMs{RECENT_SAMPLES};
+  uint64_t m_hitchThresholdNS = DEFAULT_HITCH_THRESHOLD_NS;
+  uint64_t m_hitchCount = 0;
+  uint64_t m_spikeCount = 0;
+};
+
+// summary plus the non empty histogram buckets
+std::string frameStatsToJson(const FrameStats &stats);
+// one row per non empty histogram bucket, bounds in nanoseconds and the
+// cumulative fraction of frames, ready to plot
+std::string frameStatsToCsv(const FrameStats &stats);
+bool writeFrameStatsJson(const FrameStats &stats, const char *path);
+bool writeFrameStatsCsv(const FrameStats &stats, const char *path);
+
+}  // namespace SirMetal
@@ -0,0 +1,153 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// constexpr port of the portable 32 bit FarmHash (farmhashmk::Hash32 in
+// farmhash.cc), being constexpr it can be used to hash literals at compile
+// time, while at runtime it is exactly the code farmhash runs on platforms
+// without SSE4.2. Reads are assumed little endian like the rest of the engine.
+namespace SirMetal {
+namespace hashing {
+
+constexpr uint32_t FARMHASH_C1 = 0xcc9e2d51;
+constexpr uint32_t FARMHASH_C2 = 0x1b873593;
+
+constexpr uint32_t fetch32(const char *p) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(p[0])) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 8) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 16) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(p[3])) << 24);
+}
+
+// farmhash rotates right
+constexpr uint32_t rotate32(const uint32_t val, const int shift) {
+  return shift == 0 ? val : ((val >> shift) | (val << (32 - shift)));
+}
+
+constexpr uint32_t fmix(uint32_t h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+constexpr uint32_t mur(uint32_t a, uint32_t h) {
+  a *= FARMHASH_C1;
+  a = rotate32(a, 17);
+  a *= FARMHASH_C2;
+  h ^= a;
+  h = rotate32(h, 19);
+  return h * 5 + 0xe6546b64;
+}
+
+constexpr uint32_t hash32Len0to4(const char *s, const size_t len) {
+  uint32_t b = 0;
+  uint32_t c = 9;
+  for (size_t i = 0; i < len; i++) {
+    const signed char v = static_cast<signed char>(s[i]);
+    b = b * FARMHASH_C1 + static_cast<uint32_t>(v);
+    c ^= b;
+  }
+  return fmix(mur(b, mur(static_cast<uint32_t>(len), c)));
+}
+
+constexpr uint32_t hash32Len5to12(const char *s, const size_t len) {
+  uint32_t a = static_cast<uint32_t>(len);
+  uint32_t b = static_cast<uint32_t>(len) * 5;
+  uint32_t c = 9;
+  const uint32_t d = b;
+  a += fetch32(s);
+  b += fetch32(s + len - 4);
+  c += fetch32(s + ((len >> 1) & 4));
+  return fmix(mur(c, mur(b, mur(a, d))));
+}
+
+constexpr uint32_t hash32Len13to24(const char *s, const size_t len) {
+  uint32_t a = fetch32(s - 4 + (len >> 1));
+  const uint32_t b = fetch32(s + 4);
+  const uint32_t c = fetch32(s + len - 8);
+  const uint32_t d = fetch32(s + (len >> 1));
+  const uint32_t e = fetch32(s);
+  const uint32_t f = fetch32(s + len - 4);
+  uint32_t h = d * FARMHASH_C1 + static_cast<uint32_t>(len);
+  a = rotate32(a, 12) + f;
+  h = mur(c, h) + a;
+  a = rotate32(a, 3) + c;
+  h = mur(e, h) + a;
+  a = rotate32(a + f, 12) + d;
+  h = mur(b, h) + a;
+  return fmix(h);
+}
+
+constexpr uint32_t farmhash32(const char *s, const size_t len) {
+  if (len <= 24) {
+    return len <= 12 ? (len <= 4 ? hash32Len0to4(s, len)
+                                 : hash32Len5to12(s, len))
+                     : hash32Len13to24(s, len);
+  }
+
+  // len > 24
+  uint32_t h = static_cast<uint32_t>(len);
+  uint32_t g = FARMHASH_C1 * static_cast<uint32_t>(len);
+  uint32_t f = g;
+  const uint32_t a0 =
+      rotate32(fetch32(s + len - 4) * FARMHASH_C1, 17) * FARMHASH_C2;
+  const uint32_t a1 =
+      rotate32(fetch32(s + len - 8) * FARMHASH_C1, 17) * FARMHASH_C2;
+  const uint32_t a2 =
+      rotate32(fetch32(s + len - 16) * FARMHASH_C1, 17) * FARMHASH_C2;
+  const uint32_t a3 =
+      rotate32(fetch32(s + len - 12) * FARMHASH_C1, 17) * FARMHASH_C2;
+  const uint32_t a4 =
+      rotate32(fetch32(s + len - 20) * FARMHASH_C1, 17) * FARMHASH_C2;
+  h ^= a0;
+  h = rotate32(h, 19);
+  h = h * 5 + 0xe6546b64;
+  h ^= a2;
+  h = rotate32(h, 19);
+  h = h * 5 + 0xe6546b64;
+  g ^= a1;
+  g = rotate32(g, 19);
+  g = g * 5 + 0xe6546b64;
+  g ^= a3;
+  g = rotate32(g, 19);
+  g = g * 5 + 0xe6546b64;
+  f += a4;
+  f = rotate32(f, 19) + 113;
+  size_t iters = (len - 1) / 20;
+  do {
+    const uint32_t a = fetch32(s);
+    const uint32_t b = fetch32(s + 4);
+    const uint32_t c = fetch32(s + 8);
+    const uint32_t d = fetch32(s + 12);
+    const uint32_t e = fetch32(s + 16);
+    h += a;
+    g += b;
+    f += c;
+    h = mur(d, h) + e;
+    g = mur(c, g) + a;
+    f = mur(b + e * FARMHASH_C1, f) + d;
+    f += g;
+    g += f;
+    s += 20;
+  } while (--iters != 0);
+  g = rotate32(g, 11) * FARMHASH_C1;
+  g = rotate32(g, 17) * FARMHASH_C1;
+  f = rotate32(f, 11) * FARMHASH_C1;
+  f = rotate32(f, 17) * FARMHASH_C1;
+  h = rotate32(h + g, 19);
+  h = h * 5 + 0xe6546b64;
+  h = rotate32(h, 17) * FARMHASH_C1;
+  h = rotate32(h + f, 19);
+  h = h * 5 + 0xe6546b64;
+  h = rotate32(h, 17) * FARMHASH_C1;
+  return h;
+}
+
+// constant evaluated for literals, a plain strlen call otherwise
+constexpr size_t stringLength(const char *s) { return __builtin_strlen(s); }
+
+} // namespace hashing
+} // namespace SirMetal
@@ -1,4 +1,7 @@
 #pragma once
+#include <string.h>
+
+#include "SirMetal/core/hashing/constexprHash.h"
 #include "SirMetal/core/hashing/farmhash.h"
 
 namespace SirMetal {
@@ -32,9 +35,36 @@ inline uint32_t hashUint64(const uint64_t &value) {
 inline uint64_t hashString(const char *value, const uint32_t len) {
   return util::Hash64(value, len);
 }
+// 32 bit string hashing goes through the constexpr farmhash rather than
+// util::Hash32, which picks a different variant based on SSE support and
+// debug mode, this way hashes of literals computed at compile time always
+// match the ones computed at runtime
 inline uint32_t hashString32(const char *const&value) {
   uint32_t len = static_cast<uint32_t>(strlen(value));
-  return util::Hash32(value, len);
+  return hashing::farmhash32(value, len);
+}
+
+// a string together with its length and hashString32 hash, meant to be
+// computed once and then reused for all the lookups by that name
+struct HashedString {
+  const char *string = nullptr;
+  uint32_t length = 0;
+  uint32_t hash = 0;
+};
+
+// constexpr so literals can be hashed at compile time:
+// constexpr HashedString GBUFFER = hashedString("gbuffer");
+constexpr HashedString hashedString(const char *value) {
+  const auto len = static_cast<uint32_t>(hashing::stringLength(value));
+  return HashedString{value, len, hashing::farmhash32(value, len)};
+}
+
+namespace literals {
+// string id literal, "gbuffer"_sid is the same as hashString32("gbuffer")
+// but computed at compile time
+constexpr uint32_t operator"" _sid(const char *value, const size_t len) {
+  return hashing::farmhash32(value, len);
 }
+} // namespace literals
 
 } // namespace SirMetal
\ No newline at end of file
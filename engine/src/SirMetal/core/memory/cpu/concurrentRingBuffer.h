@@ -0,0 +1,314 @@
+#pragma once
+#include <assert.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace SirMetal {
+
+// Lock free ring buffers to hand data between threads, like loading jobs going
+// from the frame thread to a loader thread and results coming back.
+// Capacity is always rounded up to a power of two, positions are free running
+// 32 bit counters and the slot is found by masking, no modulo. Positions wrap
+// around safely since only their difference is ever looked at.
+// Elements are copied with plain assignment, so T is meant to be small and
+// cheap to copy, a job description, a pointer, a handle.
+
+namespace ringBufferInternal {
+static constexpr uint32_t CACHE_LINE_SIZE = 64;
+
+inline uint32_t roundToPowerOfTwo(const uint32_t value) {
+  uint32_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+}  // namespace ringBufferInternal
+
+// Single producer, single consumer. Only the producer writes the tail and only
+// the consumer writes the head, each lives on its own cache line together with
+// a copy of the other index owned by the same thread, the copy is refreshed
+// (acquire) only when the ring looks full or empty, so in the common case a
+// push or pop touches no cache line shared with the other thread, besides the
+// data itself.
+template <typename T>
+class SPSCRingBuffer {
+public:
+  explicit SPSCRingBuffer(const uint32_t capacity)
+      : m_capacity(ringBufferInternal::roundToPowerOfTwo(capacity)),
+        m_mask(m_capacity - 1) {
+    assert(capacity > 0);
+    assert(m_capacity <= (1u << 31));
+    m_buffer = new T[m_capacity];
+  }
+  ~SPSCRingBuffer() { delete[] m_buffer; }
+
+  // producer only
+  bool push(const T &value) {
+    const uint32_t tail = m_producer.tail.load(std::memory_order_relaxed);
+    if (tail - m_producer.cachedHead == m_capacity) {
+      m_producer.cachedHead = m_consumer.head.load(std::memory_order_acquire);
+      if (tail - m_producer.cachedHead == m_capacity) {
+        return false;
+      }
+    }
+    m_buffer[tail & m_mask] = value;
+    m_producer.tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // producer only, pushes as many of the values as there is space for and
+  // returns how many, the values are published all together
+  uint32_t pushBatch(const T *values, const uint32_t count) {
+    const uint32_t tail = m_producer.tail.load(std::memory_order_relaxed);
+    uint32_t freeSlots = m_capacity - (tail - m_producer.cachedHead);
+    if (freeSlots < count) {
+      m_producer.cachedHead = m_consumer.head.load(std::memory_order_acquire);
+      freeSlots = m_capacity - (tail - m_producer.cachedHead);
+    }
+    const uint32_t toPush = count < freeSlots ? count : freeSlots;
+    for (uint32_t i = 0; i < toPush; ++i) {
+      m_buffer[(tail + i) & m_mask] = values[i];
+    }
+    m_producer.tail.store(tail + toPush, std::memory_order_release);
+    return toPush;
+  }
+
+  // consumer only
+  bool pop(T &value) {
+    const uint32_t head = m_consumer.head.load(std::memory_order_relaxed);
+    if (head == m_consumer.cachedTail) {
+      m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+      if (head == m_consumer.cachedTail) {
+        return false;
+      }
+    }
+    value = m_buffer[head & m_mask];
+    m_consumer.head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only, pops up to count values, returns how many
+  uint32_t popBatch(T *values, const uint32_t count) {
+    const uint32_t head = m_consumer.head.load(std::memory_order_relaxed);
+    uint32_t available = m_consumer.cachedTail - head;
+    if (available < count) {
+      m_consumer.cachedTail = m_producer.tail.load(std::memory_order_acquire);
+      available = m_consumer.cachedTail - head;
+    }
+    const uint32_t toPop = count < available ? count : available;
+    for (uint32_t i = 0; i < toPop; ++i) {
+      values[i] = m_buffer[(head + i) & m_mask];
+    }
+    m_consumer.head.store(head + toPop, std::memory_order_release);
+    return toPop;
+  }
+
+  // only a snapshot if the other thread is working on the ring
+  uint32_t usedElementCount() const {
+    return m_producer.tail.load(std::memory_order_acquire) -
+           m_consumer.head.load(std::memory_order_acquire);
+  }
+  bool isEmpty() const { return usedElementCount() == 0; }
+  uint32_t capacity() const { return m_capacity; }
+
+  SPSCRingBuffer(const SPSCRingBuffer &) = delete;
+  SPSCRingBuffer &operator=(const SPSCRingBuffer &) = delete;
+
+private:
+  struct alignas(ringBufferInternal::CACHE_LINE_SIZE) ProducerData {
+    std::atomic<uint32_t> tail{0};
+    uint32_t cachedHead = 0;
+  };
+  struct alignas(ringBufferInternal::CACHE_LINE_SIZE) ConsumerData {
+    std::atomic<uint32_t> head{0};
+    uint32_t cachedTail = 0;
+  };
+
+  ProducerData m_producer;
+  ConsumerData m_consumer;
+  // read only after construction, on its own line so it is never invalidated
+  // by the index updates
+  alignas(ringBufferInternal::CACHE_LINE_SIZE) T *m_buffer = nullptr;
+  const uint32_t m_capacity;
+  const uint32_t m_mask;
+};
+
+// Bounded multi producer, multi consumer. Every slot has a sequence number
+// telling which position it is ready for: a slot is free for the producer of
+// position p when its sequence is p, and holds data for the consumer of
+// position p when its sequence is p + 1. Producers and consumers claim
+// positions with a compare and swap on the enqueue/dequeue counters, then
+// publish the slot by bumping its sequence (release), so the data is only
+// ever touched by the thread owning the position.
+template <typename T>
+class MPMCRingBuffer {
+public:
+  explicit MPMCRingBuffer(const uint32_t capacity)
+      : m_capacity(ringBufferInternal::roundToPowerOfTwo(capacity)),
+        m_mask(m_capacity - 1) {
+    assert(capacity > 0);
+    assert(m_capacity <= (1u << 30));
+    m_slots = new Slot[m_capacity];
+    for (uint32_t i = 0; i < m_capacity; ++i) {
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  ~MPMCRingBuffer() { delete[] m_slots; }
+
+  bool push(const T &value) {
+    uint32_t position = m_enqueue.position.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &m_slots[position & m_mask];
+      const uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto delta = static_cast<int32_t>(sequence - position);
+      if (delta == 0) {
+        // slot is free for this position, trying to claim it
+        if (m_enqueue.position.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (delta < 0) {
+        // the slot still holds the data of the previous lap, ring is full
+        return false;
+      } else {
+        // another producer took the position
+        position = m_enqueue.position.load(std::memory_order_relaxed);
+      }
+    }
+    slot->data = value;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // pushes up to count values in consecutive positions, returns how many
+  uint32_t pushBatch(const T *values, const uint32_t count) {
+    if (count == 0) {
+      return 0;
+    }
+    uint32_t position = m_enqueue.position.load(std::memory_order_relaxed);
+    uint32_t toPush;
+    while (true) {
+      // counting how many slots from the position are free, a slot free for
+      // its position can't be taken by anyone unless they claim the position
+      // itself, which the compare and swap below would catch
+      toPush = 0;
+      while ((toPush < count) &&
+             (m_slots[(position + toPush) & m_mask].sequence.load(
+                  std::memory_order_acquire) == position + toPush)) {
+        ++toPush;
+      }
+      if (toPush == 0) {
+        const uint32_t sequence =
+            m_slots[position & m_mask].sequence.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(sequence - position) < 0) {
+          return 0;
+        }
+        position = m_enqueue.position.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (m_enqueue.position.compare_exchange_weak(
+              position, position + toPush, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (uint32_t i = 0; i < toPush; ++i) {
+      Slot &slot = m_slots[(position + i) & m_mask];
+      slot.data = values[i];
+      slot.sequence.store(position + i + 1, std::memory_order_release);
+    }
+    return toPush;
+  }
+
+  bool pop(T &value) {
+    uint32_t position = m_dequeue.position.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+      slot = &m_slots[position & m_mask];
+      const uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto delta = static_cast<int32_t>(sequence - (position + 1));
+      if (delta == 0) {
+        if (m_dequeue.position.compare_exchange_weak(
+                position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (delta < 0) {
+        // nothing has been published for this position yet, ring is empty
+        return false;
+      } else {
+        position = m_dequeue.position.load(std::memory_order_relaxed);
+      }
+    }
+    value = slot->data;
+    // freeing the slot for the producer of the next lap
+    slot->sequence.store(position + m_capacity, std::memory_order_release);
+    return true;
+  }
+
+  // pops up to count values from consecutive positions, returns how many
+  uint32_t popBatch(T *values, const uint32_t count) {
+    if (count == 0) {
+      return 0;
+    }
+    uint32_t position = m_dequeue.position.load(std::memory_order_relaxed);
+    uint32_t toPop;
+    while (true) {
+      toPop = 0;
+      while ((toPop < count) &&
+             (m_slots[(position + toPop) & m_mask].sequence.load(
+                  std::memory_order_acquire) == position + toPop + 1)) {
+        ++toPop;
+      }
+      if (toPop == 0) {
+        const uint32_t sequence =
+            m_slots[position & m_mask].sequence.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(sequence - (position + 1)) < 0) {
+          return 0;
+        }
+        position = m_dequeue.position.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (m_dequeue.position.compare_exchange_weak(
+              position, position + toPop, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (uint32_t i = 0; i < toPop; ++i) {
+      Slot &slot = m_slots[(position + i) & m_mask];
+      values[i] = slot.data;
+      slot.sequence.store(position + i + m_capacity,
+                          std::memory_order_release);
+    }
+    return toPop;
+  }
+
+  // only a snapshot if other threads are working on the ring
+  uint32_t usedElementCount() const {
+    return m_enqueue.position.load(std::memory_order_acquire) -
+           m_dequeue.position.load(std::memory_order_acquire);
+  }
+  bool isEmpty() const { return usedElementCount() == 0; }
+  uint32_t capacity() const { return m_capacity; }
+
+  MPMCRingBuffer(const MPMCRingBuffer &) = delete;
+  MPMCRingBuffer &operator=(const MPMCRingBuffer &) = delete;
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    T data;
+  };
+  struct alignas(ringBufferInternal::CACHE_LINE_SIZE) Position {
+    std::atomic<uint32_t> position{0};
+  };
+
+  Position m_enqueue;
+  Position m_dequeue;
+  alignas(ringBufferInternal::CACHE_LINE_SIZE) Slot *m_slots = nullptr;
+  const uint32_t m_capacity;
+  const uint32_t m_mask;
+};
+
+}  // namespace SirMetal
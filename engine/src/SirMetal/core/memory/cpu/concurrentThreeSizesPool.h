@@ -0,0 +1,442 @@
+#pragma once
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "SirMetal/core/memory/cpu/threeSizesPool.h"
+
+namespace SirMetal {
+
+// Thread safe version of the ThreeSizesPool.
+// Small and medium allocations are served from fixed size blocks (the bucket
+// size plus a small header) carved out of a single buffer. Every thread keeps
+// a magazine of free blocks per bucket, allocations and frees hit the magazine
+// without any synchronization. When a magazine runs empty a whole batch of
+// blocks is popped from a shared lock free stack, when it fills up the whole
+// magazine is pushed to the stack as a single batch, so the shared state is
+// touched once every MAGAZINE_SIZE operations at most. If no batch is
+// available new blocks are bumped from the buffer with an atomic add.
+// Large allocations are rare and expensive anyway, they go to a regular
+// ThreeSizesPool behind a mutex.
+// Threads get a cache slot the first time they touch any pool, up to
+// MAX_THREADS threads at the same time have one. A thread started while all
+// the slots are taken gets none for its whole life, a warning is printed the
+// first time it happens: it still works but every one of its allocations and
+// frees goes to the shared stacks, isThreadCached() tells which case the
+// calling thread is in. When a thread exits its magazines are flushed in
+// every live pool and the slot is handed to the next thread.
+class ConcurrentThreeSizesPool final {
+public:
+  static constexpr uint32_t MAX_THREADS = 64;
+  static constexpr uint32_t MAGAZINE_SIZE = 32;
+
+  // mirrors ThreeSizesPool::AllocHeader, kept at 8 bytes so blocks are 8 byte
+  // aligned
+  struct AllocHeader {
+    uint32_t size;       // size in byte of the user allocation
+    uint8_t allocFlags;  // user defined flags for the allocation
+    uint8_t bucket;      // SMALL or MEDIUM
+    uint16_t padding;
+  };
+
+  ConcurrentThreeSizesPool(const uint32_t poolSizeInByte,
+                           const uint32_t largePoolSizeInByte,
+                           const uint32_t smallSize = 64,
+                           const uint32_t mediumSize = 256)
+      : m_largePool(largePoolSizeInByte) {
+    // the free block needs to fit in the smallest block for the batch links
+    assert(smallSize >= sizeof(FreeBlock));
+    assert(mediumSize > smallSize);
+    m_poolSizeInByte = poolSizeInByte;
+    m_memory = new char[m_poolSizeInByte];
+    m_blockSize[SMALL] = alignBlockSize(smallSize + sizeof(AllocHeader));
+    m_blockSize[MEDIUM] = alignBlockSize(mediumSize + sizeof(AllocHeader));
+    m_bucketSize[SMALL] = smallSize;
+    m_bucketSize[MEDIUM] = mediumSize;
+    m_sharedBatches[SMALL].store(0);
+    m_sharedBatches[MEDIUM].store(0);
+    // blocks are at least a small block apart, so the offset divided by its
+    // size is unique per block
+    m_batchLinks =
+        new std::atomic<uint32_t>[m_poolSizeInByte / m_blockSize[SMALL] + 1]();
+
+    std::lock_guard<std::mutex> lock(getRegistryLock());
+    getLivePools().push_back(this);
+  }
+
+  ~ConcurrentThreeSizesPool() {
+    {
+      std::lock_guard<std::mutex> lock(getRegistryLock());
+      std::vector<ConcurrentThreeSizesPool *> &pools = getLivePools();
+      for (size_t i = 0; i < pools.size(); ++i) {
+        if (pools[i] == this) {
+          pools[i] = pools.back();
+          pools.pop_back();
+          break;
+        }
+      }
+    }
+    delete[] m_memory;
+    delete[] m_batchLinks;
+  }
+
+  void *allocate(const uint32_t sizeInByte, uint8_t flags = 0) {
+    if (sizeInByte >= m_bucketSize[MEDIUM]) {
+      std::lock_guard<std::mutex> lock(m_largeLock);
+      return m_largePool.allocate(sizeInByte, flags);
+    }
+    const uint32_t bucket = sizeInByte < m_bucketSize[SMALL] ? SMALL : MEDIUM;
+
+    char *block = nullptr;
+    ThreadCache *cache = getThreadCache();
+    if (cache != nullptr) {
+      Magazine &magazine = cache->magazines[bucket];
+      if (magazine.count == 0) {
+        refillMagazine(magazine, bucket);
+      }
+      block = magazine.count != 0 ? magazine.blocks[--magazine.count]
+                                  : allocateNew(bucket);
+      updateAllocCount(*cache, bucket, 1);
+    } else {
+      block = popSingle(bucket);
+      block = block != nullptr ? block : allocateNew(bucket);
+      m_uncachedAllocCount[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+    if (block == nullptr) {
+      return nullptr;
+    }
+
+    auto *header = reinterpret_cast<AllocHeader *>(block);
+    header->size = sizeInByte;
+    header->allocFlags = flags;
+    header->bucket = static_cast<uint8_t>(bucket);
+    header->padding = 0;
+    return block + sizeof(AllocHeader);
+  }
+
+  void free(void *memoryPtr) {
+    char *bytePtr = reinterpret_cast<char *>(memoryPtr);
+    if (!allocationInPool(bytePtr)) {
+      std::lock_guard<std::mutex> lock(m_largeLock);
+      m_largePool.free(memoryPtr);
+      return;
+    }
+
+    char *block = bytePtr - sizeof(AllocHeader);
+    const uint32_t bucket = reinterpret_cast<AllocHeader *>(block)->bucket;
+    assert(bucket < BUCKET_COUNT);
+
+    ThreadCache *cache = getThreadCache();
+    if (cache != nullptr) {
+      Magazine &magazine = cache->magazines[bucket];
+      if (magazine.count == MAGAZINE_SIZE) {
+        pushBatch(magazine.blocks, magazine.count, bucket);
+        magazine.count = 0;
+      }
+      magazine.blocks[magazine.count++] = block;
+      updateAllocCount(*cache, bucket, -1);
+    } else {
+      pushBatch(&block, 1, bucket);
+      m_uncachedAllocCount[bucket].fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  // returns the blocks cached by the calling thread to the shared stacks,
+  // happens automatically on thread exit
+  void flushThreadCache() {
+    ThreadCache *cache = getThreadCache();
+    if (cache != nullptr) {
+      flushCache(*cache);
+    }
+  }
+
+  // helpers
+  int allocationInPool(const void *ptr) const {
+    const int64_t delta = reinterpret_cast<const char *>(ptr) - m_memory;
+    return (delta > 0) & (delta < m_poolSizeInByte);
+  }
+
+  // getters
+
+  // returns the size of the "user" allocation ,meaning without the AllocHeader
+  uint32_t getAllocSize(void *memoryPtr) {
+    char *bytePtr = reinterpret_cast<char *>(memoryPtr);
+    if (!allocationInPool(bytePtr)) {
+      std::lock_guard<std::mutex> lock(m_largeLock);
+      return m_largePool.getAllocSize(memoryPtr);
+    }
+    return reinterpret_cast<AllocHeader *>(bytePtr - sizeof(AllocHeader))
+        ->size;
+  }
+
+  // counts are summed over all the threads and are only exact when no other
+  // thread is allocating
+  uint32_t getSmallAllocCount() const { return getAllocCount(SMALL); }
+  uint32_t getMediumAllocCount() const { return getAllocCount(MEDIUM); }
+  uint32_t getLargeAllocCount() {
+    std::lock_guard<std::mutex> lock(m_largeLock);
+    return m_largePool.getSmallAllocCount() +
+           m_largePool.getMediumAllocCount() +
+           m_largePool.getLargeAllocCount();
+  }
+  // whether the calling thread got a cache slot, see MAX_THREADS
+  static bool isThreadCached() { return getThreadIndex() < MAX_THREADS; }
+
+  // bytes bumped from the buffer so far, blocks are recycled before bumping
+  uint32_t getUsedBytes() const {
+    return m_stackPointerOffset.load(std::memory_order_relaxed);
+  }
+
+  // deleted copy constructors and assignment operator
+  ConcurrentThreeSizesPool(const ConcurrentThreeSizesPool &) = delete;
+  ConcurrentThreeSizesPool &
+  operator=(const ConcurrentThreeSizesPool &) = delete;
+
+private:
+  enum BUCKET { SMALL = 0, MEDIUM = 1, BUCKET_COUNT = 2 };
+
+  // written in the memory of a freed block, blocks in a batch are chained
+  // with nextInBatch. Links are offsets from the start of the pool + 1, so
+  // that 0 can be used as null.
+  // The link from the first block of a batch to the next batch in the shared
+  // stack is not in here but in m_batchLinks: a pop can read it while another
+  // thread already popped the same batch and handed the block to a user
+  struct FreeBlock {
+    uint32_t nextInBatch;
+    uint32_t batchCount;
+  };
+
+  struct Magazine {
+    char *blocks[MAGAZINE_SIZE];
+    uint32_t count = 0;
+  };
+
+  // aligned to avoid false sharing between threads
+  struct alignas(64) ThreadCache {
+    Magazine magazines[BUCKET_COUNT];
+    // only written by the owning thread, atomic so the getters can read it
+    std::atomic<int32_t> allocCount[BUCKET_COUNT]{};
+  };
+
+  static uint32_t alignBlockSize(const uint32_t size) {
+    return (size + 7u) & ~7u;
+  }
+
+  // the cache slot of a thread, shared by all the pools, acquired on first
+  // use and released when the thread exits
+  struct ThreadSlot {
+    uint32_t index = MAX_THREADS;
+    ThreadSlot() {
+      std::lock_guard<std::mutex> lock(getRegistryLock());
+      uint64_t &usedSlots = getUsedSlots();
+      for (uint32_t i = 0; i < MAX_THREADS; ++i) {
+        if ((usedSlots & (1ull << i)) == 0) {
+          usedSlots |= 1ull << i;
+          index = i;
+          break;
+        }
+      }
+      static bool warned = false;
+      if ((index == MAX_THREADS) & !warned) {
+        warned = true;
+        printf("[WARN] More than %u threads using concurrent pools, the "
+               "others run without a thread cache\n",
+               MAX_THREADS);
+      }
+    }
+    ~ThreadSlot() {
+      if (index == MAX_THREADS) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(getRegistryLock());
+      for (ConcurrentThreeSizesPool *pool : getLivePools()) {
+        pool->flushCache(pool->m_caches[index]);
+      }
+      getUsedSlots() &= ~(1ull << index);
+    }
+  };
+  static_assert(MAX_THREADS <= 64, "slots are tracked with a 64 bit mask");
+
+  static std::mutex &getRegistryLock() {
+    static std::mutex lock;
+    return lock;
+  }
+  static std::vector<ConcurrentThreeSizesPool *> &getLivePools() {
+    static std::vector<ConcurrentThreeSizesPool *> pools;
+    return pools;
+  }
+  static uint64_t &getUsedSlots() {
+    static uint64_t usedSlots = 0;
+    return usedSlots;
+  }
+
+  static uint32_t getThreadIndex() {
+    thread_local ThreadSlot slot;
+    return slot.index;
+  }
+
+  void flushCache(ThreadCache &cache) {
+    for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+      Magazine &magazine = cache.magazines[bucket];
+      if (magazine.count != 0) {
+        pushBatch(magazine.blocks, magazine.count, bucket);
+        magazine.count = 0;
+      }
+    }
+  }
+
+  ThreadCache *getThreadCache() {
+    const uint32_t idx = getThreadIndex();
+    return idx < MAX_THREADS ? &m_caches[idx] : nullptr;
+  }
+
+  // single writer, no need for an atomic add
+  static inline void updateAllocCount(ThreadCache &cache, const uint32_t bucket,
+                                      const int32_t delta) {
+    const int32_t count =
+        cache.allocCount[bucket].load(std::memory_order_relaxed);
+    cache.allocCount[bucket].store(count + delta, std::memory_order_relaxed);
+  }
+
+  uint32_t getAllocCount(const uint32_t bucket) const {
+    int64_t count =
+        m_uncachedAllocCount[bucket].load(std::memory_order_relaxed);
+    for (const ThreadCache &cache : m_caches) {
+      count += cache.allocCount[bucket].load(std::memory_order_relaxed);
+    }
+    return static_cast<uint32_t>(count);
+  }
+
+  inline uint32_t toLink(const char *block) const {
+    return static_cast<uint32_t>(block - m_memory) + 1;
+  }
+  inline char *fromLink(const uint32_t link) const {
+    return m_memory + (link - 1);
+  }
+  inline std::atomic<uint32_t> &getBatchLink(const uint32_t link) const {
+    return m_batchLinks[(link - 1) / m_blockSize[SMALL]];
+  }
+
+  // the head of the shared stack is a 32 bit link plus a 32 bit tag that is
+  // bumped on every change, to avoid the ABA problem on pop
+  static inline uint32_t headLink(const uint64_t head) {
+    return static_cast<uint32_t>(head & 0xFFFFFFFF);
+  }
+  static inline uint64_t makeHead(const uint64_t oldHead,
+                                  const uint32_t link) {
+    const uint64_t tag = (oldHead >> 32) + 1;
+    return (tag << 32) | link;
+  }
+
+  char *allocateNew(const uint32_t bucket) {
+    const uint32_t size = m_blockSize[bucket];
+    // compare and swap instead of an add, a bump that does not fit leaves the
+    // offset alone, the tail can still take a smaller block
+    uint32_t offset = m_stackPointerOffset.load(std::memory_order_relaxed);
+    do {
+      if (static_cast<uint64_t>(offset) + size > m_poolSizeInByte) {
+        assert(0 && "concurrent pool out of memory");
+        return nullptr;
+      }
+    } while (!m_stackPointerOffset.compare_exchange_weak(
+        offset, offset + size, std::memory_order_relaxed));
+    return m_memory + offset;
+  }
+
+  void pushBatch(char **blocks, const uint32_t count, const uint32_t bucket) {
+    assert(count > 0);
+    // chaining the blocks
+    for (uint32_t i = 0; i < count; ++i) {
+      auto *node = reinterpret_cast<FreeBlock *>(blocks[i]);
+      node->nextInBatch = i + 1 < count ? toLink(blocks[i + 1]) : 0;
+    }
+    auto *first = reinterpret_cast<FreeBlock *>(blocks[0]);
+    first->batchCount = count;
+    const uint32_t link = toLink(blocks[0]);
+
+    std::atomic<uint32_t> &nextBatch = getBatchLink(link);
+    std::atomic<uint64_t> &stack = m_sharedBatches[bucket];
+    uint64_t head = stack.load(std::memory_order_relaxed);
+    do {
+      nextBatch.store(headLink(head), std::memory_order_relaxed);
+    } while (!stack.compare_exchange_weak(head, makeHead(head, link),
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  FreeBlock *popBatch(const uint32_t bucket) {
+    std::atomic<uint64_t> &stack = m_sharedBatches[bucket];
+    uint64_t head = stack.load(std::memory_order_acquire);
+    while (headLink(head) != 0) {
+      const uint32_t link = headLink(head);
+      // the batch might have been popped and pushed again by another thread
+      // in the meantime, in that case this value is stale but the tag makes
+      // the exchange fail
+      const uint32_t next =
+          getBatchLink(link).load(std::memory_order_relaxed);
+      if (stack.compare_exchange_weak(head, makeHead(head, next),
+                                      std::memory_order_acquire,
+                                      std::memory_order_acquire)) {
+        return reinterpret_cast<FreeBlock *>(fromLink(link));
+      }
+    }
+    return nullptr;
+  }
+
+  void refillMagazine(Magazine &magazine, const uint32_t bucket) {
+    FreeBlock *batch = popBatch(bucket);
+    if (batch == nullptr) {
+      return;
+    }
+    refillMagazineFromBatch(magazine, batch);
+  }
+
+  // used by threads without a cache, takes one block from a batch and pushes
+  // the rest back
+  char *popSingle(const uint32_t bucket) {
+    FreeBlock *batch = popBatch(bucket);
+    if (batch == nullptr) {
+      return nullptr;
+    }
+    Magazine rest;
+    refillMagazineFromBatch(rest, batch);
+    char *block = rest.blocks[--rest.count];
+    if (rest.count != 0) {
+      pushBatch(rest.blocks, rest.count, bucket);
+    }
+    return block;
+  }
+
+  void refillMagazineFromBatch(Magazine &magazine, FreeBlock *batch) {
+    assert(batch->batchCount + magazine.count <= MAGAZINE_SIZE);
+    auto *current = reinterpret_cast<char *>(batch);
+    while (current != nullptr) {
+      magazine.blocks[magazine.count++] = current;
+      const uint32_t next =
+          reinterpret_cast<FreeBlock *>(current)->nextInBatch;
+      current = next != 0 ? fromLink(next) : nullptr;
+    }
+  }
+
+private:
+  char *m_memory = nullptr;
+  uint32_t m_poolSizeInByte;
+  uint32_t m_blockSize[BUCKET_COUNT];
+  uint32_t m_bucketSize[BUCKET_COUNT];
+  std::atomic<uint32_t> m_stackPointerOffset{0};
+  std::atomic<uint64_t> m_sharedBatches[BUCKET_COUNT];
+  // next batch link of the first block of every batch, indexed by block
+  std::atomic<uint32_t> *m_batchLinks = nullptr;
+  std::atomic<int32_t> m_uncachedAllocCount[BUCKET_COUNT]{};
+  ThreadCache m_caches[MAX_THREADS];
+
+  std::mutex m_largeLock;
+  ThreeSizesPool m_largePool;
+};
+
+} // namespace SirMetal
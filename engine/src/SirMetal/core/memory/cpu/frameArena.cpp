@@ -0,0 +1,64 @@
+#include "SirMetal/core/memory/cpu/frameArena.h"
+
+#include <mutex>
+#include <vector>
+
+namespace SirMetal {
+
+namespace {
+// every thread arena, so that they can be reset together at frame end
+std::mutex &getRegistryMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+std::vector<FrameArena *> &getRegistry() {
+  static std::vector<FrameArena *> registry;
+  return registry;
+}
+
+struct ThreadScratch {
+  FrameArena *arena = nullptr;
+
+  ~ThreadScratch() {
+    if (arena == nullptr) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(getRegistryMutex());
+      std::vector<FrameArena *> &registry = getRegistry();
+      for (size_t i = 0; i < registry.size(); ++i) {
+        if (registry[i] == arena) {
+          registry[i] = registry.back();
+          registry.pop_back();
+          break;
+        }
+      }
+    }
+    delete arena;
+  }
+};
+thread_local ThreadScratch t_scratch;
+}  // namespace
+
+FrameArena &getThreadScratchArena() {
+  if (t_scratch.arena == nullptr) {
+    t_scratch.arena = new FrameArena();
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    getRegistry().push_back(t_scratch.arena);
+  }
+  return *t_scratch.arena;
+}
+
+void resetFrameArenas() {
+  std::lock_guard<std::mutex> lock(getRegistryMutex());
+  for (FrameArena *arena : getRegistry()) {
+    arena->reset();
+  }
+}
+
+uint32_t getFrameArenasCount() {
+  std::lock_guard<std::mutex> lock(getRegistryMutex());
+  return static_cast<uint32_t>(getRegistry().size());
+}
+
+}  // namespace SirMetal
@@ -0,0 +1,148 @@
+#pragma once
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "SirMetal/core/memory/cpu/virtualMemoryArena.h"
+
+namespace SirMetal {
+
+// Scratch memory for data that does not outlive the frame, like the
+// temporary buffers of a mesh being loaded. Allocating is moving a pointer
+// and nothing is ever freed one by one: a FrameArenaScope gives back
+// everything allocated while it was alive, and all the arenas are reset at
+// the end of the frame.
+// An arena is not thread safe, every thread gets its own with
+// getThreadScratchArena().
+// Once the reserved range is used up allocations come from the heap instead,
+// they are freed with the rest when the arena is rewound or reset, only the
+// reserved part can grow in place.
+class FrameArena final {
+ public:
+  // only address space, pages are committed as they get used
+  static constexpr size_t DEFAULT_RESERVE = 1ull << 30;
+  static constexpr uint32_t DEFAULT_ALIGNMENT = 16;
+
+  // a point in the arena that can be rewound to
+  struct Marker {
+    size_t usedBytes;
+    size_t overflowCount;
+  };
+
+  explicit FrameArena(const size_t reserveInByte = DEFAULT_RESERVE)
+      : m_arena(reserveInByte) {}
+  ~FrameArena() { freeOverflow(0); }
+
+  // alignment needs to be a power of two
+  void *allocate(const size_t sizeInByte,
+                 const uint32_t alignment = DEFAULT_ALIGNMENT) {
+    // worst case for the padding, to never hit the exhausted arena
+    if (m_arena.getUsedBytes() + alignment + sizeInByte >
+        m_arena.getReservedBytes()) {
+      void *ptr = ::operator new[](sizeInByte, std::align_val_t{alignment});
+      m_overflow.push_back({ptr, alignment});
+      return ptr;
+    }
+    void *ptr = m_arena.allocate(sizeInByte, alignment);
+    const size_t used = m_arena.getUsedBytes();
+    m_peakUsedBytes = used > m_peakUsedBytes ? used : m_peakUsedBytes;
+    return ptr;
+  }
+
+  // memory is not initialized and no destructor is ever called, so only
+  // for types that don't need one
+  template <typename T>
+  T *allocArray(const size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "frame arena memory is never destructed");
+    constexpr uint32_t alignment = alignof(T) > DEFAULT_ALIGNMENT
+                                       ? static_cast<uint32_t>(alignof(T))
+                                       : DEFAULT_ALIGNMENT;
+    return static_cast<T *>(allocate(sizeof(T) * count, alignment));
+  }
+
+  // this is what lets the arena back a ResizableVector, the last allocation
+  // grows where it is, and can be freed
+  bool growInPlace(void *ptr, const size_t newSizeInByte) {
+    if (!m_arena.growInPlace(ptr, newSizeInByte)) {
+      return false;
+    }
+    const size_t used = m_arena.getUsedBytes();
+    m_peakUsedBytes = used > m_peakUsedBytes ? used : m_peakUsedBytes;
+    return true;
+  }
+  void free(void *ptr) { m_arena.free(ptr); }
+
+  Marker getMarker() const {
+    return Marker{m_arena.getUsedBytes(), m_overflow.size()};
+  }
+  void rewind(const Marker marker) {
+    m_arena.rewind(marker.usedBytes);
+    freeOverflow(marker.overflowCount);
+  }
+  void reset() {
+    m_arena.reset();
+    freeOverflow(0);
+  }
+  // gives the committed pages back to the os, they are committed again as
+  // soon as they are needed
+  void trim() { m_arena.trim(); }
+
+  size_t getUsedBytes() const { return m_arena.getUsedBytes(); }
+  size_t getCommittedBytes() const { return m_arena.getCommittedBytes(); }
+  // highest usage since the arena was created, useful to size things
+  size_t getPeakUsedBytes() const { return m_peakUsedBytes; }
+  // live allocations that did not fit in the reserved range
+  size_t getOverflowCount() const { return m_overflow.size(); }
+
+  FrameArena(FrameArena const &) = delete;
+  FrameArena &operator=(FrameArena const &) = delete;
+
+ private:
+  struct OverflowAllocation {
+    void *ptr;
+    uint32_t alignment;
+  };
+
+  void freeOverflow(const size_t keepCount) {
+    for (size_t i = keepCount; i < m_overflow.size(); ++i) {
+      ::operator delete[](m_overflow[i].ptr,
+                          std::align_val_t{m_overflow[i].alignment});
+    }
+    m_overflow.resize(keepCount < m_overflow.size() ? keepCount
+                                                    : m_overflow.size());
+  }
+
+ private:
+  VirtualMemoryArena m_arena;
+  std::vector<OverflowAllocation> m_overflow;
+  size_t m_peakUsedBytes = 0;
+};
+
+// rewinds the arena to where it was when the scope was opened
+class FrameArenaScope final {
+ public:
+  explicit FrameArenaScope(FrameArena &arena)
+      : m_arena(arena), m_marker(arena.getMarker()) {}
+  ~FrameArenaScope() { m_arena.rewind(m_marker); }
+
+  FrameArenaScope(FrameArenaScope const &) = delete;
+  FrameArenaScope &operator=(FrameArenaScope const &) = delete;
+
+ private:
+  FrameArena &m_arena;
+  FrameArena::Marker m_marker;
+};
+
+// scratch arena of the calling thread, created the first time a thread asks
+// for it and destroyed when the thread exits
+FrameArena &getThreadScratchArena();
+// resets the scratch arena of every thread, to be called at the end of the
+// frame, when no thread is using its scratch memory anymore
+void resetFrameArenas();
+uint32_t getFrameArenasCount();
+
+}  // namespace SirMetal
@@ -0,0 +1,243 @@
+#pragma once
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "SirMetal/core/memory/cpu/hashMap.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace SirMetal {
+
+// Group probing version of the hash map. Instead of 2 bits of metadata per bin
+// we keep one control byte per bin: if the high bit is set the bin is either
+// free or deleted, otherwise the lower 7 bits hold a fragment of the hash of
+// the key stored in the bin. Bins are probed in groups of 16, the control
+// bytes of a whole group get compared against the fragment in a single SIMD
+// instruction, so we only touch the keys for bins that have a good chance of
+// matching. Groups are probed with a triangular sequence, which visits every
+// group once as long as the group count is a power of two, that is why the
+// requested bin count gets rounded up to a power of two (minimum 16), this also
+// allows us to mask rather than mod.
+template <typename KEY, typename VALUE, uint32_t (*HASH)(const KEY &)>
+class HashMap<KEY, VALUE, HASH, HASH_MAP_PROBING::GROUP> {
+public:
+  explicit HashMap(const uint32_t bins) : m_bins(computeBinCount(bins)) {
+    m_groupMask = (m_bins / GROUP_SIZE) - 1;
+    m_keys = new KEY[m_bins];
+    m_values = new VALUE[m_bins];
+    m_control = new uint8_t[m_bins];
+    memset(m_control, CONTROL_FREE, m_bins * sizeof(uint8_t));
+    memset(m_keys, 0, m_bins * sizeof(KEY));
+    memset(m_values, 0, m_bins * sizeof(VALUE));
+  }
+
+  ~HashMap() {
+    delete[] m_keys;
+    delete[] m_values;
+    delete[] m_control;
+  }
+
+  bool insert(KEY key, VALUE value) {
+    const uint32_t computedHash = HASH(key);
+    uint32_t bin = 0;
+    if (getBin(key, computedHash, bin)) {
+      // key exists we just override the value
+      m_values[bin] = value;
+      return true;
+    }
+
+    // first bin either free or deleted in the probing sequence is the one we
+    // are going to use
+    uint32_t group = getStartGroup(computedHash);
+    for (uint32_t probe = 0; probe <= m_groupMask; ++probe) {
+      const uint32_t groupStart = group * GROUP_SIZE;
+      const uint32_t writableMask = matchWritable(m_control + groupStart);
+      if (writableMask != 0) {
+        bin = groupStart + firstSetBit(writableMask);
+        m_keys[bin] = key;
+        m_values[bin] = value;
+        m_control[bin] = getHashFragment(computedHash);
+        ++m_usedBins;
+        return true;
+      }
+      group = (group + probe + 1) & m_groupMask;
+    }
+    // every group is full
+    return false;
+  }
+
+  [[nodiscard]] bool containsKey(const KEY key) const {
+    uint32_t bin = 0;
+    return getBin(key, HASH(key), bin);
+  }
+
+  inline bool get(KEY key, VALUE &value) const {
+    uint32_t bin = 0;
+    const bool result = getBin(key, HASH(key), bin);
+    if (result) {
+      value = m_values[bin];
+    }
+    return result;
+  }
+
+  inline bool remove(KEY key) {
+    uint32_t bin = 0;
+    const bool result = getBin(key, HASH(key), bin);
+    if (result) {
+      // if the group still has a free bin, no insert ever probed past this
+      // group (free bins are never created, only consumed), meaning we can
+      // mark the bin free straight away instead of leaving a tombstone
+      const uint32_t groupStart = bin & ~(GROUP_SIZE - 1);
+      const bool groupHasFree = matchByte(m_control + groupStart, CONTROL_FREE);
+      m_control[bin] = groupHasFree ? CONTROL_FREE : CONTROL_DELETED;
+      --m_usedBins;
+    }
+    return result;
+  }
+
+  [[nodiscard]] uint32_t getUsedBins() const { return m_usedBins; }
+  inline uint32_t binCount() const { return m_bins; }
+  inline bool isBinUsed(const uint32_t bin) const {
+    assert(bin < m_bins);
+    return (m_control[bin] & CONTROL_EMPTY_BIT) == 0;
+  }
+
+  KEY getKeyAtBin(uint32_t bin) {
+    // no check done whether the bin is used or not, up to you kid
+    assert(bin < m_bins);
+    return m_keys[bin];
+  }
+  VALUE getValueAtBin(uint32_t bin) {
+    // no check done whether the bin is used or not, up to you kid
+    assert(bin < m_bins);
+    return m_values[bin];
+  }
+
+  // deleted functions
+  HashMap(const HashMap &) = delete;
+  HashMap &operator=(const HashMap &) = delete;
+
+  KEY *getKeys() { return m_keys; }
+
+private:
+  static uint32_t computeBinCount(const uint32_t bins) {
+    uint32_t count = GROUP_SIZE;
+    while (count < bins) {
+      count <<= 1;
+    }
+    return count;
+  }
+
+  // the lower 7 bits go in the control byte, the rest picks the group, this
+  // way the two are as independent as the hash function allows
+  static inline uint8_t getHashFragment(const uint32_t hash) {
+    return static_cast<uint8_t>(hash & 0x7F);
+  }
+  inline uint32_t getStartGroup(const uint32_t hash) const {
+    return (hash >> 7) & m_groupMask;
+  }
+
+  static inline uint32_t firstSetBit(const uint32_t mask) {
+    return static_cast<uint32_t>(__builtin_ctz(mask));
+  }
+
+  // returns a 16 bit mask with a bit set for every control byte in the group
+  // equal to the requested value
+  static inline uint32_t matchByte(const uint8_t *group, const uint8_t value) {
+#if defined(__SSE2__)
+    const __m128i control =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    const __m128i match =
+        _mm_cmpeq_epi8(control, _mm_set1_epi8(static_cast<char>(value)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(match));
+#elif defined(__ARM_NEON)
+    const uint8x16_t match = vceqq_u8(vld1q_u8(group), vdupq_n_u8(value));
+    return neonMoveMask(match);
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < GROUP_SIZE; ++i) {
+      mask |= static_cast<uint32_t>(group[i] == value) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // returns a 16 bit mask with a bit set for every bin in the group that is
+  // either free or deleted, both have the high bit set
+  static inline uint32_t matchWritable(const uint8_t *group) {
+#if defined(__SSE2__)
+    const __m128i control =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(control));
+#elif defined(__ARM_NEON)
+    const uint8x16_t match = vtstq_u8(vld1q_u8(group),
+                                      vdupq_n_u8(CONTROL_EMPTY_BIT));
+    return neonMoveMask(match);
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < GROUP_SIZE; ++i) {
+      mask |= static_cast<uint32_t>((group[i] & CONTROL_EMPTY_BIT) != 0) << i;
+    }
+    return mask;
+#endif
+  }
+
+#if !defined(__SSE2__) && defined(__ARM_NEON)
+  // neon has no movemask, we keep a different bit per lane and add
+  // horizontally each half of the register
+  static inline uint32_t neonMoveMask(const uint8x16_t match) {
+    static const uint8_t LANE_BITS[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                          1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t bits = vandq_u8(match, vld1q_u8(LANE_BITS));
+    const uint32_t low = vaddv_u8(vget_low_u8(bits));
+    const uint32_t high = vaddv_u8(vget_high_u8(bits));
+    return low | (high << 8);
+  }
+#endif
+
+  bool getBin(const KEY key, const uint32_t computedHash,
+              uint32_t &bin) const {
+    const uint8_t fragment = getHashFragment(computedHash);
+    uint32_t group = getStartGroup(computedHash);
+    for (uint32_t probe = 0; probe <= m_groupMask; ++probe) {
+      const uint32_t groupStart = group * GROUP_SIZE;
+      uint32_t candidates = matchByte(m_control + groupStart, fragment);
+      while (candidates != 0) {
+        const uint32_t candidate = groupStart + firstSetBit(candidates);
+        if (m_keys[candidate] == key) {
+          bin = candidate;
+          return true;
+        }
+        // clearing lowest bit set
+        candidates &= candidates - 1;
+      }
+      // a free bin in the group means the probing sequence of the key never
+      // went further than this
+      if (matchByte(m_control + groupStart, CONTROL_FREE) != 0) {
+        return false;
+      }
+      group = (group + probe + 1) & m_groupMask;
+    }
+    return false;
+  }
+
+private:
+  static constexpr uint32_t GROUP_SIZE = 16;
+  static constexpr uint8_t CONTROL_EMPTY_BIT = 0x80;
+  static constexpr uint8_t CONTROL_FREE = 0x80;
+  static constexpr uint8_t CONTROL_DELETED = 0xFE;
+
+  KEY *m_keys;
+  VALUE *m_values;
+  uint8_t *m_control;
+  uint32_t m_bins;
+  uint32_t m_groupMask;
+  uint32_t m_usedBins = 0;
+};
+
+} // namespace SirMetal
@@ -5,175 +5,445 @@
 
 namespace SirMetal {
 
-template <typename KEY, typename VALUE, uint32_t (*HASH)(const KEY &)>
+// probing strategy of the hash map, LINEAR is the implementation in this file,
+// GROUP probes 16 bins at the time using SIMD and lives in groupHashMap.h
+enum class HASH_MAP_PROBING { LINEAR = 0, GROUP = 1 };
+
+// what the hash map does once the bins used plus the deleted ones go over the
+// max load factor:
+// NONE: nothing, insert fails once every bin is taken
+// REHASH: the whole table is rebuilt in one go, doubling the size if needed,
+// deleted bins are dropped in the process
+// INCREMENTAL: same as REHASH but the old table is kept around and migrated a
+// few bins at the time on every insert, so no single insert pays for the
+// whole rehash
+enum class HASH_MAP_GROWTH { NONE = 0, REHASH = 1, INCREMENTAL = 2 };
+
+template <typename KEY, typename VALUE, uint32_t (*HASH)(const KEY &),
+          HASH_MAP_PROBING PROBING = HASH_MAP_PROBING::LINEAR>
 class HashMap {
 public:
+  static constexpr float DEFAULT_MAX_LOAD_FACTOR = 0.75f;
+  // how many bins of the old table get migrated on each insert, the new
+  // table is at least as big as the old one, so migration is guaranteed to
+  // be done before the new table needs to grow again
+  static constexpr uint32_t MIGRATION_BINS_PER_INSERT = 64;
+
   // TODO add use of engine allocator, not only heap allocations
-  explicit HashMap(const uint32_t bins) : m_bins(bins) {
-    m_keys = new KEY[m_bins];
-    m_values = new VALUE[m_bins];
-    const int count = ((m_bins * BIN_FLAGS_SIZE) / (8 * sizeof(uint32_t))) + 1;
-    m_metadata = new uint32_t[count];
-    // 85 is 01010101 in binary this means we fill 4 bins with the value of 1,
-    // meaning free
-    memset(m_metadata, 85, count * sizeof(uint32_t));
-    memset(m_keys, 0, m_bins * sizeof(KEY));
-    memset(m_values, 0, m_bins * sizeof(VALUE));
+  explicit HashMap(const uint32_t bins,
+                   const HASH_MAP_GROWTH growth = HASH_MAP_GROWTH::REHASH)
+      : m_growth(growth) {
+    assert(bins > 0);
+    allocateTable(m_table, bins);
   }
 
   ~HashMap() {
-    delete[] m_keys;
-    delete[] m_values;
-    delete[] m_metadata;
+    freeTable(m_table);
+    freeTable(m_oldTable);
   }
   bool insert(KEY key, VALUE value) {
+    return insertHashed(key, value, HASH(key));
+  }
+
+  [[nodiscard]] bool containsKey(const KEY key) const {
     const uint32_t computedHash = HASH(key);
+    uint32_t bin = 0;
+    return getBin(m_table, key, computedHash, bin) |
+           getBin(m_oldTable, key, computedHash, bin);
+  }
 
-    // modding wit the bin count
-    uint32_t bin = computedHash % m_bins;
+  inline bool get(KEY key, VALUE &value) const {
+    return getHashed(key, value, HASH(key));
+  }
 
-    uint32_t meta = getMetadata(bin);
-    if ((m_keys[bin] == key) &
-        (meta == static_cast<uint32_t>(BIN_FLAGS::USED))) {
-      // key exists we just override the value
-      m_values[bin] = value;
-      return true;
+  // batched version of get, keys are processed in blocks of BATCH_SIZE, for
+  // each block all the hashes are computed and the bins prefetched before
+  // doing any of the lookups, this way the cache misses of the different
+  // keys overlap instead of being paid one after the other
+  void getBatch(const KEY *keys, VALUE *out, bool *found,
+                const size_t n) const {
+    uint32_t hashes[BATCH_SIZE];
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+      const size_t count = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
+      for (size_t i = 0; i < count; ++i) {
+        hashes[i] = HASH(keys[start + i]);
+        prefetchBin(m_table, hashes[i]);
+      }
+      for (size_t i = 0; i < count; ++i) {
+        found[start + i] =
+            getHashed(keys[start + i], out[start + i], hashes[i]);
+      }
     }
+  }
 
-    const uint32_t startBin = bin;
-    bool free = canWriteToBin(meta);
-    while (!free) {
-      ++bin;
-      bin = bin % m_bins; // wrap around the bins count
-      meta = getMetadata(bin);
-      free = canWriteToBin(meta);
-      if (bin == startBin) {
-        return false;
+  // batched version of insert, same idea as getBatch, returns false if any of
+  // the inserts failed
+  bool insertBatch(const KEY *keys, const VALUE *values, const size_t n) {
+    uint32_t hashes[BATCH_SIZE];
+    bool result = true;
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+      const size_t count = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
+      for (size_t i = 0; i < count; ++i) {
+        hashes[i] = HASH(keys[start + i]);
+        prefetchBin(m_table, hashes[i]);
+      }
+      // an insert might trigger a rehash, in that case the prefetches are
+      // wasted but the hashes are still valid
+      for (size_t i = 0; i < count; ++i) {
+        result &= insertHashed(keys[start + i], values[start + i], hashes[i]);
       }
     }
-    // internalize the key
-    writeToBin(bin, key, value);
-    setMetadata(bin, BIN_FLAGS::USED);
-
-    return true;
+    return result;
   }
 
-  [[nodiscard]] bool containsKey(const KEY key) const {
-
+  inline bool remove(KEY key) {
+    const uint32_t computedHash = HASH(key);
     uint32_t bin = 0;
-    bool isKeyFound = getBin(key, bin);
-    const uint32_t meta = getMetadata(bin);
-    return isKeyFound & (m_keys[bin] == key) // does the key match?
-           &
-           (meta == static_cast<uint32_t>(
-                        BIN_FLAGS::USED)); // is the bin actually used, we dont
-                                           // delete anything so if they key is
-                                           // deleted key value might still
-                                           // match but metadata is set to free
+    if (getBin(m_table, key, computedHash, bin)) {
+      removeFromBin(m_table, bin);
+      return true;
+    }
+    if (getBin(m_oldTable, key, computedHash, bin)) {
+      removeFromBin(m_oldTable, bin);
+      return true;
+    }
+    return false;
   }
 
-  inline bool get(KEY key, VALUE &value) const {
-    uint32_t bin = 0;
-    const bool result = getBin(key, bin);
-    value = m_values[bin];
-    return result;
+  // rebuilds the table with the given amount of bins dropping all the
+  // deleted bins, any pending incremental migration is completed first
+  void rehash(const uint32_t newBins) {
+    finishMigration();
+    assert(newBins >= m_table.usedBins);
+    Table oldTable = m_table;
+    allocateTable(m_table, newBins);
+    for (uint32_t i = 0; i < oldTable.bins; ++i) {
+      if (getMetadata(oldTable, i) == static_cast<uint32_t>(BIN_FLAGS::USED)) {
+        const bool result =
+            writeToTable(m_table, oldTable.keys[i], oldTable.values[i],
+                         HASH(oldTable.keys[i]));
+        assert(result);
+        (void)result;
+      }
+    }
+    freeTable(oldTable);
+    ++m_rehashCount;
   }
 
-  inline bool remove(KEY key) {
-    uint32_t bin = 0;
-    const bool result = getBin(key, bin);
-    const uint32_t meta = getMetadata(bin);
-    assert(meta == static_cast<uint32_t>(BIN_FLAGS::USED));
-    if (result) {
-      setMetadata(bin, BIN_FLAGS::DELETED);
-      --m_usedBins;
+  // moves whatever is left in the old table to the new one
+  void finishMigration() {
+    if (isMigrating()) {
+      migrateBins(m_oldTable.bins);
     }
-    return result;
   }
 
-  [[nodiscard]] uint32_t getUsedBins() const { return m_usedBins; }
-  inline uint32_t binCount() const { return m_bins; }
+  [[nodiscard]] uint32_t getUsedBins() const {
+    return m_table.usedBins + m_oldTable.usedBins;
+  }
+  // bin access only looks at the current table, if an incremental migration
+  // is in flight call finishMigration() before iterating the bins
+  inline uint32_t binCount() const { return m_table.bins; }
   inline bool isBinUsed(const uint32_t bin) const {
-    assert(bin < m_bins);
-    uint32_t meta = getMetadata(bin);
+    assert(bin < m_table.bins);
+    assert(!isMigrating() && "bins accessed during a migration");
+    uint32_t meta = getMetadata(m_table, bin);
     return meta == static_cast<uint32_t>(BIN_FLAGS::USED);
   }
 
   KEY getKeyAtBin(uint32_t bin) {
     // no check done whether the bin is used or not, up to you kid
-    assert(bin < m_bins);
-    return m_keys[bin];
+    assert(bin < m_table.bins);
+    return m_table.keys[bin];
   }
   VALUE getValueAtBin(uint32_t bin) {
     // no check done whether the bin is used or not, up to you kid
-    assert(bin < m_bins);
-    return m_values[bin];
+    assert(bin < m_table.bins);
+    return m_table.values[bin];
+  }
+
+  // stats
+  [[nodiscard]] inline bool isMigrating() const {
+    return m_oldTable.bins != 0;
+  }
+  [[nodiscard]] uint32_t getTombstoneCount() const {
+    return m_table.deletedBins + m_oldTable.deletedBins;
+  }
+  [[nodiscard]] uint32_t getRehashCount() const { return m_rehashCount; }
+  [[nodiscard]] float getLoadFactor() const {
+    return static_cast<float>(m_table.usedBins + m_table.deletedBins) /
+           static_cast<float>(m_table.bins);
+  }
+  void setMaxLoadFactor(const float maxLoadFactor) {
+    assert((maxLoadFactor > 0.0f) & (maxLoadFactor <= 1.0f));
+    m_maxLoadFactor = maxLoadFactor;
+  }
+
+  // for every used bin of the current table computes how many bins away from
+  // the bin the key hashes to the key is stored, and counts it in the
+  // histogram, the last bucket collects every probe length equal or greater
+  // than bucketCount-1
+  void getProbeLengthHistogram(uint32_t *histogram,
+                               const uint32_t bucketCount) const {
+    assert(bucketCount > 0);
+    memset(histogram, 0, bucketCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < m_table.bins; ++i) {
+      if (getMetadata(m_table, i) != static_cast<uint32_t>(BIN_FLAGS::USED)) {
+        continue;
+      }
+      const uint32_t home = HASH(m_table.keys[i]) % m_table.bins;
+      const uint32_t distance =
+          i >= home ? i - home : (m_table.bins - home) + i;
+      const uint32_t bucket =
+          distance < bucketCount - 1 ? distance : bucketCount - 1;
+      ++histogram[bucket];
+    }
   }
 
   // deleted functions
   HashMap(const HashMap &) = delete;
   HashMap &operator=(const HashMap &) = delete;
 
-  KEY *getKeys() { return m_keys; }
+  KEY *getKeys() { return m_table.keys; }
 
 private:
   enum class BIN_FLAGS { NONE = 0, FREE = 1, DELETED = 2, USED = 3 };
 
-  bool getBin(const KEY key, uint32_t &bin) const {
-    const uint32_t computedHash = HASH(key);
-    bin = computedHash % m_bins;
+  struct Table {
+    KEY *keys = nullptr;
+    VALUE *values = nullptr;
+    uint32_t *metadata = nullptr;
+    uint32_t bins = 0;
+    uint32_t usedBins = 0;
+    uint32_t deletedBins = 0;
+  };
+
+  bool insertHashed(KEY key, VALUE value, const uint32_t computedHash) {
+    uint32_t bin = 0;
+    if (getBin(m_table, key, computedHash, bin)) {
+      // key exists we just override the value
+      m_table.values[bin] = value;
+      return true;
+    }
+
+    if (isMigrating()) {
+      // if the key has not been migrated yet we remove it from the old table
+      // and let it be written to the new one
+      if (getBin(m_oldTable, key, computedHash, bin)) {
+        removeFromBin(m_oldTable, bin);
+      }
+      migrateBins(MIGRATION_BINS_PER_INSERT);
+    }
+
+    if (needsRehash()) {
+      growOrCompact();
+    }
+
+    return writeToTable(m_table, key, value, computedHash);
+  }
+
+  bool getHashed(KEY key, VALUE &value, const uint32_t computedHash) const {
+    uint32_t bin = 0;
+    if (getBin(m_table, key, computedHash, bin)) {
+      value = m_table.values[bin];
+      return true;
+    }
+    if (getBin(m_oldTable, key, computedHash, bin)) {
+      value = m_oldTable.values[bin];
+      return true;
+    }
+    return false;
+  }
+
+  // prefetching the key, value and metadata of the bin the hash maps to, most
+  // lookups are resolved in that bin or the next few
+  static inline void prefetchBin(const Table &table,
+                                 const uint32_t computedHash) {
+    const uint32_t bin = computedHash % table.bins;
+    __builtin_prefetch(table.keys + bin);
+    __builtin_prefetch(table.values + bin);
+    __builtin_prefetch(table.metadata + ((bin * BIN_FLAGS_SIZE) / 32));
+  }
+
+  static void allocateTable(Table &table, const uint32_t bins) {
+    table.bins = bins;
+    table.usedBins = 0;
+    table.deletedBins = 0;
+    table.keys = new KEY[bins];
+    table.values = new VALUE[bins];
+    const int count = ((bins * BIN_FLAGS_SIZE) / (8 * sizeof(uint32_t))) + 1;
+    table.metadata = new uint32_t[count];
+    // 85 is 01010101 in binary this means we fill 4 bins with the value of 1,
+    // meaning free
+    memset(table.metadata, 85, count * sizeof(uint32_t));
+    memset(table.keys, 0, bins * sizeof(KEY));
+    memset(table.values, 0, bins * sizeof(VALUE));
+  }
+
+  static void freeTable(Table &table) {
+    delete[] table.keys;
+    delete[] table.values;
+    delete[] table.metadata;
+    table = Table{};
+  }
+
+  inline bool needsRehash() const {
+    const auto maxLoad =
+        static_cast<uint32_t>(static_cast<float>(m_table.bins) *
+                              m_maxLoadFactor);
+    return (m_growth != HASH_MAP_GROWTH::NONE) &
+           ((m_table.usedBins + m_table.deletedBins + 1) > maxLoad);
+  }
+
+  void growOrCompact() {
+    // if at least half of the load is made of deleted bins we rebuild at the
+    // same size, which is enough to get rid of the tombstones, otherwise we
+    // double, a table with no tombstones at all always grows, even when it
+    // is empty and too small to hold its first key
+    const bool mostlyTombstones = (m_table.deletedBins > 0) &
+                                  (m_table.deletedBins >= m_table.usedBins);
+    const uint32_t newBins =
+        mostlyTombstones ? m_table.bins : m_table.bins * 2;
+    if (m_growth == HASH_MAP_GROWTH::INCREMENTAL) {
+      startMigration(newBins);
+    } else {
+      rehash(newBins);
+    }
+  }
+
+  void startMigration(const uint32_t newBins) {
+    finishMigration();
+    m_oldTable = m_table;
+    allocateTable(m_table, newBins);
+    m_migrationBin = 0;
+    ++m_rehashCount;
+  }
+
+  void migrateBins(const uint32_t count) {
+    const uint32_t end = m_migrationBin + count < m_oldTable.bins
+                             ? m_migrationBin + count
+                             : m_oldTable.bins;
+    for (; m_migrationBin < end; ++m_migrationBin) {
+      const uint32_t bin = m_migrationBin;
+      if (getMetadata(m_oldTable, bin) !=
+          static_cast<uint32_t>(BIN_FLAGS::USED)) {
+        continue;
+      }
+      const bool result =
+          writeToTable(m_table, m_oldTable.keys[bin], m_oldTable.values[bin],
+                       HASH(m_oldTable.keys[bin]));
+      assert(result);
+      (void)result;
+      // the bin must not be found anymore, but it can't be set free either
+      // or keys not yet migrated in the same cluster would not be reachable
+      setMetadata(m_oldTable, bin, BIN_FLAGS::DELETED);
+      --m_oldTable.usedBins;
+      ++m_oldTable.deletedBins;
+    }
+    if (m_migrationBin == m_oldTable.bins) {
+      freeTable(m_oldTable);
+      m_migrationBin = 0;
+    }
+  }
+
+  static bool getBin(const Table &table, const KEY key,
+                     const uint32_t computedHash, uint32_t &bin) {
+    if (table.bins == 0) {
+      return false;
+    }
+    bin = computedHash % table.bins;
     const uint32_t startBin = bin;
 
-    bool go = true;
-    bool status = true;
-    while (go) {
-      const uint32_t meta = getMetadata(bin);
-      const bool isKeyTheSame = key == m_keys[bin];
+    while (true) {
+      const uint32_t meta = getMetadata(table, bin);
+      // a free bin terminates the probing sequence, deleted bins don't since
+      // the key we are looking for might have been inserted past them
+      if (meta == static_cast<uint32_t>(BIN_FLAGS::FREE)) {
+        return false;
+      }
+      const bool isKeyTheSame = key == table.keys[bin];
       const bool isBinUsed = meta == static_cast<uint32_t>(BIN_FLAGS::USED);
       if (isKeyTheSame & isBinUsed) {
-        break;
+        return true;
       }
 
       ++bin;
-      bin = bin % m_bins; // wrap around the bins count
-      if ((bin == startBin) | !isBinUsed) {
-        go = false;
-        status = false;
+      bin = bin % table.bins; // wrap around the bins count
+      if (bin == startBin) {
+        return false;
       }
     }
-    return status;
   }
 
-  inline bool canWriteToBin(const uint32_t metadata) {
-    return (metadata == static_cast<uint32_t>(BIN_FLAGS::FREE)) |
-           (metadata == static_cast<uint32_t>(BIN_FLAGS::DELETED));
+  static bool writeToTable(Table &table, KEY key, VALUE value,
+                           const uint32_t computedHash) {
+    // modding wit the bin count
+    uint32_t bin = computedHash % table.bins;
+    const uint32_t startBin = bin;
+    uint32_t meta = getMetadata(table, bin);
+    while (!canWriteToBin(meta)) {
+      ++bin;
+      bin = bin % table.bins; // wrap around the bins count
+      if (bin == startBin) {
+        return false;
+      }
+      meta = getMetadata(table, bin);
+    }
+    table.deletedBins -=
+        meta == static_cast<uint32_t>(BIN_FLAGS::DELETED) ? 1 : 0;
+    table.keys[bin] = key;
+    table.values[bin] = value;
+    ++table.usedBins;
+    setMetadata(table, bin, BIN_FLAGS::USED);
+    return true;
   }
 
-  inline void writeToBin(uint32_t bin, KEY key, VALUE value) {
-    m_keys[bin] = key;
-    m_values[bin] = value;
-    ++m_usedBins;
+  static void removeFromBin(Table &table, const uint32_t bin) {
+    --table.usedBins;
+    // if the next bin is free no probing sequence goes past this bin, so we
+    // can free it rather than leaving a tombstone, the same then applies to
+    // any tombstone right before it
+    const uint32_t next = (bin + 1) % table.bins;
+    if (getMetadata(table, next) != static_cast<uint32_t>(BIN_FLAGS::FREE)) {
+      setMetadata(table, bin, BIN_FLAGS::DELETED);
+      ++table.deletedBins;
+      return;
+    }
+    setMetadata(table, bin, BIN_FLAGS::FREE);
+    uint32_t previous = bin == 0 ? table.bins - 1 : bin - 1;
+    while ((previous != bin) &
+           (getMetadata(table, previous) ==
+            static_cast<uint32_t>(BIN_FLAGS::DELETED))) {
+      setMetadata(table, previous, BIN_FLAGS::FREE);
+      --table.deletedBins;
+      previous = previous == 0 ? table.bins - 1 : previous - 1;
+    }
+  }
+
+  static inline bool canWriteToBin(const uint32_t metadata) {
+    return (metadata == static_cast<uint32_t>(BIN_FLAGS::FREE)) |
+           (metadata == static_cast<uint32_t>(BIN_FLAGS::DELETED));
   }
 
-  inline void setMetadata(const uint32_t bin, BIN_FLAGS flag) {
+  static inline void setMetadata(Table &table, const uint32_t bin,
+                                 BIN_FLAGS flag) {
     const uint32_t bit = bin * BIN_FLAGS_SIZE;
     const uint32_t bit32 = bit / 32;
     const uint32_t reminder32 = bit % 32;
     const auto flag32 = static_cast<uint32_t>(flag);
     // first we want to clear the value
     const uint32_t mask = (~0) & ~(3 << reminder32);
-    m_metadata[bit32] &= mask;
+    table.metadata[bit32] &= mask;
     // now set the value
-    m_metadata[bit32] |= flag32 << reminder32;
+    table.metadata[bit32] |= flag32 << reminder32;
   }
 
-  inline uint32_t getMetadata(const uint32_t bin) const {
+  static inline uint32_t getMetadata(const Table &table, const uint32_t bin) {
     const uint32_t bit = bin * BIN_FLAGS_SIZE;
     const uint32_t bit32 = bit / 32;
     const uint32_t reminder32 = bit % 32;
     const uint32_t mask = 3 << reminder32;
 
-    const uint32_t binMetadata = (m_metadata[bit32] & mask) >> reminder32;
+    const uint32_t binMetadata = (table.metadata[bit32] & mask) >> reminder32;
     return binMetadata;
   }
 
@@ -181,12 +451,16 @@ private:
   // this is the number of bytes required for
   static constexpr uint32_t BIN_FLAGS_SIZE = 2;
   static constexpr uint32_t BIN_FLAGS_MASK = 3; // first two bit sets
+  // how many keys the batched functions hash and prefetch ahead
+  static constexpr size_t BATCH_SIZE = 16;
 
-  KEY *m_keys;
-  VALUE *m_values;
-  uint32_t *m_metadata;
-  uint32_t m_bins;
-  uint32_t m_usedBins = 0;
+  Table m_table;
+  // only valid while an incremental migration is in flight
+  Table m_oldTable;
+  uint32_t m_migrationBin = 0;
+  uint32_t m_rehashCount = 0;
+  float m_maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+  HASH_MAP_GROWTH m_growth;
 };
 
 } // namespace SirMetal
@@ -3,61 +3,39 @@
 
 namespace SirMetal {
 
-uint64_t alignTo(const uint64_t stackOffset, const uint32_t alignment) {
-  const bool isAligned = stackOffset % alignment == 0;
-  return isAligned ? stackOffset : ((stackOffset / alignment) + 1) * alignment;
-}
-
 BufferRangeHandle LinearBufferManager::allocate(const uint64_t allocSizeInBytes,
                                                 const uint32_t alignment) {
+  assert(allocSizeInBytes > 0);
+  assert((alignment > 0) && ((alignment & (alignment - 1)) == 0) &&
+         "alignment needs to be a power of two");
+
+  // let us first check if there are free blocks
+  uint64_t alignedOffset;
+  const uint32_t freeBlock =
+      findFreeBlock(allocSizeInBytes, alignment, alignedOffset);
+  if (freeBlock != NULL_BLOCK) {
+    removeFreeBlock(freeBlock);
+    useBlock(freeBlock, alignedOffset, allocSizeInBytes);
+    return createHandle(freeBlock, alignedOffset, allocSizeInBytes);
+  }
+
+  // if we are here we need a new block from the stack, the alignment padding
+  // is part of the block so it comes back when the block is freed
   const uint64_t alignedStackPointer = alignTo(m_stackPointer, alignment);
   const uint64_t newStackPointer = allocSizeInBytes + alignedStackPointer;
-  const bool allocationFits = newStackPointer < m_bufferSizeInBytes;
-  const bool hasFreeAllocations = m_freeAllocations.size() != 0;
-  if ((!allocationFits) & (!hasFreeAllocations)) {
-    // allocation does not fit and no free allocations
+  if (newStackPointer > m_bufferSizeInBytes) {
+    // allocation does not fit and no free block does
     return BufferRangeHandle{};
   }
-
-  // let us first check if there are free allocations
-  uint32_t count = m_freeAllocations.size();
-  ;
-  for (uint32_t i = 0; i < count; ++i) {
-    BufferRangeTracker &range = m_freeAllocations[i];
-    if (allocSizeInBytes > range.m_actualAllocSize) {
-      continue;
-    }
-
-    // if we are here means the allocation could fit!
-    range.m_range.m_size = allocSizeInBytes;
-    range.m_magicNumber = MAGIC_NUMBER_COUNTER++;
-    range.m_allocIndex = i;
-    // we need to move it back into the free
-    m_allocations[range.m_allocIndex] = range;
-    m_freeAllocations.removeByPatchingFromLast(i);
-    // lets return the handle
-    const BufferRangeHandle handle{static_cast<uint32_t>(
-        (range.m_magicNumber << 16u) | range.m_allocIndex)};
-    m_allocCount += 1;
-    return handle;
-  }
-
-  // if we are here we need a new allocation
-  BufferRangeTracker toReturn{};
-  toReturn.m_range = {alignedStackPointer, allocSizeInBytes};
-  toReturn.m_allocIndex = static_cast<uint16_t>(m_allocations.size());
-  toReturn.m_magicNumber = MAGIC_NUMBER_COUNTER++;
-  toReturn.m_actualAllocSize = allocSizeInBytes;
-  m_allocations.pushBack(toReturn);
+  const uint32_t blockIndex =
+      createBlock(m_stackPointer, newStackPointer - m_stackPointer);
+  m_blocks[blockIndex].neighbourPrevious = m_lastBlock;
+  m_blocks[m_lastBlock].neighbourNext = blockIndex;
+  m_lastBlock = blockIndex;
 
   // moving stack pointer up
-  m_stackPointer = alignedStackPointer + allocSizeInBytes;
-  m_allocCount += 1;
-
-  const BufferRangeHandle handle{static_cast<uint32_t>(
-      (toReturn.m_magicNumber << 16) | toReturn.m_allocIndex)};
-
-  return handle;
+  m_stackPointer = newStackPointer;
+  return createHandle(blockIndex, alignedStackPointer, allocSizeInBytes);
 }
 
 void LinearBufferManager::free(const BufferRangeHandle handle) {
@@ -66,11 +44,227 @@ void LinearBufferManager::free(const BufferRangeHandle handle) {
   assert(idx < m_allocations.size());
 
   BufferRangeTracker &tracker = m_allocations[idx];
-  // this invalidate the tracker
+  assert(tracker.m_range.isValid() && "buffer range already freed");
+  uint32_t blockIndex = tracker.m_blockIndex;
+
+  // merging with the free neighbours, the merged away blocks are recycled.
+  // The sentinel is never free and takes the writes past the ends
+  const uint32_t previous = m_blocks[blockIndex].neighbourPrevious;
+  if (m_blocks[previous].isFree) {
+    removeFreeBlock(previous);
+    const uint32_t next = m_blocks[blockIndex].neighbourNext;
+    m_blocks[previous].size += m_blocks[blockIndex].size;
+    m_blocks[previous].neighbourNext = next;
+    m_blocks[next].neighbourPrevious = previous;
+    m_lastBlock = m_lastBlock == blockIndex ? previous : m_lastBlock;
+    releaseBlock(blockIndex);
+    blockIndex = previous;
+  }
+  const uint32_t next = m_blocks[blockIndex].neighbourNext;
+  if (m_blocks[next].isFree) {
+    removeFreeBlock(next);
+    const uint32_t afterNext = m_blocks[next].neighbourNext;
+    m_blocks[blockIndex].size += m_blocks[next].size;
+    m_blocks[blockIndex].neighbourNext = afterNext;
+    m_blocks[afterNext].neighbourPrevious = blockIndex;
+    m_lastBlock = m_lastBlock == next ? blockIndex : m_lastBlock;
+    releaseBlock(next);
+  }
+  insertFreeBlock(blockIndex);
+
+  // this invalidate the tracker, and any handle still pointing to it
   tracker.m_range.m_size = 0;
-  assert(tracker.m_range.isValid() == false);
-  m_freeAllocations.pushBack(tracker);
+  tracker.m_blockIndex = m_freeAllocationSlot;
+  tracker.m_magicNumber = (tracker.m_magicNumber + 1) & MAGIC_MASK;
+  tracker.m_magicNumber += tracker.m_magicNumber == 0 ? 1 : 0;
+  m_freeAllocationSlot = idx;
   m_allocCount -= 1;
 }
 
+uint32_t LinearBufferManager::findFreeBlock(const uint64_t size,
+                                            const uint32_t alignment,
+                                            uint64_t &alignedOffset) const {
+  if (m_firstLevelBitmap == 0) {
+    return NULL_BLOCK;
+  }
+  // good fit first: the size plus the worst alignment padding rounded up to
+  // the next class, every block from that class up fits, so we take the head
+  // of the first non empty one without walking any list
+  uint32_t firstLevel;
+  uint32_t secondLevel;
+  mapSize(roundUpToClass(size + alignment - 1), firstLevel, secondLevel);
+  if (findFreeClass(firstLevel, secondLevel)) {
+    const uint32_t head = m_freeHeads[firstLevel][secondLevel];
+    alignedOffset = alignTo(m_blocks[head].offset, alignment);
+    return head;
+  }
+
+  // nothing that big is free, the classes in between can still have blocks
+  // that fit, before growing the stack we look for the smallest of them
+  mapSize(size, firstLevel, secondLevel);
+  const uint32_t sizeFirstLevel = firstLevel;
+  const uint32_t sizeSecondLevel = secondLevel;
+  while (findFreeClass(firstLevel, secondLevel)) {
+    // the class of the size itself can have blocks both smaller and bigger
+    // than the size, we look for the smallest one that fits. Every block in
+    // the classes above is big enough, there we stop at the first one the
+    // alignment works for, whatever is left is split off anyway
+    const bool isSizeClass =
+        (firstLevel == sizeFirstLevel) & (secondLevel == sizeSecondLevel);
+    uint32_t best = NULL_BLOCK;
+    uint64_t bestSize = ~0ull;
+    uint32_t searched = 0;
+    for (uint32_t current = m_freeHeads[firstLevel][secondLevel];
+         (current != NULL_BLOCK) & (searched < MAX_CLASS_SEARCH);
+         current = m_blocks[current].binNext, ++searched) {
+      const Block &block = m_blocks[current];
+      const uint64_t aligned = alignTo(block.offset, alignment);
+      if ((aligned + size <= block.offset + block.size) &
+          (block.size < bestSize)) {
+        best = current;
+        bestSize = block.size;
+        alignedOffset = aligned;
+        if ((!isSizeClass) | (block.size == size)) {
+          break;
+        }
+      }
+    }
+    if (best != NULL_BLOCK) {
+      return best;
+    }
+    ++secondLevel;
+  }
+  return NULL_BLOCK;
+}
+
+uint32_t LinearBufferManager::createBlock(const uint64_t offset,
+                                          const uint64_t size) {
+  uint32_t blockIndex = m_unusedBlock;
+  if (blockIndex != NULL_BLOCK) {
+    m_unusedBlock = m_blocks[blockIndex].binNext;
+  } else {
+    blockIndex = m_blocks.size();
+    m_blocks.pushBack(Block{});
+  }
+  // field by field, a whole block built on the stack and copied stalls on
+  // the store forwarding
+  Block &block = m_blocks[blockIndex];
+  block.offset = offset;
+  block.size = size;
+  block.neighbourPrevious = NULL_BLOCK;
+  block.neighbourNext = NULL_BLOCK;
+  block.isFree = false;
+  return blockIndex;
+}
+
+void LinearBufferManager::releaseBlock(const uint32_t blockIndex) {
+  m_blocks[blockIndex].binNext = m_unusedBlock;
+  m_unusedBlock = blockIndex;
+}
+
+void LinearBufferManager::insertFreeBlock(const uint32_t blockIndex) {
+  Block &block = m_blocks[blockIndex];
+  uint32_t firstLevel;
+  uint32_t secondLevel;
+  mapSize(block.size, firstLevel, secondLevel);
+
+  const uint32_t head = m_freeHeads[firstLevel][secondLevel];
+  block.isFree = true;
+  block.firstLevel = static_cast<uint8_t>(firstLevel);
+  block.secondLevel = static_cast<uint8_t>(secondLevel);
+  block.binPrevious = NULL_BLOCK;
+  block.binNext = head;
+  m_blocks[head].binPrevious = blockIndex;
+  m_freeHeads[firstLevel][secondLevel] = blockIndex;
+  m_firstLevelBitmap |= 1ull << firstLevel;
+  m_secondLevelBitmap[firstLevel] |= 1u << secondLevel;
+  ++m_freeBlockCount;
+  m_freeBytes += block.size;
+}
+
+void LinearBufferManager::removeFreeBlock(const uint32_t blockIndex) {
+  Block &block = m_blocks[blockIndex];
+  assert(block.isFree);
+  const uint32_t firstLevel = block.firstLevel;
+  const uint32_t secondLevel = block.secondLevel;
+
+  // no branches on where the block is in the list, which is random, the
+  // sentinel takes the writes at the ends
+  const uint32_t next = block.binNext;
+  const uint32_t previous = block.binPrevious;
+  m_blocks[next].binPrevious = previous;
+  m_blocks[previous].binNext = next;
+  uint32_t &head = m_freeHeads[firstLevel][secondLevel];
+  head = head == blockIndex ? next : head;
+  const uint32_t isEmpty = head == NULL_BLOCK;
+  m_secondLevelBitmap[firstLevel] &= ~(isEmpty << secondLevel);
+  const uint64_t isLevelEmpty = m_secondLevelBitmap[firstLevel] == 0;
+  m_firstLevelBitmap &= ~(isLevelEmpty << firstLevel);
+
+  block.isFree = false;
+  --m_freeBlockCount;
+  m_freeBytes -= block.size;
+}
+
+void LinearBufferManager::useBlock(const uint32_t blockIndex,
+                                   const uint64_t alignedOffset,
+                                   const uint64_t size) {
+  // copies, creating blocks might reallocate the blocks array
+  const uint64_t blockOffset = m_blocks[blockIndex].offset;
+  const uint64_t blockEnd = blockOffset + m_blocks[blockIndex].size;
+  const uint32_t neighbourPrevious = m_blocks[blockIndex].neighbourPrevious;
+  const uint32_t neighbourNext = m_blocks[blockIndex].neighbourNext;
+
+  // splitting the alignment padding in front, if big enough
+  const uint64_t leading = alignedOffset - blockOffset;
+  if (leading >= MIN_BLOCK_SIZE) {
+    const uint32_t before = createBlock(blockOffset, leading);
+    m_blocks[before].neighbourPrevious = neighbourPrevious;
+    m_blocks[before].neighbourNext = blockIndex;
+    m_blocks[neighbourPrevious].neighbourNext = before;
+    m_blocks[blockIndex].neighbourPrevious = before;
+    m_blocks[blockIndex].offset = alignedOffset;
+    m_blocks[blockIndex].size -= leading;
+    insertFreeBlock(before);
+  }
+
+  // and what is left after the allocation
+  const uint64_t trailing = blockEnd - (alignedOffset + size);
+  if (trailing >= MIN_BLOCK_SIZE) {
+    const uint32_t after = createBlock(alignedOffset + size, trailing);
+    m_blocks[after].neighbourPrevious = blockIndex;
+    m_blocks[after].neighbourNext = neighbourNext;
+    m_blocks[neighbourNext].neighbourPrevious = after;
+    m_lastBlock = m_lastBlock == blockIndex ? after : m_lastBlock;
+    m_blocks[blockIndex].neighbourNext = after;
+    m_blocks[blockIndex].size -= trailing;
+    insertFreeBlock(after);
+  }
+}
+
+BufferRangeHandle LinearBufferManager::createHandle(
+    const uint32_t blockIndex, const uint64_t alignedOffset,
+    const uint64_t size) {
+  uint32_t slot;
+  if (m_freeAllocationSlot != NULL_INDEX) {
+    slot = m_freeAllocationSlot;
+    m_freeAllocationSlot = m_allocations[slot].m_blockIndex;
+  } else {
+    assert(m_allocations.size() < MAX_ALLOCATIONS &&
+           "too many buffer range allocations");
+    slot = m_allocations.size();
+    m_allocations.pushBack(
+        BufferRangeTracker{{0, 0}, 0, 1, slot, NULL_INDEX});
+  }
+
+  BufferRangeTracker &tracker = m_allocations[slot];
+  tracker.m_range = {alignedOffset, size};
+  tracker.m_actualAllocSize = m_blocks[blockIndex].size;
+  tracker.m_allocIndex = slot;
+  tracker.m_blockIndex = blockIndex;
+  m_allocCount += 1;
+
+  return BufferRangeHandle{(tracker.m_magicNumber << INDEX_BITS) | slot};
+}
+
 } // namespace SirMetal
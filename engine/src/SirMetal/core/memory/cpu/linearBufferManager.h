@@ -19,9 +19,13 @@ struct BufferRange {
 
 struct BufferRangeTracker {
   BufferRange m_range;
+  // size of the whole block backing the range, alignment padding and
+  // leftovers too small to be tracked on their own included
   uint64_t m_actualAllocSize;
-  uint16_t m_magicNumber;
-  uint16_t m_allocIndex;
+  uint32_t m_magicNumber;
+  uint32_t m_allocIndex;
+  // block backing the range, the next free slot once freed
+  uint32_t m_blockIndex;
 };
 
 /*
@@ -30,6 +34,23 @@ struct BufferRangeTracker {
  * dealing with memory makes it possible to deal with memory that is not
  * accessible, for example GPU ram, but from the CPU side you will be able to
  * know which part is free, usable , make sub allocations and so on.
+ *
+ * The buffer is split in blocks, every block knows the blocks before and after
+ * it in the buffer. Freed blocks are merged with free neighbours and kept in
+ * segregated size classes, TLSF style like the ThreeSizesPool: a first level
+ * per power of two and 16 linear second level classes inside each one, with
+ * two levels of bitmaps telling which classes have free blocks.
+ * Allocations round the size plus the worst alignment padding up to the next
+ * class and take the first block of the first non empty class from there,
+ * every block in it fits so there is no list to walk, whatever is left is
+ * split off. If there is none the classes in between are searched for the
+ * smallest block that fits, and if no free block fits the allocation is made
+ * by increasing the stack pointer, which never decreases.
+ * The search looks at most at MAX_CLASS_SEARCH blocks per class, so the cost
+ * of an allocation is bounded whatever the fragmentation. The price is that
+ * a crowded class can hide a block that fits past the first ones, the stack
+ * then grows even though the buffer had room, and a later allocation fails
+ * on a full buffer that could have held it.
  */
 template class ResizableVector<BufferRangeTracker>;
 class LinearBufferManager {
@@ -42,14 +63,23 @@ class LinearBufferManager {
       const uint32_t preAlloc = DEFAULT_ALLOCATION_RESERVE)
       : m_bufferSizeInBytes(bufferSizeInBytes),
         m_allocations(preAlloc),
-        m_freeAllocations(preAlloc){};
+        m_blocks(preAlloc) {
+    clear();
+  };
 
   BufferRangeHandle allocate(const uint64_t allocSizeInBytes,
                              const uint32_t alignment);
   void free(const BufferRangeHandle handle);
   void clear() {
     m_allocations.clear();
-    m_freeAllocations.clear();
+    m_blocks.clear();
+    // the sentinel, never free, stands for no block
+    m_blocks.pushBack(Block{0, 0, NULL_BLOCK, NULL_BLOCK, NULL_BLOCK,
+                            NULL_BLOCK, false, 0, 0});
+    clearFreeLists();
+    m_freeAllocationSlot = NULL_INDEX;
+    m_unusedBlock = NULL_BLOCK;
+    m_lastBlock = NULL_BLOCK;
     m_allocCount = 0;
     m_stackPointer = 0;
   }
@@ -59,10 +89,14 @@ class LinearBufferManager {
     return m_bufferSizeInBytes;
   }
   [[nodiscard]] uint32_t getAllocationsCount() const { return m_allocCount; }
+  // number of free blocks, after merging
   [[nodiscard]] uint32_t getFreeAllocationsCount() const {
-    return m_freeAllocations.size();
+    return m_freeBlockCount;
   }
+  [[nodiscard]] uint64_t getFreeBlocksBytes() const { return m_freeBytes; }
+  [[nodiscard]] uint64_t getStackPointer() const { return m_stackPointer; }
 
+  // indexed by the handle index, freed slots have an invalid range
   [[nodiscard]] const ResizableVector<BufferRangeTracker> *getAllocations()
       const {
     return &m_allocations;
@@ -75,26 +109,126 @@ class LinearBufferManager {
     assert(idx < m_allocations.size());
     return m_allocations[idx].m_range;
   }
+  // size of the block backing the range, it includes the alignment padding
+  // and leftovers too small to be split off
+  [[nodiscard]] uint64_t getAllocatedSize(
+      const BufferRangeHandle handle) const {
+    assertMagicNumber(handle);
+    uint32_t idx = getIndexFromHandle(handle);
+    assert(idx < m_allocations.size());
+    return m_allocations[idx].m_actualAllocSize;
+  }
 
-  [[nodiscard]] bool canAllocate(uint32_t allocSizeInBytes) const {
-    uint64_t newStackPointer = allocSizeInBytes + m_stackPointer;
-    bool allocationFits = newStackPointer < m_bufferSizeInBytes;
-    if (allocationFits) {
+  [[nodiscard]] bool canAllocate(const uint64_t allocSizeInBytes,
+                                 const uint32_t alignment = 1) const {
+    const uint64_t newStackPointer =
+        alignTo(m_stackPointer, alignment) + allocSizeInBytes;
+    if (newStackPointer <= m_bufferSizeInBytes) {
       return true;
     }
-    // if here alloc does not free need to search
-    // let us first check if there are free allocations
-    uint32_t count = m_freeAllocations.size();
-    for (uint32_t i = 0; i < count; ++i) {
-      BufferRangeTracker &range = m_freeAllocations[i];
-      if (allocSizeInBytes <= range.m_actualAllocSize) {
-        return true;
+    uint64_t alignedOffset;
+    return findFreeBlock(allocSizeInBytes, alignment, alignedOffset) !=
+           NULL_BLOCK;
+  }
+
+ private:
+  struct Block {
+    uint64_t offset;
+    uint64_t size;
+    // blocks right before and after this one in the buffer
+    uint32_t neighbourPrevious;
+    uint32_t neighbourNext;
+    // free list of the size class while the block is free, binNext links
+    // the unused blocks too
+    uint32_t binPrevious;
+    uint32_t binNext;
+    bool isFree;
+    // size class the block was put in, so removing it needs no mapping
+    uint8_t firstLevel;
+    uint8_t secondLevel;
+  };
+
+  // alignment needs to be a power of two
+  static uint64_t alignTo(const uint64_t offset, const uint32_t alignment) {
+    return (offset + alignment - 1) & ~static_cast<uint64_t>(alignment - 1);
+  }
+
+  static inline uint32_t highestBit(const uint64_t value) {
+    return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+  }
+  static inline uint32_t lowestBit(const uint64_t value) {
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+  }
+
+  // maps a size to the class it belongs to, below SMALL_BLOCK_SIZE classes
+  // are linear, 8 bytes each
+  static void mapSize(const uint64_t size, uint32_t &firstLevel,
+                      uint32_t &secondLevel) {
+    if (size < SMALL_BLOCK_SIZE) {
+      firstLevel = 0;
+      secondLevel =
+          static_cast<uint32_t>(size / (SMALL_BLOCK_SIZE / SECOND_LEVEL_COUNT));
+      return;
+    }
+    const uint32_t bit = highestBit(size);
+    firstLevel = bit - FIRST_LEVEL_SHIFT;
+    secondLevel = static_cast<uint32_t>(size >> (bit - SECOND_LEVEL_LOG2)) ^
+                  SECOND_LEVEL_COUNT;
+  }
+
+  // smallest size whose class only has blocks at least as big as size
+  static uint64_t roundUpToClass(const uint64_t size) {
+    if (size < SMALL_BLOCK_SIZE) {
+      return size + SMALL_BLOCK_SIZE / SECOND_LEVEL_COUNT - 1;
+    }
+    return size + (1ull << (highestBit(size) - SECOND_LEVEL_LOG2)) - 1;
+  }
+
+  // moves to the first class with free blocks, starting from the given one,
+  // returns false if there is none
+  bool findFreeClass(uint32_t &firstLevel, uint32_t &secondLevel) const {
+    uint32_t secondLevelMap =
+        secondLevel < SECOND_LEVEL_COUNT
+            ? m_secondLevelBitmap[firstLevel] & (~0u << secondLevel)
+            : 0;
+    if (secondLevelMap == 0) {
+      if (firstLevel + 1 >= FIRST_LEVEL_COUNT) {
+        return false;
+      }
+      const uint64_t firstLevelMap =
+          m_firstLevelBitmap & (~0ull << (firstLevel + 1));
+      if (firstLevelMap == 0) {
+        return false;
       }
+      firstLevel = lowestBit(firstLevelMap);
+      secondLevelMap = m_secondLevelBitmap[firstLevel];
     }
-    return false;
+    secondLevel = lowestBit(secondLevelMap);
+    return true;
   }
 
- private:
+  void clearFreeLists() {
+    m_firstLevelBitmap = 0;
+    for (uint32_t i = 0; i < FIRST_LEVEL_COUNT; ++i) {
+      m_secondLevelBitmap[i] = 0;
+      for (uint32_t j = 0; j < SECOND_LEVEL_COUNT; ++j) {
+        m_freeHeads[i][j] = NULL_BLOCK;
+      }
+    }
+    m_freeBlockCount = 0;
+    m_freeBytes = 0;
+  }
+
+  uint32_t findFreeBlock(uint64_t size, uint32_t alignment,
+                         uint64_t &alignedOffset) const;
+  uint32_t createBlock(uint64_t offset, uint64_t size);
+  void releaseBlock(uint32_t blockIndex);
+  void insertFreeBlock(uint32_t blockIndex);
+  void removeFreeBlock(uint32_t blockIndex);
+  void useBlock(uint32_t blockIndex, uint64_t alignedOffset, uint64_t size);
+  BufferRangeHandle createHandle(uint32_t blockIndex, uint64_t alignedOffset,
+                                 uint64_t size);
+
   inline void assertMagicNumber(const BufferRangeHandle handle) const {
     uint32_t magic = getMagicFromHandle(handle);
     uint32_t idx = getIndexFromHandle(handle);
@@ -103,31 +237,62 @@ class LinearBufferManager {
   }
 
   static uint32_t getIndexFromHandle(const BufferRangeHandle h) {
-    constexpr uint32_t STANDARD_INDEX_MASK = (1 << 16) - 1;
-    return h.handle & STANDARD_INDEX_MASK;
+    return h.handle & INDEX_MASK;
   }
 
   static uint32_t getMagicFromHandle(const BufferRangeHandle h) {
-    constexpr uint32_t STANDARD_INDEX_MASK = (1 << 16) - 1;
-    const uint32_t STANDARD_MAGIC_NUMBER_MASK = ~STANDARD_INDEX_MASK;
-    return (h.handle & STANDARD_MAGIC_NUMBER_MASK) >> 16;
+    return h.handle >> INDEX_BITS;
   }
 
  private:
-  uint16_t MAGIC_NUMBER_COUNTER = 1;
+  static constexpr uint32_t NULL_INDEX = 0xFFFFFFFF;
+  // blocks start with a sentinel, links past the ends and the end of the
+  // lists point to it, so they can be followed without checking
+  static constexpr uint32_t NULL_BLOCK = 0;
+  // handles are 20 bits of index and 12 bits of magic number, the magic
+  // number of a slot is bumped every time it is freed, and never 0 so no
+  // valid handle is 0
+  static constexpr uint32_t INDEX_BITS = 20;
+  static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+  static constexpr uint32_t MAGIC_MASK = (1u << (32 - INDEX_BITS)) - 1;
+  static constexpr uint32_t MAX_ALLOCATIONS = 1u << INDEX_BITS;
+  // leftovers smaller than this are not worth a block, they stay attached to
+  // the allocation
+  static constexpr uint64_t MIN_BLOCK_SIZE = 16;
+  // blocks looked at in a single size class before moving to the next one,
+  // keeps the search bounded when a class gets crowded
+  static constexpr uint32_t MAX_CLASS_SEARCH = 16;
+
+  // size classes, 16 per power of two, sizes below SMALL_BLOCK_SIZE all go in
+  // the first level
+  static constexpr uint32_t SECOND_LEVEL_LOG2 = 4;
+  static constexpr uint32_t SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_LOG2;
+  static constexpr uint64_t SMALL_BLOCK_SIZE = 128;
+  // log2(SMALL_BLOCK_SIZE) - 1, so that SMALL_BLOCK_SIZE maps to level 1
+  static constexpr uint32_t FIRST_LEVEL_SHIFT = 6;
+  static constexpr uint32_t FIRST_LEVEL_COUNT = 64 - FIRST_LEVEL_SHIFT;
 
   uint64_t m_bufferSizeInBytes;
 
   /*
-   * Here we have two data structure that allow to keep track of what is free
-   * and what is not. the main idea is that when an allocation is freed, the
-   * m_allocations array is not resized, this allows us to keep the handles
-   * indices static, instead a copy is put in the free allocations, and when
-   * that allocations is re-used then it will be put back in place at correct
-   * index.
+   * m_allocations is indexed by the handle index, a freed slot is not
+   * removed, it goes in a list of free slots, linked through m_blockIndex, to
+   * be reused by a later allocation, so handle indices are stable. Blocks work
+   * the same way, the blocks merged away on free are linked through binNext.
    */
   ResizableVector<BufferRangeTracker> m_allocations;
-  ResizableVector<BufferRangeTracker> m_freeAllocations;
+  ResizableVector<Block> m_blocks;
+  uint32_t m_freeAllocationSlot = NULL_INDEX;
+  uint32_t m_unusedBlock = NULL_BLOCK;
+  // block ending at the stack pointer
+  uint32_t m_lastBlock = NULL_BLOCK;
+
+  uint64_t m_firstLevelBitmap;
+  uint32_t m_secondLevelBitmap[FIRST_LEVEL_COUNT];
+  uint32_t m_freeHeads[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+  uint32_t m_freeBlockCount;
+  uint64_t m_freeBytes;
+
   uint64_t m_stackPointer = 0;
   uint32_t m_allocCount = 0;
 };
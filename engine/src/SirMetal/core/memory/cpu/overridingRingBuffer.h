@@ -1,30 +1,42 @@
 #pragma once
+#include <type_traits>
+
 #include "threeSizesPool.h"
 
 namespace SirMetal {
 
+// Ring buffer that never fails a push, once full the oldest element gets
+// overridden, meant for rolling windows like telemetry samples.
+// Which slots are alive is fully defined by the head and the count, the live
+// elements are the count slots before the head, so no per slot bookkeeping is
+// kept. The live elements are at most two contiguous spans of the buffer, the
+// range functions copy in and out with at most two copies, and getView()
+// exposes the spans directly so reductions can run on plain arrays.
 template <typename T, typename ALLOCATOR = ThreeSizesPool>
 class OverridingRingBuffer {
-  enum RING_CONTROL_FLAGS : uint8_t { FREE = 0, USED = 1 };
-
  public:
+  struct Span {
+    const T *data;
+    uint32_t count;
+  };
+  // live elements oldest first, the second span is empty unless the elements
+  // wrap around the end of the buffer
+  struct View {
+    Span first;
+    Span second;
+    uint32_t count() const { return first.count + second.count; }
+  };
+
   explicit OverridingRingBuffer(const int size, ALLOCATOR *alloc = nullptr) {
     assert(size > 0);
     m_size = size;
-    // init membuffer
 
     m_alloc = alloc;
-    // buffer bigger than internal optimization needs to allocate
     if (m_alloc != nullptr) {
       m_buffer = reinterpret_cast<T *>(alloc->allocate(sizeof(T) * size));
-      m_controlBuffer =
-          reinterpret_cast<uint8_t *>(alloc->allocate(sizeof(uint8_t) * size));
     } else {
       m_buffer = new T[size];
-      m_controlBuffer = new uint8_t[size];
     }
-    // clearing the control buffer
-    memset(m_controlBuffer, RING_CONTROL_FLAGS::FREE, sizeof(char) * size);
   }
   inline void registerDestroyCallback(void (*callback)(T &)) {
     m_callback = callback;
@@ -33,12 +45,9 @@ class OverridingRingBuffer {
   ~OverridingRingBuffer() {
     // freeing whatever needed
     if (m_callback != nullptr) {
-      for (uint32_t i = m_head; i < m_count; ++i) {
-        uint32_t idx = i % m_size;
-        assert(m_controlBuffer[idx] == USED);
-        if (m_controlBuffer[idx] != FREE) {
-          m_callback(m_buffer[idx]);
-        }
+      const uint32_t first = getFirstElementIndex();
+      for (uint32_t i = 0; i < m_count; ++i) {
+        m_callback(m_buffer[wrap(first + i)]);
       }
     }
     if (m_alloc != nullptr) {
@@ -47,31 +56,93 @@ class OverridingRingBuffer {
       delete[] m_buffer;
     }
   }
+  OverridingRingBuffer(const OverridingRingBuffer &) = delete;
+  OverridingRingBuffer &operator=(const OverridingRingBuffer &) = delete;
 
   bool push(T value) {
-    int id = m_head;
-    m_head = (m_head + 1) % m_size;
-    // if the slot is occupied and wee have a callback we want to free the
-    // element properly
-    if ((m_controlBuffer[id] != FREE) & (m_callback != nullptr)) {
-      m_callback(m_buffer[id]);
+    const uint32_t id = m_head;
+    m_head = wrap(m_head + 1);
+    // if the buffer is full the head is on the oldest element, if we have a
+    // callback we want to free the element properly
+    if (m_count == m_size) {
+      if (m_callback != nullptr) {
+        m_callback(m_buffer[id]);
+      }
+    } else {
+      ++m_count;
     }
     m_buffer[id] = value;
-    m_count += m_controlBuffer[id] == FREE ? 1 : 0;
-    m_controlBuffer[id] = USED;
     return true;
   }
 
+  // same as pushing the values one by one, but the data is copied with at
+  // most two copies, one up to the end of the buffer and one from the start
+  void pushRange(const T *values, uint32_t count) {
+    // only the last m_size values can survive, the ones before would be
+    // pushed and overridden straight away
+    if (count > m_size) {
+      const uint32_t skipped = count - m_size;
+      if (m_callback != nullptr) {
+        for (uint32_t i = 0; i < skipped; ++i) {
+          T value = values[i];
+          m_callback(value);
+        }
+      }
+      values += skipped;
+      count = m_size;
+    }
+
+    const uint32_t freeSlots = m_size - m_count;
+    if (count > freeSlots) {
+      const uint32_t overridden = count - freeSlots;
+      if (m_callback != nullptr) {
+        const uint32_t first = getFirstElementIndex();
+        for (uint32_t i = 0; i < overridden; ++i) {
+          m_callback(m_buffer[wrap(first + i)]);
+        }
+      }
+      m_count -= overridden;
+    }
+
+    const uint32_t toEnd = m_size - m_head;
+    const uint32_t firstCount = count < toEnd ? count : toEnd;
+    copySpan(m_buffer + m_head, values, firstCount);
+    copySpan(m_buffer, values + firstCount, count - firstCount);
+    m_head = wrap(m_head + count);
+    m_count += count;
+  }
+
   T pop() {
     assert(m_count > 0);
     uint32_t idx = getFirstElementIndex();
-    assert(m_controlBuffer[idx] == USED);
-    m_controlBuffer[idx] = FREE;
     // we don't de-alloc we return it to the user is up to him to do dealloc if
     // requested
     --m_count;
     return m_buffer[idx];
   }
+
+  // pops up to count of the oldest elements in out, returns how many, like pop
+  // no callback is called, the elements are handed to the user
+  uint32_t popRange(T *out, uint32_t count) {
+    count = count < m_count ? count : m_count;
+    const uint32_t first = getFirstElementIndex();
+    const uint32_t toEnd = m_size - first;
+    const uint32_t firstCount = count < toEnd ? count : toEnd;
+    copySpan(out, m_buffer + first, firstCount);
+    copySpan(out + firstCount, m_buffer, count - firstCount);
+    m_count -= count;
+    return count;
+  }
+
+  // valid until the next push or pop
+  View getView() const {
+    const uint32_t first = getFirstElementIndex();
+    const uint32_t toEnd = m_size - first;
+    const uint32_t firstCount = m_count < toEnd ? m_count : toEnd;
+    return View{{m_buffer + first, firstCount},
+                {m_buffer, m_count - firstCount}};
+  }
+
   T back() const {
     uint32_t idx = getLastElementIndex();
     return m_buffer[idx];
@@ -109,19 +180,39 @@ class OverridingRingBuffer {
   }
 
   void clear() {
-    uint32_t count = m_count;
-    for (uint32_t i = 0; i < count; ++i) {
-      T value = pop();
-      if (m_callback != nullptr) {
+    // without a callback there is nothing to visit, dropping the elements
+    // is enough
+    if (m_callback != nullptr) {
+      const uint32_t first = getFirstElementIndex();
+      for (uint32_t i = 0; i < m_count; ++i) {
+        T value = m_buffer[wrap(first + i)];
         m_callback(value);
       }
     }
+    m_count = 0;
+  }
+
+ private:
+  // only valid for values smaller than twice the size
+  inline uint32_t wrap(const uint32_t index) const {
+    return index >= m_size ? index - m_size : index;
+  }
+
+  static void copySpan(T *destination, const T *source, const uint32_t count) {
+    if constexpr (std::is_trivially_copyable<T>::value) {
+      if (count != 0) {
+        memcpy(destination, source, sizeof(T) * count);
+      }
+    } else {
+      for (uint32_t i = 0; i < count; ++i) {
+        destination[i] = source[i];
+      }
+    }
   }
 
  private:
   ALLOCATOR *m_alloc = nullptr;
   T *m_buffer = nullptr;
-  uint8_t *m_controlBuffer = nullptr;
   uint32_t m_head = 0;  // next free slot
   uint32_t m_count = 0;
   uint32_t m_size = 0;
@@ -1,70 +1,82 @@
 #pragma once
 #include <assert.h>
+#include <stdint.h>
+
+#include "SirMetal/core/memory/cpu/linearBufferManager.h"
 
-#include "vector"
 namespace SirMetal {
 
 struct RandomSizeAllocationHandle {
   uint32_t offset = 0;
-  uint16_t allocSize = 0;
-  uint16_t dataSize = 0;
+  // bytes actually taken, it can be more than requested when the leftover
+  // of a reused block was too small to be split off
+  uint32_t allocSize = 0;
+  uint32_t dataSize = 0;
+  // the block in the tracker, needed to give it back
+  BufferRangeHandle range{0};
   inline bool isHandleValid() const { return allocSize > 0; }
 };
 
+/*
+ * Allocator for allocations of any size in a single chunk of memory. The
+ * bookkeeping is done by a LinearBufferManager over the chunk, so freed
+ * blocks are merged with their free neighbours, and allocations reuse the
+ * best fitting free block from the size classes, splitting off what is left.
+ * Only if no free block fits the unfragmented pointer moves forward.
+ * Sizes are rounded up to GRANULARITY, so every allocation is 4 bytes
+ * aligned.
+ */
 class RandomSizeAllocator final {
   static const int DEBUG_VALUE = 0xBEEFBAAD;
 
  private:
-  void set32BitMem(char *ptr, int sizeInBtye, int value) {
-    int sizeInInt32 = sizeInBtye / 4;
+  void set32BitMem(char *ptr, uint32_t sizeInBtye, int value) {
+    uint32_t sizeInInt32 = sizeInBtye / 4;
     uint32_t *uintptr = reinterpret_cast<uint32_t *>(ptr);
-    for (int i = 0; i < sizeInInt32; ++i) {
+    for (uint32_t i = 0; i < sizeInInt32; ++i) {
       *(uintptr + i) = value;
     }
   }
 
  public:
+  static constexpr uint32_t GRANULARITY = 4;
+
   RandomSizeAllocator() = default;
   void initialize(const uint32_t totalSizeInByte,
                   const int reservedAllocations = 20) {
+    assert(m_memory == nullptr);
     m_memory = new char[totalSizeInByte];
-    m_unfragmentedPtr = m_memory;
     m_end = m_memory + totalSizeInByte;
-    m_allocations.reserve(reservedAllocations);
+    m_tracker = new LinearBufferManager(totalSizeInByte,
+                                        static_cast<uint32_t>(reservedAllocations));
 #if SE_DEBUG
     set32BitMem(m_memory, totalSizeInByte, DEBUG_VALUE);
 #endif
   }
-  ~RandomSizeAllocator() { delete m_memory; }
+  ~RandomSizeAllocator() {
+    delete m_tracker;
+    delete[] m_memory;
+  }
 
-  RandomSizeAllocationHandle allocate(const uint16_t sizeInByte) {
-    // first inspect if we have any free allocation blocks
+  // returns an invalid handle if no space is left
+  RandomSizeAllocationHandle allocate(const uint32_t sizeInByte) {
+    assert(sizeInByte > 0);
+    // every block boundary is a multiple of the granularity, so no padding is
+    // ever needed in front of an allocation
+    const uint32_t size = (sizeInByte + GRANULARITY - 1) & ~(GRANULARITY - 1);
     RandomSizeAllocationHandle toReturnHandle;
-    const int allocCount = static_cast<int>(m_allocations.size());
-    const RandomSizeAllocationHandle *allocs = m_allocations.data();
-    int foundIndex = -1;
-    for (int i = 0; i < allocCount; ++i) {
-      if (sizeInByte <= allocs[i].allocSize) {
-        foundIndex = i;
-        break;
-      }
-    }
-    if (foundIndex != -1) {
-      toReturnHandle = m_allocations[foundIndex];
-      toReturnHandle.dataSize = sizeInByte;
-      // patching the hole in the allocation list
-      m_allocations[foundIndex] = m_allocations[m_allocations.size() - 1];
-      m_allocations.pop_back();
-    } else {
-      // lets make a new allocation
-      assert(m_unfragmentedPtr + sizeInByte < m_end);
-      toReturnHandle.allocSize = sizeInByte;
-      toReturnHandle.dataSize = sizeInByte;
-      toReturnHandle.offset =
-          static_cast<uint32_t>((m_unfragmentedPtr)-m_memory);
-      // moving the unfrag pointer forward
-      m_unfragmentedPtr += sizeInByte;
+    const BufferRangeHandle range = m_tracker->allocate(size, GRANULARITY);
+    if (!range.isHandleValid()) {
+      return toReturnHandle;
     }
+
+    const uint64_t offset = m_tracker->getBufferRange(range).m_offset;
+    const uint64_t allocSize = m_tracker->getAllocatedSize(range);
+    assert(offset + allocSize <= static_cast<uint64_t>(m_end - m_memory));
+    toReturnHandle.offset = static_cast<uint32_t>(offset);
+    toReturnHandle.allocSize = static_cast<uint32_t>(allocSize);
+    toReturnHandle.dataSize = sizeInByte;
+    toReturnHandle.range = range;
     assert(toReturnHandle.isHandleValid());
 
 #if SE_DEBUG
@@ -73,14 +85,14 @@ class RandomSizeAllocator final {
     return toReturnHandle;
   }
   inline char *getPointer(const RandomSizeAllocationHandle handle) const {
-    assert((m_memory + handle.offset + handle.allocSize) < m_end);
+    assert((m_memory + handle.offset + handle.allocSize) <= m_end);
     return m_memory + handle.offset;
   }
   void freeAllocation(const RandomSizeAllocationHandle handle) {
-    m_allocations.push_back(handle);
 #if SE_DEBUG
     tagMemoryAsFreed(handle);
 #endif
+    m_tracker->free(handle.range);
   }
   inline void tagMemoryAsFreed(const RandomSizeAllocationHandle handle) {
     char *ptr = getPointer(handle);
@@ -89,7 +101,9 @@ class RandomSizeAllocator final {
   }
 
   inline const char *getStartPtr() const { return m_memory; };
-  inline const char *getUnfragmentedPtr() const { return m_unfragmentedPtr; };
+  inline const char *getUnfragmentedPtr() const {
+    return m_memory + m_tracker->getStackPointer();
+  };
 
   inline void assertMemoryIsNotAllocated(
       const RandomSizeAllocationHandle handle) const {
@@ -98,20 +112,26 @@ class RandomSizeAllocator final {
     char *ptr = getPointer(handle);
     assert((reinterpret_cast<int *>(ptr)[0] == static_cast<int>(DEBUG_VALUE)));
   }
+  // free blocks below the unfragmented pointer, after merging
   inline int getFreeBlocksCount() const {
-    return static_cast<int>(m_allocations.size());
+    return static_cast<int>(m_tracker->getFreeAllocationsCount());
+  }
+  inline uint64_t getFreeBlocksBytes() const {
+    return m_tracker->getFreeBlocksBytes();
   }
 
   inline float getAllocatedAmount() const {
     auto range = static_cast<double>(m_end - m_memory);
-    auto curr = static_cast<double>(m_unfragmentedPtr - m_memory);
+    auto curr = static_cast<double>(getUnfragmentedPtr() - m_memory);
     return static_cast<float>(curr / range);
   }
 
+  RandomSizeAllocator(const RandomSizeAllocator &) = delete;
+  RandomSizeAllocator &operator=(const RandomSizeAllocator &) = delete;
+
  private:
   char *m_memory = nullptr;
-  char *m_unfragmentedPtr = nullptr;
   char *m_end = nullptr;
-  std::vector<RandomSizeAllocationHandle> m_allocations;
+  LinearBufferManager *m_tracker = nullptr;
 };
 }  // namespace SirMetal
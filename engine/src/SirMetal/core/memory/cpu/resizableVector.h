@@ -2,6 +2,11 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "threeSizesPool.h"
 
 namespace SirMetal {
 
@@ -12,26 +17,42 @@ compilation. You can only use POD data, and or structures in pod data, what
 happens is a shallow copy when resizing or more memory required, if you have
 pointers there those won't be deep copied, which might be the intended
 behaviour, just bewhare!
+
+Memory comes from the allocator if one is given, anything with
+allocate(bytes) and free(pointer) works, ThreeSizesPool, StackAllocator,
+VirtualMemoryArena, otherwise from the heap. A ThreeSizesPool only has blocks
+up to about 1MB, bigger vectors use the heap even if a pool is given. The data is always ALIGNMENT
+aligned, so it can be loaded straight in SIMD registers.
+If the allocator has a growInPlace(pointer, bytes) the vector first tries to
+grow the memory where it is, and only copies if that fails. The stack
+allocator and the virtual memory arena can always grow their last
+allocation, a big vertex array built in its own arena is never copied.
 */
-template <typename T>
+template <typename T, typename ALLOCATOR = ThreeSizesPool,
+          uint32_t ALIGNMENT = 16>
 class ResizableVector {
-
-public:
-  explicit ResizableVector(const uint32_t reserveSize = 0) {
+  static_assert((ALIGNMENT & (ALIGNMENT - 1)) == 0,
+                "alignment needs to be a power of two");
+  static_assert(ALIGNMENT >= alignof(T), "alignment smaller than the type's");
+
+ public:
+  explicit ResizableVector(const uint32_t reserveSize = 0,
+                           ALLOCATOR *alloc = nullptr) {
+    m_alloc = alloc;
     m_size = 0;
     m_reserved = reserveSize;
     // allocate new memory if needed
     if (m_reserved != 0) {
-      m_memory = reinterpret_cast<T *>(allocateMemoryInternal(m_reserved));
-    }
-
+      allocateMemoryInternal(m_reserved, m_allocation, m_memory);
 #if SE_DEBUG
-    // just setting memory to an easily readable value in case we are in debug
-    memset(m_memory, 0xDEADBAAD, sizeof(T) * m_reserved);
+      // just setting memory to an easily readable value in case we are in
+      // debug
+      memset(m_memory, 0xDEADBAAD, sizeof(T) * m_reserved);
 #endif
+    }
   };
 
-  ~ResizableVector() { freeMemoryInternal(m_memory); }
+  ~ResizableVector() { freeMemoryInternal(m_allocation); }
 
   inline void clear() { m_size = 0; }
   /*This function is designed  for quick removal of objects,
@@ -55,9 +76,11 @@ public:
     // first checking whether there is enough buffer left, if
     // not we re-allocate
     if (m_size >= m_reserved) {
-      assert(m_reserved != 0);
-      reallocateMemoryInternal(m_size * 2);
-      m_reserved *= 2;
+      // doubling, starting from a few elements if nothing was reserved
+      const uint32_t newReserved =
+          m_reserved != 0 ? m_reserved * 2 : MIN_GROWTH;
+      reallocateMemoryInternal(newReserved);
+      m_reserved = newReserved;
     }
     m_memory[m_size] = value;
     m_size += 1;
@@ -88,6 +111,14 @@ public:
     }
   }
 
+  // makes sure there is space for at least reserveSize elements
+  void reserve(const uint32_t reserveSize) {
+    if (reserveSize > m_reserved) {
+      reallocateMemoryInternal(reserveSize);
+      m_reserved = reserveSize;
+    }
+  }
+
   inline const T &getConstRef(const uint32_t index) const {
 #if SE_MEMORY_INDEX_CHECKING
     assert(index < m_size);
@@ -102,16 +133,76 @@ public:
   ResizableVector(const ResizableVector &) = delete;
   ResizableVector &operator=(const ResizableVector &) = delete;
 
-private:
-  void *allocateMemoryInternal(uint32_t size, uint8_t = 0) {
-      return new T[size];
+ private:
+  template <typename A, typename = void>
+  struct CanGrowInPlace : std::false_type {};
+  template <typename A>
+  struct CanGrowInPlace<A, std::void_t<decltype(std::declval<A &>().growInPlace(
+                               std::declval<void *>(), size_t{}))>>
+      : std::true_type {};
+
+  // allocators don't know about our alignment, we ask for enough extra bytes
+  // to be able to align the start ourselves
+  static size_t getAllocationSize(const uint32_t count) {
+    return sizeof(T) * static_cast<size_t>(count) + ALIGNMENT - 1;
+  }
+
+  // the pool blocks can't be bigger than ThreeSizesPool::getMaxAllocSize(),
+  // past that the vector memory comes from the heap
+  bool isHeapAllocation(const void *allocation) const {
+    if (m_alloc == nullptr) {
+      return true;
+    }
+    if constexpr (std::is_same_v<ALLOCATOR, ThreeSizesPool>) {
+      return !m_alloc->allocationInPool(allocation);
+    }
+    return false;
+  }
+
+  void allocateMemoryInternal(const uint32_t count, void *&allocation,
+                              T *&memory) {
+    const size_t bytes = getAllocationSize(count);
+    bool useHeap = m_alloc == nullptr;
+    if constexpr (std::is_same_v<ALLOCATOR, ThreeSizesPool>) {
+      useHeap |= bytes > ThreeSizesPool::getMaxAllocSize();
+    }
+    if (useHeap) {
+      allocation = ::operator new(sizeof(T) * static_cast<size_t>(count),
+                                  std::align_val_t{ALIGNMENT});
+      memory = static_cast<T *>(allocation);
+      return;
+    }
+    allocation = m_alloc->allocate(static_cast<uint32_t>(bytes));
+    assert(allocation != nullptr && "allocator out of memory");
+    const auto address = reinterpret_cast<uintptr_t>(allocation);
+    memory = reinterpret_cast<T *>((address + ALIGNMENT - 1) &
+                                   ~static_cast<uintptr_t>(ALIGNMENT - 1));
   }
-  void freeMemoryInternal(void *memory) {
-      delete[] m_memory;
+  void freeMemoryInternal(void *allocation) {
+    if (allocation == nullptr) {
+      return;
+    }
+    if (isHeapAllocation(allocation)) {
+      ::operator delete(allocation, std::align_val_t{ALIGNMENT});
+    } else {
+      m_alloc->free(allocation);
+    }
   }
 
   void reallocateMemoryInternal(const uint32_t newSize) {
-    T *tempMemory = reinterpret_cast<T *>(allocateMemoryInternal(newSize));
+    if constexpr (CanGrowInPlace<ALLOCATOR>::value) {
+      if ((m_alloc != nullptr) && (m_allocation != nullptr) &&
+          m_alloc->growInPlace(m_allocation, getAllocationSize(newSize))) {
+        // the alignment offset does not change, the data stays where it is
+#if SE_DEBUG
+        memset(m_memory + m_size, 0xDEADBAAD, sizeof(T) * (newSize - m_size));
+#endif
+        return;
+      }
+    }
+    void *tempAllocation;
+    T *tempMemory;
+    allocateMemoryInternal(newSize, tempAllocation, tempMemory);
     if ((m_size != 0) & (m_memory != nullptr)) {
       memcpy(tempMemory, m_memory, m_size * sizeof(T));
     }
@@ -119,11 +210,17 @@ private:
     // just setting memory to an easily readable value in case we are in debug
     memset(tempMemory + m_size, 0xDEADBAAD, sizeof(T) * (newSize - m_size));
 #endif
-    freeMemoryInternal(m_memory);
+    freeMemoryInternal(m_allocation);
+    m_allocation = tempAllocation;
     m_memory = tempMemory;
   }
 
-private:
+ private:
+  static constexpr uint32_t MIN_GROWTH = 16;
+
+  ALLOCATOR *m_alloc = nullptr;
+  // what the allocator returned, m_memory is the aligned start of the data
+  void *m_allocation = nullptr;
   T *m_memory = nullptr;
   uint32_t m_size;
   uint32_t m_reserved;
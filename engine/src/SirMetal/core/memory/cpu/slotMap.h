@@ -0,0 +1,163 @@
+#pragma once
+#include <assert.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+namespace SirMetal {
+
+// Slot map, a pool handing out keys to the data it stores. The data is kept
+// densely packed in a single array, so iterating the live entries is a walk
+// over contiguous memory, removing an entry moves the last one in its place.
+// A key does not point to the data directly but to a slot, the slot knows
+// where the data currently is in the dense array, so resolving a key is two
+// array lookups, no hashing.
+// Every slot has a generation which is bumped when its entry is removed,
+// the generation is part of the key, so a key of a removed entry does not
+// resolve anymore, even if the slot has been reused.
+// Keys are 24 bits, 16 for the slot and 8 for the generation, so they fit
+// in a resource handle next to the 8 bits of type, see handle.h
+// With 8 bits the generation would come back to a value already handed out
+// after 256 reuses of a slot, and a stale key would resolve again. Instead
+// a slot is retired once its last generation is removed, it never goes back
+// in the free list, so a stale key never resolves. The price is that the map
+// can hand out at most 256 keys per slot over its lifetime, about 16M, after
+// that insert returns INVALID_KEY like when the map is full.
+template <typename T>
+class SlotMap final {
+ public:
+  // returned by insert when every slot is in use, never resolves
+  static constexpr uint32_t INVALID_KEY = (1 << 24) - 1;
+
+  explicit SlotMap(const uint32_t reserve = 0) {
+    m_dense.reserve(reserve);
+    m_denseToSlot.reserve(reserve);
+    m_slots.reserve(reserve);
+  }
+  SlotMap(const SlotMap &) = delete;
+  SlotMap &operator=(const SlotMap &) = delete;
+
+  // INVALID_KEY when the map is full or every slot has been retired, the
+  // value is then dropped, a slot past the key bits would alias the
+  // generation of another key
+  uint32_t insert(T value) {
+    uint32_t slot;
+    if (m_nextFreeSlot != NULL_SLOT) {
+      slot = m_nextFreeSlot;
+      // free slots store the next free slot in place of the dense index
+      m_nextFreeSlot = m_slots[slot].denseIndex;
+    } else {
+      if (m_slots.size() >= MAX_SLOTS) {
+        return INVALID_KEY;
+      }
+      slot = static_cast<uint32_t>(m_slots.size());
+      m_slots.emplace_back(Slot{0, 0});
+    }
+    m_slots[slot].denseIndex = static_cast<uint32_t>(m_dense.size());
+    m_dense.emplace_back(std::move(value));
+    m_denseToSlot.push_back(slot);
+    return makeKey(slot, m_slots[slot].generation);
+  }
+
+  bool remove(const uint32_t key) {
+    if (!contains(key)) {
+      return false;
+    }
+    const uint32_t slot = getSlotFromKey(key);
+    const uint32_t denseIndex = m_slots[slot].denseIndex;
+    const uint32_t last = static_cast<uint32_t>(m_dense.size()) - 1;
+    // patching the hole with the last entry
+    if (denseIndex != last) {
+      m_dense[denseIndex] = std::move(m_dense[last]);
+      m_denseToSlot[denseIndex] = m_denseToSlot[last];
+      m_slots[m_denseToSlot[denseIndex]].denseIndex = denseIndex;
+    }
+    m_dense.pop_back();
+    m_denseToSlot.pop_back();
+
+    // retiring the slot instead of wrapping the generation, the keys handed
+    // out for it could alias the ones of the next round otherwise
+    if (m_slots[slot].generation == GENERATION_MASK) {
+      m_slots[slot].denseIndex = NULL_SLOT;
+      return true;
+    }
+    ++m_slots[slot].generation;
+    m_slots[slot].denseIndex = m_nextFreeSlot;
+    m_nextFreeSlot = slot;
+    return true;
+  }
+
+  [[nodiscard]] bool contains(const uint32_t key) const {
+    const uint32_t slot = getSlotFromKey(key);
+    // free slots always have a different generation than any key that has
+    // been handed out for them, retired slots have no dense index
+    return (slot < m_slots.size()) &&
+           (m_slots[slot].generation == getGenerationFromKey(key)) &&
+           (m_slots[slot].denseIndex < m_dense.size()) &&
+           (m_denseToSlot[m_slots[slot].denseIndex] == slot);
+  }
+
+  // returns nullptr if the key is stale
+  inline T *get(const uint32_t key) {
+    return contains(key) ? &m_dense[m_slots[getSlotFromKey(key)].denseIndex]
+                         : nullptr;
+  }
+  inline const T *get(const uint32_t key) const {
+    return contains(key) ? &m_dense[m_slots[getSlotFromKey(key)].denseIndex]
+                         : nullptr;
+  }
+
+  [[nodiscard]] uint32_t size() const {
+    return static_cast<uint32_t>(m_dense.size());
+  }
+  [[nodiscard]] bool empty() const { return m_dense.empty(); }
+
+  // live entries, in no particular order, valid until the next insert or
+  // remove
+  T *data() { return m_dense.data(); }
+  const T *data() const { return m_dense.data(); }
+  T *begin() { return m_dense.data(); }
+  T *end() { return m_dense.data() + m_dense.size(); }
+  const T *begin() const { return m_dense.data(); }
+  const T *end() const { return m_dense.data() + m_dense.size(); }
+
+  // key of the entry at the given position of the dense array
+  uint32_t getKeyAtDenseIndex(const uint32_t denseIndex) const {
+    assert(denseIndex < m_dense.size());
+    const uint32_t slot = m_denseToSlot[denseIndex];
+    return makeKey(slot, m_slots[slot].generation);
+  }
+
+  static uint32_t getSlotFromKey(const uint32_t key) {
+    return key & SLOT_MASK;
+  }
+  static uint32_t getGenerationFromKey(const uint32_t key) {
+    return (key >> SLOT_BITS) & GENERATION_MASK;
+  }
+
+ private:
+  struct Slot {
+    uint32_t denseIndex;
+    uint32_t generation;
+  };
+
+  static uint32_t makeKey(const uint32_t slot, const uint32_t generation) {
+    return (generation << SLOT_BITS) | slot;
+  }
+
+ private:
+  static constexpr uint32_t SLOT_BITS = 16;
+  static constexpr uint32_t SLOT_MASK = (1 << SLOT_BITS) - 1;
+  static constexpr uint32_t GENERATION_MASK = (1 << 8) - 1;
+  // the last slot index is never handed out, it is the one of INVALID_KEY
+  static constexpr uint32_t MAX_SLOTS = SLOT_MASK;
+  static constexpr uint32_t NULL_SLOT = 0xFFFFFFFF;
+
+  std::vector<T> m_dense;
+  std::vector<uint32_t> m_denseToSlot;
+  std::vector<Slot> m_slots;
+  uint32_t m_nextFreeSlot = NULL_SLOT;
+};
+
+}  // namespace SirMetal
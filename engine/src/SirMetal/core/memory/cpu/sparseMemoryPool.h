@@ -2,6 +2,8 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <new>
+#include <type_traits>
 
 namespace SirMetal {
 
@@ -9,17 +11,20 @@ namespace SirMetal {
 // the pool tries to patch holes on new allocation, there is no
 // actual hard guarantees that the memory will actually be contiguous
 
-// the way it works is the following, you have a memory pool, which gets
-// allocated at the beginning. The memory gets initialized by a linked list,
-// which is a fancy term for index of the next available slot.
-// this mean the Nth index array will be initialized from Nth+1,
-// for example starting from zero memory will be set as 1,2,3,4...
-
-// the next empty slots starts at zero, when an allocation is made,
-// the nextAllocation slot is used and the value at which the slot points
-// to will be set as nextAllocation, for example if you do your first allocation
-// the address of memory[0] will be returned and nextAllocation will be 1,
-// because that is the value that memory[0] holds at the beginning.
+// the way it works is the following, the memory is split in chunks of the same
+// power of two size, chunks get allocated on demand when the pool runs out of
+// slots and are never moved or released until the pool is destroyed, meaning
+// an index, or a reference to the data, stays valid for as long as the slot is
+// allocated. Index N lives in chunk N / chunkSize at slot N % chunkSize.
+
+// freed slots are kept in a linked list, which is a fancy term for index of
+// the next available slot, stored in the freed slot memory itself.
+// When an allocation is made, if the linked list is not empty the head slot is
+// used and the value at which the slot points to becomes the new head,
+// otherwise the high water mark is used, which is the first slot never
+// allocated, and it is bumped by one. This means the list does not need to be
+// initialized upfront, so both construction and clear are constant time,
+// clear just resets the high water mark and the head of the list.
 
 // deletion works in a similar fashion, once a slot is freed, in the current
 // freed slot we store the current nextAllocation slot, and nextAllocation slot
@@ -28,55 +33,66 @@ namespace SirMetal {
 template <typename T>
 class SparseMemoryPool final {
  public:
-  explicit SparseMemoryPool(const uint32_t poolSize) {
+  explicit SparseMemoryPool(const uint32_t chunkSize) {
     // since we use uint32_t as indices we need at least 4 byte dataType
     // to store the "linked list" in the same memory.
-    assert(sizeof(T) >= 4);
-
-    m_memory = new T[poolSize];
-    m_poolSize = poolSize;
-    setupLinkedList();
-
-#if SE_DEBUG
-    m_freedMemory = new char[poolSize];
-    memset(m_freedMemory, 1, sizeof(char) * poolSize);
-#endif
+    static_assert(sizeof(T) >= 4);
+    // destructors are never called, slots are recycled by overriding them
+    static_assert(std::is_trivially_destructible<T>::value);
+    assert(chunkSize > 0);
+
+    m_chunkShift = 0;
+    while ((1u << m_chunkShift) < chunkSize) {
+      ++m_chunkShift;
+    }
+    m_chunkMask = (1u << m_chunkShift) - 1;
   };
 
   ~SparseMemoryPool() {
-    delete m_memory;
+    for (uint32_t i = 0; i < m_chunkCount; ++i) {
+      ::operator delete[](m_chunks[i], std::align_val_t{alignof(T)});
 #if SE_DEBUG
-    delete m_freedMemory;
+      delete[] m_freedMemory[i];
+#endif
+    }
+    delete[] m_chunks;
+#if SE_DEBUG
+    delete[] m_freedMemory;
 #endif
   };
   SparseMemoryPool(const SparseMemoryPool &) = delete;
   SparseMemoryPool &operator=(const SparseMemoryPool &) = delete;
 
   inline T &getFreeMemoryData(uint32_t &index) {
-    assert(m_allocationCount < m_poolSize &&
-           "requested deallocation is outside pool range");
-
-    index = m_nextAllocation;
-    m_nextAllocation =
-        *(reinterpret_cast<uint32_t *>(&m_memory[m_nextAllocation]));
+    if (m_nextAllocation != NULL_INDEX) {
+      index = m_nextAllocation;
+      m_nextAllocation = *(reinterpret_cast<uint32_t *>(getSlot(index)));
+    } else {
+      // free list is empty, we take the first slot never used
+      if (m_highWaterMark == getPoolSize()) {
+        addChunk();
+      }
+      index = m_highWaterMark++;
+    }
     ++m_allocationCount;
 #if SE_DEBUG
-    m_memory[index] = T{};
-    assert(m_freedMemory[index] == 1);
-    m_freedMemory[index] = 0;
+    assert(getFreedFlag(index) == 1);
+    getFreedFlag(index) = 0;
 #endif
-    return m_memory[index];
+    return *new (getSlot(index)) T{};
   }
   inline void free(const uint32_t index) {
+    assert(index < m_highWaterMark &&
+           "requested deallocation is outside pool range");
 #if SE_DEBUG
-    assert(m_freedMemory[index] == 0 && "memory has been already deallocated");
-    m_freedMemory[index] = 1;
-    m_memory[index] = T{};
+    assert(getFreedFlag(index) == 0 && "memory has been already deallocated");
+    getFreedFlag(index) = 1;
+    memset(getSlot(index), 0xff, sizeof(T));
 #endif
 
     --m_allocationCount;
     // set in the new freed slot the value to the next free slot
-    *(reinterpret_cast<uint32_t *>(&m_memory[index])) = m_nextAllocation;
+    *(reinterpret_cast<uint32_t *>(getSlot(index))) = m_nextAllocation;
     m_nextAllocation = index;
   }
   inline uint32_t getAllocatedCount() const { return m_allocationCount; }
@@ -84,54 +100,104 @@ class SparseMemoryPool final {
   // subscript operator to access the pool directly, we are adults, we don't
   // make mistakes, direct memory access is fine.
   inline T &operator[](const uint32_t index) {
-    assert(index < m_poolSize);
-    return m_memory[index];
+    assert(index < m_highWaterMark);
+    return *getSlot(index);
   }
 
   inline const T &getConstRef(const uint32_t index) const {
-    assert(index < m_poolSize);
-    return m_memory[index];
+    assert(index < m_highWaterMark);
+    return *getSlot(index);
   }
-  inline uint32_t getPoolSize() const { return m_poolSize; }
+  // number of slots in the currently allocated chunks
+  inline uint32_t getPoolSize() const { return m_chunkCount << m_chunkShift; }
+  inline uint32_t getChunkSize() const { return 1u << m_chunkShift; }
+  inline uint32_t getChunkCount() const { return m_chunkCount; }
+  // first slot never allocated since construction or the last clear
+  inline uint32_t getHighWaterMark() const { return m_highWaterMark; }
 
 #if SE_DEBUG
   bool assertEverythingDealloc() const {
     bool toReturn = true;
-    for (unsigned i = 0; i < m_poolSize; ++i) {
-      bool current = m_freedMemory[i];
+    for (unsigned i = 0; i < m_highWaterMark; ++i) {
+      bool current = m_freedMemory[i >> m_chunkShift][i & m_chunkMask];
       toReturn &= current;
     }
     return toReturn;
   }
 #endif
-  // TODO can we avoid the setup of linked list somehow?
-  // to note this is not a fast operation, the whole pool is getting
-  // iterate to set the linked list of allocations
+  // the chunks are kept, so the pool does not need to grow again to reach
+  // the same size
   void clear() {
-    setupLinkedList();
-    m_nextAllocation = 0;
+    m_highWaterMark = 0;
+    m_nextAllocation = NULL_INDEX;
     m_allocationCount = 0;
 #if SE_DEBUG
-    // clearing the debug memory to zero
-    memset(m_freedMemory, 1, sizeof(char) * m_poolSize);
+    // clearing the debug memory to freed
+    for (uint32_t i = 0; i < m_chunkCount; ++i) {
+      memset(m_freedMemory[i], 1, sizeof(char) * getChunkSize());
+    }
 #endif
   }
 
  private:
-  inline void setupLinkedList() {
-    // initializing the "linked list", nextAlloc is already init to 0;
-    for (uint32_t i = 0; i < m_poolSize; ++i) {
-      *(reinterpret_cast<uint32_t *>(&m_memory[i])) = i + 1;
+  inline T *getSlot(const uint32_t index) const {
+    return m_chunks[index >> m_chunkShift] + (index & m_chunkMask);
+  }
+
+#if SE_DEBUG
+  inline char &getFreedFlag(const uint32_t index) {
+    return m_freedMemory[index >> m_chunkShift][index & m_chunkMask];
+  }
+#endif
+
+  void addChunk() {
+    assert((static_cast<uint64_t>(m_chunkCount + 1) << m_chunkShift) <
+               NULL_INDEX &&
+           "pool out of indices");
+    // only the array of chunk pointers gets reallocated, the chunks
+    // themselves never move
+    if (m_chunkCount == m_chunkCapacity) {
+      const uint32_t newCapacity =
+          m_chunkCapacity == 0 ? 4 : m_chunkCapacity * 2;
+      T **newChunks = new T *[newCapacity];
+      if (m_chunkCount != 0) {
+        memcpy(newChunks, m_chunks, sizeof(T *) * m_chunkCount);
+      }
+      delete[] m_chunks;
+      m_chunks = newChunks;
+#if SE_DEBUG
+      char **newFreed = new char *[newCapacity];
+      if (m_chunkCount != 0) {
+        memcpy(newFreed, m_freedMemory, sizeof(char *) * m_chunkCount);
+      }
+      delete[] m_freedMemory;
+      m_freedMemory = newFreed;
+#endif
+      m_chunkCapacity = newCapacity;
     }
+    // raw memory, slots are constructed when allocated
+    m_chunks[m_chunkCount] = static_cast<T *>(::operator new[](
+        sizeof(T) * getChunkSize(), std::align_val_t{alignof(T)}));
+#if SE_DEBUG
+    m_freedMemory[m_chunkCount] = new char[getChunkSize()];
+    memset(m_freedMemory[m_chunkCount], 1, sizeof(char) * getChunkSize());
+#endif
+    ++m_chunkCount;
   }
 
  private:
-  T *m_memory = nullptr;
-  uint32_t m_poolSize;
+  static constexpr uint32_t NULL_INDEX = 0xFFFFFFFF;
+
+  T **m_chunks = nullptr;
+  uint32_t m_chunkCount = 0;
+  uint32_t m_chunkCapacity = 0;
+  uint32_t m_chunkShift;
+  uint32_t m_chunkMask;
+  uint32_t m_highWaterMark = 0;
   uint32_t m_allocationCount = 0;
-  uint32_t m_nextAllocation = 0;
+  uint32_t m_nextAllocation = NULL_INDEX;
 #if SE_DEBUG
-  char *m_freedMemory = nullptr;
+  char **m_freedMemory = nullptr;
 #endif
 };
 
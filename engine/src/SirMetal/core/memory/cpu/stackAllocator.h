@@ -14,20 +14,48 @@ class StackAllocator final {
     assert(isAllocatorValid());
     char *basePtr = m_SP;
     m_SP += sizeInByte;
+    m_lastAllocation = basePtr;
     assert(isAllocatorValid());
     return basePtr;
   }
 
-  inline void reset() { m_SP = m_start; };
+  inline void reset() {
+    m_SP = m_start;
+    m_lastAllocation = nullptr;
+  };
 
   // free bits from the top of the stack
   void *free(const size_t sizeByte) {
     assert(isAllocatorValid());
     m_SP -= sizeByte;
+    m_lastAllocation = nullptr;
     assert(isAllocatorValid());
     return m_SP;
   };
 
+  // free by pointer, only the last allocation can actually be freed, anything
+  // else stays allocated until reset
+  void free(void *ptr) {
+    if ((ptr != nullptr) & (ptr == m_lastAllocation)) {
+      m_SP = m_lastAllocation;
+      m_lastAllocation = nullptr;
+    }
+  }
+
+  // resizes the last allocation made, nothing is after it on the stack so it
+  // does not need to move
+  bool growInPlace(void *ptr, const size_t newSizeInByte) {
+    if ((ptr == nullptr) | (ptr != m_lastAllocation)) {
+      return false;
+    }
+    char *newSP = m_lastAllocation + newSizeInByte;
+    if (newSP > m_end) {
+      return false;
+    }
+    m_SP = newSP;
+    return true;
+  }
+
   void initialize(const size_t sizeInByte) {
     assert(m_start == nullptr);
     assert(m_end == nullptr);
@@ -83,6 +111,7 @@ class StackAllocator final {
   char *m_SP{nullptr};
   char *m_start{nullptr};
   char *m_end{nullptr};
+  char *m_lastAllocation{nullptr};
 };
 
 }  // namespace SirMetal
@@ -2,94 +2,114 @@
 
 #include <string.h>
 
-#include "SirMetal/core/hashing.h"
+#include "SirMetal/core/hashing/hashing.h"
 #include "SirMetal/core/memory/cpu/hashMap.h"
 #include "stringPool.h"
 
 namespace SirMetal {
 
+// String specialization of the hash map, the full 32 bit hash and the length
+// of every key are stored next to it, so while probing we only touch the
+// string memory for bins whose hash and length match, and then compare a known
+// number of bytes. Lookups can also be done with a HashedString, in that case
+// the key is never hashed or measured by the map.
+// If a StringPool is provided keys are copied in it on insert and released on
+// remove, otherwise the map stores the pointer it is given, which then needs
+// to outlive the map (string literals, interned names etc).
 template <typename VALUE>
 class HashMap<const char *, VALUE, hashString32> {
  public:
   // TODO add use of engine allocator, not only heap allocations
-  explicit HashMap(const uint32_t bins) : m_bins(bins) {
+  explicit HashMap(const uint32_t bins, StringPool *pool = nullptr)
+      : m_bins(bins), m_pool(pool) {
+    assert(bins > 0);
     m_keys = new const char *[m_bins];
+    m_hashes = new uint32_t[m_bins];
+    m_lengths = new uint32_t[m_bins];
     m_values = new VALUE[m_bins];
     const int count = ((m_bins * BIN_FLAGS_SIZE) / (8 * sizeof(uint32_t))) + 1;
     m_metadata = new uint32_t[count];
     // 85 is 01010101 in binary this means we fill 4 bins with the value of 1,
     // meaning free
     memset(m_keys, 0, m_bins * sizeof(char *));
+    memset(m_hashes, 0, m_bins * sizeof(uint32_t));
+    memset(m_lengths, 0, m_bins * sizeof(uint32_t));
     memset(m_metadata, 85, count * sizeof(uint32_t));
   }
 
   ~HashMap() {
+    if (m_pool != nullptr) {
+      for (uint32_t i = 0; i < m_bins; ++i) {
+        if (isBinUsed(i)) {
+          m_pool->free(m_keys[i]);
+        }
+      }
+    }
     delete[] m_keys;
+    delete[] m_hashes;
+    delete[] m_lengths;
     delete[] m_values;
     delete[] m_metadata;
   }
-  bool insert(const char *key, VALUE value) {
-    const uint32_t computedHash = hashString32(key);
 
-    // modding wit the bin count
-    uint32_t bin = computedHash % m_bins;
-    uint32_t meta = getMetadata(bin);
-    if ((m_keys[bin] != nullptr && strcmp(m_keys[bin], key) == 0) &
-        (meta == static_cast<uint32_t>(BIN_FLAGS::USED))) {
+  bool insert(const char *key, VALUE value) {
+    return insert(hashedString(key), value);
+  }
+  bool insert(const HashedString &key, VALUE value) {
+    uint32_t bin = 0;
+    if (getBin(key, bin)) {
       // key exists we just override the value
       m_values[bin] = value;
       return true;
     }
 
+    // modding wit the bin count
+    bin = key.hash % m_bins;
     const uint32_t startBin = bin;
-    //this might still fail if you actually store null pointer as a string.
-    bool free = canWriteToBin(meta);
-    while ((!free) && !(m_keys[bin] != nullptr && strcmp(m_keys[bin], key) == 0)) {
+    while (!canWriteToBin(getMetadata(bin))) {
       ++bin;
       bin = bin % m_bins;  // wrap around the bins count
-      meta = getMetadata(bin);
-      free = canWriteToBin(meta);
       if (bin == startBin) {
         return false;
       }
     }
-    const char *newKey = globals::STRING_POOL->allocatePersistent(key);
-    writeToBin(bin, newKey, value);
+    const char *newKey =
+        m_pool != nullptr ? m_pool->allocatePersistent(key.string) : key.string;
+    writeToBin(bin, newKey, key.hash, key.length, value);
     setMetadata(bin, BIN_FLAGS::USED);
 
     return true;
   }
 
   [[nodiscard]] bool containsKey(const char *key) const {
+    return containsKey(hashedString(key));
+  }
+  [[nodiscard]] bool containsKey(const HashedString &key) const {
     uint32_t bin = 0;
-    const bool isKeyFound = getBin(key, bin);
-    const uint32_t meta = getMetadata(bin);
-    return isKeyFound &
-           (m_keys[bin] != nullptr &&
-            strcmp(m_keys[bin], key) == 0)  // does the key match?
-           &
-           (meta == static_cast<uint32_t>(
-                        BIN_FLAGS::USED));  // is the bin actually used, we dont
-                                            // delete anything so if they key is
-                                            // deleted key value might still
-                                            // match but metadata is set to free
+    return getBin(key, bin);
   }
 
   inline bool get(const char *key, VALUE &value) const {
+    return get(hashedString(key), value);
+  }
+  inline bool get(const HashedString &key, VALUE &value) const {
     uint32_t bin = 0;
     const bool result = getBin(key, bin);
-    value = m_values[bin];
+    if (result) {
+      value = m_values[bin];
+    }
     return result;
   }
 
-  inline bool remove(const char *key) {
+  inline bool remove(const char *key) { return remove(hashedString(key)); }
+  inline bool remove(const HashedString &key) {
     uint32_t bin = 0;
     const bool result = getBin(key, bin);
-    const uint32_t meta = getMetadata(bin);
-    assert(meta == static_cast<uint32_t>(BIN_FLAGS::USED));
     if (result) {
       setMetadata(bin, BIN_FLAGS::DELETED);
-      globals::STRING_POOL->free(m_keys[bin]);
+      if (m_pool != nullptr) {
+        m_pool->free(m_keys[bin]);
+      }
       m_keys[bin] = nullptr;
       --m_usedBins;
     }
@@ -109,6 +129,11 @@ class HashMap<const char *, VALUE, hashString32> {
     assert(bin < m_bins);
     return m_keys[bin];
   }
+  uint32_t getHashAtBin(const uint32_t bin) const {
+    // no check done whether the bin is used or not, up to you kid
+    assert(bin < m_bins);
+    return m_hashes[bin];
+  }
   VALUE getValueAtBin(uint32_t bin) {
     // no check done whether the bin is used or not, up to you kid
     assert(bin < m_bins);
@@ -122,39 +147,43 @@ class HashMap<const char *, VALUE, hashString32> {
  private:
   enum class BIN_FLAGS { NONE = 0, FREE = 1, DELETED = 2, USED = 3 };
 
-  bool getBin(const char *key, uint32_t &bin) const {
-    const uint32_t computedHash = hashString32(key);
-    bin = computedHash % m_bins;
+  bool getBin(const HashedString &key, uint32_t &bin) const {
+    bin = key.hash % m_bins;
     const uint32_t startBin = bin;
 
-    bool go = true;
-    bool status = true;
-    while (go) {
+    while (true) {
       const uint32_t meta = getMetadata(bin);
-      const bool isKeyTheSame =
-          m_keys[bin] != nullptr && strcmp(key, m_keys[bin]) == 0;
+      // a free bin terminates the probing sequence, deleted bins don't since
+      // the key we are looking for might have been inserted past them
+      if (meta == static_cast<uint32_t>(BIN_FLAGS::FREE)) {
+        return false;
+      }
+      // the string is only compared if the hashes and lengths match
       const bool isBinUsed = meta == static_cast<uint32_t>(BIN_FLAGS::USED);
-      if (isKeyTheSame & isBinUsed) {
-        break;
+      if (isBinUsed & (m_hashes[bin] == key.hash) &
+              (m_lengths[bin] == key.length) &&
+          memcmp(key.string, m_keys[bin], key.length) == 0) {
+        return true;
       }
 
       ++bin;
       bin = bin % m_bins;  // wrap around the bins count
-      if ((bin == startBin) | !isBinUsed) {
-        go = false;
-        status = false;
+      if (bin == startBin) {
+        return false;
       }
     }
-    return status;
   }
 
-  inline bool canWriteToBin(const uint32_t metadata) {
+  static inline bool canWriteToBin(const uint32_t metadata) {
     return (metadata == static_cast<uint32_t>(BIN_FLAGS::FREE)) |
            (metadata == static_cast<uint32_t>(BIN_FLAGS::DELETED));
   }
 
-  inline void writeToBin(uint32_t bin, const char *key, VALUE value) {
+  inline void writeToBin(uint32_t bin, const char *key, const uint32_t hash,
+                         const uint32_t length, VALUE value) {
     m_keys[bin] = key;
+    m_hashes[bin] = hash;
+    m_lengths[bin] = length;
     m_values[bin] = value;
     ++m_usedBins;
   }
@@ -187,9 +216,12 @@ class HashMap<const char *, VALUE, hashString32> {
   static constexpr uint32_t BIN_FLAGS_MASK = 3;  // first two bit sets
 
   const char **m_keys;
+  uint32_t *m_hashes;
+  uint32_t *m_lengths;
   VALUE *m_values;
   uint32_t *m_metadata;
   uint32_t m_bins;
   uint32_t m_usedBins = 0;
+  StringPool *m_pool;
 };
 }  // namespace SirMetal
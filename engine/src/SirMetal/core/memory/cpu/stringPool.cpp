@@ -1,4 +1,6 @@
 #include "SirMetal/core/memory/cpu/stringPool.h"
+#include "SirMetal/io/mappedFile.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <wchar.h>
@@ -43,50 +45,33 @@ inline int isFlagSet(const uint8_t flags,
 
 const char *StringPool::loadFilePersistent(const char *path,
                                            uint32_t &readFileSize) {
-  FILE *fp = fopen(path, "rb");
-  // assert((error == 0) && "could not open file");
-  if (fp == nullptr) {
-    printf("[Error] Could not open file %s", path);
+  const MappedFile file = MappedFile::open(path);
+  if (!file.isValid()) {
     return nullptr;
   }
-
-  fseek(fp, 0L, SEEK_END);
-  const long fileSize = ftell(fp);
-  rewind(fp);
-  readFileSize = fileSize + 1;
-
-  // allocating memory
-  char *buffer = reinterpret_cast<char *>(m_pool.allocate(fileSize + 1));
-
-  const uint64_t count = fread(buffer, fileSize, 1, fp);
-  assert(count == 1 && "error reading actual memory from file");
-  // need tos et the final value
+  // a single copy from the page cache in the pool, the string needs to own
+  // its memory and be null terminated
+  const uint64_t fileSize = file.size();
+  readFileSize = static_cast<uint32_t>(fileSize + 1);
+  char *buffer = reinterpret_cast<char *>(m_pool.allocate(readFileSize));
+  memcpy(buffer, file.data(), fileSize);
   buffer[fileSize] = '\0';
-
-  fclose(fp);
   return buffer;
 }
 
 const char *StringPool::loadFileFrame(const char *path,
                                       uint32_t &readFileSize) {
-  FILE *fp = fopen(path, "rb");
-  assert((fp != nullptr) && "could not open file");
-
-  fseek(fp, 0L, SEEK_END);
-  const long fileSize = ftell(fp);
-  rewind(fp);
-  readFileSize = fileSize + 1;
-
-  // allocating memory
+  const MappedFile file = MappedFile::open(path);
+  assert(file.isValid() && "could not open file");
+  if (!file.isValid()) {
+    return nullptr;
+  }
+  const uint64_t fileSize = file.size();
+  readFileSize = static_cast<uint32_t>(fileSize + 1);
   char *buffer =
-      reinterpret_cast<char *>(m_stackAllocator.allocate(fileSize + 1));
-
-  const uint64_t count = fread(buffer, fileSize, 1, fp);
-  assert(count == 1 && "error reading actual memory from file");
-  // need tos et the final value
+      reinterpret_cast<char *>(m_stackAllocator.allocate(readFileSize));
+  memcpy(buffer, file.data(), fileSize);
   buffer[fileSize] = '\0';
-
-  fclose(fp);
   return buffer;
 }
 
@@ -5,12 +5,19 @@
 namespace SirMetal {
 
 // This is memory pool, which allows any kind of size allocation.
-// Main feature is that allocations are bucketed based on 3 sizes, small ,medium
-// large. Three different linked lists keeps track of freed allocation, when a
-// new allocation is made a check in the linked list of the right bucket is
-// made, if there is any allocation to be recycled it will be used, otherwise
-// normal allocation will be made by increasing the stack pointer, to note stack
-// pointer can never be decreased.
+// Allocations are still counted based on 3 sizes, small, medium and large, but
+// freed blocks are recycled through segregated size classes, TLSF style: a
+// first level per power of two and 16 linear second level classes inside each
+// one, two levels of bitmaps tell us which classes have free blocks, so
+// finding a block that fits is a couple of bit scans no matter how many free
+// blocks there are. The search starts from the class above the requested size,
+// so any block found fits, this is a good fit rather than the strict best
+// fit, the waste is bounded by the class width (1/16th of the size).
+// Blocks found are split if the remainder is big enough to be a block on its
+// own and freed blocks are merged with free neighbours, so the pool does not
+// fragment over time.
+// If nothing is free allocation is made by increasing the stack pointer, to
+// note stack pointer can never be decreased.
 class  ThreeSizesPool final {
 private:
 // flags used to mark the headers and allocations
@@ -18,19 +25,37 @@ private:
 #define MEDIUM_ALLOC_TAG 2;
 #define LARGE_ALLOC_TAG 4;
 
-  // This struct is the node of the linked list, enough information are
-  // stored to keep track of the current memory block and the next,
-  // the smallest allocation possible is the same size of the NextAlloc
-  // otherwise we would not be able to store the node in the pool
-  struct NextAlloc {
-    uint32_t offset : 32; // offset from the start of the pool in byte
-    uint32_t nextOffset;  // offset from the start of the pool in byte for the
+public:
+  // this is an allocation description, is always going to be present, so if we
+  // ask to allocate a some memory we will always allocate that memory + the
+  // header. It is public because some tools, like string pool can benefit from
+  // this
+
+  // This class defines a memory allocation, the data will live before the
+  // actual reserved memory for the user
+  struct AllocHeader {
+    uint32_t size : 20;      // size in byte of the allocation
+    uint32_t allocFlags : 8; // user defined flags for the allocation, mostly
+                             // useful for tools
+    uint32_t type : 2;   // type of allocation, either SMALL , MEDIUM or LARGE
+    uint32_t isPreviousFree : 1; // for internal use, whether the block right
+                                 // before this one in memory is free
+    uint32_t isNode : 1; // for internal use, whether the memory is a free
+                         // list node or not, mostly used for assertions
+  };
+
+private:
+  // This struct is the node of the free lists, it lives in the freed block
+  // itself, the smallest allocation possible is the size of the node plus the
+  // footer, otherwise we would not be able to store the node in the pool.
+  // The last 4 bytes of a free block hold its size, that is how a block being
+  // freed finds the start of a free block before it
+  struct FreeBlock {
+    AllocHeader header;
+    uint32_t nextOffset;     // offset from the start of the pool in byte for
+                             // the next node in the list, NULL_OFFSET if none
     uint32_t previousOffset; // offset from the start of the pool in byte for
-                             // the previous node in the linked list, 0 if null
-    bool isNode : 1;    // a bit flag setting whether the data here refers to a
-                        // node or an alloc, mostly debugging purpose
-    uint32_t size : 28; // size of the allocation in byte
-    uint32_t allocType : 3; // type of allocation
+                             // the previous node in the list
   };
 
   // helpers
@@ -42,57 +67,195 @@ private:
     return isInMediumRange + isInLargeRange * 2;
   }
 
-  void *allocateNew(const uint32_t sizeInByte, uint8_t flags) {
-    uint32_t totalAllocSize = sizeInByte + sizeof(AllocHeader);
-    totalAllocSize =
-        totalAllocSize < MIN_ALLOC_SIZE ? MIN_ALLOC_SIZE : totalAllocSize;
+  // user size + header, rounded so that every header stays 4 bytes aligned
+  static uint32_t getTotalAllocSize(const uint32_t sizeInByte) {
+    uint32_t totalAllocSize =
+        (sizeInByte + sizeof(AllocHeader) + BLOCK_ALIGNMENT - 1) &
+        ~(BLOCK_ALIGNMENT - 1);
+    return totalAllocSize < MIN_ALLOC_SIZE ? MIN_ALLOC_SIZE : totalAllocSize;
+  }
 
-    auto *header =
-        reinterpret_cast<AllocHeader *>(m_memory + m_stackPointerOffset);
-    header->size = totalAllocSize;
-    header->isNode = false;
-    header->type = getAllocationTypeFromSize(sizeInByte);
-    header->allocFlags = flags;
+  static inline uint32_t highestBit(const uint32_t value) {
+    return 31 - static_cast<uint32_t>(__builtin_clz(value));
+  }
+  static inline uint32_t lowestBit(const uint32_t value) {
+    return static_cast<uint32_t>(__builtin_ctz(value));
+  }
 
-    ++m_allocCount[header->type];
-    m_stackPointerOffset += totalAllocSize;
+  // maps a size to the class it belongs to, below SMALL_BLOCK_SIZE classes
+  // are linear, 8 bytes each
+  static void mapSize(const uint32_t size, uint32_t &firstLevel,
+                      uint32_t &secondLevel) {
+    if (size < SMALL_BLOCK_SIZE) {
+      firstLevel = 0;
+      secondLevel = size / (SMALL_BLOCK_SIZE / SECOND_LEVEL_COUNT);
+      return;
+    }
+    const uint32_t bit = highestBit(size);
+    firstLevel = bit - FIRST_LEVEL_SHIFT;
+    secondLevel = (size >> (bit - SECOND_LEVEL_LOG2)) ^ SECOND_LEVEL_COUNT;
+  }
 
-    return reinterpret_cast<char *>(header) + sizeof(AllocHeader);
+  // same as mapSize but rounding the size up to the next class, every block
+  // of the returned class or above is big enough for the size
+  static void mapSizeForSearch(const uint32_t size, uint32_t &firstLevel,
+                               uint32_t &secondLevel) {
+    uint32_t rounded = size;
+    if (size < SMALL_BLOCK_SIZE) {
+      rounded += (SMALL_BLOCK_SIZE / SECOND_LEVEL_COUNT) - 1;
+    } else {
+      rounded += (1u << (highestBit(size) - SECOND_LEVEL_LOG2)) - 1;
+    }
+    mapSize(rounded, firstLevel, secondLevel);
+  }
+
+  inline AllocHeader *getHeader(const uint32_t offset) const {
+    return reinterpret_cast<AllocHeader *>(m_memory + offset);
+  }
+  inline FreeBlock *getFreeBlock(const uint32_t offset) const {
+    return reinterpret_cast<FreeBlock *>(m_memory + offset);
+  }
+  inline uint32_t *getFooter(const uint32_t offset, const uint32_t size) const {
+    return reinterpret_cast<uint32_t *>(m_memory + offset + size -
+                                        sizeof(uint32_t));
+  }
+
+  // only valid if the previous block is free, reads its footer
+  inline uint32_t getPreviousBlockSize(const uint32_t offset) const {
+    return *reinterpret_cast<uint32_t *>(m_memory + offset - sizeof(uint32_t));
+  }
+
+  inline void setPreviousFreeOfNext(const uint32_t offset, const uint32_t size,
+                                    const bool value) {
+    const uint32_t nextOffset = offset + size;
+    if (nextOffset < m_stackPointerOffset) {
+      getHeader(nextOffset)->isPreviousFree = value;
+    } else {
+      // there is no block yet, we keep it for the next one on the stack
+      m_isLastBlockFree = value;
+    }
+  }
+
+  void insertFreeBlock(const uint32_t offset, const uint32_t size,
+                       const bool isPreviousFree) {
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    mapSize(size, firstLevel, secondLevel);
+
+    FreeBlock *block = getFreeBlock(offset);
+    block->header.size = size;
+    block->header.allocFlags = 0;
+    block->header.type = 0;
+    block->header.isPreviousFree = isPreviousFree;
+    block->header.isNode = true;
+    block->previousOffset = NULL_OFFSET;
+    block->nextOffset = m_freeHeads[firstLevel][secondLevel];
+    if (block->nextOffset != NULL_OFFSET) {
+      getFreeBlock(block->nextOffset)->previousOffset = offset;
+    }
+    *getFooter(offset, size) = size;
+
+    m_freeHeads[firstLevel][secondLevel] = offset;
+    m_firstLevelBitmap |= 1u << firstLevel;
+    m_secondLevelBitmap[firstLevel] |= 1u << secondLevel;
+    m_freeListBytes += size;
+
+    setPreviousFreeOfNext(offset, size, true);
   }
 
-  NextAlloc *findNextFreeAllocForSize(NextAlloc *start,
-                                      uint32_t totalAllocSize) {
-    if (totalAllocSize <= start->size) {
-      return start;
+  void removeFreeBlock(const uint32_t offset) {
+    FreeBlock *block = getFreeBlock(offset);
+    assert(block->header.isNode == true);
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    mapSize(block->header.size, firstLevel, secondLevel);
+
+    if (block->nextOffset != NULL_OFFSET) {
+      getFreeBlock(block->nextOffset)->previousOffset = block->previousOffset;
     }
-    NextAlloc *current = start;
-    while (current->nextOffset != 0) {
-      current = reinterpret_cast<NextAlloc *>(m_memory + current->nextOffset);
-      if (totalAllocSize < current->size) {
-        return current;
+    if (block->previousOffset != NULL_OFFSET) {
+      getFreeBlock(block->previousOffset)->nextOffset = block->nextOffset;
+    } else {
+      // it was the head of the list
+      m_freeHeads[firstLevel][secondLevel] = block->nextOffset;
+      if (block->nextOffset == NULL_OFFSET) {
+        m_secondLevelBitmap[firstLevel] &= ~(1u << secondLevel);
+        if (m_secondLevelBitmap[firstLevel] == 0) {
+          m_firstLevelBitmap &= ~(1u << firstLevel);
+        }
       }
     }
-    return nullptr;
+    m_freeListBytes -= block->header.size;
   }
 
-public:
-  // this is an allocation description, is always going to be present, so if we
-  // ask to allocate a some memory we will always allocate that memory + the
-  // header. It is public because some tools, like string pool can benefit from
-  // this
+  uint32_t findFreeBlock(const uint32_t totalAllocSize) const {
+    uint32_t firstLevel;
+    uint32_t secondLevel;
+    // the class of the size itself might have blocks big enough, we check
+    // only the head of the list, so it stays O(1), this catches exact fits
+    // which the rounded search would skip
+    mapSize(totalAllocSize, firstLevel, secondLevel);
+    const uint32_t head = m_freeHeads[firstLevel][secondLevel];
+    if ((head != NULL_OFFSET) &&
+        (getFreeBlock(head)->header.size >= totalAllocSize)) {
+      return head;
+    }
 
-  // This class defines a memory allocation, the data will live before the
-  // actual reserved memory for the user
-  struct AllocHeader {
-    uint32_t size : 20;      // size in byte of the allocation
-    uint32_t allocFlags : 8; // user defined flags for the allocation, mostly
-                             // useful for tools
-    uint32_t type : 3;   // type of allocation, either SMALL , MEDIUM or LARGE
-                         // depending of the bit set
-    uint32_t isNode : 1; // for internal use, whether the memory is a linked
-                         // list node or not, mostly used for assertions
-  };
+    mapSizeForSearch(totalAllocSize, firstLevel, secondLevel);
+    if (firstLevel >= FIRST_LEVEL_COUNT) {
+      return NULL_OFFSET;
+    }
+
+    // first we look for the requested class or a bigger one in the same first
+    // level, if there is none we move to the next first level that has any
+    uint32_t secondLevelMap =
+        m_secondLevelBitmap[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0) {
+      const uint32_t firstLevelMap =
+          m_firstLevelBitmap & (~0u << (firstLevel + 1));
+      if (firstLevelMap == 0) {
+        return NULL_OFFSET;
+      }
+      firstLevel = lowestBit(firstLevelMap);
+      secondLevelMap = m_secondLevelBitmap[firstLevel];
+    }
+    return m_freeHeads[firstLevel][lowestBit(secondLevelMap)];
+  }
 
+  void *writeAllocation(const uint32_t offset, const uint32_t size,
+                        const uint32_t allocType, const uint8_t flags,
+                        const bool isPreviousFree) {
+    AllocHeader *header = getHeader(offset);
+    header->size = size;
+    header->isNode = false;
+    header->isPreviousFree = isPreviousFree;
+    header->type = allocType;
+    header->allocFlags = flags;
+
+    ++m_allocCount[allocType];
+    m_usedBytes += size;
+    m_peakUsedBytes = m_usedBytes > m_peakUsedBytes ? m_usedBytes
+                                                    : m_peakUsedBytes;
+
+    return reinterpret_cast<char *>(header) + sizeof(AllocHeader);
+  }
+
+  void *allocateNew(const uint32_t totalAllocSize, const uint32_t allocType,
+                    uint8_t flags) {
+    assert((m_stackPointerOffset + totalAllocSize) <= m_poolSizeInByte &&
+           "pool out of memory");
+    const uint32_t offset = m_stackPointerOffset;
+    m_stackPointerOffset += totalAllocSize;
+    m_peakStackPointerOffset = m_stackPointerOffset > m_peakStackPointerOffset
+                                   ? m_stackPointerOffset
+                                   : m_peakStackPointerOffset;
+    const bool isPreviousFree = m_isLastBlockFree;
+    m_isLastBlockFree = false;
+    return writeAllocation(offset, totalAllocSize, allocType, flags,
+                           isPreviousFree);
+  }
+
+public:
   explicit ThreeSizesPool(const uint32_t poolSizeInByte,
                           const uint32_t smallSize = 64,
                           const uint32_t mediumSize = 256) {
@@ -101,12 +264,10 @@ public:
     m_mediumSize = mediumSize;
     m_memory = new char[m_poolSizeInByte];
 
-    m_nextAlloc[0] = nullptr;
-    m_nextAlloc[1] = nullptr;
-    m_nextAlloc[2] = nullptr;
+    memset(m_freeHeads, 0xff, sizeof(m_freeHeads));
   };
 
-  ~ThreeSizesPool() { delete m_memory; }
+  ~ThreeSizesPool() { delete[] m_memory; }
 
   // public interface
 
@@ -140,6 +301,50 @@ public:
   uint32_t getLargeAllocCount() const { return m_allocCount[2]; }
 
   static uint32_t getMinAllocSize() { return MIN_ALLOC_SIZE; }
+  // biggest user size a single allocation can have
+  static uint32_t getMaxAllocSize() {
+    return MAX_BLOCK_SIZE - sizeof(AllocHeader);
+  }
+
+  // metrics, all sizes are raw sizes, meaning headers included
+
+  // bytes of the live allocations
+  uint32_t getUsedBytes() const { return m_usedBytes; }
+  uint32_t getPeakUsedBytes() const { return m_peakUsedBytes; }
+  // bytes of the pool touched so far, live allocations plus free blocks, that
+  // is where the stack pointer is
+  uint32_t getFootprint() const { return m_stackPointerOffset; }
+  uint32_t getPeakFootprint() const { return m_peakStackPointerOffset; }
+  // bytes sitting in the free lists, below the stack pointer
+  uint32_t getFreeListBytes() const { return m_freeListBytes; }
+
+  uint32_t getLargestFreeBlock() const {
+    if (m_firstLevelBitmap == 0) {
+      return 0;
+    }
+    // the biggest block is in the highest class, but a class is a range, so
+    // we still need to walk that one list
+    const uint32_t firstLevel = highestBit(m_firstLevelBitmap);
+    const uint32_t secondLevel = highestBit(m_secondLevelBitmap[firstLevel]);
+    uint32_t largest = 0;
+    uint32_t offset = m_freeHeads[firstLevel][secondLevel];
+    while (offset != NULL_OFFSET) {
+      const FreeBlock *block = getFreeBlock(offset);
+      largest = block->header.size > largest ? block->header.size : largest;
+      offset = block->nextOffset;
+    }
+    return largest;
+  }
+
+  // 0 means all the free memory below the stack pointer is a single block,
+  // the closer to 1 the more it is scattered in small blocks
+  float getFragmentation() const {
+    if (m_freeListBytes == 0) {
+      return 0.0f;
+    }
+    return 1.0f - static_cast<float>(getLargestFreeBlock()) /
+                      static_cast<float>(m_freeListBytes);
+  }
 
   // methods
   void free(void *memoryPtr) {
@@ -148,108 +353,77 @@ public:
 
     auto *header =
         reinterpret_cast<AllocHeader *>(bytePtr - sizeof(AllocHeader));
-
-    const uint32_t allocSize = header->size;
     assert(header->isNode == 0);
 
-/* TODO need to have a generic debug flag
-#if _DEBUG
+    uint32_t offset = static_cast<uint32_t>(bytePtr - m_memory) -
+                      sizeof(AllocHeader);
+    uint32_t size = header->size;
+    bool isPreviousFree = header->isPreviousFree;
+
+#if SE_DEBUG
     // tagging the memory as freed
-    memset(memoryPtr, 0xff, allocSize - sizeof(AllocHeader));
+    memset(memoryPtr, 0xff, size - sizeof(AllocHeader));
 #endif
-*/
-
-    int allocType =
-        getAllocationTypeFromSize(header->size - sizeof(AllocHeader));
-    // lets create the node to dealloc
-    NextAlloc alloc{};
-    alloc.size = header->size;
-    alloc.isNode = true;
-    alloc.allocType = 1 << allocType;
-    alloc.nextOffset = 0;
-    alloc.previousOffset = 0;
-    alloc.offset = reinterpret_cast<char *>(header) - m_memory;
 
     // reducing alloc count
-    --m_allocCount[allocType];
-
-    // lets add to the linked list
-    if (m_nextAlloc[allocType] != nullptr) {
-      // patching offset of the next, and for the next patching offset
-      // of this to keep a doubled linked list
-      alloc.nextOffset = m_nextAlloc[allocType]->offset;
-      m_nextAlloc[allocType]->previousOffset = alloc.offset;
+    --m_allocCount[header->type];
+    m_usedBytes -= size;
+
+    // merging with the free block before, if any, blocks are merged only if
+    // the result still fits in the header size
+    if (isPreviousFree) {
+      const uint32_t previousSize = getPreviousBlockSize(offset);
+      if (previousSize + size <= MAX_BLOCK_SIZE) {
+        offset -= previousSize;
+        size += previousSize;
+        isPreviousFree = getHeader(offset)->isPreviousFree;
+        removeFreeBlock(offset);
+      }
     }
 
-    // now that the whole header is setup we commit it to memory
-    memcpy(header, &alloc, sizeof(NextAlloc));
+    // merging with the free block after, if any, the last block has nothing
+    // after it, the stack pointer is never moved back
+    const uint32_t nextOffset = offset + size;
+    if (nextOffset < m_stackPointerOffset) {
+      const AllocHeader *next = getHeader(nextOffset);
+      if (next->isNode && (next->size + size <= MAX_BLOCK_SIZE)) {
+        const uint32_t nextSize = next->size;
+        removeFreeBlock(nextOffset);
+        size += nextSize;
+      }
+    }
 
-    m_nextAlloc[allocType] = reinterpret_cast<NextAlloc *>(header);
+    insertFreeBlock(offset, size, isPreviousFree);
   };
 
   void *allocate(const uint32_t sizeInByte, uint8_t flags = 0) {
-    assert((m_stackPointerOffset + sizeInByte) < m_poolSizeInByte);
     // first lets find out what kind of allocation has been requested
-    uint32_t allocType = getAllocationTypeFromSize(sizeInByte);
-
-    // next we check if we have any allocation we can recycle
-    NextAlloc *currentLinkedListTip = m_nextAlloc[allocType];
-    if (currentLinkedListTip != nullptr) {
-      // ok we have something in the cache let us try see if one slot is big
-      // enough
-      const uint32_t totalAllocSize = sizeInByte + sizeof(AllocHeader);
-      NextAlloc *found =
-          findNextFreeAllocForSize(currentLinkedListTip, totalAllocSize);
-
-      // if an allocation big enough in the bucket is not found we
-      // perform a new allocation
-      if (found == nullptr) {
-        return allocateNew(sizeInByte, flags);
-      }
-
-      assert(found->isNode == true);
-
-      // patching linked list
-      NextAlloc *nextInList =
-          found->nextOffset != 0
-              ? reinterpret_cast<NextAlloc *>(m_memory + found->nextOffset)
-              : nullptr;
-      NextAlloc *previousInList =
-          found->previousOffset != 0
-              ? reinterpret_cast<NextAlloc *>(m_memory + found->previousOffset)
-              : nullptr;
-
-      if (previousInList != nullptr) {
-        // if we have a previous node we need to update the offsets
-        previousInList->nextOffset =
-            nextInList != nullptr ? nextInList->offset : 0;
-      }
-
-      if (nextInList != nullptr) {
-        nextInList->previousOffset =
-            previousInList != nullptr ? previousInList->offset : 0;
-      }
-
-      // finally we set the head of the linked list
-      if (m_nextAlloc[allocType] == found) {
-        m_nextAlloc[allocType] = nextInList;
-      }
-
-      ++m_allocCount[allocType];
-
-      // lets now build the header
-      AllocHeader header{};
-      header.size = found->size;
-      header.isNode = false;
-      header.type = allocType;
-      header.allocFlags = flags;
-      memcpy(found, &header, sizeof(header));
+    const uint32_t allocType = getAllocationTypeFromSize(sizeInByte);
+    const uint32_t totalAllocSize = getTotalAllocSize(sizeInByte);
+    assert(totalAllocSize <= MAX_BLOCK_SIZE && "allocation too big for pool");
+
+    // next we check if we have any block we can recycle
+    const uint32_t offset = findFreeBlock(totalAllocSize);
+    if (offset == NULL_OFFSET) {
+      // no hit in the free lists, we need to allocate from the stack
+      return allocateNew(totalAllocSize, allocType, flags);
+    }
 
-      return reinterpret_cast<char *>(found) + sizeof(AllocHeader);
+    const FreeBlock *found = getFreeBlock(offset);
+    uint32_t size = found->header.size;
+    const bool isPreviousFree = found->header.isPreviousFree;
+    removeFreeBlock(offset);
+
+    // if what is left is big enough for a block we split it and give it back
+    // to the free lists, otherwise the allocation keeps the whole block
+    if (size - totalAllocSize >= MIN_ALLOC_SIZE) {
+      insertFreeBlock(offset + totalAllocSize, size - totalAllocSize, false);
+      size = totalAllocSize;
+    } else {
+      setPreviousFreeOfNext(offset, size, false);
     }
 
-    // no hit in the cache, we need to allocate from the pool
-    return allocateNew(sizeInByte, flags);
+    return writeAllocation(offset, size, allocType, flags, isPreviousFree);
   }
 
   // deleted copy constructors and assignment operator
@@ -257,15 +431,40 @@ public:
   ThreeSizesPool &operator=(const ThreeSizesPool &) = delete;
 
 private:
-  static constexpr uint32_t MIN_ALLOC_SIZE = sizeof(NextAlloc);
+  static constexpr uint32_t NULL_OFFSET = 0xFFFFFFFF;
+  static constexpr uint32_t BLOCK_ALIGNMENT = 4;
+  static constexpr uint32_t MIN_ALLOC_SIZE =
+      sizeof(FreeBlock) + sizeof(uint32_t);
+  // biggest size the 20 bits of the header can hold, keeping the alignment
+  static constexpr uint32_t MAX_BLOCK_SIZE =
+      ((1u << 20) - 1) & ~(BLOCK_ALIGNMENT - 1);
+  // size classes, 16 per power of two, sizes below SMALL_BLOCK_SIZE all go in
+  // the first level with linear classes
+  static constexpr uint32_t SECOND_LEVEL_LOG2 = 4;
+  static constexpr uint32_t SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_LOG2;
+  static constexpr uint32_t SMALL_BLOCK_SIZE = 128;
+  // log2(SMALL_BLOCK_SIZE) - 1, so that SMALL_BLOCK_SIZE maps to level 1
+  static constexpr uint32_t FIRST_LEVEL_SHIFT = 6;
+  // levels needed to cover 20 bits of size
+  static constexpr uint32_t FIRST_LEVEL_COUNT = 20 - FIRST_LEVEL_SHIFT;
+
   char *m_memory = nullptr;
   uint32_t m_poolSizeInByte;
   uint32_t m_stackPointerOffset = 0;
+  bool m_isLastBlockFree = false;
+
+  uint32_t m_firstLevelBitmap = 0;
+  uint32_t m_secondLevelBitmap[FIRST_LEVEL_COUNT]{};
+  uint32_t m_freeHeads[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
 
-  NextAlloc *m_nextAlloc[3];
   uint32_t m_allocCount[3]{};
   uint32_t m_smallSize;
   uint32_t m_mediumSize;
+
+  uint32_t m_usedBytes = 0;
+  uint32_t m_peakUsedBytes = 0;
+  uint32_t m_peakStackPointerOffset = 0;
+  uint32_t m_freeListBytes = 0;
 };
 
 } // namespace SirMetal
@@ -0,0 +1,165 @@
+#pragma once
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// not thread safe
+namespace SirMetal {
+
+// Linear allocator on top of a reserved range of virtual memory. Reserving is
+// only taking address space, nothing is backed by physical memory until it is
+// committed, and pages are committed as the stack pointer moves forward, so
+// the reservation can be huge at no cost.
+// Nothing lives after the last allocation, so that one can grow in place: a
+// buffer that keeps growing, like the vertices of a big mesh being loaded,
+// never needs to be copied as long as it is the last allocation made.
+class VirtualMemoryArena final {
+ public:
+  VirtualMemoryArena() = default;
+  explicit VirtualMemoryArena(const size_t reserveInByte) {
+    initialize(reserveInByte);
+  }
+  ~VirtualMemoryArena() {
+    if (m_start != nullptr) {
+      munmap(m_start, m_reserved);
+    }
+  }
+
+  void initialize(const size_t reserveInByte) {
+    assert(m_start == nullptr);
+    m_pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    m_reserved = roundUp(reserveInByte, m_pageSize);
+    int flags = MAP_PRIVATE | MAP_ANON;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void *memory = mmap(nullptr, m_reserved, PROT_NONE, flags, -1, 0);
+    assert(memory != MAP_FAILED && "could not reserve the virtual range");
+    if (memory == MAP_FAILED) {
+      m_reserved = 0;
+      return;
+    }
+    m_start = static_cast<char *>(memory);
+    m_SP = m_start;
+    m_committedEnd = m_start;
+  }
+
+  // alignment needs to be a power of two, returns nullptr if the reserved
+  // range is exhausted
+  void *allocate(const size_t sizeInByte,
+                 const size_t alignment = ALIGNMENT) {
+    assert((alignment != 0) && ((alignment & (alignment - 1)) == 0));
+    char *basePtr = m_start + roundUp(m_SP - m_start, alignment);
+    if (!commitUpTo(basePtr + sizeInByte)) {
+      assert(0 && "virtual memory arena out of reserved memory");
+      return nullptr;
+    }
+    m_SP = basePtr + sizeInByte;
+    m_lastAllocation = basePtr;
+    return basePtr;
+  }
+
+  // resizes the allocation without moving it, only possible for the last
+  // allocation made
+  bool growInPlace(void *ptr, const size_t newSizeInByte) {
+    if ((ptr == nullptr) | (ptr != m_lastAllocation)) {
+      return false;
+    }
+    char *newEnd = m_lastAllocation + newSizeInByte;
+    if (!commitUpTo(newEnd)) {
+      return false;
+    }
+    m_SP = newEnd;
+    return true;
+  }
+
+  // only the last allocation can actually be freed, anything else stays
+  // allocated until reset
+  void free(void *ptr) {
+    if ((ptr != nullptr) & (ptr == m_lastAllocation)) {
+      m_SP = m_lastAllocation;
+      m_lastAllocation = nullptr;
+    }
+  }
+
+  // moves the stack pointer back to a previous getUsedBytes(), everything
+  // allocated after that point is gone. An allocation made before that point
+  // and grown in place past it is still alive, while it is the last one the
+  // stack pointer is its end, and the stack pointer is left there
+  void rewind(const size_t usedBytes) {
+    assert(usedBytes <= getUsedBytes());
+    char *newSP = m_start + usedBytes;
+    if ((m_lastAllocation != nullptr) & (m_lastAllocation < newSP)) {
+      return;
+    }
+    m_SP = newSP;
+    m_lastAllocation = nullptr;
+  }
+
+  // committed pages are kept, so filling the arena again is free
+  inline void reset() {
+    m_SP = m_start;
+    m_lastAllocation = nullptr;
+  };
+
+  // gives back to the os the committed pages past the stack pointer
+  void trim() {
+    char *keep = m_start + roundUp(m_SP - m_start, m_pageSize);
+    if (keep < m_committedEnd) {
+      const size_t size = m_committedEnd - keep;
+      madvise(keep, size, MADV_DONTNEED);
+      mprotect(keep, size, PROT_NONE);
+      m_committedEnd = keep;
+    }
+  }
+
+  size_t getUsedBytes() const { return m_SP - m_start; }
+  size_t getCommittedBytes() const { return m_committedEnd - m_start; }
+  size_t getReservedBytes() const { return m_reserved; }
+  void *getStartPtr() const { return m_start; }
+
+  VirtualMemoryArena(VirtualMemoryArena const &) = delete;
+  VirtualMemoryArena &operator=(VirtualMemoryArena const &) = delete;
+
+ private:
+  static size_t roundUp(const size_t value, const size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  bool commitUpTo(char *end) {
+    if (end <= m_committedEnd) {
+      return true;
+    }
+    const size_t needed = end - m_start;
+    if (needed > m_reserved) {
+      return false;
+    }
+    // committing in big steps, to not pay a syscall for every few pages
+    size_t newCommitted = roundUp(needed, COMMIT_GRANULARITY);
+    newCommitted = newCommitted > m_reserved ? m_reserved : newCommitted;
+    const int result = mprotect(m_committedEnd,
+                                newCommitted - getCommittedBytes(),
+                                PROT_READ | PROT_WRITE);
+    assert(result == 0 && "could not commit memory");
+    if (result != 0) {
+      return false;
+    }
+    m_committedEnd = m_start + newCommitted;
+    return true;
+  }
+
+ private:
+  static constexpr size_t ALIGNMENT = 64;
+  static constexpr size_t COMMIT_GRANULARITY = 64 * 1024;
+
+  char *m_start = nullptr;
+  char *m_SP = nullptr;
+  char *m_committedEnd = nullptr;
+  char *m_lastAllocation = nullptr;
+  size_t m_reserved = 0;
+  size_t m_pageSize = 0;
+};
+
+}  // namespace SirMetal
@@ -1,20 +1,24 @@
 #pragma once
 
+#include <cassert>
 #include <cstdint>
+#include <limits>
 #include <vector>
-#import <unordered_set>
-#import <stack>
 
 namespace SirMetal {
+    // Nodes don't own a list of children, every node knows its first and last
+    // child and its next sibling, so the whole tree lives in the flat array of
+    // nodes and no node allocates anything
     struct DenseTreeNode {
         static constexpr uint32_t PARENT_NULL = std::numeric_limits<uint32_t>::max();
+        static constexpr uint32_t INDEX_NULL = std::numeric_limits<uint32_t>::max();
         void *nodeData = nullptr;
         uint32_t id;
         uint32_t index;
         uint32_t parentIndex = PARENT_NULL;
-        //Change this for random allocator handle, or anything else.
-        //anything is better than a vector here
-        std::vector<uint32_t> children;
+        uint32_t firstChild = INDEX_NULL;
+        uint32_t lastChild = INDEX_NULL;
+        uint32_t nextSibling = INDEX_NULL;
     };
 
     class DenseTree {
@@ -23,15 +27,18 @@ namespace SirMetal {
             m_nodes.reserve(initialSize);
         }
 
+        //to note, creating nodes might reallocate the nodes, so previously
+        //returned references are not valid anymore, indices are
         DenseTreeNode &createNode(DenseTreeNode &parent, uint32_t id, void *data = nullptr) {
+            const uint32_t parentIndex = parent.index;
             DenseTreeNode &node = createNode(id, data);
-            parentNode(parent, node);
+            parentNode(m_nodes[parentIndex], node);
             return node;
         };
 
         DenseTreeNode &createRoot(uint32_t id, void *data = nullptr) {
             DenseTreeNode &root = createNode(id, data);
-            m_root = &root;
+            m_rootIndex = root.index;
             return root;
         };
 
@@ -39,14 +46,20 @@ namespace SirMetal {
             assert(parent.index < m_nodes.size());
             assert(children.index < m_nodes.size());
 
-            parent.children.push_back(children.index);
-
             if (children.parentIndex != DenseTreeNode::PARENT_NULL) {
                 assert(children.parentIndex < m_nodes.size());
                 DenseTreeNode &childrenParent = m_nodes[children.parentIndex];
                 unparentNode(childrenParent, children);
             }
 
+            //appending at the end, so children keep the order they have been
+            //added with
+            if (parent.lastChild == DenseTreeNode::INDEX_NULL) {
+                parent.firstChild = children.index;
+            } else {
+                m_nodes[parent.lastChild].nextSibling = children.index;
+            }
+            parent.lastChild = children.index;
             children.parentIndex = parent.index;
             m_isSorted = false;
         }
@@ -56,57 +69,90 @@ namespace SirMetal {
         }
 
         bool isDirectChild(const DenseTreeNode &parent, const DenseTreeNode &child) const {
-            size_t count = parent.children.size();
-            bool result = false;
-            for (size_t i = 0; i < count; ++i) {
-                result |= parent.children[i] == child.index;
+            uint32_t current = parent.firstChild;
+            while (current != DenseTreeNode::INDEX_NULL) {
+                if (current == child.index) {
+                    return true;
+                }
+                current = m_nodes[current].nextSibling;
             }
-            return result;
+            return false;
         }
 
         std::vector<DenseTreeNode> &getNodes() {
             return m_nodes;
         };
+        const std::vector<DenseTreeNode> &getNodes() const {
+            return m_nodes;
+        };
 
         DenseTreeNode *getRoot() {
-            return m_root;
+            return m_rootIndex != DenseTreeNode::INDEX_NULL ? &m_nodes[m_rootIndex] : nullptr;
         }
 
         //this can be done externally, for now I will be doing it as member class
         //to make it simpler and more efficient
+        //after the sort nodes are in depth first order, parents before their
+        //children and siblings in the order they have been added, indices and
+        //links are all patched. The walk needs no stack, we go down the first
+        //child, then to the next sibling, then climb up the parents until one
+        //has a sibling. Everything is O(n)
         void depthFirstSort() {
-            //we simply rewrite the indices then ask the std::sort to sort based
-            //on that
             if (m_isSorted) {return;}
 
-            m_sortIndices.push(m_root->index);
-            m_visitedNodes.clear();
-            int counter = 0;
-            while (!m_sortIndices.empty()) {
-                const uint32_t idx = m_sortIndices.top();
-                DenseTreeNode &node = m_nodes[idx];
-                node.index = counter++;
-                m_sortIndices.pop();
-                m_visitedNodes.insert(idx);
-                for (uint32_t child : node.children) {
-                    if (m_visitedNodes.find(child) == m_visitedNodes.end()) {
-                        m_sortIndices.push(child);
-                    }
+            const auto count = static_cast<uint32_t>(m_nodes.size());
+            m_sortOrder.clear();
+            m_sortOrder.reserve(count);
+            m_remap.resize(count);
+
+            //the root goes first, any other node without a parent is treated
+            //as a root as well, in creation order
+            if (m_rootIndex != DenseTreeNode::INDEX_NULL) {
+                linearizeSubtree(m_rootIndex);
+            }
+            for (uint32_t i = 0; i < count; ++i) {
+                if ((m_nodes[i].parentIndex == DenseTreeNode::PARENT_NULL) & (i != m_rootIndex)) {
+                    linearizeSubtree(i);
                 }
             }
+            assert(m_sortOrder.size() == count);
 
-            std::sort(m_nodes.begin(), m_nodes.end(),
-                    [](const DenseTreeNode &lhs, const DenseTreeNode &rhs) {
-                        return lhs.index < rhs.index;
-                    });
+            for (uint32_t i = 0; i < count; ++i) {
+                m_remap[m_sortOrder[i]] = i;
+            }
+            m_sortedNodes.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                DenseTreeNode node = m_nodes[m_sortOrder[i]];
+                node.index = i;
+                node.parentIndex = remapIndex(node.parentIndex);
+                node.firstChild = remapIndex(node.firstChild);
+                node.lastChild = remapIndex(node.lastChild);
+                node.nextSibling = remapIndex(node.nextSibling);
+                m_sortedNodes[i] = node;
+            }
+            m_nodes.swap(m_sortedNodes);
+            m_rootIndex = remapIndex(m_rootIndex);
             m_isSorted = true;
-
         }
 
         bool isSorted() const {
             return m_isSorted;
         }
 
+        //computes the world transform of every node, in a single linear pass
+        //over the nodes, which works since after the sort a parent always
+        //comes before its children. local and world are indexed like the nodes,
+        //multiply(parentWorld, local) returns the world of the child
+        template<typename MATRIX, typename MULTIPLY>
+        void propagateTransforms(const MATRIX *local, MATRIX *world, const MULTIPLY &multiply) const {
+            assert(m_isSorted && "tree needs to be sorted to propagate transforms");
+            const auto count = static_cast<uint32_t>(m_nodes.size());
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t parent = m_nodes[i].parentIndex;
+                world[i] = parent == DenseTreeNode::PARENT_NULL ? local[i] : multiply(world[parent], local[i]);
+            }
+        }
+
     private:
         DenseTreeNode &createNode(uint32_t id, void *data) {
             m_nodes.emplace_back(DenseTreeNode{data, id, static_cast<uint32_t>(m_nodes.size())});
@@ -117,31 +163,61 @@ namespace SirMetal {
         };
 
         void unparentNode(DenseTreeNode &parent, DenseTreeNode &child) {
-            int index = -1;
-            size_t count = parent.children.size();
-            for (size_t i = 0; i < count; ++i) {
-                if (parent.children[i] == child.index) {
-                    index = static_cast<int>(i);
-                }
+            //finding the sibling before the child, if any
+            uint32_t previous = DenseTreeNode::INDEX_NULL;
+            uint32_t current = parent.firstChild;
+            while ((current != DenseTreeNode::INDEX_NULL) & (current != child.index)) {
+                previous = current;
+                current = m_nodes[current].nextSibling;
             }
-            assert(index != -1);
-            if (index != -1) {
-                //patching element from last
-                parent.children[index] = parent.children[count - 1];
-                parent.children.pop_back();
+            assert(current != DenseTreeNode::INDEX_NULL);
+            if (current != DenseTreeNode::INDEX_NULL) {
+                if (previous == DenseTreeNode::INDEX_NULL) {
+                    parent.firstChild = child.nextSibling;
+                } else {
+                    m_nodes[previous].nextSibling = child.nextSibling;
+                }
+                if (parent.lastChild == child.index) {
+                    parent.lastChild = previous;
+                }
+                child.nextSibling = DenseTreeNode::INDEX_NULL;
                 child.parentIndex = DenseTreeNode::PARENT_NULL;
                 m_isSorted = false;
             }
 
         }
 
+        void linearizeSubtree(const uint32_t subtreeRoot) {
+            uint32_t current = subtreeRoot;
+            while (current != DenseTreeNode::INDEX_NULL) {
+                m_sortOrder.push_back(current);
+                const DenseTreeNode &node = m_nodes[current];
+                if (node.firstChild != DenseTreeNode::INDEX_NULL) {
+                    current = node.firstChild;
+                    continue;
+                }
+                //no children, we move to the sibling, or to the sibling of the
+                //first parent that has one, without leaving the subtree
+                while ((current != subtreeRoot) && (m_nodes[current].nextSibling == DenseTreeNode::INDEX_NULL)) {
+                    current = m_nodes[current].parentIndex;
+                }
+                current = current == subtreeRoot ? DenseTreeNode::INDEX_NULL : m_nodes[current].nextSibling;
+            }
+        }
+
+        inline uint32_t remapIndex(const uint32_t index) const {
+            return index == DenseTreeNode::INDEX_NULL ? index : m_remap[index];
+        }
+
     private:
         bool m_isSorted = true;
         std::vector<DenseTreeNode> m_nodes;
-        DenseTreeNode *m_root = nullptr;
-        std::stack<uint32_t> m_sortIndices;
-        std::unordered_set<uint32_t> m_visitedNodes;
+        uint32_t m_rootIndex = DenseTreeNode::INDEX_NULL;
+        //scratch memory for the sort, kept around to not reallocate it
+        std::vector<uint32_t> m_sortOrder;
+        std::vector<uint32_t> m_remap;
+        std::vector<DenseTreeNode> m_sortedNodes;
     };
 
 
-}
\ No newline at end of file
+}
@@ -85,10 +85,14 @@ BufferHandle GPUMemoryAllocator::allocate(const uint32_t sizeInBytes,
   bufferData.allocationSize = allocatedSize;
   bufferData.flags = flags;
 
-  uint32_t index = versionCounter++;
-  m_bufferStorage[index] = bufferData;
-  // creating a handle
-  return getHandle<BufferHandle>(index);
+  // creating a handle, a full storage gives back the invalid handle instead
+  // of a key that never resolves
+  const uint32_t key = m_bufferStorage.insert(bufferData);
+  if (key == SlotMap<Buffer>::INVALID_KEY) {
+    assert(0 && "buffer storage is full, cannot allocate more buffers");
+    return {};
+  }
+  return getHandle<BufferHandle>(key);
 }
 
 void GPUMemoryAllocator::cleanup() {}
@@ -97,14 +101,14 @@ void GPUMemoryAllocator::update(BufferHandle handle, void *data,
                                 uint32_t offset, uint32_t size) const {
   assert(getTypeFromHandle(handle) == HANDLE_TYPE::BUFFER);
   uint32_t index = getIndexFromHandle(handle);
-  auto found = m_bufferStorage.find(index);
-  if (found == m_bufferStorage.end()) {
+  const Buffer *found = m_bufferStorage.get(index);
+  if (found == nullptr) {
     printf("[ERROR] Tried to update buffer %i, but buffer could not be found",
            index);
     return;
   }
 
-  const Buffer &bufferData = found->second;
+  const Buffer &bufferData = *found;
   bool isGPUOnly = (bufferData.flags & BUFFER_FLAG_GPU_ONLY) > 0;
   if (isGPUOnly) {
     assert(0 && "not supported yet");
@@ -117,13 +121,13 @@ void GPUMemoryAllocator::update(BufferHandle handle, void *data,
 id GPUMemoryAllocator::getBuffer(BufferHandle handle) const {
   assert(getTypeFromHandle(handle) == HANDLE_TYPE::BUFFER);
   uint32_t index = getIndexFromHandle(handle);
-  auto found = m_bufferStorage.find(index);
-  if (found == m_bufferStorage.end()) {
+  const Buffer *found = m_bufferStorage.get(index);
+  if (found == nullptr) {
     printf("[ERROR] Tried to get metal buffer from handle %i, but buffer could "
            "not be found",
            index);
     return nil;
   }
-  return found->second.buffer;
+  return found->buffer;
 }
 } // namespace SirMetal
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace SirMetal {
+
+// how many threads are worth using for cpu bound work, at least one
+inline uint32_t getWorkerThreadCount() {
+  const uint32_t count = std::thread::hardware_concurrency();
+  return count != 0 ? count : 1;
+}
+
+// Runs work(index) for every index in [0, count) on up to threadCount
+// threads, the calling thread being one of them, and returns when all the
+// work is done. Indices are handed out one at a time in increasing order, so
+// when the cost is uneven putting the most expensive first balances the
+// threads best.
+// The threads only live for the call, meant for loading time batches where
+// the work is far longer than starting a thread, not for per frame jobs
+template <typename WORK>
+void parallelFor(uint32_t threadCount, const size_t count, const WORK &work) {
+  threadCount = count < threadCount ? static_cast<uint32_t>(count) : threadCount;
+  std::atomic<size_t> next(0);
+  const auto worker = [&]() {
+    size_t index;
+    while ((index = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+      work(index);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount > 1 ? threadCount - 1 : 0);
+  for (uint32_t i = 1; i < threadCount; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace SirMetal
@@ -0,0 +1,276 @@
+#include "SirMetal/core/profiler.h"
+
+#if SE_PROFILING
+#include "SirMetal/core/memory/cpu/overridingRingBuffer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <mutex>
+
+namespace SirMetal {
+
+namespace profilerInternal {
+thread_local ThreadProfile *t_threadProfile = nullptr;
+std::atomic<uint32_t> g_frameIndex{0};
+}  // namespace profilerInternal
+
+namespace {
+using profilerInternal::ThreadProfile;
+
+struct ProfilerData {
+  std::mutex mutex;
+  std::vector<ThreadProfile *> threads;
+  // profiles of the threads that are gone, handed to the next new thread with
+  // their ring and index, short lived threads like the parallelFor ones do
+  // not allocate a ring each and the index space does not run out
+  std::vector<ThreadProfile *> freeProfiles;
+  // indexed by thread index, kept after the thread is gone so the trace can
+  // still name it, until the index goes to a new thread
+  std::vector<std::string> threadNames;
+  OverridingRingBuffer<ProfileZone> history{PROFILER_HISTORY_SIZE};
+  // dropped by threads that are gone
+  uint32_t droppedByOldThreads = 0;
+  uint64_t frameStart = profilerInternal::getTimestamp();
+
+  // the first conversion would calibrate the cycle clock, sleeping while
+  // holding the mutex, it is done here instead, before any lock is taken
+  ProfilerData() { CycleClock::getCalibration(); }
+  ~ProfilerData() {
+    for (ThreadProfile *profile : freeProfiles) {
+      delete profile;
+    }
+  }
+};
+ProfilerData &getData() {
+  static ProfilerData data;
+  return data;
+}
+
+// needs the profiler lock
+void drainThread(ProfilerData &data, ThreadProfile &profile) {
+  constexpr uint32_t BATCH_SIZE = 256;
+  ProfileZone zones[BATCH_SIZE];
+  uint32_t count;
+  while ((count = profile.ring.popBatch(zones, BATCH_SIZE)) != 0) {
+    for (uint32_t i = 0; i < count; ++i) {
+      zones[i].startNS = CycleClock::toNanoseconds(zones[i].startNS);
+      zones[i].endNS = CycleClock::toNanoseconds(zones[i].endNS);
+    }
+    data.history.pushRange(zones, count);
+  }
+}
+
+// gives back the thread profile when the thread exits, what is left in the
+// ring goes in the history first and the profile is kept for reuse
+struct ThreadProfileOwner {
+  ~ThreadProfileOwner() {
+    ThreadProfile *profile = profilerInternal::t_threadProfile;
+    if (profile == nullptr) {
+      return;
+    }
+    {
+      ProfilerData &data = getData();
+      std::lock_guard<std::mutex> lock(data.mutex);
+      drainThread(data, *profile);
+      data.droppedByOldThreads += profile->dropped.load();
+      profile->dropped.store(0, std::memory_order_relaxed);
+      profile->depth = 0;
+      for (size_t i = 0; i < data.threads.size(); ++i) {
+        if (data.threads[i] == profile) {
+          data.threads[i] = data.threads.back();
+          data.threads.pop_back();
+          break;
+        }
+      }
+      data.freeProfiles.push_back(profile);
+    }
+    profilerInternal::t_threadProfile = nullptr;
+  }
+};
+thread_local ThreadProfileOwner t_owner;
+
+void appendEscaped(std::string &out, const char *string) {
+  for (const char *c = string; *c != '\0'; ++c) {
+    if ((*c == '"') | (*c == '\\')) {
+      out.push_back('\\');
+      out.push_back(*c);
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      out.push_back(' ');
+    } else {
+      out.push_back(*c);
+    }
+  }
+}
+}  // namespace
+
+namespace profilerInternal {
+ThreadProfile *createThreadProfile() {
+  // touching the owner, so its destructor runs when the thread exits
+  (void)&t_owner;
+  ProfilerData &data = getData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  ThreadProfile *profile;
+  if (!data.freeProfiles.empty()) {
+    profile = data.freeProfiles.back();
+    data.freeProfiles.pop_back();
+  } else {
+    // one index per live thread, running out means 64k threads at once
+    assert(data.threadNames.size() <= UINT16_MAX &&
+           "profiler out of thread indices");
+    profile = new ThreadProfile(static_cast<uint16_t>(data.threadNames.size()));
+    data.threadNames.emplace_back();
+  }
+  snprintf(profile->name, THREAD_NAME_SIZE, "thread %u", profile->threadIndex);
+  data.threadNames[profile->threadIndex] = profile->name;
+  data.threads.push_back(profile);
+  t_threadProfile = profile;
+  return profile;
+}
+}  // namespace profilerInternal
+
+void profilerSetThreadName(const char *name) {
+  ThreadProfile &profile = profilerInternal::getThreadProfile();
+  snprintf(profile.name, profilerInternal::THREAD_NAME_SIZE, "%s", name);
+  ProfilerData &data = getData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  data.threadNames[profile.threadIndex] = profile.name;
+}
+
+void profilerCollect() {
+  ProfilerData &data = getData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  for (ThreadProfile *profile : data.threads) {
+    drainThread(data, *profile);
+  }
+}
+
+void profilerNewFrame() {
+  ProfilerData &data = getData();
+  ThreadProfile &profile = profilerInternal::getThreadProfile();
+  const uint64_t now = profilerInternal::getTimestamp();
+  const uint32_t frame =
+      profilerInternal::g_frameIndex.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(data.mutex);
+    const ProfileZone frameZone{"frame",
+                                CycleClock::toNanoseconds(data.frameStart),
+                                CycleClock::toNanoseconds(now),
+                                frame,
+                                profile.depth,
+                                profile.threadIndex};
+    data.frameStart = now;
+    for (ThreadProfile *thread : data.threads) {
+      drainThread(data, *thread);
+    }
+    data.history.push(frameZone);
+  }
+}
+
+uint32_t profilerGetFrameIndex() {
+  return profilerInternal::g_frameIndex.load(std::memory_order_relaxed);
+}
+
+void profilerGetZones(std::vector<ProfileZone> &outZones) {
+  ProfilerData &data = getData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  const auto view = data.history.getView();
+  outZones.resize(view.count());
+  if (view.first.count != 0) {
+    memcpy(outZones.data(), view.first.data,
+           sizeof(ProfileZone) * view.first.count);
+  }
+  if (view.second.count != 0) {
+    memcpy(outZones.data() + view.first.count, view.second.data,
+           sizeof(ProfileZone) * view.second.count);
+  }
+}
+
+uint32_t profilerGetDroppedZonesCount() {
+  ProfilerData &data = getData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  uint32_t dropped = data.droppedByOldThreads;
+  for (ThreadProfile *profile : data.threads) {
+    dropped += profile->dropped.load(std::memory_order_relaxed);
+  }
+  return dropped;
+}
+
+void profilerClear() {
+  ProfilerData &data = getData();
+  std::lock_guard<std::mutex> lock(data.mutex);
+  // zones still in the rings are drained and thrown away as well
+  for (ThreadProfile *profile : data.threads) {
+    drainThread(data, *profile);
+    profile->dropped.store(0, std::memory_order_relaxed);
+  }
+  data.history.clear();
+  data.droppedByOldThreads = 0;
+}
+
+std::string profilerToChromeTrace() {
+  std::vector<ProfileZone> zones;
+  profilerGetZones(zones);
+  std::vector<std::string> names;
+  {
+    ProfilerData &data = getData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    names = data.threadNames;
+  }
+
+  // timestamps from the first zone, microseconds as the format wants
+  uint64_t origin = ~0ull;
+  for (const ProfileZone &zone : zones) {
+    origin = zone.startNS < origin ? zone.startNS : origin;
+  }
+
+  std::string out;
+  out.reserve(128 + zones.size() * 128);
+  out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (size_t i = 0; i < names.size(); ++i) {
+    out += first ? "\n" : ",\n";
+    first = false;
+    out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":";
+    out += std::to_string(i);
+    out += ",\"args\":{\"name\":\"";
+    appendEscaped(out, names[i].c_str());
+    out += "\"}}";
+  }
+  char buffer[160];
+  for (const ProfileZone &zone : zones) {
+    out += first ? "\n" : ",\n";
+    first = false;
+    out += "{\"name\":\"";
+    appendEscaped(out, zone.name);
+    const uint64_t start = zone.startNS - origin;
+    const uint64_t duration = zone.endNS - zone.startNS;
+    snprintf(buffer, sizeof(buffer),
+             "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,"
+             "\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,\"args\":{\"frame\":%u}}",
+             zone.threadIndex, static_cast<unsigned long long>(start / 1000),
+             static_cast<unsigned long long>(start % 1000),
+             static_cast<unsigned long long>(duration / 1000),
+             static_cast<unsigned long long>(duration % 1000), zone.frame);
+    out += buffer;
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+bool profilerExportChromeTrace(const char *path) {
+  const std::string trace = profilerToChromeTrace();
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    printf("[ERROR] Could not open %s to write the profiler trace\n", path);
+    return false;
+  }
+  const size_t written = fwrite(trace.data(), 1, trace.size(), file);
+  fclose(file);
+  return written == trace.size();
+}
+
+}  // namespace SirMetal
+
+#endif
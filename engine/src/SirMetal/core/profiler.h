@@ -0,0 +1,129 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SirMetal/core/clock.h"
+#include "SirMetal/core/memory/cpu/concurrentRingBuffer.h"
+
+// Cpu profiler. SM_PROFILE_SCOPE("name") times the rest of the enclosing
+// scope, zones opened while another one is open on the same thread are nested
+// in it. The name is not copied, it needs to be a string literal or anything
+// else living until the trace is exported.
+// Every thread writes its zones in its own lock free ring, a zone costs two
+// raw cpu timestamp reads and one push, nothing is shared with other threads.
+// Once per frame SM_PROFILE_NEW_FRAME() collects the rings in the history,
+// converting the timestamps to nanoseconds, the history can be exported as a
+// chrome trace (about:tracing, ui.perfetto.dev).
+// The first zone or call of the process calibrates CycleClock, on x86 that is
+// a CycleClock::CALIBRATION_TIME sleep, outside of the zone being timed.
+// With SE_PROFILING off the macros compile to nothing and the profiler itself
+// is not built, the functions below are only there with it on.
+#if SE_PROFILING
+#define SM_PROFILE_CONCAT_INTERNAL(a, b) a##b
+#define SM_PROFILE_CONCAT(a, b) SM_PROFILE_CONCAT_INTERNAL(a, b)
+#define SM_PROFILE_SCOPE(name) \
+  SirMetal::ProfileScope SM_PROFILE_CONCAT(smProfileScope, __LINE__)(name)
+#define SM_PROFILE_FUNCTION() SM_PROFILE_SCOPE(__func__)
+#define SM_PROFILE_THREAD_NAME(name) SirMetal::profilerSetThreadName(name)
+#define SM_PROFILE_NEW_FRAME() SirMetal::profilerNewFrame()
+#else
+#define SM_PROFILE_SCOPE(name)
+#define SM_PROFILE_FUNCTION()
+#define SM_PROFILE_THREAD_NAME(name)
+#define SM_PROFILE_NEW_FRAME()
+#endif
+
+namespace SirMetal {
+
+// zones kept once collected, older ones are overridden
+static constexpr uint32_t PROFILER_HISTORY_SIZE = 1 << 16;
+
+struct ProfileZone {
+  const char *name;
+  // steady clock nanoseconds, raw CycleClock ticks until collected
+  uint64_t startNS;
+  uint64_t endNS;
+  // frame the zone started in
+  uint32_t frame;
+  // how many zones of the same thread it is nested in
+  uint16_t depth;
+  uint16_t threadIndex;
+};
+
+namespace profilerInternal {
+static constexpr uint32_t THREAD_RING_SIZE = 1 << 14;
+static constexpr uint32_t THREAD_NAME_SIZE = 32;
+
+struct ThreadProfile {
+  explicit ThreadProfile(const uint16_t index)
+      : ring(THREAD_RING_SIZE), threadIndex(index) {}
+
+  SPSCRingBuffer<ProfileZone> ring;
+  // only touched by the owning thread
+  uint16_t depth = 0;
+  uint16_t threadIndex;
+  // zones lost because the ring was full, the frame was too long or
+  // profilerNewFrame() is not called
+  std::atomic<uint32_t> dropped{0};
+  char name[THREAD_NAME_SIZE]{};
+};
+
+ThreadProfile *createThreadProfile();
+extern thread_local ThreadProfile *t_threadProfile;
+extern std::atomic<uint32_t> g_frameIndex;
+
+inline ThreadProfile &getThreadProfile() {
+  ThreadProfile *profile = t_threadProfile;
+  return profile != nullptr ? *profile : *createThreadProfile();
+}
+
+inline uint64_t getTimestamp() { return CycleClock::now(); }
+}  // namespace profilerInternal
+
+class ProfileScope final {
+ public:
+  explicit ProfileScope(const char *name)
+      : m_profile(profilerInternal::getThreadProfile()) {
+    m_zone.name = name;
+    m_zone.frame = profilerInternal::g_frameIndex.load(std::memory_order_relaxed);
+    m_zone.depth = m_profile.depth++;
+    m_zone.threadIndex = m_profile.threadIndex;
+    m_zone.startNS = profilerInternal::getTimestamp();
+  }
+  ~ProfileScope() {
+    m_zone.endNS = profilerInternal::getTimestamp();
+    --m_profile.depth;
+    if (!m_profile.ring.push(m_zone)) {
+      m_profile.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+ private:
+  profilerInternal::ThreadProfile &m_profile;
+  ProfileZone m_zone;
+};
+
+// name shown for the calling thread in the trace, copied
+void profilerSetThreadName(const char *name);
+// collects the zones of every thread and moves to the next frame, to be
+// called once per frame
+void profilerNewFrame();
+uint32_t profilerGetFrameIndex();
+// collects the zones of every thread without moving to the next frame
+void profilerCollect();
+// zones collected so far, in collection order, only the last
+// PROFILER_HISTORY_SIZE are kept. Every frame also has a "frame" zone, on the
+// thread calling profilerNewFrame(), spanning the whole frame
+void profilerGetZones(std::vector<ProfileZone> &outZones);
+uint32_t profilerGetDroppedZonesCount();
+void profilerClear();
+
+// chrome trace event format, the zones collected so far
+std::string profilerToChromeTrace();
+bool profilerExportChromeTrace(const char *path);
+
+}  // namespace SirMetal
@@ -21,6 +21,10 @@ static const char *CONFIG_WINDOW_TITLE = "windowTitle";
 static const char *CONFIG_WINDOW_WIDTH = "windowWidth";
 static const char *CONFIG_WINDOW_HEIGHT = "windowHeight";
 static const char *CONFIG_FRAME_BUFFERING_COUNT = "frameBufferingCount";
+static const char *CONFIG_FRAME_STATS_JSON = "frameStatsJson";
+static const char *CONFIG_FRAME_STATS_CSV = "frameStatsCsv";
+static const char *CONFIG_MESH_CACHE = "meshCache";
+static const char *DEFAULT_MESH_CACHE_FOLDER = "meshCache";
 
 static const std::string DEFAULT_STRING = "";
 
@@ -48,6 +52,13 @@ EngineConfig parseConfigFile(const std::string &path) {
 
   config.m_frameBufferingCount =
       (getValueIfInJson(jobj, CONFIG_FRAME_BUFFERING_COUNT, 2u));
+  config.m_frameStatsJsonPath =
+      getValueIfInJson(jobj, CONFIG_FRAME_STATS_JSON, DEFAULT_STRING);
+  config.m_frameStatsCsvPath =
+      getValueIfInJson(jobj, CONFIG_FRAME_STATS_CSV, DEFAULT_STRING);
+  config.m_meshCachePath =
+      getValueIfInJson(jobj, CONFIG_MESH_CACHE,
+                       config.m_dataSourcePath + DEFAULT_MESH_CACHE_FOLDER);
 
   assert(config.m_windowConfig.m_width != 0);
   assert(config.m_windowConfig.m_height != 0);
@@ -64,6 +75,8 @@ EngineConfig initializeConfigDefault() {
   config.m_windowConfig.m_width = 1280;
   config.m_windowConfig.m_height = 720;
   config.m_frameBufferingCount = 2;
+  config.m_meshCachePath =
+      config.m_dataSourcePath + DEFAULT_MESH_CACHE_FOLDER;
   return config;
 }
 EngineConfig loadEngineConfigFile(const std::string &path) {
@@ -90,7 +103,7 @@ EngineContext *engineStartUp(const EngineConfig &config, SDL_Window *window) {
   context->m_constantBufferManager = new ConstantBufferManager();
   context->m_constantBufferManager->initialize(device, queue,20 * MB_TO_BYTE);
   context->m_meshManager = new MeshManager();
-  context->m_meshManager->initialize(device, queue);
+  context->m_meshManager->initialize(device, queue, config.m_meshCachePath);
   context->m_textureManager = new TextureManager();
   context->m_textureManager->initialize(device,queue);
   context->m_debugRenderer = new graphics::DebugRenderer();
@@ -105,10 +118,29 @@ EngineContext *engineStartUp(const EngineConfig &config, SDL_Window *window) {
 void Timing::newFrame() {
   m_lastFrameTimeNS = m_clock.getDelta();
   ++m_totalNumberOfFrames;
+  if (m_totalNumberOfFrames > 1) {
+    m_frameStats.recordFrame(m_lastFrameTimeNS);
+  }
   m_deltaTimeInSeconds = m_lastFrameTimeNS * NS_TO_SECONDS;
   m_timeSinceStartInSeconds = m_clock.getDeltaFromOrigin() * NS_TO_SECONDS;
 }
 void engineShutdown(EngineContext *context) {
+  const FrameStats &frameStats = context->m_timings.m_frameStats;
+  const FrameStatsSummary summary = frameStats.getSummary();
+  printf("[INFO] Frame times over %llu frames: p50 %.2fms p95 %.2fms p99 "
+         "%.2fms p99.9 %.2fms max %.2fms, %llu hitches\n",
+         static_cast<unsigned long long>(summary.frameCount),
+         summary.p50NS * 1e-6, summary.p95NS * 1e-6, summary.p99NS * 1e-6,
+         summary.p999NS * 1e-6, summary.maxNS * 1e-6,
+         static_cast<unsigned long long>(summary.hitchCount));
+  if (!context->m_config.m_frameStatsJsonPath.empty()) {
+    writeFrameStatsJson(frameStats,
+                        context->m_config.m_frameStatsJsonPath.c_str());
+  }
+  if (!context->m_config.m_frameStatsCsvPath.empty()) {
+    writeFrameStatsCsv(frameStats,
+                       context->m_config.m_frameStatsCsvPath.c_str());
+  }
   context->m_debugRenderer->cleanup(context);
   delete context->m_debugRenderer;
   context->m_textureManager->cleanup();
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "SirMetal/core/clock.h"
+#include "SirMetal/core/frameStats.h"
 #include "SirMetal/graphics/graphicsDefines.h"
 
 class SDL_Window;
@@ -35,6 +36,11 @@ struct EngineConfig {
   WindowProps m_windowConfig;
   // graphics
   uint32_t m_frameBufferingCount;
+  // frame time statistics written at shutdown, empty to skip
+  std::string m_frameStatsJsonPath;
+  std::string m_frameStatsCsvPath;
+  // built meshes are cached here, empty to always load from the source
+  std::string m_meshCachePath;
 };
 
 struct Timing {
@@ -43,6 +49,9 @@ struct Timing {
   size_t m_totalNumberOfFrames;
   double m_timeSinceStartInSeconds;
   double m_deltaTimeInSeconds;
+  // every frame time since start up, the first frame is left out, it
+  // includes the loading
+  FrameStats m_frameStats;
   void newFrame();
 };
 
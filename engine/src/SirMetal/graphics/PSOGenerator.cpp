@@ -1,5 +1,6 @@
 
 #include "PSOGenerator.h"
+#import "SirMetal/core/hashing/hashing.h"
 #import "SirMetal/engine.h"
 #import "SirMetal/graphics/materialManager.h"
 #import "SirMetal/graphics/renderingContext.h"
@@ -43,7 +44,8 @@ std::size_t computePSOHash(const SirMetal::graphics::DrawTracker &tracker,
     hash_combine(toReturn, material.blendingState.destinationAlphaBlendFactor);
   }
 
-  hash_combine(toReturn, material.shaderName);
+  // engine string id of the shader, same value "name"_sid gives for literals
+  hash_combine(toReturn, hashString32(material.shaderName.c_str()));
   return toReturn;
 }
 
@@ -0,0 +1,106 @@
+#include "SirMetal/graphics/clusterCulling.h"
+
+#include <math.h>
+
+namespace SirMetal {
+
+namespace {
+bool isSphereInFrustum(const float planes[6][4], const float center[3],
+                       const float radius) {
+  for (int p = 0; p < 6; ++p) {
+    const float *plane = planes[p];
+    const float distance = plane[0] * center[0] + plane[1] * center[1] +
+                           plane[2] * center[2] + plane[3];
+    if (distance < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// the center based test from meshoptimizer, conservative and no apex needed
+bool isBackFacing(const MeshletBounds &bounds, const float cameraPosition[3]) {
+  const float toCenter[3] = {bounds.center[0] - cameraPosition[0],
+                             bounds.center[1] - cameraPosition[1],
+                             bounds.center[2] - cameraPosition[2]};
+  const float distance =
+      sqrtf(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] +
+            toCenter[2] * toCenter[2]);
+  const float alignment = toCenter[0] * bounds.coneAxis[0] +
+                          toCenter[1] * bounds.coneAxis[1] +
+                          toCenter[2] * bounds.coneAxis[2];
+  return alignment >= bounds.coneCutoff * distance + bounds.radius;
+}
+}  // namespace
+
+void extractFrustumPlanes(const float *viewProjection, float outPlanes[6][4]) {
+  // Gribb & Hartmann, the planes are sums of the last row with the others,
+  // element (row, column) is at column * 4 + row
+  const auto row = [viewProjection](const int r, const int c) {
+    return viewProjection[c * 4 + r];
+  };
+  for (int p = 0; p < 6; ++p) {
+    const int axis = p / 2;
+    const float sign = (p % 2) == 0 ? 1.0f : -1.0f;
+    float *plane = outPlanes[p];
+    for (int c = 0; c < 4; ++c) {
+      plane[c] = row(3, c) + sign * row(axis, c);
+    }
+    const float length =
+        sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+    for (int c = 0; c < 4; ++c) {
+      plane[c] *= scale;
+    }
+  }
+}
+
+void initializeCullingView(ClusterCullingView &outView,
+                           const float *viewProjection,
+                           const float cameraPosition[3]) {
+  extractFrustumPlanes(viewProjection, outView.planes);
+  for (int c = 0; c < 3; ++c) {
+    outView.cameraPosition[c] = cameraPosition[c];
+  }
+}
+
+uint32_t cullMeshlets(const Meshlet *meshlets, const MeshletBounds *bounds,
+                      const uint32_t count, const ClusterCullingView &view,
+                      uint32_t *outVisible, ClusterCullingStats *stats) {
+  uint32_t visibleCount = 0;
+  uint64_t triangles = 0;
+  uint64_t visibleTriangles = 0;
+  uint64_t frustumCulledTriangles = 0;
+  uint32_t frustumCulled = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    const MeshletBounds &meshletBounds = bounds[i];
+    const uint32_t triangleCount = meshlets[i].triangleCount;
+    triangles += triangleCount;
+    if (!isSphereInFrustum(view.planes, meshletBounds.center,
+                           meshletBounds.radius)) {
+      ++frustumCulled;
+      frustumCulledTriangles += triangleCount;
+      continue;
+    }
+    if (isBackFacing(meshletBounds, view.cameraPosition)) {
+      continue;
+    }
+    outVisible[visibleCount++] = i;
+    visibleTriangles += triangleCount;
+  }
+
+  if (stats != nullptr) {
+    stats->meshletCount += count;
+    stats->visibleMeshlets += visibleCount;
+    stats->frustumCulledMeshlets += frustumCulled;
+    stats->backfaceCulledMeshlets += count - visibleCount - frustumCulled;
+    stats->triangleCount += triangles;
+    stats->visibleTriangles += visibleTriangles;
+    stats->frustumCulledTriangles += frustumCulledTriangles;
+    stats->backfaceCulledTriangles +=
+        triangles - visibleTriangles - frustumCulledTriangles;
+  }
+  return visibleCount;
+}
+
+}  // namespace SirMetal
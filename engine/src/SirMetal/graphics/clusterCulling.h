@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+#include "SirMetal/resources/resourceTypes.h"
+
+// Cpu culling of meshlets against a view, frustum first then back faces with
+// the meshlet normal cone. No dependency on the renderer so it runs headless,
+// to pick what to submit or to measure what a gpu cluster pass would save.
+// Everything is in the mesh space, the caller moves the view in it: the
+// planes come from view projection * model and the camera position from the
+// inverse of the model matrix, the cone test assumes no non uniform scale
+namespace SirMetal {
+
+struct ClusterCullingView {
+  // a point p is inside when dot(plane.xyz, p) + plane.w >= 0, the xyz are
+  // normalized so the value is a distance
+  float planes[6][4];
+  float cameraPosition[3];
+};
+
+// added to by every cullMeshlets call it is passed to
+struct ClusterCullingStats {
+  uint64_t meshletCount = 0;
+  uint64_t visibleMeshlets = 0;
+  uint64_t frustumCulledMeshlets = 0;
+  uint64_t backfaceCulledMeshlets = 0;
+  uint64_t triangleCount = 0;
+  uint64_t visibleTriangles = 0;
+  uint64_t frustumCulledTriangles = 0;
+  uint64_t backfaceCulledTriangles = 0;
+};
+
+// planes of a column major view projection with clip space z in [-w, w], as
+// matrix_float4x4_perspective builds it, left right bottom top near far
+void extractFrustumPlanes(const float *viewProjection, float outPlanes[6][4]);
+void initializeCullingView(ClusterCullingView &outView,
+                           const float *viewProjection,
+                           const float cameraPosition[3]);
+
+// writes the index of every visible meshlet in outVisible, which needs room
+// for count of them, and returns how many there are, stats can be null
+uint32_t cullMeshlets(const Meshlet *meshlets, const MeshletBounds *bounds,
+                      uint32_t count, const ClusterCullingView &view,
+                      uint32_t *outVisible,
+                      ClusterCullingStats *stats = nullptr);
+
+}  // namespace SirMetal
@@ -57,7 +57,7 @@ namespace SirMetal {
     uint32_t ConstantBufferManager::findAllocator(uint32_t size) {
         size_t count = m_bufferPools.size();
         for (size_t i = 0; i < count; ++i) {
-            if (m_bufferPools[i].linearManager->canAllocate(size)) {
+            if (m_bufferPools[i].linearManager->canAllocate(size, bufferAlignment)) {
                 return static_cast<uint32_t>(i);
             }
         }
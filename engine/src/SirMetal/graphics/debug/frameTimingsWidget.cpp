@@ -3,22 +3,12 @@
 #include "SirMetal/graphics/debug/imgui/imgui.h"
 
 #include <iomanip>
-#include <random>
 #include <sstream>
 #include <string>
 
 #include "SirMetal/engine.h"
 
 namespace SirMetal::graphics{
-FrameTimingsWidget::FrameTimingsWidget() {
-  for (float & m_sample : m_samples) {
-    m_sample = 0.0f;
-  }
-  for (float & i : m_framesHistogram) {
-    i = 0.0f;
-  }
-}
-
 void FrameTimingsWidget::render(EngineContext* context) {
   std::string totalFrames{"Number of frames: "};
   totalFrames += std::to_string(context->m_timings.m_totalNumberOfFrames);
@@ -31,41 +21,41 @@ void FrameTimingsWidget::render(EngineContext* context) {
   if (!ImGui::CollapsingHeader("Timings", ImGuiTreeNodeFlags_DefaultOpen))
     return;
 
-  float lastFrameInMs =
-      static_cast<float>(context->m_timings.m_lastFrameTimeNS) * 1e-6f;
-  // render frame graphs
-  m_samples[m_runningCounter] = lastFrameInMs;
-  m_runningCounter = ((m_runningCounter + 1) % NUMBER_OF_SAMPLES);
-  float finalSamples[NUMBER_OF_SAMPLES];
-  float average = 0.0f;
-  float maxV = -100.0f;
-  float minV = 100.0f;
-
-  // lets compute min max and average
-  for (float v : m_samples) {
-    maxV = maxV > v ? maxV : v;
-    minV = minV < v ? minV : v;
-    average += v;
-  }
-  average /= static_cast<float>(NUMBER_OF_SAMPLES);
+  const FrameStats &stats = context->m_timings.m_frameStats;
+  const FrameStatsSummary summary = stats.getSummary();
+  ImGui::Text("p50 %.2fms p95 %.2fms p99 %.2fms p99.9 %.2fms",
+              summary.p50NS * 1e-6, summary.p95NS * 1e-6,
+              summary.p99NS * 1e-6, summary.p999NS * 1e-6);
+  ImGui::Text("Hitches over %.1fms: %llu, spikes: %llu",
+              stats.getHitchThreshold() * 1e-6,
+              static_cast<unsigned long long>(summary.hitchCount),
+              static_cast<unsigned long long>(summary.spikeCount));
 
-  // final
-  for (uint32_t i = 0; i < NUMBER_OF_SAMPLES; ++i) {
-    int idx = (m_runningCounter + i) % NUMBER_OF_SAMPLES;
-    finalSamples[i] = ((m_samples[idx] - minV) / (maxV - minV) - 0.5f) * 2.0f;
+  // render frame graphs
+  const auto recent = stats.getRecentSamples();
+  const FrameStats::RecentWindow window = stats.getRecentWindow();
+  const float range = window.maxMs - window.minMs;
+  const float scale = range > 0.0f ? 1.0f / range : 0.0f;
+  float finalSamples[FrameStats::RECENT_SAMPLES];
+  uint32_t sampleCount = 0;
+  for (const auto &span : {recent.first, recent.second}) {
+    for (uint32_t i = 0; i < span.count; ++i) {
+      finalSamples[sampleCount++] =
+          ((span.data[i] - window.minMs) * scale - 0.5f) * 2.0f;
+    }
   }
   std::string overlay{"avg "};
-  overlay += std::to_string(average) + " ms";
+  overlay += std::to_string(window.averageMs) + " ms";
   ImGui::Text("Frame Times:");
 
   ImGui::PushItemWidth(ImGui::GetWindowWidth() - 90);
 
   //\n are tricks to try to place the bottom scale in the right place
   std::stringstream stream;
-  stream << std::fixed << std::setprecision(2) << maxV << "ms\n\n\n\n\n"
-         << minV << "ms";
+  stream << std::fixed << std::setprecision(2) << window.maxMs << "ms\n\n\n\n\n"
+         << window.minMs << "ms";
   std::string s = stream.str();
-  ImGui::PlotLines(s.c_str(), finalSamples, IM_ARRAYSIZE(finalSamples), 0,
+  ImGui::PlotLines(s.c_str(), finalSamples, static_cast<int>(sampleCount), 0,
                    overlay.c_str(), -1.0f, 1.0f, ImVec2(0, 80));
 
   // render histogram frames
@@ -73,36 +63,33 @@ void FrameTimingsWidget::render(EngineContext* context) {
   // goes to widgets. We choose a width proportional to our font size.
   ImGui::PushItemWidth(-1);
 
-  // computing the bucket size
-  float bucketSize =
-      MAX_FRAME_TIME / static_cast<float>(NUMBER_OF_HISTOGRAMS_BUCKETS - 1);
-  // now we can figure out which bucket our value goes into
-  auto bucket = static_cast<uint32_t>(std::floorf(lastFrameInMs / bucketSize));
-
-  // update the histogram, we reserved last bucket for all the frames greater
-  // than the max
-  if (lastFrameInMs > MAX_FRAME_TIME) {
-    ++m_framesHistogram[NUMBER_OF_HISTOGRAMS_BUCKETS - 1];
-  } else {
-    ++m_framesHistogram[bucket];
-  }
-
+  // the whole run folded in log2 buckets, no frame time is out of range
+  const LogHistogram &histogram = stats.getHistogram();
   float finalHisto[NUMBER_OF_HISTOGRAMS_BUCKETS];
+  uint64_t previousCount = 0;
+  float edgeMs = FIRST_BUCKET_MS;
+  for (uint32_t i = 0; i < NUMBER_OF_HISTOGRAMS_BUCKETS - 1; ++i) {
+    const uint64_t count =
+        histogram.getCountBelow(static_cast<uint64_t>(edgeMs * 1e6f));
+    finalHisto[i] = static_cast<float>(count - previousCount);
+    previousCount = count;
+    edgeMs *= 2.0f;
+  }
+  finalHisto[NUMBER_OF_HISTOGRAMS_BUCKETS - 1] =
+      static_cast<float>(histogram.getCount() - previousCount);
 
   // we need to normalize the histogram based on the biggest one,
   // imgui accepts values from 0-1
   float tallestValue = 0.0f;
-  for (int i = 0; i < NUMBER_OF_HISTOGRAMS_BUCKETS; ++i) {
-    if (m_framesHistogram[i] > tallestValue) {
-      tallestValue = m_framesHistogram[i];
-    }
+  for (float value : finalHisto) {
+    tallestValue = value > tallestValue ? value : tallestValue;
   }
-  // now that we have it we can normalize and populate the final histogram array
-  for (int i = 0; i < NUMBER_OF_HISTOGRAMS_BUCKETS; ++i) {
-    finalHisto[i] = m_framesHistogram[i] / tallestValue;
+  const float normalize = tallestValue > 0.0f ? 1.0f / tallestValue : 0.0f;
+  for (float &value : finalHisto) {
+    value *= normalize;
   }
-  std::string histoLabel{"Frame distribution: bucket size "};
-  histoLabel += std::to_string(bucketSize) + "ms";
+  std::string histoLabel{"Frame distribution: log2 buckets from "};
+  histoLabel += std::to_string(FIRST_BUCKET_MS) + "ms";
   ImGui::Text("%s",histoLabel.c_str());
   ImGui::PlotHistogram("", finalHisto, IM_ARRAYSIZE(finalHisto), 0, NULL, 0.0f,
                        1.0f, ImVec2(0, 80));
@@ -6,14 +6,13 @@ struct EngineContext;
 }
 
 namespace SirMetal::graphics {
+// draws the frame statistics collected by the engine Timing, it keeps no
+// state of its own
 struct FrameTimingsWidget final {
-  static constexpr uint32_t NUMBER_OF_SAMPLES = 200;
+  // log2 buckets, the first one is below FIRST_BUCKET_MS, the last one is
+  // above FIRST_BUCKET_MS * 2^(NUMBER_OF_HISTOGRAMS_BUCKETS - 2)
   static constexpr uint32_t NUMBER_OF_HISTOGRAMS_BUCKETS = 11;
-  static constexpr float MAX_FRAME_TIME = 20.0f;
-  FrameTimingsWidget();
+  static constexpr float FIRST_BUCKET_MS = 1.0f;
   void render(EngineContext *context);
-  float m_samples[NUMBER_OF_SAMPLES]{};
-  uint32_t m_runningCounter = 0;
-  float m_framesHistogram[NUMBER_OF_HISTOGRAMS_BUCKETS]{};
 };
 } // namespace SirMetal::graphics
@@ -2,10 +2,9 @@
 
 #include <exception>
 #include <filesystem>
-#include <fstream>
-#include <sstream>
 
 #include "SirMetal//io/fileUtils.h"
+#include "SirMetal/io/mappedFile.h"
 #include "nlohmann/json.hpp"
 
 namespace SirMetal {
@@ -40,18 +39,12 @@ void assertInJson(const nlohmann::json &jobj, const std::string &key) {
 }
 
 void getJsonObj(const std::string &path, nlohmann::json &outJson) {
-  bool res = fileExists(path);
-  if (res) {
-    // let s open the stream
-    std::ifstream st(path);
-    std::stringstream sBuffer;
-    sBuffer << st.rdbuf();
-    std::string sBuffStr = sBuffer.str();
-
+  // parsing straight from the mapped file, no copy of the text
+  const MappedFile file = MappedFile::open(path.c_str());
+  if (file.isValid()) {
     try {
       // try to parse
-      nlohmann::json jObj = nlohmann::json::parse(sBuffStr);
-      outJson = jObj;
+      outJson = nlohmann::json::parse(file.data(), file.data() + file.size());
     } catch (...) {
       // if not lets throw an error
       auto ex = std::current_exception();
@@ -0,0 +1,92 @@
+#include "SirMetal/io/mappedFile.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SirMetal {
+
+namespace {
+void adviseRange(const char *data, const uint64_t size, const uint32_t hints) {
+  if ((data == nullptr) | (size == 0)) {
+    return;
+  }
+  // madvise wants a page aligned start
+  const auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const auto address = reinterpret_cast<uintptr_t>(data);
+  const uintptr_t start = address & ~(pageSize - 1);
+  void *startPtr = reinterpret_cast<void *>(start);
+  const size_t length = size + (address - start);
+  if ((hints & MAPPED_FILE_HINT_SEQUENTIAL) != 0) {
+    madvise(startPtr, length, MADV_SEQUENTIAL);
+  }
+  if ((hints & MAPPED_FILE_HINT_RANDOM) != 0) {
+    madvise(startPtr, length, MADV_RANDOM);
+  }
+  if ((hints & MAPPED_FILE_HINT_WILL_NEED) != 0) {
+    madvise(startPtr, length, MADV_WILLNEED);
+  }
+}
+}  // namespace
+
+MappedFile MappedFile::open(const char *path, const uint32_t hints) {
+  MappedFile file;
+  const int descriptor = ::open(path, O_RDONLY);
+  if (descriptor < 0) {
+    printf("[ERROR] Could not open file %s to map it\n", path);
+    return file;
+  }
+  struct stat info {};
+  if (fstat(descriptor, &info) != 0) {
+    printf("[ERROR] Could not read the size of file %s\n", path);
+    ::close(descriptor);
+    return file;
+  }
+
+  const auto size = static_cast<uint64_t>(info.st_size);
+  const char *data = nullptr;
+  // mapping zero bytes is an error, an empty file is just valid with no data
+  if (size != 0) {
+    void *memory =
+        mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (memory == MAP_FAILED) {
+      printf("[ERROR] Could not map file %s\n", path);
+      ::close(descriptor);
+      return file;
+    }
+    data = static_cast<const char *>(memory);
+  }
+  // the mapping keeps its own reference to the file
+  ::close(descriptor);
+
+  file.m_mapping = new Mapping{data, size, {1}};
+  adviseRange(data, size, hints);
+  return file;
+}
+
+void MappedFile::advise(const uint64_t offset, const uint64_t size,
+                        const uint32_t hints) const {
+  if ((m_mapping == nullptr) || (offset >= m_mapping->size)) {
+    return;
+  }
+  const uint64_t available = m_mapping->size - offset;
+  adviseRange(m_mapping->data + offset, size < available ? size : available,
+              hints);
+}
+
+void MappedFile::release() {
+  if (m_mapping == nullptr) {
+    return;
+  }
+  if (m_mapping->referenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    if (m_mapping->data != nullptr) {
+      munmap(const_cast<char *>(m_mapping->data), m_mapping->size);
+    }
+    delete m_mapping;
+  }
+  m_mapping = nullptr;
+}
+
+}  // namespace SirMetal
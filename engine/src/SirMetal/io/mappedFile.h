@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+
+#include <atomic>
+
+namespace SirMetal {
+
+// how the mapping is going to be read, forwarded to madvise
+enum MAPPED_FILE_HINTS {
+  MAPPED_FILE_HINT_NONE = 0,
+  // read front to back once, the kernel reads ahead aggressively and can drop
+  // pages behind us
+  MAPPED_FILE_HINT_SEQUENTIAL = 1 << 1,
+  // jumping around, no read ahead
+  MAPPED_FILE_HINT_RANDOM = 1 << 2,
+  // all of it is going to be needed soon, start paging it in now
+  MAPPED_FILE_HINT_WILL_NEED = 1 << 3
+};
+
+// Read only view of a whole file mapped in memory. The data is the page cache
+// itself, there is no copy in a user buffer and pages are only read from disk
+// when touched.
+// Copies share the same mapping, which is reference counted and unmapped when
+// the last copy goes away, so a loader can hand out views of the file to
+// whoever needs to keep it around, like buffers pointing inside a glb.
+// The content is not null terminated.
+class MappedFile final {
+ public:
+  struct Span {
+    const char *data;
+    uint64_t size;
+  };
+
+  // an invalid file, isValid() is false
+  MappedFile() = default;
+  // on failure, missing file or failed mapping, the result is invalid. An
+  // empty file is valid with no data
+  static MappedFile open(const char *path,
+                         uint32_t hints = MAPPED_FILE_HINT_SEQUENTIAL);
+
+  MappedFile(const MappedFile &other) : m_mapping(other.m_mapping) {
+    acquire();
+  }
+  MappedFile(MappedFile &&other) noexcept : m_mapping(other.m_mapping) {
+    other.m_mapping = nullptr;
+  }
+  MappedFile &operator=(const MappedFile &other) {
+    if (this != &other) {
+      release();
+      m_mapping = other.m_mapping;
+      acquire();
+    }
+    return *this;
+  }
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      release();
+      m_mapping = other.m_mapping;
+      other.m_mapping = nullptr;
+    }
+    return *this;
+  }
+  ~MappedFile() { release(); }
+
+  bool isValid() const { return m_mapping != nullptr; }
+  const char *data() const {
+    return m_mapping != nullptr ? m_mapping->data : nullptr;
+  }
+  uint64_t size() const { return m_mapping != nullptr ? m_mapping->size : 0; }
+  Span getSpan() const { return Span{data(), size()}; }
+  // how many MappedFile share the mapping, 0 if invalid
+  uint32_t getReferenceCount() const {
+    return m_mapping != nullptr
+               ? m_mapping->referenceCount.load(std::memory_order_relaxed)
+               : 0;
+  }
+  // new hints for part of the file, offset and size are in bytes and get
+  // widened to whole pages
+  void advise(uint64_t offset, uint64_t size, uint32_t hints) const;
+  // drops this reference, the mapping stays alive if it is shared
+  void close() { release(); }
+
+ private:
+  struct Mapping {
+    const char *data;
+    uint64_t size;
+    std::atomic<uint32_t> referenceCount;
+  };
+
+  void acquire() {
+    if (m_mapping != nullptr) {
+      m_mapping->referenceCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  void release();
+
+  Mapping *m_mapping = nullptr;
+};
+
+}  // namespace SirMetal
@@ -0,0 +1,142 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+// Decimal number parsing for text assets. Floats are exactly rounded, the
+// same value strtof gives, the digits are gathered in an integer and scaled
+// once instead of being accumulated in a double:
+// - up to 19 digits and a power of ten up to 22 the mantissa and the power
+//   are exact doubles, a single division or multiplication rounds correctly
+//   (Clinger's fast path). Rounding that double to float is only wrong when
+//   it lands exactly half way between two floats, that case is checked.
+// - anything else, very long mantissas or huge exponents, is handed to
+//   strtof, it is rare in meshes.
+// The digits are scanned one at a time on purpose, numbers in meshes are
+// short and a predicted loop lets the cpu start on the next number right
+// away, finding the length with a vector compare makes every number wait on
+// the previous one
+namespace SirMetal {
+
+namespace numberParsingInternal {
+static constexpr uint32_t MAX_FAST_DIGITS = 19;
+static constexpr int32_t MAX_FAST_POWER = 22;
+static constexpr uint64_t MAX_FAST_MANTISSA = 1ull << 53;
+static constexpr double POWERS_OF_TEN[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool isDigit(const char c) { return unsigned(c - '0') < 10; }
+
+// exactly half way between two floats, rounding it again would be a double
+// rounding. Only valid in the normal float range, which is all the fast path
+// can produce
+inline bool isFloatMidpoint(const double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(double));
+  // a double has 29 more mantissa bits than a float
+  return (bits & ((1ull << 29) - 1)) == (1ull << 28);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((noinline, cold))
+#endif
+inline float parseFloatSlow(const char *begin, const char *end) {
+  // strtof needs a terminated string, and only gets the characters already
+  // validated so it can't go further, as in reading a hex float. Relies on
+  // the C locale, which the engine never changes
+  const auto length = static_cast<size_t>(end - begin);
+  char buffer[64];
+  if (length < sizeof(buffer)) {
+    memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    return strtof(buffer, nullptr);
+  }
+  const std::string copy(begin, length);
+  return strtof(copy.c_str(), nullptr);
+}
+}  // namespace numberParsingInternal
+
+// skips spaces and tabs, reads [sign]digits[.digits][(e|E)[sign]digits].
+// Reading stops at the first character that does not fit, end is set to it,
+// no digits at all reads as zero
+inline float parseFloat(const char *s, const char **end) {
+  using namespace numberParsingInternal;
+  while (*s == ' ' || *s == '\t') {
+    s++;
+  }
+  const char *token = s;
+  const bool negative = *s == '-';
+  s += (*s == '-' || *s == '+');
+
+  // past 19 digits the mantissa wraps around, those go to the slow path
+  uint64_t mantissa = 0;
+  const char *integer = s;
+  while (isDigit(*s)) {
+    mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+    s++;
+  }
+  auto digits = static_cast<uint32_t>(s - integer);
+  int32_t power = 0;
+  if (*s == '.') {
+    s++;
+    const char *fraction = s;
+    while (isDigit(*s)) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+      s++;
+    }
+    power = -static_cast<int32_t>(s - fraction);
+    digits += static_cast<uint32_t>(s - fraction);
+  }
+  if ((*s | ' ') == 'e') {
+    s++;
+    const bool negativeExponent = *s == '-';
+    s += (*s == '-' || *s == '+');
+    int32_t exponent = 0;
+    while (isDigit(*s)) {
+      // big enough to be infinity or zero, no overflow
+      exponent = exponent < 100000 ? exponent * 10 + (*s - '0') : exponent;
+      s++;
+    }
+    power += negativeExponent ? -exponent : exponent;
+  }
+  *end = s;
+
+  if (digits <= MAX_FAST_DIGITS) {
+    if (mantissa == 0) {
+      return negative ? -0.0f : 0.0f;
+    }
+    if ((mantissa <= MAX_FAST_MANTISSA) & (power >= -MAX_FAST_POWER) &
+        (power <= MAX_FAST_POWER)) {
+      double value = static_cast<double>(static_cast<int64_t>(mantissa));
+      value = power < 0 ? value / POWERS_OF_TEN[-power]
+                        : value * POWERS_OF_TEN[power];
+      if (!isFloatMidpoint(value)) {
+        const auto result = static_cast<float>(value);
+        return negative ? -result : result;
+      }
+    }
+  }
+  return parseFloatSlow(token, s);
+}
+
+// skips spaces and tabs, reads [sign]digits, wraps around on overflow
+inline int parseInt(const char *s, const char **end) {
+  using namespace numberParsingInternal;
+  while (*s == ' ' || *s == '\t') {
+    s++;
+  }
+  const bool negative = *s == '-';
+  s += (*s == '-' || *s == '+');
+  uint32_t result = 0;
+  while (isDigit(*s)) {
+    result = result * 10 + static_cast<uint32_t>(*s - '0');
+    s++;
+  }
+  *end = s;
+  return negative ? -int(result) : int(result);
+}
+
+}  // namespace SirMetal
@@ -1,11 +1,18 @@
 #include "SirMetal/resources/gltfLoader.h"
+#include "SirMetal/core/memory/denseTree.h"
+#include "SirMetal/core/parallelFor.h"
 #include "SirMetal/engine.h"
 #include "SirMetal/io/fileUtils.h"
+#include "SirMetal/io/mappedFile.h"
 #include "SirMetal/resources/meshes/meshManager.h"
 #include "SirMetal/resources/textureManager.h"
 #include <SirMetal/core/mathUtils.h>
 #include <simd/simd.h>
 
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
 #define CGLTF_IMPLEMENTATION
 #include "SirMetal/engine.h"
 #include "SirMetal/graphics/renderingContext.h"
@@ -64,18 +71,13 @@ GLTFMaterial loadMaterial(EngineContext *context,
 }
 
 void loadNode(EngineContext *context, const cgltf_node *node,
-              GLTFAsset &outAsset, const GLTFLoadOptions& loadOptions,
-              simd_float4x4 parentMatrix) {
+              GLTFAsset &outAsset, const GLTFLoadOptions &loadOptions,
+              const simd_float4x4 &worldMatrix, const MeshHandle mesh) {
   Model model{};
   GLTFMaterial material{};
   if (node->mesh != nullptr) {
     printf("loading mesh for node %s\n", node->name);
-    assert(node->mesh->primitives_count == 1 &&
-           "gltf loader does not support multiple primitives per mesh yet");
-    model.mesh = context->m_meshManager->loadFromMemory(
-            node->mesh, LOAD_MESH_TYPE::GLTF_MESH, &loadOptions);
-
-    assert(node->mesh->primitives_count == 1);
+    model.mesh = mesh;
 
     if (node->mesh->primitives[0].material != nullptr) {
       material =
@@ -83,8 +85,7 @@ void loadNode(EngineContext *context, const cgltf_node *node,
     }
   }
 
-  simd_float4x4 matrix = getMatrix(*node);
-  model.matrix = simd_mul(parentMatrix, matrix);
+  model.matrix = worldMatrix;
 
   bool flatten = (loadOptions.flags & GLTF_LOAD_FLAGS_FLATTEN_HIERARCHY) > 0;
   bool isEmpty = node->mesh == nullptr;
@@ -92,10 +93,136 @@ void loadNode(EngineContext *context, const cgltf_node *node,
     outAsset.models.push_back(model);
     outAsset.materials.push_back(material);
   }
+}
+
+// builds a flat tree of the scene nodes, under a root with no gltf node, once
+// sorted depth first the nodes are in the same order a recursive visit of the
+// scene would produce
+void buildSceneTree(const cgltf_scene *scene, DenseTree &tree) {
+  tree.createRoot(0);
+  // the tree nodes are created breadth first, every node created is later
+  // visited to create its children
+  for (int i = 0; i < scene->nodes_count; ++i) {
+    tree.createNode(tree.getNodes()[0], i, scene->nodes[i]);
+  }
+  for (uint32_t i = 1; i < tree.getNodes().size(); ++i) {
+    const auto *node =
+            static_cast<const cgltf_node *>(tree.getNodes()[i].nodeData);
+    for (int c = 0; c < node->children_count; ++c) {
+      tree.createNode(tree.getNodes()[i], c, node->children[c]);
+    }
+  }
+}
+
+// every mesh referenced by the nodes, once even when shared by several nodes,
+// in the order the sorted nodes first use them
+void collectMeshes(const std::vector<DenseTreeNode> &nodes,
+                   std::vector<const cgltf_mesh *> &outMeshes,
+                   std::unordered_map<const cgltf_mesh *, uint32_t> &outIndices) {
+  for (uint32_t i = 1; i < nodes.size(); ++i) {
+    const auto *node = static_cast<const cgltf_node *>(nodes[i].nodeData);
+    if (node->mesh == nullptr) {
+      continue;
+    }
+    assert(node->mesh->primitives_count == 1 &&
+           "gltf loader does not support multiple primitives per mesh yet");
+    const auto inserted = outIndices.emplace(
+            node->mesh, static_cast<uint32_t>(outMeshes.size()));
+    if (inserted.second) {
+      outMeshes.push_back(node->mesh);
+    }
+  }
+}
 
-  for (int c = 0; c < node->children_count; ++c) {
-    const auto *child = node->children[c];
-    loadNode(context, child, outAsset, loadOptions, model.matrix);
+// rough cost of preparing a mesh, the light map unwrap and the optimizations
+// all scale with the triangles
+cgltf_size getMeshCost(const cgltf_mesh *mesh) {
+  const cgltf_primitive &primitive = mesh->primitives[0];
+  if (primitive.indices != nullptr) {
+    return primitive.indices->count;
+  }
+  return primitive.attributes_count > 0 ? primitive.attributes[0].data->count
+                                        : 0;
+}
+
+// Decode, attribute normalization, light map uvs and vertex cache
+// optimization of every mesh are independent, they run on worker threads.
+// The gpu buffers are then created here in the mesh order, the handles are the
+// same whatever thread finished first
+void loadMeshes(EngineContext *context,
+                const std::vector<const cgltf_mesh *> &meshes,
+                const GLTFLoadOptions &loadOptions,
+                std::vector<MeshHandle> &outHandles) {
+  MeshManager *meshManager = context->m_meshManager;
+  const auto meshCount = static_cast<uint32_t>(meshes.size());
+
+  // most expensive first, a big unwrap picked up last would run alone
+  std::vector<uint32_t> order(meshCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&meshes](const uint32_t a, const uint32_t b) {
+                     return getMeshCost(meshes[a]) > getMeshCost(meshes[b]);
+                   });
+
+  std::vector<PreparedMesh> prepared(meshCount);
+  parallelFor(getWorkerThreadCount(), meshCount, [&](const size_t i) {
+    const uint32_t m = order[i];
+    meshManager->prepareFromMemory(prepared[m], meshes[m],
+                                   LOAD_MESH_TYPE::GLTF_MESH, &loadOptions);
+  });
+
+  outHandles.resize(meshCount);
+  for (uint32_t m = 0; m < meshCount; ++m) {
+    outHandles[m] = meshManager->uploadPrepared(prepared[m]);
+    // the cpu copy is not needed once uploaded
+    prepared[m] = PreparedMesh{};
+  }
+}
+
+// cgltf reads the gltf/glb and its buffers through these, every file is
+// mapped instead of read in a heap copy, for a glb the binary chunk and the
+// buffers pointing in it are straight views of the mapping
+struct GLTFMappedFiles {
+  std::vector<MappedFile> files;
+};
+
+cgltf_result readMappedFile(const cgltf_memory_options *,
+                            const cgltf_file_options *fileOptions,
+                            const char *path, cgltf_size *size, void **data) {
+  MappedFile file = MappedFile::open(path, MAPPED_FILE_HINT_WILL_NEED);
+  if (!file.isValid()) {
+    return cgltf_result_file_not_found;
+  }
+  // the size is asked up front for buffers, zero means the whole file
+  if (*size > file.size()) {
+    return cgltf_result_io_error;
+  }
+  if (*size == 0) {
+    *size = file.size();
+  }
+  *data = const_cast<char *>(file.data());
+  auto *mappedFiles = static_cast<GLTFMappedFiles *>(fileOptions->user_data);
+  mappedFiles->files.emplace_back(std::move(file));
+  return cgltf_result_success;
+}
+
+void releaseMappedFile(const cgltf_memory_options *memoryOptions,
+                       const cgltf_file_options *fileOptions, void *data) {
+  auto *mappedFiles = static_cast<GLTFMappedFiles *>(fileOptions->user_data);
+  std::vector<MappedFile> &files = mappedFiles->files;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (files[i].data() == data) {
+      files[i] = std::move(files.back());
+      files.pop_back();
+      return;
+    }
+  }
+  // not a mapping, cgltf can hand back the buffers it decoded itself, like
+  // base64 data uris, those are freed as its default release would
+  if (memoryOptions->free != nullptr) {
+    memoryOptions->free(memoryOptions->user_data, data);
+  } else {
+    free(data);
   }
 }
 
@@ -104,7 +231,12 @@ bool loadGLTF(EngineContext *context, const char *path, GLTFAsset &outAsset,
   assert(((loadOptions.flags & GLTF_LOAD_FLAGS_FLATTEN_HIERARCHY) > 0) &&
          "only flatten hierarchy supported for now");
   assert(fileExists(path));
+  // needs to outlive cgltf_free
+  GLTFMappedFiles mappedFiles;
   cgltf_options options = {};
+  options.file.read = readMappedFile;
+  options.file.release = releaseMappedFile;
+  options.file.user_data = &mappedFiles;
   cgltf_data *data = nullptr;
   cgltf_result result = cgltf_parse_file(&options, path, &data);
   if (result != cgltf_result_success) {
@@ -122,12 +254,42 @@ bool loadGLTF(EngineContext *context, const char *path, GLTFAsset &outAsset,
   printf("Loading gltf file %s\n", path);
 
   cgltf_scene *scene = data->scene;
-  // iterate the the scene
-  int nodesCount = scene->nodes_count;
-  for (int i = 0; i < nodesCount; ++i) {
-    auto *node = scene->nodes[i];
-    printf("Node -> %s\n", node->name);
-    loadNode(context, node, outAsset, loadOptions, getIdentity());
+  DenseTree tree;
+  tree.initialize(static_cast<uint32_t>(data->nodes_count) + 1);
+  buildSceneTree(scene, tree);
+  tree.depthFirstSort();
+
+  // world matrices for the whole scene in a single pass over the sorted nodes
+  const std::vector<DenseTreeNode> &nodes = tree.getNodes();
+  const auto nodesCount = static_cast<uint32_t>(nodes.size());
+  std::vector<simd_float4x4> localMatrices(nodesCount);
+  std::vector<simd_float4x4> worldMatrices(nodesCount);
+  for (uint32_t i = 0; i < nodesCount; ++i) {
+    const auto *node = static_cast<const cgltf_node *>(nodes[i].nodeData);
+    localMatrices[i] = node != nullptr ? getMatrix(*node) : getIdentity();
+  }
+  tree.propagateTransforms(
+          localMatrices.data(), worldMatrices.data(),
+          [](const simd_float4x4 &parent, const simd_float4x4 &local) {
+            return simd_mul(parent, local);
+          });
+
+  std::vector<const cgltf_mesh *> meshes;
+  std::unordered_map<const cgltf_mesh *, uint32_t> meshIndices;
+  collectMeshes(nodes, meshes, meshIndices);
+  std::vector<MeshHandle> meshHandles;
+  loadMeshes(context, meshes, loadOptions, meshHandles);
+
+  // skipping the root, it is not a gltf node
+  for (uint32_t i = 1; i < nodesCount; ++i) {
+    const auto *node = static_cast<const cgltf_node *>(nodes[i].nodeData);
+    if (nodes[i].parentIndex == 0) {
+      printf("Node -> %s\n", node->name);
+    }
+    const MeshHandle mesh = node->mesh != nullptr
+                                    ? meshHandles[meshIndices[node->mesh]]
+                                    : MeshHandle{};
+    loadNode(context, node, outAsset, loadOptions, worldMatrices[i], mesh);
   }
 
   cgltf_free(data);
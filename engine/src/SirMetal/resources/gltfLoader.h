@@ -23,6 +23,8 @@ enum GLTFLoadFlags : uint32_t {
   GLTF_LOAD_FLAGS_NONE = 0,
   GLTF_LOAD_FLAGS_FLATTEN_HIERARCHY = 1,
   GLTF_LOAD_FLAGS_GENERATE_LIGHT_MAP_UVS = 2,
+  // meshlets with their bounds, for per cluster culling
+  GLTF_LOAD_FLAGS_GENERATE_MESHLETS = 4,
 };
 
 
@@ -14,6 +14,9 @@ namespace SirMetal {
         BUFFER= 4,
     };
 
+    // handles keep the type in the top 8 bits, the lower 24 bits are the index
+    // given by the manager, for managers backed by a SlotMap that is the slot
+    // map key, which includes the generation of the slot
     template<typename T>
     inline T getHandle(const uint32_t index) {
         return {(static_cast<uint32_t>(T::type) << 24)| index};
@@ -1,12 +1,13 @@
 #include "SirMetal/resources/meshes/gltfMesh.h"
+#include "SirMetal/core/memory/cpu/frameArena.h"
+#include "SirMetal/core/profiler.h"
 #include "SirMetal/resources/gltfLoader.h"
+#include "SirMetal/resources/meshes/meshCache.h"
 #include "SirMetal/resources/meshes/meshOptimize.h"
 
 #include <cgltf/cgltf.h>
 #include <xatlas/xatlas.h>
 
-#include <chrono>
-
 namespace SirMetal {
 static cgltf_size component_size(cgltf_component_type component_type) {
   switch (component_type) {
@@ -46,7 +47,41 @@ static cgltf_size component_count(cgltf_type type) {
   }
 }
 
+static uint64_t hashAccessor(const cgltf_accessor *accessor, uint64_t hash) {
+  const cgltf_buffer_view *view = accessor->buffer_view;
+  const uint64_t layout[3] = {accessor->count, accessor->component_type,
+                              accessor->type};
+  hash = hashMeshSource(layout, sizeof(layout), hash);
+  return hashMeshSource(static_cast<const char *>(view->buffer->data) + view->offset,
+                        view->size, hash);
+}
+
+uint64_t hashGltfMeshSource(const void *gltfMesh, const void *options) {
+  const auto *mesh = reinterpret_cast<const cgltf_mesh *>(gltfMesh);
+  const auto *typedOptions = static_cast<const GLTFLoadOptions *>(options);
+  // the options and the name change what gets built, they are part of the key
+  const uint32_t optionValues[2] = {typedOptions->flags, typedOptions->lightMapSize};
+  uint64_t hash = hashMeshSource(optionValues, sizeof(optionValues),
+                                 MESH_CACHE_SEED_GLTF);
+  if (mesh->name != nullptr) {
+    hash = hashMeshSource(mesh->name, strlen(mesh->name), hash);
+  }
+  // the attributes the loader looks for, a missing one changes the key too
+  const cgltf_primitive &prim = mesh->primitives[0];
+  for (uint32_t attrIdx = 0; attrIdx < MESH_ATTRIBUTE_TYPE_COUNT; ++attrIdx) {
+    for (int a = 0; a < prim.attributes_count; ++a) {
+      if (strcmp(prim.attributes[a].name, MESH_ATTRIBUTES[attrIdx]) == 0) {
+        hash = hashMeshSource(&attrIdx, sizeof(attrIdx), hash);
+        hash = hashAccessor(prim.attributes[a].data, hash);
+        break;
+      }
+    }
+  }
+  return hashAccessor(prim.indices, hash);
+}
+
 bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* options) {
+  SM_PROFILE_SCOPE("loadGltfMesh");
   const auto *mesh = reinterpret_cast<const cgltf_mesh *>(gltfMesh);
 
   auto* typedOptions = static_cast<const GLTFLoadOptions*>(options);
@@ -74,7 +109,12 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
   bool found = false;
   int foundIdx = 0;
 
-  std::vector<float> fullMeshData[MESH_ATTRIBUTE_TYPE_COUNT];
+  // the de-interleaved attributes are only needed until they are merged in
+  // the final vertex buffer, they live in the thread scratch memory
+  FrameArena &scratch = getThreadScratchArena();
+  FrameArenaScope scratchScope(scratch);
+  float *fullMeshData[MESH_ATTRIBUTE_TYPE_COUNT] = {};
+  uint64_t fullMeshSizes[MESH_ATTRIBUTE_TYPE_COUNT] = {};
   float strides[MESH_ATTRIBUTE_TYPE_COUNT] = {};
 
   for (int attrIdx = 0; attrIdx < MESH_ATTRIBUTE_TYPE_COUNT; ++attrIdx) {
@@ -109,15 +149,14 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
                MESH_ATTRIBUTES[attrIdx]);
         assert(uniqueVerticesCount != -1);
         uint32_t sizeInFloats = MESH_ATTRIBUTE_SIZE_IN_BYTES[attrIdx] / sizeof(float);
-        fullMeshData[attrIdx].resize(uniqueVerticesCount * sizeInFloats);
-        memset(fullMeshData[attrIdx].data(), 0,
-               fullMeshData[attrIdx].size() * sizeof(float));
+        fullMeshSizes[attrIdx] = uniqueVerticesCount * sizeInFloats;
+        fullMeshData[attrIdx] = scratch.allocArray<float>(fullMeshSizes[attrIdx]);
+        memset(fullMeshData[attrIdx], 0, fullMeshSizes[attrIdx] * sizeof(float));
       }
       continue;
     }
 
     assert(foundIdx < 4);
-    auto &meshData = fullMeshData[attrIdx];
 
     // gltf maps a vertex attribute to an accessor, an accessor contains data
     // telling us how to read/access the data to make sense of it.
@@ -155,17 +194,22 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
     // to fill a value if we get a vec3, we use a different filler per attribute
     float filler = attrIdx == 0 ? 1.0f : 0.0f;
 
+    const uint32_t outComponents = attrIdx != MESH_ATTRIBUTE_TYPE_UV ? 4 : 2;
+    fullMeshSizes[attrIdx] = uniqueVerticesCount * outComponents;
+    float *meshData = scratch.allocArray<float>(fullMeshSizes[attrIdx]);
+    fullMeshData[attrIdx] = meshData;
     for (int idx = 0; idx < uniqueVerticesCount; ++idx) {
-      meshData.push_back(dataToCopy[idx * componentCount + 0]);
-      meshData.push_back(dataToCopy[idx * componentCount + 1]);
+      float *outVertex = meshData + idx * outComponents;
+      outVertex[0] = dataToCopy[idx * componentCount + 0];
+      outVertex[1] = dataToCopy[idx * componentCount + 1];
       if (attrIdx != MESH_ATTRIBUTE_TYPE_UV) {
         // if is not a UV (float2) we push in the 3rd parameter plus filler
-        meshData.push_back(dataToCopy[idx * componentCount + 2]);
-        meshData.push_back(filler);
+        outVertex[2] = dataToCopy[idx * componentCount + 2];
+        outVertex[3] = filler;
       }
     }
 
-    size_t end = static_cast<uint32_t>(meshData.size());
+    size_t end = fullMeshSizes[attrIdx];
 
     if (attrIdx == MESH_ATTRIBUTE_TYPE_POSITION) {
       // generate bounding boxes for the positions
@@ -175,7 +219,7 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
       float maxX = std::numeric_limits<float>::min();
       float maxY = maxX;
       float maxZ = maxX;
-      const float *posData = meshData.data();
+      const float *posData = meshData;
       for (size_t p = 0; p < end; p += 4) {
         const float *vtx = posData + p;
 
@@ -223,7 +267,7 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
 
   bool generateLightUVs = (gltfFlags & GLTF_LOAD_FLAGS_GENERATE_LIGHT_MAP_UVS) > 0;
   if (generateLightUVs) {
-    auto t1 = std::chrono::high_resolution_clock::now();
+    SM_PROFILE_SCOPE("generate light map uvs");
 
     //let us generate the uvs for lightmapping
     //Atlas_Dim dim;
@@ -231,12 +275,12 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
     // Prepare mesh to be processed by xatlas:
     {
       xatlas::MeshDecl meshDcl;
-      meshDcl.vertexCount = static_cast<uint32_t>(fullMeshData[0].size()) / 4;
-      meshDcl.vertexPositionData = fullMeshData[0].data();
+      meshDcl.vertexCount = static_cast<uint32_t>(fullMeshSizes[0]) / 4;
+      meshDcl.vertexPositionData = fullMeshData[0];
       meshDcl.vertexPositionStride = sizeof(float) * 4;
-      meshDcl.vertexNormalData = fullMeshData[1].data();
+      meshDcl.vertexNormalData = fullMeshData[1];
       meshDcl.vertexNormalStride = sizeof(float) * 4;
-      meshDcl.vertexUvData = fullMeshData[2].data();
+      meshDcl.vertexUvData = fullMeshData[2];
       meshDcl.vertexUvStride = sizeof(float) * 2;
       meshDcl.indexCount = outMesh.indices.size();
       meshDcl.indexData = outMesh.indices.data();
@@ -266,11 +310,17 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
 
       outMesh.indices.clear();
       outMesh.indices.resize(atlasMesh.indexCount);
-      std::vector<float> apos(atlasMesh.vertexCount * 4);
-      std::vector<float> anorm(atlasMesh.vertexCount * 4);
-      std::vector<float> auv(atlasMesh.vertexCount * 2);
-      std::vector<float> atan(atlasMesh.vertexCount * 4);
-      fullMeshData[MESH_ATTRIBUTE_TYPE_UV_LIGHTMAP].resize(atlasMesh.vertexCount * 2);
+      const uint64_t atlasVertexCount = atlasMesh.vertexCount;
+      float *apos = scratch.allocArray<float>(atlasVertexCount * 4);
+      float *anorm = scratch.allocArray<float>(atlasVertexCount * 4);
+      float *auv = scratch.allocArray<float>(atlasVertexCount * 2);
+      float *atan = scratch.allocArray<float>(atlasVertexCount * 4);
+      float *auv2 = scratch.allocArray<float>(atlasVertexCount * 2);
+      memset(apos, 0, sizeof(float) * atlasVertexCount * 4);
+      memset(anorm, 0, sizeof(float) * atlasVertexCount * 4);
+      memset(auv, 0, sizeof(float) * atlasVertexCount * 2);
+      memset(atan, 0, sizeof(float) * atlasVertexCount * 4);
+      memset(auv2, 0, sizeof(float) * atlasVertexCount * 2);
 
 
       for (uint32_t j = 0; j < atlasMesh.indexCount; ++j) {
@@ -280,8 +330,8 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
         outMesh.indices[j] = ind;
         uint32_t vid = ind * 4u;
         uint32_t vidSrc = v.xref * 4u;
-        assert(vid < apos.size());
-        assert(vidSrc < fullMeshData[0].size());
+        assert(vid < atlasVertexCount * 4);
+        assert(vidSrc < fullMeshSizes[0]);
         apos[vid + 0] = fullMeshData[0][vidSrc + 0];
         apos[vid + 1] = fullMeshData[0][vidSrc + 1];
         apos[vid + 2] = fullMeshData[0][vidSrc + 2];
@@ -292,8 +342,8 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
         anorm[vid + 2] = fullMeshData[1][vidSrc + 2];
         anorm[vid + 3] = fullMeshData[1][vidSrc + 3];
 
-        assert((ind * 2) < apos.size());
-        assert((v.xref * 2) < fullMeshData[2].size());
+        assert((ind * 2) < atlasVertexCount * 2);
+        assert((v.xref * 2) < fullMeshSizes[2]);
         auv[ind * 2 + 0] = fullMeshData[2][v.xref * 2 + 0];
         auv[ind * 2 + 1] = fullMeshData[2][v.xref * 2 + 1];
 
@@ -302,38 +352,53 @@ bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* opt
         atan[vid + 2] = fullMeshData[3][vidSrc + 2];
         atan[vid + 3] = fullMeshData[3][vidSrc + 3];
 
-        fullMeshData[4][ind * 2 + 0] = v.uv[0] / float(aw);
-        fullMeshData[4][ind * 2 + 1] = v.uv[1] / float(ah);
+        auv2[ind * 2 + 0] = v.uv[0] / float(aw);
+        auv2[ind * 2 + 1] = v.uv[1] / float(ah);
       }
+      // the old buffers stay in the scratch memory until the end of the
+      // function, no need to copy
       fullMeshData[MESH_ATTRIBUTE_TYPE_POSITION] = apos;
       fullMeshData[MESH_ATTRIBUTE_TYPE_NORMAL] = anorm;
       fullMeshData[MESH_ATTRIBUTE_TYPE_UV] = auv;
       fullMeshData[MESH_ATTRIBUTE_TYPE_TANGENT] = atan;
+      fullMeshData[MESH_ATTRIBUTE_TYPE_UV_LIGHTMAP] = auv2;
+      fullMeshSizes[MESH_ATTRIBUTE_TYPE_POSITION] = atlasVertexCount * 4;
+      fullMeshSizes[MESH_ATTRIBUTE_TYPE_NORMAL] = atlasVertexCount * 4;
+      fullMeshSizes[MESH_ATTRIBUTE_TYPE_UV] = atlasVertexCount * 2;
+      fullMeshSizes[MESH_ATTRIBUTE_TYPE_TANGENT] = atlasVertexCount * 4;
+      fullMeshSizes[MESH_ATTRIBUTE_TYPE_UV_LIGHTMAP] = atlasVertexCount * 2;
 
       //setting the stride for the uvs
       strides[MESH_ATTRIBUTE_TYPE_UV_LIGHTMAP] = static_cast<float>(
               MESH_ATTRIBUTE_SIZE_IN_BYTES[MESH_ATTRIBUTE_TYPE_UV_LIGHTMAP] / 4u);
-
-      auto t2 = std::chrono::high_resolution_clock::now();
-      auto secs = std::chrono::duration_cast<std::chrono::seconds>(t2 - t1);
-      printf("Generating atlas for mesh %s took %llds\n", outMesh.name.c_str(),
-             secs.count());
     }
   }
 
 
-  std::vector<uint32_t> inIndices = outMesh.indices;
-  SirMetal::optimizeVertexCache(outMesh.indices, inIndices, outMesh.indices.size(),
-                                fullMeshData[0].size());
+  const auto indexCount = static_cast<uint32_t>(outMesh.indices.size());
+  auto *inIndices = scratch.allocArray<uint32_t>(indexCount);
+  memcpy(inIndices, outMesh.indices.data(), sizeof(uint32_t) * indexCount);
+  SirMetal::optimizeVertexCache(outMesh.indices, inIndices, indexCount,
+                                fullMeshSizes[0]);
 
   // merge the buffer into a single one
   int attributesCount = 4;
   //if we have the uv maps we have an extra attributes. this is good enough until we have skinning, then it will be trickier
   attributesCount += generateLightUVs ? 1 : 0;
-  SirMetal::mergeRawMeshBuffers(fullMeshData, strides, attributesCount, outMesh.vertices,
+  MeshAttribute attributes[MESH_ATTRIBUTE_TYPE_COUNT];
+  for (int i = 0; i < MESH_ATTRIBUTE_TYPE_COUNT; ++i) {
+    attributes[i] = {fullMeshData[i], fullMeshSizes[i]};
+  }
+  SirMetal::mergeRawMeshBuffers(attributes, strides, attributesCount, outMesh.vertices,
                                 outMesh.ranges);
 
-  outMesh.name = mesh->name;
+  if ((gltfFlags & GLTF_LOAD_FLAGS_GENERATE_MESHLETS) > 0) {
+    SM_PROFILE_SCOPE("build meshlets");
+    SirMetal::buildMeshlets(outMesh, scratch);
+  }
+
+  // the name is optional in gltf
+  outMesh.name = mesh->name != nullptr ? mesh->name : "";
 
   return true;
 }
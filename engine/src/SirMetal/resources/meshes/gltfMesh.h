@@ -4,4 +4,6 @@
 
 namespace SirMetal {
 bool loadGltfMesh(MeshLoadResult &outMesh, const void *gltfMesh, const void* options);
+// mesh cache key, hashes the buffers loadGltfMesh reads and the options
+uint64_t hashGltfMeshSource(const void *gltfMesh, const void *options);
 }
\ No newline at end of file
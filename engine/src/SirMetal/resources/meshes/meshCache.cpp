@@ -0,0 +1,174 @@
+#include "SirMetal/resources/meshes/meshCache.h"
+#include "SirMetal/core/hashing/farmhash.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace SirMetal {
+
+namespace {
+uint64_t alignUp(const uint64_t value) {
+  return (value + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+bool writePadded(FILE *file, const void *data, const uint64_t size,
+                 uint64_t &written) {
+  static const char ZEROES[MESH_CACHE_ALIGNMENT] = {};
+  if ((size != 0) && (fwrite(data, 1, size, file) != size)) {
+    return false;
+  }
+  const uint64_t padding = alignUp(written + size) - (written + size);
+  if ((padding != 0) && (fwrite(ZEROES, 1, padding, file) != padding)) {
+    return false;
+  }
+  written += size + padding;
+  return true;
+}
+
+bool isSectionInFile(const uint64_t offset, const uint64_t count,
+                     const uint64_t elementSize, const uint64_t fileSize) {
+  // the count check keeps the multiplication from overflowing
+  return (offset % MESH_CACHE_ALIGNMENT == 0) && (offset <= fileSize) &&
+         (count <= (fileSize - offset) / elementSize);
+}
+
+bool isRangeInVertices(const MemoryRange &range, const uint64_t verticesSize) {
+  return uint64_t(range.m_offset) + range.m_size <= verticesSize;
+}
+
+// the attribute and cluster ranges are in bytes inside the vertex buffer
+bool areRangesInVertices(const MeshCacheHeader &header) {
+  const uint64_t verticesSize = header.vertexCount * sizeof(float);
+  for (const MemoryRange &range : header.ranges) {
+    if (!isRangeInVertices(range, verticesSize)) {
+      return false;
+    }
+  }
+  for (const MemoryRange &range : header.clusterRanges) {
+    if (!isRangeInVertices(range, verticesSize)) {
+      return false;
+    }
+  }
+  // the culling walks meshletCount entries of both ranges
+  const MemoryRange &meshlets =
+      header.clusterRanges[MESH_CLUSTER_DATA_TYPE_MESHLETS];
+  const MemoryRange &bounds = header.clusterRanges[MESH_CLUSTER_DATA_TYPE_BOUNDS];
+  return (uint64_t(header.meshletCount) * sizeof(Meshlet) <= meshlets.m_size) &&
+         (uint64_t(header.meshletCount) * sizeof(MeshletBounds) <=
+          bounds.m_size);
+}
+}  // namespace
+
+uint64_t hashMeshSource(const void *data, const uint64_t sizeInBytes,
+                        const uint64_t seed) {
+  return util::Hash64WithSeed(static_cast<const char *>(data), sizeInBytes,
+                              seed ^ MESH_CACHE_VERSION);
+}
+
+std::string getMeshCachePath(const std::string &directory,
+                             const uint64_t sourceHash) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx",
+           static_cast<unsigned long long>(sourceHash));
+  return directory + "/" + name + MESH_CACHE_EXTENSION;
+}
+
+bool writeMeshCache(const char *path, const MeshLoadResult &mesh,
+                    const uint64_t sourceHash) {
+  MeshCacheHeader header{};
+  header.magic = MESH_CACHE_MAGIC;
+  header.version = MESH_CACHE_VERSION;
+  header.sourceHash = sourceHash;
+  header.vertexCount = mesh.vertices.size();
+  header.indexCount = mesh.indices.size();
+  header.nameLength = mesh.name.size();
+  header.vertexOffset = sizeof(MeshCacheHeader);
+  header.indexOffset =
+      alignUp(header.vertexOffset + header.vertexCount * sizeof(float));
+  header.nameOffset =
+      alignUp(header.indexOffset + header.indexCount * sizeof(uint32_t));
+  memcpy(header.ranges, mesh.ranges, sizeof(header.ranges));
+  memcpy(header.clusterRanges, mesh.clusterRanges,
+         sizeof(header.clusterRanges));
+  header.meshletCount = mesh.meshletCount;
+  memcpy(header.boundingBox, mesh.m_boundingBox, sizeof(header.boundingBox));
+
+  // meshes are prepared on several threads and two sources can hash the same,
+  // every writer gets its own temporary file and the last rename wins
+  static std::atomic<uint32_t> writeCounter(0);
+  const std::string temporaryPath =
+      std::string(path) + "." + std::to_string(getpid()) + "." +
+      std::to_string(writeCounter.fetch_add(1)) + ".tmp";
+  FILE *file = fopen(temporaryPath.c_str(), "wb");
+  if (file == nullptr) {
+    printf("[ERROR] Could not open %s to write the mesh cache\n",
+           temporaryPath.c_str());
+    return false;
+  }
+  uint64_t written = 0;
+  const bool ok =
+      writePadded(file, &header, sizeof(header), written) &&
+      writePadded(file, mesh.vertices.data(),
+                  header.vertexCount * sizeof(float), written) &&
+      writePadded(file, mesh.indices.data(),
+                  header.indexCount * sizeof(uint32_t), written) &&
+      writePadded(file, mesh.name.data(), header.nameLength, written);
+  const bool closed = fclose(file) == 0;
+  if (!ok || !closed || (rename(temporaryPath.c_str(), path) != 0)) {
+    printf("[ERROR] Could not write the mesh cache %s\n", path);
+    remove(temporaryPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool readMeshCache(const char *path, const uint64_t sourceHash,
+                   MeshCacheView &outView) {
+  // a missing cache is the normal first run, not worth an error
+  struct stat info {};
+  if (stat(path, &info) != 0) {
+    return false;
+  }
+  MappedFile file = MappedFile::open(path, MAPPED_FILE_HINT_WILL_NEED);
+  if (file.size() < sizeof(MeshCacheHeader)) {
+    return false;
+  }
+  MeshCacheHeader header;
+  memcpy(&header, file.data(), sizeof(MeshCacheHeader));
+  const uint64_t size = file.size();
+  const bool valid =
+      (header.magic == MESH_CACHE_MAGIC) &&
+      (header.version == MESH_CACHE_VERSION) &&
+      (header.sourceHash == sourceHash) &&
+      isSectionInFile(header.vertexOffset, header.vertexCount, sizeof(float),
+                      size) &&
+      isSectionInFile(header.indexOffset, header.indexCount, sizeof(uint32_t),
+                      size) &&
+      isSectionInFile(header.nameOffset, header.nameLength, 1, size) &&
+      areRangesInVertices(header);
+  if (!valid) {
+    return false;
+  }
+  const char *data = file.data();
+  const auto *fileHeader = reinterpret_cast<const MeshCacheHeader *>(data);
+  outView.vertices =
+      reinterpret_cast<const float *>(data + header.vertexOffset);
+  outView.vertexCount = header.vertexCount;
+  outView.indices =
+      reinterpret_cast<const uint32_t *>(data + header.indexOffset);
+  outView.indexCount = header.indexCount;
+  outView.ranges = fileHeader->ranges;
+  outView.clusterRanges = fileHeader->clusterRanges;
+  outView.meshletCount = header.meshletCount;
+  outView.boundingBox = fileHeader->boundingBox;
+  outView.name = data + header.nameOffset;
+  outView.nameLength = header.nameLength;
+  outView.file = std::move(file);
+  return true;
+}
+
+}  // namespace SirMetal
@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+
+#include "SirMetal/core/core.h"
+#include "SirMetal/io/mappedFile.h"
+#include "SirMetal/resources/resourceTypes.h"
+
+namespace SirMetal {
+
+// bump it whenever the layout or what the mesh loaders produce changes, every
+// cache written before is rebuilt
+static constexpr uint32_t MESH_CACHE_VERSION = 2;
+// "SMSH" read as a little endian uint32
+static constexpr uint32_t MESH_CACHE_MAGIC = 0x48534D53;
+static constexpr uint64_t MESH_CACHE_ALIGNMENT = 64;
+static constexpr const char *MESH_CACHE_EXTENSION = ".smesh";
+// starting seeds for hashMeshSource, one per loader so the same bytes loaded
+// as different formats never share a cache
+static constexpr uint64_t MESH_CACHE_SEED_OBJ = 0x6F626A;
+static constexpr uint64_t MESH_CACHE_SEED_GLTF = 0x676C7466;
+
+// Layout of a .smesh file, the final mesh as MeshManager uploads it. The
+// header is followed by the vertices, meshlets included, the indices and the
+// name, each section
+// starts on a MESH_CACHE_ALIGNMENT boundary so the mapped file is used in
+// place, nothing is parsed or copied before the gpu upload.
+// Files are little endian and only read back on the machine type that wrote
+// them, they are a cache, not an asset format
+struct MeshCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  // hash of the data the mesh was built from and of the load options
+  uint64_t sourceHash;
+  // offsets are in bytes from the start of the file, counts in elements
+  uint64_t vertexOffset;
+  uint64_t vertexCount;
+  uint64_t indexOffset;
+  uint64_t indexCount;
+  uint64_t nameOffset;
+  uint64_t nameLength;
+  MemoryRange ranges[MESH_ATTRIBUTE_TYPE_COUNT];
+  MemoryRange clusterRanges[MESH_CLUSTER_DATA_TYPE_COUNT];
+  float boundingBox[6];
+  uint32_t meshletCount;
+  uint32_t reserved[7];
+};
+static_assert(sizeof(MeshCacheHeader) % MESH_CACHE_ALIGNMENT == 0,
+              "the vertices need to start aligned right after the header");
+
+// a cached mesh, the pointers are inside the mapping and stay valid as long
+// as the view, or a copy of its file, is alive
+struct MeshCacheView {
+  MappedFile file;
+  const float *vertices = nullptr;
+  uint64_t vertexCount = 0;
+  const uint32_t *indices = nullptr;
+  uint64_t indexCount = 0;
+  const MemoryRange *ranges = nullptr;
+  const MemoryRange *clusterRanges = nullptr;
+  uint32_t meshletCount = 0;
+  const float *boundingBox = nullptr;
+  const char *name = nullptr;
+  uint64_t nameLength = 0;
+};
+
+// the seed tells apart the kind of source and the load options, chain calls
+// to hash data coming from several buffers
+uint64_t hashMeshSource(const void *data, uint64_t sizeInBytes, uint64_t seed);
+// the cache file is named after the hash, a changed source or different
+// options map to a new file and the old one is simply not used anymore
+std::string getMeshCachePath(const std::string &directory, uint64_t sourceHash);
+
+// written to a temporary file first and renamed, a reader never sees a half
+// written cache, safe to call from several threads
+bool writeMeshCache(const char *path, const MeshLoadResult &mesh,
+                    uint64_t sourceHash);
+// false, quietly, when the file is missing, was written by another version,
+// from a different source or is truncated, the mesh then needs to be built
+bool readMeshCache(const char *path, uint64_t sourceHash,
+                   MeshCacheView &outView);
+
+}  // namespace SirMetal
@@ -1,6 +1,7 @@
 
 #include "SirMetal/resources/meshes/meshManager.h"
 #import "SirMetal/resources/meshes/gltfMesh.h"
+#import "SirMetal/resources/meshes/meshCache.h"
 #import "SirMetal/resources/meshes/meshOptimize.h"
 #import "SirMetal/resources/meshes/wavefrontobj.h"
 #include <SirMetal/io/file.h>
@@ -23,46 +24,115 @@ MeshHandle MeshManager::loadMesh(const std::string &path) {
   return MeshHandle{};
 }
 
+void MeshManager::initialize(id device, id queue,
+                             const std::string &cacheDirectory) {
+  m_allocator.initialize(device, queue);
+  m_device = device;
+  m_queue = queue;
+  m_cacheDirectory = cacheDirectory;
+  if (!m_cacheDirectory.empty()) {
+    ensureDirectory(m_cacheDirectory);
+  }
+}
+
 MeshHandle MeshManager::processObjMesh(const std::string &path) {
 
   assert(fileExists(path));
-  MeshLoadResult result;
-  loadMeshObj(result, path.c_str());
+  const std::string meshName = getFileName(path);
+
+  // the key is the whole obj, hashing the mapped file costs a fraction of
+  // the parse and the optimization
+  MeshHandle handle{};
+  uint64_t sourceHash = 0;
+  std::string cachePath;
+  if (!m_cacheDirectory.empty()) {
+    const MappedFile source = MappedFile::open(path.c_str());
+    sourceHash = hashMeshSource(source.data(), source.size(), MESH_CACHE_SEED_OBJ);
+    cachePath = getMeshCachePath(m_cacheDirectory, sourceHash);
+    MeshCacheView cached;
+    if (readMeshCache(cachePath.c_str(), sourceHash, cached)) {
+      handle = uploadMesh(meshName, cached.vertices, cached.vertexCount,
+                          cached.indices, cached.indexCount, cached.ranges,
+                          cached.boundingBox, cached.clusterRanges,
+                          cached.meshletCount);
+    }
+  }
 
-  std::string meshName = getFileName(path);
+  if (!handle.isHandleValid()) {
+    MeshLoadResult result;
+    const bool loaded = loadMeshObj(result, path.c_str());
+    result.name = meshName;
+    // a failed load is not cached, the next run tries the source again
+    if (loaded && !cachePath.empty()) {
+      writeMeshCache(cachePath.c_str(), result, sourceHash);
+    }
+    handle = uploadMesh(meshName, result.vertices.data(), result.vertices.size(),
+                        result.indices.data(), result.indices.size(),
+                        result.ranges, result.m_boundingBox,
+                        result.clusterRanges, result.meshletCount);
+  }
 
+  m_nameToHandle[meshName] = handle.handle;
+  return handle;
+}
+
+MeshHandle MeshManager::uploadMesh(const std::string &name, const float *vertices,
+                                   const uint64_t vertexCount,
+                                   const uint32_t *indices,
+                                   const uint64_t indexCount,
+                                   const MemoryRange *ranges,
+                                   const float *boundingBox,
+                                   const MemoryRange *clusterRanges,
+                                   const uint32_t meshletCount) {
+  // the allocator copies the data in a staging buffer before returning, the
+  // pointers can be straight in a cache mapping
   BufferHandle vhandle = m_allocator.allocate(
-          sizeof(float) * result.vertices.size(), (meshName + "Vertices").c_str(),
-          BUFFER_FLAG_GPU_ONLY, result.vertices.data());
+          sizeof(float) * vertexCount, (name + "Vertices").c_str(),
+          BUFFER_FLAG_GPU_ONLY, const_cast<float *>(vertices));
   id vertexBuffer = m_allocator.getBuffer(vhandle);
 
   BufferHandle ihandle = m_allocator.allocate(
-          result.indices.size() * sizeof(uint32_t), (meshName + "Indices").c_str(),
-          BUFFER_FLAG_GPU_ONLY, result.indices.data());
+          indexCount * sizeof(uint32_t), (name + "Indices").c_str(),
+          BUFFER_FLAG_GPU_ONLY, const_cast<uint32_t *>(indices));
   id indexBuffer = m_allocator.getBuffer(ihandle);
 
-  uint32_t index = m_meshCounter++;
-  MeshData data{vertexBuffer,
-                indexBuffer,
-                std::move(meshName),
-                {result.ranges[0], result.ranges[1], result.ranges[2], result.ranges[3]},
-                static_cast<uint32_t>(result.indices.size()),
-                vhandle,
-                ihandle};
-
-  m_handleToMesh[index] = data;
-  const std::string fileName = getFileName(path);
-  auto handle = getHandle<MeshHandle>(index);
-  m_nameToHandle[fileName] = handle.handle;
-  return handle;
+  MeshData outMesh{};
+  outMesh.name = name;
+  outMesh.indexBuffer = indexBuffer;
+  outMesh.vertexBuffer = vertexBuffer;
+  outMesh.m_indexHandle = ihandle;
+  outMesh.m_vertexHandle = vhandle;
+  outMesh.primitivesCount = static_cast<uint32_t>(indexCount);
+  for (int r = 0; r < MESH_ATTRIBUTE_TYPE_COUNT; ++r) {
+    outMesh.ranges[r] = ranges[r];
+  }
+  for (int i = 0; i < 6; ++i) {
+    outMesh.m_boundingBox[i] = boundingBox[i];
+  }
+  for (int r = 0; r < MESH_CLUSTER_DATA_TYPE_COUNT; ++r) {
+    outMesh.clusterRanges[r] = clusterRanges[r];
+  }
+  outMesh.meshletCount = meshletCount;
+  const uint32_t key = m_meshes.insert(std::move(outMesh));
+  if (key == SlotMap<MeshData>::INVALID_KEY) {
+    assert(0 && "mesh storage is full, cannot load more meshes");
+    return {};
+  }
+  return getHandle<MeshHandle>(key);
 }
 
 void MeshManager::cleanup() {}
 
 MeshHandle MeshManager::loadFromMemory(const void *data, LOAD_MESH_TYPE type,
                                        const void* options) {
+  PreparedMesh mesh;
+  prepareFromMemory(mesh, data, type, options);
+  return uploadPrepared(mesh);
+}
 
-  MeshLoadResult result;
+void MeshManager::prepareFromMemory(PreparedMesh &outMesh, const void *data,
+                                    LOAD_MESH_TYPE type,
+                                    const void *options) const {
   switch (type) {
 
     case LOAD_MESH_TYPE::INVALID: {
@@ -70,37 +140,40 @@ MeshHandle MeshManager::loadFromMemory(const void *data, LOAD_MESH_TYPE type,
       break;
     }
     case LOAD_MESH_TYPE::GLTF_MESH: {
-      loadGltfMesh(result, data, options);
+      // the key is every buffer the mesh is built from, with the light map
+      // uvs generation a cache hit saves the most here
+      uint64_t sourceHash = 0;
+      std::string cachePath;
+      if (!m_cacheDirectory.empty()) {
+        sourceHash = hashGltfMeshSource(data, options);
+        cachePath = getMeshCachePath(m_cacheDirectory, sourceHash);
+        if (readMeshCache(cachePath.c_str(), sourceHash, outMesh.cached)) {
+          return;
+        }
+      }
+      const bool loaded = loadGltfMesh(outMesh.result, data, options);
+      if (loaded && !cachePath.empty()) {
+        writeMeshCache(cachePath.c_str(), outMesh.result, sourceHash);
+      }
+      break;
     }
   }
+}
 
-
-  BufferHandle vhandle = m_allocator.allocate(
-          sizeof(float) * result.vertices.size(), (result.name + "Vertices").c_str(),
-          BUFFER_FLAG_GPU_ONLY, result.vertices.data());
-  id vertexBuffer = m_allocator.getBuffer(vhandle);
-
-  BufferHandle ihandle = m_allocator.allocate(
-          result.indices.size() * sizeof(uint32_t), (result.name + "Indices").c_str(),
-          BUFFER_FLAG_GPU_ONLY, result.indices.data());
-  id indexBuffer = m_allocator.getBuffer(ihandle);
-
-  MeshData outMesh{};
-  outMesh.name = result.name;
-  outMesh.indexBuffer = indexBuffer;
-  outMesh.vertexBuffer = vertexBuffer;
-  outMesh.m_indexHandle = ihandle;
-  outMesh.m_vertexHandle = vhandle;
-  outMesh.primitivesCount = result.indices.size();
-  for (int r = 0; r < MESH_ATTRIBUTE_TYPE_COUNT; ++r) {
-    outMesh.ranges[r] = result.ranges[r];
-  }
-
-  uint32_t index = m_meshCounter++;
-  m_handleToMesh[index] = outMesh;
+MeshHandle MeshManager::uploadPrepared(const PreparedMesh &mesh) {
   // NOTE we are not adding the handle to the look up by name because this comes
   // from a gltf file, meaning multiple meshes in a file
-  auto handle = getHandle<MeshHandle>(index);
-  return handle;
+  const MeshCacheView &cached = mesh.cached;
+  if (cached.file.isValid()) {
+    return uploadMesh(std::string(cached.name, cached.nameLength),
+                      cached.vertices, cached.vertexCount, cached.indices,
+                      cached.indexCount, cached.ranges, cached.boundingBox,
+                      cached.clusterRanges, cached.meshletCount);
+  }
+  const MeshLoadResult &result = mesh.result;
+  return uploadMesh(result.name, result.vertices.data(), result.vertices.size(),
+                    result.indices.data(), result.indices.size(), result.ranges,
+                    result.m_boundingBox, result.clusterRanges,
+                    result.meshletCount);
 }
 }// namespace SirMetal
@@ -7,10 +7,10 @@
 
 #import "SirMetal/core/core.h"
 #include "SirMetal/core/mathUtils.h"
+#include "SirMetal/core/memory/cpu/slotMap.h"
 #include "SirMetal/core/memory/gpu/GPUMemoryAllocator.h"
 #include "SirMetal/resources/resourceTypes.h"
-
-#import "SirMetal/resources/meshes/meshManager.h"
+#include "SirMetal/resources/meshes/meshCache.h"
 
 struct cgltf_mesh;
 
@@ -29,18 +29,35 @@ struct MeshData {
   BufferHandle m_vertexHandle;
   BufferHandle m_indexHandle;
   float m_boundingBox[6]{};
+  // in the vertex buffer, after the attributes, meshletCount is 0 when the
+  // mesh was loaded without meshlets
+  MemoryRange clusterRanges[MESH_CLUSTER_DATA_TYPE_COUNT]{};
+  uint32_t meshletCount = 0;
+};
+
+// cpu side of a mesh load, built by prepareFromMemory on any thread and turned
+// into gpu buffers by uploadPrepared on the thread owning the manager
+struct PreparedMesh {
+  MeshLoadResult result;
+  // valid when the mesh came from the cache, the data is then in the mapping
+  MeshCacheView cached;
 };
 
 class MeshManager {
   public:
   MeshHandle loadMesh(const std::string &path);
   MeshHandle loadFromMemory(const void *data, LOAD_MESH_TYPE type, const void *options);
+  // same as loadFromMemory split in two, the prepare step decodes, optimizes
+  // and reads or writes the cache without touching the manager state, it can
+  // run for many meshes at once on worker threads, the upload creates the
+  // buffers and needs to happen on the owning thread
+  void prepareFromMemory(PreparedMesh &outMesh, const void *data,
+                         LOAD_MESH_TYPE type, const void *options) const;
+  MeshHandle uploadPrepared(const PreparedMesh &mesh);
 
-  void initialize(id device, id queue) {
-    m_allocator.initialize(device, queue);
-    m_device = device;
-    m_queue = queue;
-  };
+  // meshes are cached in cacheDirectory after the first load, empty to
+  // always build them from the source
+  void initialize(id device, id queue, const std::string &cacheDirectory = "");
   const MeshHandle getHandleFromName(const std::string &name) const {
     auto found = m_nameToHandle.find(name);
     if (found != m_nameToHandle.end()) { return {found->second}; }
@@ -49,10 +66,7 @@ class MeshManager {
 
   const MeshData *getMeshData(MeshHandle handle) const {
     assert(getTypeFromHandle(handle) == HANDLE_TYPE::MESH);
-    uint32_t index = getIndexFromHandle(handle);
-    auto found = m_handleToMesh.find(index);
-    if (found != m_handleToMesh.end()) { return &found->second; }
-    return nullptr;
+    return m_meshes.get(getIndexFromHandle(handle));
   }
 
   void cleanup();
@@ -60,12 +74,18 @@ class MeshManager {
   private:
   id m_device;
   id m_queue;
-  std::unordered_map<uint32_t, MeshData> m_handleToMesh;
+  SlotMap<MeshData> m_meshes;
   std::unordered_map<std::string, uint32_t> m_nameToHandle;
 
-  SirMetal::MeshHandle processObjMesh(const std::string &path);
+  std::string m_cacheDirectory;
 
-  uint32_t m_meshCounter = 1;
+  SirMetal::MeshHandle processObjMesh(const std::string &path);
+  MeshHandle uploadMesh(const std::string &name, const float *vertices,
+                        uint64_t vertexCount, const uint32_t *indices,
+                        uint64_t indexCount, const MemoryRange *ranges,
+                        const float *boundingBox,
+                        const MemoryRange *clusterRanges,
+                        uint32_t meshletCount);
   GPUMemoryAllocator m_allocator;
 };
 
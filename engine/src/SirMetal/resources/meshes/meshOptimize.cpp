@@ -1,7 +1,13 @@
 #include "SirMetal/resources/meshes/meshOptimize.h"
+#include "SirMetal/core/memory/cpu/frameArena.h"
+#include "SirMetal/resources/resourceTypes.h"
 #include "meshoptimizer.h"
 
 namespace SirMetal {
+// same boundary for every section of the merged buffer, attributes and
+// cluster data, in bytes
+static constexpr uint32_t MERGED_BUFFER_ALIGNMENT = 256;
+
 uint64_t alignSize(const uint64_t sizeInBytes, const uint64_t boundaryInByte,
                    uint64_t &offset) {
   uint64_t modulus = sizeInBytes % boundaryInByte;
@@ -9,55 +15,72 @@ uint64_t alignSize(const uint64_t sizeInBytes, const uint64_t boundaryInByte,
   return sizeInBytes + offset;
 }
 
-void optimizeRawDeinterleavedMesh(const MapperData &data) {
+// copies a section at the end of the merged buffer, the size needs to be a
+// multiple of a float
+static void appendAlignedSection(std::vector<float> &outData, const void *data,
+                                 const uint64_t sizeInBytes,
+                                 MemoryRange &outRange) {
+  assert((sizeInBytes % sizeof(float)) == 0);
+  uint64_t padding = 0;
+  const uint64_t offsetByte = alignSize(outData.size() * sizeof(float),
+                                        MERGED_BUFFER_ALIGNMENT, padding);
+  outData.resize((offsetByte + sizeInBytes) / sizeof(float));
+  memcpy(reinterpret_cast<char *>(outData.data()) + offsetByte, data,
+         sizeInBytes);
+  outRange.m_offset = static_cast<uint32_t>(offsetByte);
+  outRange.m_size = static_cast<uint32_t>(sizeInBytes);
+}
+
+void optimizeRawDeinterleavedMesh(MapperData &data, FrameArena &scratch) {
   // mesh optimizer pass for doing both an index buffer and some optimizations
   // since we want de-interleaved data we need to use different streams
   // TODO we might be able to not re-copy the data from the obj ,remap it with
   // the correct stride
   meshopt_Stream streams[] = {
-          {data.pIn->data(), sizeof(float) * 4, sizeof(float) * 4},
-          {data.nIn->data(), sizeof(float) * 4, sizeof(float) * 4},
-          {data.uvIn->data(), sizeof(float) * 2, sizeof(float) * 2},
-          {data.tIn->data(), sizeof(float) * 4, sizeof(float) * 4},
+          {data.pIn, sizeof(float) * 4, sizeof(float) * 4},
+          {data.nIn, sizeof(float) * 4, sizeof(float) * 4},
+          {data.uvIn, sizeof(float) * 2, sizeof(float) * 2},
+          {data.tIn, sizeof(float) * 4, sizeof(float) * 4},
   };
 
   // building the remapper data structure
-  std::vector<uint32_t> remap(data.indexCount);
+  auto *remap = scratch.allocArray<uint32_t>(data.indexCount);
   size_t vertex_count = meshopt_generateVertexRemapMulti(
-          remap.data(), nullptr, data.indexCount, data.indexCount, streams, 4);
+          remap, nullptr, data.indexCount, data.indexCount, streams, 4);
 
   // allocating necessary memory for storing remapper result
-  data.pOut->resize(vertex_count * 4);
-  data.nOut->resize(vertex_count * 4);
-  data.uvOut->resize(vertex_count * 2);
-  data.tOut->resize(vertex_count * 4);
+  data.vertexCount = static_cast<uint32_t>(vertex_count);
+  data.pOut = scratch.allocArray<float>(vertex_count * 4);
+  data.nOut = scratch.allocArray<float>(vertex_count * 4);
+  data.uvOut = scratch.allocArray<float>(vertex_count * 2);
+  data.tOut = scratch.allocArray<float>(vertex_count * 4);
   data.outIndex->resize(data.indexCount);
 
   //remap the vertices, one stream at the time
-  meshopt_remapVertexBuffer(data.pOut->data(), data.pIn->data(), data.indexCount,
-                            sizeof(float) * 4, remap.data());
-  meshopt_remapVertexBuffer(data.nOut->data(), data.nIn->data(), data.indexCount,
-                            sizeof(float) * 4, remap.data());
-  meshopt_remapVertexBuffer(data.uvOut->data(), data.uvIn->data(), data.indexCount,
-                            sizeof(float) * 2, remap.data());
-  meshopt_remapVertexBuffer(data.tOut->data(), data.tIn->data(), data.indexCount,
-                            sizeof(float) * 4, remap.data());
-
-  std::vector<uint32_t> tmp(data.indexCount);
+  meshopt_remapVertexBuffer(data.pOut, data.pIn, data.indexCount,
+                            sizeof(float) * 4, remap);
+  meshopt_remapVertexBuffer(data.nOut, data.nIn, data.indexCount,
+                            sizeof(float) * 4, remap);
+  meshopt_remapVertexBuffer(data.uvOut, data.uvIn, data.indexCount,
+                            sizeof(float) * 2, remap);
+  meshopt_remapVertexBuffer(data.tOut, data.tIn, data.indexCount,
+                            sizeof(float) * 4, remap);
+
+  auto *tmp = scratch.allocArray<uint32_t>(data.indexCount);
   //remapping index buffer and optimize for vertex cache reuse
-  meshopt_remapIndexBuffer(tmp.data(), nullptr, data.indexCount, remap.data());
+  meshopt_remapIndexBuffer(tmp, nullptr, data.indexCount, remap);
 
-  meshopt_optimizeVertexCache(data.outIndex->data(), tmp.data(), data.indexCount,
+  meshopt_optimizeVertexCache(data.outIndex->data(), tmp, data.indexCount,
                               vertex_count);
 }
-void mergeRawMeshBuffers(const std::vector<float> *attributes, float *strides,
+void mergeRawMeshBuffers(const MeshAttribute *attributes, const float *strides,
                          uint32_t count, std::vector<float> &outData,
                          MemoryRange *ranges) {
 
 
   // now I need to merge the data and generate the memory ranges
   // lets compute all the alignment offsets
-  constexpr uint32_t alignRequirement = 256;// in bytes
+  constexpr uint32_t alignRequirement = MERGED_BUFFER_ALIGNMENT;// in bytes
   uint64_t totalRequiredAlignmentFloats = 0;
   uint64_t prevSize = 0;
   uint64_t offsetByte = 0;
@@ -66,8 +89,8 @@ void mergeRawMeshBuffers(const std::vector<float> *attributes, float *strides,
   //we iterate all the attributes, accumulating required padding  for aligment
   //and recording actual final memory ranges
   for (int i = 0; i < count; ++i) {
-    const std::vector<float> &attribute = attributes[i];
-    uint64_t currSize = attribute.size() * sizeof(float);
+    const MeshAttribute &attribute = attributes[i];
+    uint64_t currSize = attribute.sizeInFloats * sizeof(float);
     uint64_t pointerOffset = 0;
 
     //this function computes the aligment, it returns the aligment offset and also how much
@@ -88,7 +111,7 @@ void mergeRawMeshBuffers(const std::vector<float> *attributes, float *strides,
   totalRequiredAlignmentFloats/=4;
 
   // lets do the mem-copies
-  uint32_t vertexCount = attributes[0].size() / 4;
+  uint32_t vertexCount = attributes[0].sizeInFloats / 4;
   //allocating enough memory
   uint64_t totalRequiredMemoryInFloats =
           (vertexCount * floatsPerVertex) + totalRequiredAlignmentFloats;
@@ -104,14 +127,79 @@ void mergeRawMeshBuffers(const std::vector<float> *attributes, float *strides,
 
   //perform the copies
   for (int i = 0; i < count; ++i) {
-    memcpy(((char *) outData.data()) + ranges[i].m_offset, attributes[i].data(),
+    memcpy(((char *) outData.data()) + ranges[i].m_offset, attributes[i].data,
            ranges[i].m_size);
   }
 }
 void optimizeVertexCache(std::vector<uint32_t> &outIndices,
-                         const std::vector<uint32_t> &inIndices, uint32_t indexCount,
+                         const uint32_t *inIndices, uint32_t indexCount,
                          uint32_t vertexCount) {
-  meshopt_optimizeVertexCache(outIndices.data(), inIndices.data(), indexCount,
+  meshopt_optimizeVertexCache(outIndices.data(), inIndices, indexCount,
                               vertexCount);
 }
+
+void buildMeshlets(MeshLoadResult &mesh, FrameArena &scratch) {
+  static_assert(sizeof(Meshlet) == sizeof(meshopt_Meshlet),
+                "meshlets are copied straight from mesh optimizer");
+  FrameArenaScope scratchScope(scratch);
+  const MemoryRange &positionRange = mesh.ranges[MESH_ATTRIBUTE_TYPE_POSITION];
+  const auto *positions = reinterpret_cast<const float *>(
+          reinterpret_cast<const char *>(mesh.vertices.data()) +
+          positionRange.m_offset);
+  constexpr size_t positionStride = sizeof(float) * 4;
+  const size_t vertexCount = positionRange.m_size / positionStride;
+  const size_t indexCount = mesh.indices.size();
+  if (indexCount == 0) {
+    return;
+  }
+
+  const size_t maxMeshlets = meshopt_buildMeshletsBound(
+          indexCount, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+  auto *meshlets = scratch.allocArray<meshopt_Meshlet>(maxMeshlets);
+  auto *meshletVertices =
+          scratch.allocArray<uint32_t>(maxMeshlets * MESHLET_MAX_VERTICES);
+  auto *meshletTriangles =
+          scratch.allocArray<uint8_t>(maxMeshlets * MESHLET_MAX_TRIANGLES * 3);
+  const size_t meshletCount = meshopt_buildMeshlets(
+          meshlets, meshletVertices, meshletTriangles, mesh.indices.data(),
+          indexCount, positions, vertexCount, positionStride,
+          MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, MESHLET_CONE_WEIGHT);
+
+  auto *bounds = scratch.allocArray<MeshletBounds>(meshletCount);
+  for (size_t i = 0; i < meshletCount; ++i) {
+    const meshopt_Meshlet &meshlet = meshlets[i];
+    const meshopt_Bounds meshletBounds = meshopt_computeMeshletBounds(
+            meshletVertices + meshlet.vertex_offset,
+            meshletTriangles + meshlet.triangle_offset, meshlet.triangle_count,
+            positions, vertexCount, positionStride);
+    MeshletBounds &outBounds = bounds[i];
+    memcpy(outBounds.center, meshletBounds.center, sizeof(outBounds.center));
+    outBounds.radius = meshletBounds.radius;
+    memcpy(outBounds.coneAxis, meshletBounds.cone_axis,
+           sizeof(outBounds.coneAxis));
+    outBounds.coneCutoff = meshletBounds.cone_cutoff;
+  }
+
+  // the builder pads the triangles of every meshlet to 4 bytes, the last one
+  // tells how much of the worst case buffers got used
+  const meshopt_Meshlet &last = meshlets[meshletCount - 1];
+  const uint64_t usedVertices = last.vertex_offset + last.vertex_count;
+  const uint64_t usedTriangleBytes =
+          last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3u);
+
+  // the pointers in the vertex buffer are not valid anymore after this point
+  MemoryRange *ranges = mesh.clusterRanges;
+  appendAlignedSection(mesh.vertices, meshlets,
+                       meshletCount * sizeof(Meshlet),
+                       ranges[MESH_CLUSTER_DATA_TYPE_MESHLETS]);
+  appendAlignedSection(mesh.vertices, meshletVertices,
+                       usedVertices * sizeof(uint32_t),
+                       ranges[MESH_CLUSTER_DATA_TYPE_VERTICES]);
+  appendAlignedSection(mesh.vertices, meshletTriangles, usedTriangleBytes,
+                       ranges[MESH_CLUSTER_DATA_TYPE_TRIANGLES]);
+  appendAlignedSection(mesh.vertices, bounds,
+                       meshletCount * sizeof(MeshletBounds),
+                       ranges[MESH_CLUSTER_DATA_TYPE_BOUNDS]);
+  mesh.meshletCount = static_cast<uint32_t>(meshletCount);
+}
 }// namespace SirMetal
\ No newline at end of file
@@ -6,28 +6,57 @@
 #include "SirMetal/core/core.h"
 namespace SirMetal
 {
+class FrameArena;
+struct MeshLoadResult;
+
+// meshlet limits, the sizes meshoptimizer suggests for mesh shaders, also a
+// good granularity for culling on the cpu
+static constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+// how much the meshlet builder favours tight normal cones over compact
+// clusters, higher culls more back faces but gives bigger spheres
+static constexpr float MESHLET_CONE_WEIGHT = 0.25f;
+
+// a single de-interleaved vertex attribute
+struct MeshAttribute
+{
+  const float* data;
+  uint64_t sizeInFloats;
+};
+
+// the input streams have one vertex per index, the output streams are
+// allocated in the scratch arena passed to the optimizer, so they are only
+// valid until that arena is rewound
 struct MapperData
 {
-  const std::vector<float>* pIn;
-  const std::vector<float>* nIn;
-  const std::vector<float>* uvIn;
-  const std::vector<float>* tIn;
-  std::vector<float>* pOut;
-  std::vector<float>* nOut;
-  std::vector<float>* uvOut;
-  std::vector<float>* tOut;
+  const float* pIn;
+  const float* nIn;
+  const float* uvIn;
+  const float* tIn;
+  float* pOut;
+  float* nOut;
+  float* uvOut;
+  float* tOut;
+  uint32_t vertexCount;
   std::vector<uint32_t>* outIndex;
   uint32_t indexCount;
 };
 
-void optimizeRawDeinterleavedMesh( const MapperData& data);
-void optimizeVertexCache(std::vector<uint32_t> &outIndices, const std::vector<uint32_t> &inIndices,
+void optimizeRawDeinterleavedMesh(MapperData& data, FrameArena& scratch);
+void optimizeVertexCache(std::vector<uint32_t> &outIndices, const uint32_t *inIndices,
                          uint32_t indexCount, uint32_t vertexCount);
 
 void mergeRawMeshBuffers(
-        const std::vector<float> *attributes, float *strides,
+        const MeshAttribute *attributes, const float *strides,
         uint32_t count, std::vector<float> &outData,
         MemoryRange *ranges);
 
+// Splits an already merged mesh in meshlets and computes their bounding
+// sphere and normal cone. The cluster data is appended to the vertex buffer
+// after the attributes, each section aligned as the attributes are, and
+// recorded in clusterRanges. The index buffer is left as it is, the meshlets
+// have their own vertex and triangle lists, run it last on the final mesh
+void buildMeshlets(MeshLoadResult &mesh, FrameArena &scratch);
+
 
 }
\ No newline at end of file
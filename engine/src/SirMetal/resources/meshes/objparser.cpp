@@ -5,12 +5,19 @@
 #endif
 
 #include "objparser.h"
+#include "SirMetal/core/parallelFor.h"
+#include "SirMetal/io/mappedFile.h"
+#include "SirMetal/io/numberParsing.h"
 
 #include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
 
 template <typename T>
 static void growArray(T*& data, size_t& capacity)
@@ -33,100 +40,9 @@ static int fixupIndex(int index, size_t size)
     return (index >= 0) ? index - 1 : int(size) + index;
 }
 
-static int parseInt(const char* s, const char** end)
-{
-    // skip whitespace
-    while (*s == ' ' || *s == '\t')
-        s++;
-
-    // read sign bit
-    int sign = (*s == '-');
-    s += (*s == '-' || *s == '+');
-
-    unsigned int result = 0;
-
-    while (unsigned(*s - '0') < 10)
-    {
-        result = result * 10 + (*s - '0');
-        s++;
-    }
-
-    // return end-of-string
-    *end = s;
-
-    return sign ? -int(result) : int(result);
-}
-
-static float parseFloat(const char* s, const char** end)
-{
-    static const double digits[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
-    static const double powers[] = {1e0, 1e+1, 1e+2, 1e+3, 1e+4, 1e+5, 1e+6, 1e+7, 1e+8, 1e+9, 1e+10, 1e+11, 1e+12, 1e+13, 1e+14, 1e+15, 1e+16, 1e+17, 1e+18, 1e+19, 1e+20, 1e+21, 1e+22};
-
-    // skip whitespace
-    while (*s == ' ' || *s == '\t')
-        s++;
-
-    // read sign
-    double sign = (*s == '-') ? -1 : 1;
-    s += (*s == '-' || *s == '+');
-
-    // read integer part
-    double result = 0;
-    int power = 0;
-
-    while (unsigned(*s - '0') < 10)
-    {
-        result = result * 10 + digits[*s - '0'];
-        s++;
-    }
-
-    // read fractional part
-    if (*s == '.')
-    {
-        s++;
-
-        while (unsigned(*s - '0') < 10)
-        {
-            result = result * 10 + digits[*s - '0'];
-            s++;
-            power--;
-        }
-    }
-
-    // read exponent part
-    if ((*s | ' ') == 'e')
-    {
-        s++;
-
-        // read exponent sign
-        int expsign = (*s == '-') ? -1 : 1;
-        s += (*s == '-' || *s == '+');
-
-        // read exponent
-        int exppower = 0;
-
-        while (unsigned(*s - '0') < 10)
-        {
-            exppower = exppower * 10 + (*s - '0');
-            s++;
-        }
-
-        // done!
-        power += expsign * exppower;
-    }
-
-    // return end-of-string
-    *end = s;
-
-    // note: this is precise if result < 9e15
-    // for longer inputs we lose a bit of precision here
-    if (unsigned(-power) < sizeof(powers) / sizeof(powers[0]))
-        return float(sign * result / powers[-power]);
-    else if (unsigned(power) < sizeof(powers) / sizeof(powers[0]))
-        return float(sign * result * powers[power]);
-    else
-        return float(sign * result * pow(10.0, power));
-}
+// shared with the other text loaders, floats are exactly rounded
+using SirMetal::parseFloat;
+using SirMetal::parseInt;
 
 static const char* parseFace(const char* s, int& vi, int& vti, int& vni)
 {
@@ -180,7 +96,26 @@ ObjFile::~ObjFile()
     delete[] g;
 }
 
-void objParseLine(ObjFile& result, const char* line)
+// what a chunk parsed on its own can't resolve, fixed up when the chunks are
+// merged
+struct ObjChunk
+{
+    const char* data;
+    size_t size;
+
+    ObjFile file;
+
+    // faces met before the first usemtl of the chunk, they belong to the group
+    // open when the chunk starts
+    bool leading_faces;
+    size_t leading_index_count;
+
+    // offsets in file.f of the relative indices, resolved against the chunk
+    // counts, the counts of the chunks before need to be added
+    std::vector<size_t> relative;
+};
+
+static void parseLine(ObjFile& result, const char* line, ObjChunk* chunk)
 {
     if (line[0] == 'v' && line[1] == ' ')
     {
@@ -231,12 +166,24 @@ void objParseLine(ObjFile& result, const char* line)
     {
         const char* s = line + 2;
 
-        if (!result.g)
+        size_t* index_count;
+
+        if (chunk && !result.g)
         {
-            growArray(result.g, result.g_cap);
+            chunk->leading_faces = true;
+            index_count = &chunk->leading_index_count;
+        }
+        else
+        {
+            if (!result.g)
+            {
+                growArray(result.g, result.g_cap);
 
-            ObjGroup g = {};
-            result.g[result.g_size++] = g;
+                ObjGroup g = {};
+                result.g[result.g_size++] = g;
+            }
+
+            index_count = &result.g[result.g_size - 1].index_count;
         }
 
         size_t v = result.v_size / 3;
@@ -245,6 +192,8 @@ void objParseLine(ObjFile& result, const char* line)
 
         int fv = 0;
         int f[3][3] = {};
+        // which of the indices of each vertex are relative, one bit each
+        int relative[3] = {};
 
         while (*s)
         {
@@ -257,20 +206,29 @@ void objParseLine(ObjFile& result, const char* line)
             f[fv][0] = fixupIndex(vi, v);
             f[fv][1] = fixupIndex(vti, vt);
             f[fv][2] = fixupIndex(vni, vn);
+            relative[fv] = (vi < 0) | ((vti < 0) << 1) | ((vni < 0) << 2);
 
             if (fv == 2)
             {
                 if (result.f_size + 9 > result.f_cap)
                     growArray(result.f, result.f_cap);
 
+                if (chunk && (relative[0] | relative[1] | relative[2]))
+                {
+                    for (int i = 0; i < 9; ++i)
+                        if (relative[i / 3] & (1 << (i % 3)))
+                            chunk->relative.push_back(result.f_size + i);
+                }
+
                 memcpy(&result.f[result.f_size], f, 9 * sizeof(int));
                 result.f_size += 9;
 
-                result.g[result.g_size - 1].index_count += 3;
+                *index_count += 3;
 
                 f[1][0] = f[2][0];
                 f[1][1] = f[2][1];
                 f[1][2] = f[2][2];
+                relative[1] = relative[2];
             }
             else
             {
@@ -299,56 +257,215 @@ void objParseLine(ObjFile& result, const char* line)
     }
 }
 
-bool objParseFile(ObjFile& result, const char* path)
+void objParseLine(ObjFile& result, const char* line)
 {
-    FILE* file = fopen(path, "rb");
-    if (!file)
-        return false;
+    parseLine(result, line, nullptr);
+}
 
+static void parseLines(ObjFile& result, const char* data, size_t size, ObjChunk* chunk)
+{
+    // only for lines that can't be parsed in place
     char buffer[65536];
-    size_t size = 0;
+    std::string longLine;
+    size_t line = 0;
 
-    while (!feof(file))
+    while (line < size)
     {
-        size += fread(buffer + size, 1, sizeof(buffer) - size, file);
+        // find the end of current line
+        const void* eol = memchr(data + line, '\n', size - line);
+        const size_t next = eol ? static_cast<const char*>(eol) - data : size;
+
+        // vertex and face lines stop parsing at the end of line on their own,
+        // and lines the parser ignores are only looked at for their first few
+        // characters, usemtl copies the whole line and the last line has
+        // nothing after it in the mapping, those two get zero-terminated in
+        // the buffer, or on the heap when longer than it
+        if (eol && data[line] != 'u')
+        {
+            parseLine(result, data + line, chunk);
+        }
+        else
+        {
+            const size_t length = next - line;
+            if (length < sizeof(buffer))
+            {
+                memcpy(buffer, data + line, length);
+                buffer[length] = 0;
 
-        size_t line = 0;
+                parseLine(result, buffer, chunk);
+            }
+            else
+            {
+                longLine.assign(data + line, length);
+                parseLine(result, longLine.c_str(), chunk);
+            }
+        }
 
-        while (line < size)
-        {
-            // find the end of current line
-            void* eol = memchr(buffer + line, '\n', size - line);
-            if (!eol)
-                break;
+        line = next + 1;
+    }
+}
 
-            // zero-terminate for objParseLine
-            size_t next = static_cast<char*>(eol) - buffer;
+bool objParseFile(ObjFile& result, const char* path)
+{
+    // the file is mapped, lines are parsed straight from the page cache instead
+    // of being read in a buffer first
+    SirMetal::MappedFile file = SirMetal::MappedFile::open(path, SirMetal::MAPPED_FILE_HINT_SEQUENTIAL | SirMetal::MAPPED_FILE_HINT_WILL_NEED);
+    if (!file.isValid())
+        return false;
 
-            buffer[next] = 0;
+    parseLines(result, file.data(), file.size(), nullptr);
+    return true;
+}
 
-            // process next line
-            objParseLine(result, buffer + line);
+template <typename T>
+static void releaseArray(T*& data, size_t& size, size_t& capacity)
+{
+    delete[] data;
+    data = 0;
+    size = 0;
+    capacity = 0;
+}
 
-            line = next + 1;
-        }
+static void releaseArrays(ObjFile& file)
+{
+    releaseArray(file.v, file.v_size, file.v_cap);
+    releaseArray(file.vt, file.vt_size, file.vt_cap);
+    releaseArray(file.vn, file.vn_size, file.vn_cap);
+    releaseArray(file.f, file.f_size, file.f_cap);
+    releaseArray(file.g, file.g_size, file.g_cap);
+}
 
-        // move prefix of the last line in the buffer to the beginning of the buffer for next iteration
-        assert(line <= size);
+template <typename T>
+static void allocateMerged(T*& data, size_t& size, size_t& capacity, size_t total)
+{
+    // same as the serial path, nothing is allocated for what the file doesn't have
+    size = total;
+    capacity = total;
+    data = total ? new T[total] : nullptr;
+}
+
+template <typename T>
+static void copyChunk(T* destination, size_t offset, const T* source, size_t count)
+{
+    if (count)
+        memcpy(destination + offset, source, count * sizeof(T));
+}
+
+bool objParseFileParallel(ObjFile& result, const char* path, unsigned int threadCount)
+{
+    SirMetal::MappedFile file = SirMetal::MappedFile::open(path, SirMetal::MAPPED_FILE_HINT_SEQUENTIAL | SirMetal::MAPPED_FILE_HINT_WILL_NEED);
+    if (!file.isValid())
+        return false;
 
-        memmove(buffer, buffer + line, size - line);
-        size -= line;
+    if (threadCount == 0)
+        threadCount = SirMetal::getWorkerThreadCount();
+
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    // a few chunks per thread so a slow chunk doesn't keep the others waiting,
+    // small files are not worth the threads
+    size_t chunk_size = size / (threadCount * OBJ_CHUNKS_PER_THREAD) + 1;
+    chunk_size = chunk_size < OBJ_MIN_CHUNK_SIZE ? OBJ_MIN_CHUNK_SIZE : chunk_size;
+    if (threadCount == 1 || size <= chunk_size)
+    {
+        parseLines(result, data, size, nullptr);
+        return true;
     }
 
-    if (size)
+    // chunks end right after a new line, no line is split
+    std::vector<size_t> ends;
+    size_t start = 0;
+    while (start < size)
     {
-        // process last line
-        assert(size < sizeof(buffer));
-        buffer[size] = 0;
+        size_t end = start + chunk_size;
+        if (end >= size)
+        {
+            end = size;
+        }
+        else
+        {
+            const void* eol = memchr(data + end, '\n', size - end);
+            end = eol ? static_cast<const char*>(eol) - data + 1 : size;
+        }
+        ends.push_back(end);
+        start = end;
+    }
+
+    std::vector<ObjChunk> chunks(ends.size());
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        const size_t begin = i == 0 ? 0 : ends[i - 1];
+        chunks[i].data = data + begin;
+        chunks[i].size = ends[i] - begin;
+        chunks[i].leading_faces = false;
+        chunks[i].leading_index_count = 0;
+    }
+
+    const size_t chunk_count = chunks.size();
+    threadCount = chunk_count < threadCount ? unsigned(chunk_count) : threadCount;
+    SirMetal::parallelFor(threadCount, chunk_count, [&](size_t i) {
+        parseLines(chunks[i].file, chunks[i].data, chunks[i].size, &chunks[i]);
+    });
+
+    // where every chunk lands in the merged arrays, and the groups, which need
+    // to be walked in order
+    std::vector<size_t> offsets(chunk_count * 4);
+    size_t v_total = 0, vt_total = 0, vn_total = 0, f_total = 0;
+    std::vector<ObjGroup> groups;
+
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        const ObjChunk& chunk = chunks[i];
+        offsets[i * 4 + 0] = v_total;
+        offsets[i * 4 + 1] = vt_total;
+        offsets[i * 4 + 2] = vn_total;
+        offsets[i * 4 + 3] = f_total;
 
-        objParseLine(result, buffer);
+        if (chunk.leading_faces)
+        {
+            // the default group, as the serial path creates it at the first face
+            if (groups.empty())
+                groups.push_back(ObjGroup{});
+            groups.back().index_count += chunk.leading_index_count;
+        }
+        for (size_t g = 0; g < chunk.file.g_size; ++g)
+        {
+            groups.push_back(chunk.file.g[g]);
+            groups.back().index_offset += f_total / 3;
+        }
+
+        v_total += chunk.file.v_size;
+        vt_total += chunk.file.vt_size;
+        vn_total += chunk.file.vn_size;
+        f_total += chunk.file.f_size;
     }
 
-    fclose(file);
+    allocateMerged(result.v, result.v_size, result.v_cap, v_total);
+    allocateMerged(result.vt, result.vt_size, result.vt_cap, vt_total);
+    allocateMerged(result.vn, result.vn_size, result.vn_cap, vn_total);
+    allocateMerged(result.f, result.f_size, result.f_cap, f_total);
+    allocateMerged(result.g, result.g_size, result.g_cap, groups.size());
+    copyChunk(result.g, 0, groups.data(), groups.size());
+
+    SirMetal::parallelFor(threadCount, chunk_count, [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        const size_t* offset = &offsets[i * 4];
+        copyChunk(result.v, offset[0], chunk.file.v, chunk.file.v_size);
+        copyChunk(result.vt, offset[1], chunk.file.vt, chunk.file.vt_size);
+        copyChunk(result.vn, offset[2], chunk.file.vn, chunk.file.vn_size);
+        copyChunk(result.f, offset[3], chunk.file.f, chunk.file.f_size);
+
+        // relative indices counted from the chunk start, f is made of
+        // position, uv and normal indices
+        int* f = result.f + offset[3];
+        for (size_t r : chunk.relative)
+            f[r] += int(offset[r % 3] / 3);
+
+        // the chunk copy is not needed anymore, giving the memory back early
+        releaseArrays(chunk.file);
+    });
+
     return true;
 }
 
@@ -39,4 +39,11 @@ private:
 void objParseLine(ObjFile& result, const char* line);
 bool objParseFile(ObjFile& result, const char* path);
 
+// the file is split in chunks at line boundaries, parsed on threadCount
+// threads (0 for one per core) and merged, the result is bit identical to
+// objParseFile
+const size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+const unsigned int OBJ_CHUNKS_PER_THREAD = 4;
+bool objParseFileParallel(ObjFile& result, const char* path, unsigned int threadCount = 0);
+
 bool objValidate(const ObjFile& result);
\ No newline at end of file
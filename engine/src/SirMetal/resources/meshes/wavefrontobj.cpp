@@ -1,9 +1,12 @@
 
 #include "SirMetal/resources/meshes/wavefrontobj.h"
+#include "SirMetal/core/memory/cpu/frameArena.h"
+#include "SirMetal/core/profiler.h"
 #include "SirMetal/resources/meshes/meshOptimize.h"
 #include "SirMetal/resources/meshes/objparser.h"
 
 #include <math.h>
+#include <string.h>
 
 #define FAST_OBJ_IMPLEMENTATION
 #include "SirMetal/resources/meshes/fast_obj.h"
@@ -12,24 +15,25 @@
 
 namespace SirMetal {
 bool loadMeshObj(MeshLoadResult &result, const char *path) {
+  SM_PROFILE_SCOPE("loadMeshObj");
 
   ObjFile file;
-  if (!objParseFile(file, path)) return false;
+  if (!objParseFileParallel(file, path)) return false;
 
   size_t index_count = file.f_size / 3;
 
-  // not super happy about this but for now it will do, ideally you should have
-  // a pool of scratch memory that can be used
-  std::vector<float> positions(index_count * 4);
-  std::vector<float> normals(index_count * 4);
-  std::vector<float> uvs(index_count * 2);
-  std::vector<float> tangents(index_count * 4);
-
-  for (int i = 0; i < index_count * 2; ++i) { uvs[i] = 0.0f; }
-  for (int i = 0; i < index_count * 4; ++i) {
-    tangents[i] = 0.0f;
-    normals[i] = 0.0f;
-  }
+  // all the temporary buffers live in the thread scratch memory, and are
+  // given back when we leave the function
+  FrameArena &scratch = getThreadScratchArena();
+  FrameArenaScope scratchScope(scratch);
+  float *positions = scratch.allocArray<float>(index_count * 4);
+  float *normals = scratch.allocArray<float>(index_count * 4);
+  float *uvs = scratch.allocArray<float>(index_count * 2);
+  float *tangents = scratch.allocArray<float>(index_count * 4);
+
+  memset(uvs, 0, sizeof(float) * index_count * 2);
+  memset(tangents, 0, sizeof(float) * index_count * 4);
+  memset(normals, 0, sizeof(float) * index_count * 4);
 
   // let us extract the data from the obj, for later manipulation
   //#pragma omp parallel for
@@ -60,29 +64,46 @@ bool loadMeshObj(MeshLoadResult &result, const char *path) {
     }
   }
 
-  std::vector<float> posOut;
-  std::vector<float> nOut;
-  std::vector<float> uvOut;
-  std::vector<float> tOut;
   result.indices.resize(index_count);
-  SirMetal::MapperData mapper{&positions,
-                              &normals,
-                              &uvs,
-                              &tangents,
-                              &posOut,
-                              &nOut,
-                              &uvOut,
-                              &tOut,
+  SirMetal::MapperData mapper{positions,
+                              normals,
+                              uvs,
+                              tangents,
+                              nullptr,
+                              nullptr,
+                              nullptr,
+                              nullptr,
+                              0,
                               &result.indices,
                               static_cast<uint32_t>(index_count)};
 
   // generate an index buffer and optimize per vertex cache hit using mesh
   // optimizer
-  SirMetal::optimizeRawDeinterleavedMesh(mapper);
+  SirMetal::optimizeRawDeinterleavedMesh(mapper, scratch);
 
-  // merge the buffer into a single one
+  // bounding box of the positions, min xyz then max xyz
+  const uint64_t vertexCount = mapper.vertexCount;
+  for (int c = 0; c < 3; ++c) {
+    result.m_boundingBox[c] = vertexCount != 0 ? mapper.pOut[c] : 0.0f;
+    result.m_boundingBox[c + 3] = result.m_boundingBox[c];
+  }
+  for (uint64_t v = 1; v < vertexCount; ++v) {
+    const float *position = mapper.pOut + v * 4;
+    for (int c = 0; c < 3; ++c) {
+      const float value = position[c];
+      result.m_boundingBox[c] =
+              value < result.m_boundingBox[c] ? value : result.m_boundingBox[c];
+      result.m_boundingBox[c + 3] = value > result.m_boundingBox[c + 3]
+                                            ? value
+                                            : result.m_boundingBox[c + 3];
+    }
+  }
 
-  std::vector<float> attributes[4] = {posOut, nOut, uvOut, tOut};
+  // merge the buffer into a single one
+  MeshAttribute attributes[4] = {{mapper.pOut, vertexCount * 4},
+                                 {mapper.nOut, vertexCount * 4},
+                                 {mapper.uvOut, vertexCount * 2},
+                                 {mapper.tOut, vertexCount * 4}};
   float strides[4]{4, 4, 2, 4};
   SirMetal::mergeRawMeshBuffers(attributes, strides, 4, result.vertices, result.ranges);
 
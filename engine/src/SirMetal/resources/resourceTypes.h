@@ -35,12 +35,49 @@ static constexpr bool MESH_ATTRIBUTE_REQUIRED[] = {1, 1, 1, 1, 0};
 static constexpr float MESH_ATTRIBUTES_COMPONENT_FILLER[MESH_ATTRIBUTE_TYPE_COUNT] = {
         1, 0, -1, 0};
 
+// optional per cluster data, appended after the vertex attributes in the same
+// buffer when the mesh is split in meshlets, see buildMeshlets
+enum MESH_CLUSTER_DATA_TYPE {
+  // one Meshlet each
+  MESH_CLUSTER_DATA_TYPE_MESHLETS = 0,
+  // uint32 mesh vertex index, a meshlet uses vertexCount of them
+  MESH_CLUSTER_DATA_TYPE_VERTICES = 1,
+  // uint8 triangle corners indexing the meshlet vertices, the triangles of
+  // every meshlet start on a 4 bytes boundary
+  MESH_CLUSTER_DATA_TYPE_TRIANGLES = 2,
+  // one MeshletBounds each, same order as the meshlets
+  MESH_CLUSTER_DATA_TYPE_BOUNDS = 3,
+  MESH_CLUSTER_DATA_TYPE_COUNT = 4
+};
+
+// offsets are in elements of the vertices and in bytes of the triangles
+struct Meshlet {
+  uint32_t vertexOffset;
+  uint32_t triangleOffset;
+  uint32_t vertexCount;
+  uint32_t triangleCount;
+};
+
+// bounding sphere and normal cone of a meshlet in the mesh space, the meshlet
+// faces away from any point p where
+// dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius,
+// a cutoff of 1 means the normals are too spread to ever be back facing
+struct MeshletBounds {
+  float center[3];
+  float radius;
+  float coneAxis[3];
+  float coneCutoff;
+};
+
 struct MeshLoadResult {
   std::vector<float> vertices;
   std::vector<uint32_t> indices;
-  MemoryRange ranges[4];
-  float m_boundingBox[6];
+  MemoryRange ranges[MESH_ATTRIBUTE_TYPE_COUNT]{};
+  float m_boundingBox[6]{};
   std::string name;
+  // empty unless meshlets were generated
+  MemoryRange clusterRanges[MESH_CLUSTER_DATA_TYPE_COUNT]{};
+  uint32_t meshletCount = 0;
 };
 
 // texture types
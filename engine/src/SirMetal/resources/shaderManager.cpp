@@ -9,7 +9,7 @@ LibraryHandle ShaderManager::loadShader(const char *path) {
   const std::string fileName = getFileName(path);
   auto found = m_nameToLibraryHandle.find(fileName);
   if (found != m_nameToLibraryHandle.end()) {
-    return LibraryHandle{found->second};
+    return getHandle<LibraryHandle>(found->second);
   }
 
   assert(fileExists(path));
@@ -40,10 +40,12 @@ LibraryHandle ShaderManager::loadShader(const char *path) {
     return {};
   }
 
-  uint32_t index = m_libraryCounter++;
-
   // updating the look ups
-  m_libraries[index] = metadata;
+  const uint32_t index = m_libraries.insert(std::move(metadata));
+  if (index == SlotMap<ShaderMetadata>::INVALID_KEY) {
+    assert(0 && "shader storage is full, cannot load more libraries");
+    return {};
+  }
   m_nameToLibraryHandle[fileName] = index;
 
   return getHandle<LibraryHandle>(index);
@@ -51,7 +53,8 @@ LibraryHandle ShaderManager::loadShader(const char *path) {
 
 id ShaderManager::getLibraryFromHandle(LibraryHandle handle) {
   uint32_t index = getIndexFromHandle(handle);
-  return m_libraries[index].library;
+  assert(m_libraries.contains(index));
+  return m_libraries.get(index)->library;
 }
 
 LibraryHandle ShaderManager::getHandleFromName(const std::string &name) const {
@@ -168,22 +171,22 @@ for (MTLArgument *arg in reflectionObj.vertexArguments)
 
 id ShaderManager::getVertexFunction(LibraryHandle handle) {
   uint32_t index = getIndexFromHandle(handle);
-  assert(m_libraries.find(index) != m_libraries.end());
-  return m_libraries[index].vertexFn;
+  assert(m_libraries.contains(index));
+  return m_libraries.get(index)->vertexFn;
 }
 id ShaderManager::getFragmentFunction(LibraryHandle handle) {
   assert(handle.isHandleValid());
   assert(getTypeFromHandle(handle) == LibraryHandle::type);
   uint32_t index = getIndexFromHandle(handle);
-  assert(m_libraries.find(index) != m_libraries.end());
-  return m_libraries[index].fragFn;
+  assert(m_libraries.contains(index));
+  return m_libraries.get(index)->fragFn;
 }
 id ShaderManager::getKernelFunction(LibraryHandle handle) {
   assert(handle.isHandleValid());
   assert(getTypeFromHandle(handle) == LibraryHandle::type);
   uint32_t index = getIndexFromHandle(handle);
-  assert(m_libraries.find(index) != m_libraries.end());
-  return m_libraries[index].computeFn;
+  assert(m_libraries.contains(index));
+  return m_libraries.get(index)->computeFn;
 
 }
 
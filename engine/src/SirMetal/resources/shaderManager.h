@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <string>
 #include "handle.h"
+#include "SirMetal/core/memory/cpu/slotMap.h"
 #include "SirMetal/graphics/graphicsDefines.h"
 
 namespace SirMetal {
@@ -39,9 +40,8 @@ namespace SirMetal {
 
     private:
         id m_device;
-        std::unordered_map<uint32_t, ShaderMetadata> m_libraries;
+        SlotMap<ShaderMetadata> m_libraries;
         std::unordered_map<std::string, uint32_t> m_nameToLibraryHandle;
-        uint32_t m_libraryCounter = 1;
     };
 }
 
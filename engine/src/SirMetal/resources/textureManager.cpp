@@ -46,8 +46,12 @@ TextureHandle TextureManager::allocate(id<MTLDevice> device,
   }
   auto tex = createTextureFromRequest(device, request);
 
-  auto handle = getHandle<TextureHandle>(m_textureCounter++);
-  m_data[handle.handle] = TextureData{request, tex};
+  const uint32_t key = m_data.insert(TextureData{request, tex});
+  if (key == SlotMap<TextureData>::INVALID_KEY) {
+    assert(0 && "texture storage is full, cannot allocate more textures");
+    return {};
+  }
+  auto handle = getHandle<TextureHandle>(key);
   m_nameToHandle[request.name] = handle.handle;
 
   return handle;
@@ -71,9 +75,9 @@ TextureHandle TextureManager::loadFromMemory(id<MTLDevice> device, id<MTLCommand
 id TextureManager::getNativeFromHandle(TextureHandle handle) {
   HANDLE_TYPE type = getTypeFromHandle(handle);
   assert(type == HANDLE_TYPE::TEXTURE);
-  auto found = m_data.find(handle.handle);
-  if (found != m_data.end()) {
-    return found->second.texture;
+  const TextureData *found = m_data.get(getIndexFromHandle(handle));
+  if (found != nullptr) {
+    return found->texture;
   }
   assert(0 && "requested invalid texture");
   return nil;
@@ -90,12 +94,12 @@ bool TextureManager::resizeTexture(id<MTLDevice> device, TextureHandle handle,
   }
 
   // fetching the corresponding data
-  auto found = m_data.find(handle.handle);
-  if (found == m_data.end()) {
+  TextureData *found = m_data.get(getIndexFromHandle(handle));
+  if (found == nullptr) {
     printf("[ERROR][Texture Manager] Could not find data for requested handle");
     return false;
   }
-  TextureData &texData = found->second;
+  TextureData &texData = *found;
   if ((texData.request.width == newWidth) &
       (texData.request.height == newHeight)) {
     printf("[WARN][Texture Manager] Requested resize of texture with name%s "
@@ -173,8 +177,12 @@ TextureHandle TextureManager::createTextureFromTextureLoadResult(
   data.request.name = result.name;
   data.texture = tex;
 
-  auto handle = getHandle<TextureHandle>(m_textureCounter++);
-  m_data[handle.handle] = data;
+  const uint32_t key = m_data.insert(data);
+  if (key == SlotMap<TextureData>::INVALID_KEY) {
+    assert(0 && "texture storage is full, cannot load more textures");
+    return {};
+  }
+  auto handle = getHandle<TextureHandle>(key);
   m_nameToHandle[data.request.name] = handle.handle;
 
   return handle;
@@ -257,8 +265,12 @@ TextureHandle TextureManager::generateSolidColorTexture(id<MTLDevice> device, id
   data.request.name = name;
   data.texture = tex;
 
-  auto handle = getHandle<TextureHandle>(m_textureCounter++);
-  m_data[handle.handle] = data;
+  const uint32_t key = m_data.insert(data);
+  if (key == SlotMap<TextureData>::INVALID_KEY) {
+    assert(0 && "texture storage is full, cannot load more textures");
+    return {};
+  }
+  auto handle = getHandle<TextureHandle>(key);
   m_nameToHandle[data.request.name] = handle.handle;
   return handle;
 }
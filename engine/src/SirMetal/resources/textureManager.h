@@ -7,6 +7,7 @@
 
 #import <Metal/Metal.h>
 
+#include "SirMetal/core/memory/cpu/slotMap.h"
 #include "SirMetal/resources/handle.h"
 #include "SirMetal/resources/resourceTypes.h"
 #import "gltfLoader.h"
@@ -42,9 +43,9 @@ class TextureManager {
   MTLPixelFormat getFormat(const TextureHandle handle) const {
     HANDLE_TYPE type = getTypeFromHandle(handle);
     assert(type == HANDLE_TYPE::TEXTURE);
-    auto found = m_data.find(handle.handle);
-    if (found != m_data.end()) {
-      return found->second.request.format;
+    const TextureData *found = m_data.get(getIndexFromHandle(handle));
+    if (found != nullptr) {
+      return found->request.format;
     }
     assert(0 && "requested invalid texture");
     return MTLPixelFormatInvalid;
@@ -67,9 +68,8 @@ class TextureManager {
   };
 
   private:
-  std::unordered_map<uint32_t, TextureData> m_data;
+  SlotMap<TextureData> m_data;
   std::unordered_map<std::string, uint32_t> m_nameToHandle;
-  int m_textureCounter = 1;
   TextureHandle m_whiteTexture{};
   TextureHandle m_blackTexture{};
 };
@@ -0,0 +1,56 @@
+#include "SirMetal/core/clock.h"
+#include "catch/catch.h"
+
+#include <math.h>
+#include <time.h>
+
+TEST_CASE("Cycle clock calibration", "[clock]") {
+  const SirMetal::CycleClock::Calibration &calibration =
+      SirMetal::CycleClock::getCalibration();
+  REQUIRE(calibration.nanosecondsPerTick > 0.0);
+
+  const uint64_t steadyStart = SirMetal::CycleClock::getSteadyNanoseconds();
+  const uint64_t ticksStart = SirMetal::CycleClock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  const uint64_t ticksEnd = SirMetal::CycleClock::now();
+  const uint64_t steadyEnd = SirMetal::CycleClock::getSteadyNanoseconds();
+  REQUIRE(ticksEnd > ticksStart);
+
+  // the converted timestamps land on the steady clock timeline
+  const uint64_t start = SirMetal::CycleClock::toNanoseconds(ticksStart);
+  const uint64_t end = SirMetal::CycleClock::toNanoseconds(ticksEnd);
+  const auto startError = static_cast<double>(start) -
+                          static_cast<double>(steadyStart);
+  const auto endError =
+      static_cast<double>(end) - static_cast<double>(steadyEnd);
+  REQUIRE(fabs(startError) < 1e6);
+  REQUIRE(fabs(endError) < 1e6);
+
+  // and durations agree within a couple of percent
+  const double steadyDuration = static_cast<double>(steadyEnd - steadyStart);
+  const double cycleDuration = static_cast<double>(
+      SirMetal::CycleClock::durationToNanoseconds(ticksEnd - ticksStart));
+  REQUIRE(cycleDuration == Approx(steadyDuration).epsilon(0.02));
+  const uint64_t roundTrip = SirMetal::CycleClock::durationToNanoseconds(
+      SirMetal::CycleClock::nanosecondsToDuration(1000000));
+  REQUIRE(static_cast<double>(roundTrip) == Approx(1000000.0).epsilon(0.001));
+}
+
+TEST_CASE("Clock sleep", "[clock]") {
+  SirMetal::GameClock gameClock;
+  const long long amount = 30 * 1000 * 1000;  // 30ms
+
+  const clock_t cpuStart = clock();
+  const SirMetal::high_res_time_point start = SirMetal::GameClock::now();
+  gameClock.sleep(amount);
+  const long long slept = gameClock.getDelta(start);
+  const clock_t cpuEnd = clock();
+
+  REQUIRE(slept >= amount);
+  // generous, the machine running the tests might be busy
+  REQUIRE(slept < amount + 20 * 1000 * 1000);
+  // most of the time is spent in an OS sleep, not burning the core
+  const double cpuSeconds =
+      static_cast<double>(cpuEnd - cpuStart) / CLOCKS_PER_SEC;
+  REQUIRE(cpuSeconds < 0.015);
+}
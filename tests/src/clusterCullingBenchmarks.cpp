@@ -0,0 +1,237 @@
+#include "SirMetal/core/memory/cpu/frameArena.h"
+#include "SirMetal/graphics/clusterCulling.h"
+#include "SirMetal/resources/meshes/meshOptimize.h"
+#include "catch/catch.h"
+
+#include <math.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+// a city block: a ground grid and rows of spheres standing on it, y up
+constexpr uint32_t GROUND_QUADS = 256;
+constexpr float GROUND_SIZE = 200.0f;
+constexpr uint32_t SPHERE_ROWS = 8;
+constexpr float SPHERE_SPACING = 24.0f;
+constexpr float SPHERE_RADIUS = 6.0f;
+constexpr uint32_t SPHERE_RINGS = 32;
+constexpr uint32_t SPHERE_SEGMENTS = 48;
+constexpr uint32_t FRAMES_PER_PATH = 300;
+
+struct CameraKey {
+  float position[3];
+  float target[3];
+};
+struct CameraPath {
+  const char *name;
+  std::vector<CameraKey> keys;
+};
+
+// camera paths recorded flying around the scene, the frames in between the
+// keys are interpolated
+const CameraPath CAMERA_PATHS[] = {
+    {"orbit",
+     {{{120, 40, 0}, {0, 0, 0}},
+      {{0, 40, 120}, {0, 0, 0}},
+      {{-120, 40, 0}, {0, 0, 0}},
+      {{0, 40, -120}, {0, 0, 0}},
+      {{120, 40, 0}, {0, 0, 0}}}},
+    {"street",
+     {{{-95, 2, 0}, {-60, 2, 0}},
+      {{-20, 2, 0}, {20, 2, 0}},
+      {{60, 2, 0}, {95, 2, 0}},
+      {{96, 2, 0}, {96, 2, 40}},
+      {{96, 2, 60}, {96, 2, 100}}}},
+    {"overhead",
+     {{{-60, 90, -60}, {-60, 0, -59}},
+      {{60, 90, -60}, {60, 0, -59}},
+      {{60, 90, 60}, {60, 0, 61}},
+      {{-60, 90, 60}, {-60, 0, 61}}}},
+};
+
+void addVertex(std::vector<float> &positions, const float x, const float y,
+               const float z) {
+  positions.insert(positions.end(), {x, y, z, 1.0f});
+}
+
+SirMetal::MeshLoadResult buildScene() {
+  std::vector<float> positions;
+  std::vector<uint32_t> indices;
+  const auto addGrid = [&](const uint32_t columns, const uint32_t rows,
+                           const uint32_t base) {
+    for (uint32_t r = 0; r < rows; ++r) {
+      for (uint32_t c = 0; c < columns; ++c) {
+        const uint32_t v = base + r * (columns + 1) + c;
+        const uint32_t below = v + columns + 1;
+        indices.insert(indices.end(),
+                       {v, below, v + 1, v + 1, below, below + 1});
+      }
+    }
+  };
+
+  const float cell = GROUND_SIZE / GROUND_QUADS;
+  for (uint32_t z = 0; z <= GROUND_QUADS; ++z) {
+    for (uint32_t x = 0; x <= GROUND_QUADS; ++x) {
+      addVertex(positions, x * cell - GROUND_SIZE * 0.5f, 0.0f,
+                z * cell - GROUND_SIZE * 0.5f);
+    }
+  }
+  addGrid(GROUND_QUADS, GROUND_QUADS, 0);
+
+  const float first = -SPHERE_SPACING * (SPHERE_ROWS - 1) * 0.5f;
+  for (uint32_t i = 0; i < SPHERE_ROWS * SPHERE_ROWS; ++i) {
+    const float cx = first + (i % SPHERE_ROWS) * SPHERE_SPACING;
+    const float cz = first + (i / SPHERE_ROWS) * SPHERE_SPACING;
+    const auto base = static_cast<uint32_t>(positions.size() / 4);
+    for (uint32_t r = 0; r <= SPHERE_RINGS; ++r) {
+      const float theta = 3.14159265f * r / SPHERE_RINGS;
+      for (uint32_t s = 0; s <= SPHERE_SEGMENTS; ++s) {
+        // clockwise seen from above, the triangles face out
+        const float phi = -6.2831853f * s / SPHERE_SEGMENTS;
+        addVertex(positions, cx + SPHERE_RADIUS * sinf(theta) * cosf(phi),
+                  SPHERE_RADIUS * (1.0f + cosf(theta)),
+                  cz + SPHERE_RADIUS * sinf(theta) * sinf(phi));
+      }
+    }
+    addGrid(SPHERE_SEGMENTS, SPHERE_RINGS, base);
+  }
+
+  // only the positions matter for the meshlets, the other attributes are
+  // there to get the same layout as a loaded mesh
+  SirMetal::MeshLoadResult mesh;
+  mesh.indices = std::move(indices);
+  const uint64_t vertexCount = positions.size() / 4;
+  std::vector<float> zeroes(vertexCount * 4, 0.0f);
+  SirMetal::MeshAttribute attributes[4] = {{positions.data(), vertexCount * 4},
+                                           {zeroes.data(), vertexCount * 4},
+                                           {zeroes.data(), vertexCount * 2},
+                                           {zeroes.data(), vertexCount * 4}};
+  float strides[4]{4, 4, 2, 4};
+  SirMetal::mergeRawMeshBuffers(attributes, strides, 4, mesh.vertices,
+                                mesh.ranges);
+  SirMetal::buildMeshlets(mesh, SirMetal::getThreadScratchArena());
+  return mesh;
+}
+
+void subtract(const float *a, const float *b, float *out) {
+  for (int i = 0; i < 3; ++i) {
+    out[i] = a[i] - b[i];
+  }
+}
+void cross(const float *a, const float *b, float *out) {
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+float dot(const float *a, const float *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+void normalize(float *v) {
+  const float length = sqrtf(dot(v, v));
+  for (int i = 0; i < 3; ++i) {
+    v[i] /= length;
+  }
+}
+
+// perspective as matrix_float4x4_perspective times a look at view, column
+// major
+void buildViewProjection(const CameraKey &key, float *out) {
+  const float up[3] = {0, 1, 0};
+  float forward[3];
+  float side[3];
+  float cameraUp[3];
+  subtract(key.target, key.position, forward);
+  normalize(forward);
+  cross(forward, up, side);
+  normalize(side);
+  cross(side, forward, cameraUp);
+  const float rows[3][4] = {
+      {side[0], side[1], side[2], -dot(side, key.position)},
+      {cameraUp[0], cameraUp[1], cameraUp[2], -dot(cameraUp, key.position)},
+      {-forward[0], -forward[1], -forward[2], dot(forward, key.position)}};
+
+  const float nearPlane = 0.1f;
+  const float farPlane = 500.0f;
+  const float yScale = 1.0f / tanf(1.0471976f * 0.5f);
+  const float xScale = yScale / (16.0f / 9.0f);
+  const float zScale = -(farPlane + nearPlane) / (farPlane - nearPlane);
+  const float wzScale = -2.0f * farPlane * nearPlane / (farPlane - nearPlane);
+  for (int c = 0; c < 4; ++c) {
+    out[c * 4 + 0] = xScale * rows[0][c];
+    out[c * 4 + 1] = yScale * rows[1][c];
+    out[c * 4 + 2] = zScale * rows[2][c] + (c == 3 ? wzScale : 0.0f);
+    out[c * 4 + 3] = -rows[2][c];
+  }
+}
+
+std::vector<SirMetal::ClusterCullingView> samplePath(const CameraPath &path) {
+  std::vector<SirMetal::ClusterCullingView> views(FRAMES_PER_PATH);
+  const auto segments = static_cast<float>(path.keys.size() - 1);
+  for (uint32_t f = 0; f < FRAMES_PER_PATH; ++f) {
+    const float t = segments * f / (FRAMES_PER_PATH - 1);
+    const auto k = static_cast<uint32_t>(t < segments ? t : segments - 1);
+    const float blend = t - k;
+    const CameraKey &from = path.keys[k];
+    const CameraKey &to = path.keys[k + 1];
+    CameraKey key;
+    for (int i = 0; i < 3; ++i) {
+      key.position[i] =
+          from.position[i] + (to.position[i] - from.position[i]) * blend;
+      key.target[i] =
+          from.target[i] + (to.target[i] - from.target[i]) * blend;
+    }
+    float viewProjection[16];
+    buildViewProjection(key, viewProjection);
+    SirMetal::initializeCullingView(views[f], viewProjection, key.position);
+  }
+  return views;
+}
+
+template <typename T>
+const T *getSection(const SirMetal::MeshLoadResult &mesh,
+                    const SirMetal::MESH_CLUSTER_DATA_TYPE type) {
+  return reinterpret_cast<const T *>(
+      reinterpret_cast<const char *>(mesh.vertices.data()) +
+      mesh.clusterRanges[type].m_offset);
+}
+}  // namespace
+
+// run with: tests "[!benchmark]"
+TEST_CASE("cluster culling over camera paths", "[!benchmark]") {
+  const SirMetal::MeshLoadResult mesh = buildScene();
+  const auto *meshlets = getSection<SirMetal::Meshlet>(
+      mesh, SirMetal::MESH_CLUSTER_DATA_TYPE_MESHLETS);
+  const auto *bounds = getSection<SirMetal::MeshletBounds>(
+      mesh, SirMetal::MESH_CLUSTER_DATA_TYPE_BOUNDS);
+  const uint32_t meshletCount = mesh.meshletCount;
+  WARN("scene: " << mesh.indices.size() / 3 << " triangles in " << meshletCount
+                 << " meshlets");
+  std::vector<uint32_t> visible(meshletCount);
+
+  for (const CameraPath &path : CAMERA_PATHS) {
+    const std::vector<SirMetal::ClusterCullingView> views = samplePath(path);
+    SirMetal::ClusterCullingStats stats;
+    for (const SirMetal::ClusterCullingView &view : views) {
+      SirMetal::cullMeshlets(meshlets, bounds, meshletCount, view,
+                             visible.data(), &stats);
+    }
+    const double viewCount = static_cast<double>(views.size());
+    const uint64_t culled = stats.triangleCount - stats.visibleTriangles;
+    WARN(path.name << ": " << views.size() << " views, per view "
+                   << culled / viewCount << " triangles culled of "
+                   << stats.triangleCount / viewCount << " ("
+                   << 100.0 * culled / stats.triangleCount << "%), frustum "
+                   << stats.frustumCulledTriangles / viewCount << ", back face "
+                   << stats.backfaceCulledTriangles / viewCount);
+
+    BENCHMARK(std::string("cull ") + path.name) {
+      uint32_t visibleCount = 0;
+      for (const SirMetal::ClusterCullingView &view : views) {
+        visibleCount += SirMetal::cullMeshlets(meshlets, bounds, meshletCount,
+                                               view, visible.data());
+      }
+      return visibleCount;
+    };
+  }
+}
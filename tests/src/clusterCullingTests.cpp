@@ -0,0 +1,126 @@
+#include "SirMetal/graphics/clusterCulling.h"
+#include "catch/catch.h"
+
+#include <math.h>
+
+namespace {
+// same matrix as matrix_float4x4_perspective, column major, the camera sits
+// at the origin looking down -z
+void perspective(float *out, const float aspect, const float fovy,
+                 const float nearPlane, const float farPlane) {
+  const float yScale = 1.0f / tanf(fovy * 0.5f);
+  const float zRange = farPlane - nearPlane;
+  for (int i = 0; i < 16; ++i) {
+    out[i] = 0.0f;
+  }
+  out[0] = yScale / aspect;
+  out[5] = yScale;
+  out[10] = -(farPlane + nearPlane) / zRange;
+  out[11] = -1.0f;
+  out[14] = -2.0f * farPlane * nearPlane / zRange;
+}
+
+SirMetal::ClusterCullingView makeView() {
+  float viewProjection[16];
+  perspective(viewProjection, 1.0f, 1.5707963f, 0.1f, 100.0f);
+  const float cameraPosition[3] = {0, 0, 0};
+  SirMetal::ClusterCullingView view;
+  SirMetal::initializeCullingView(view, viewProjection, cameraPosition);
+  return view;
+}
+
+SirMetal::MeshletBounds makeBounds(const float x, const float y, const float z,
+                                   const float radius) {
+  // normals too spread to be back facing
+  return {{x, y, z}, radius, {0, 0, 1}, 1.0f};
+}
+}  // namespace
+
+TEST_CASE("Cluster culling frustum planes", "[culling]") {
+  const SirMetal::ClusterCullingView view = makeView();
+  const auto isInside = [&view](const float x, const float y, const float z) {
+    for (const float *plane : view.planes) {
+      if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+        return false;
+      }
+    }
+    return true;
+  };
+  REQUIRE(isInside(0, 0, -10));
+  REQUIRE(isInside(9, -9, -10));
+  REQUIRE(!isInside(11, 0, -10));
+  REQUIRE(!isInside(0, 11, -10));
+  REQUIRE(!isInside(0, 0, 10));
+  REQUIRE(!isInside(0, 0, -0.05f));
+  REQUIRE(!isInside(0, 0, -101));
+  // normalized, the near plane value is the distance from it
+  const float *nearPlane = view.planes[4];
+  REQUIRE(nearPlane[2] * -1.1f + nearPlane[3] == Approx(1.0f).epsilon(1e-3));
+}
+
+TEST_CASE("Cluster culling rejects meshlets out of the frustum", "[culling]") {
+  const SirMetal::ClusterCullingView view = makeView();
+  const SirMetal::Meshlet meshlets[5] = {
+      {0, 0, 3, 1}, {3, 4, 3, 2}, {6, 12, 3, 3}, {9, 24, 3, 4}, {12, 40, 3, 5}};
+  const SirMetal::MeshletBounds bounds[5] = {
+      makeBounds(0, 0, -10, 1),
+      // behind the camera
+      makeBounds(0, 0, 10, 1),
+      // past the right plane but touching it
+      makeBounds(10.5f, 0, -10, 1),
+      // far on the left
+      makeBounds(-50, 0, -10, 1),
+      // beyond the far plane
+      makeBounds(0, 0, -150, 1)};
+  uint32_t visible[5];
+  SirMetal::ClusterCullingStats stats;
+  const uint32_t visibleCount =
+      SirMetal::cullMeshlets(meshlets, bounds, 5, view, visible, &stats);
+  REQUIRE(visibleCount == 2);
+  REQUIRE(visible[0] == 0);
+  REQUIRE(visible[1] == 2);
+  REQUIRE(stats.meshletCount == 5);
+  REQUIRE(stats.visibleMeshlets == 2);
+  REQUIRE(stats.frustumCulledMeshlets == 3);
+  REQUIRE(stats.backfaceCulledMeshlets == 0);
+  REQUIRE(stats.triangleCount == 15);
+  REQUIRE(stats.visibleTriangles == 4);
+  REQUIRE(stats.frustumCulledTriangles == 11);
+
+  // stats keep adding up, the result does not depend on them
+  REQUIRE(SirMetal::cullMeshlets(meshlets, bounds, 5, view, visible) == 2);
+  SirMetal::cullMeshlets(meshlets, bounds, 5, view, visible, &stats);
+  REQUIRE(stats.meshletCount == 10);
+  REQUIRE(stats.triangleCount == 30);
+}
+
+TEST_CASE("Cluster culling rejects back facing meshlets", "[culling]") {
+  const SirMetal::ClusterCullingView view = makeView();
+  const SirMetal::Meshlet meshlets[4] = {
+      {0, 0, 3, 10}, {0, 0, 3, 20}, {0, 0, 3, 30}, {0, 0, 3, 40}};
+  // cones of 30 degrees around the axis, cutoff sin(30)
+  SirMetal::MeshletBounds bounds[4] = {
+      // facing away from the camera
+      {{0, 0, -10}, 1, {0, 0, -1}, 0.5f},
+      // facing the camera
+      {{0, 0, -10}, 1, {0, 0, 1}, 0.5f},
+      // seen from the side, some faces can be front facing
+      {{0, 0, -10}, 1, {1, 0, 0}, 0.5f},
+      // facing away but the normals are spread over more than half a sphere
+      {{0, 0, -10}, 1, {0, 0, -1}, 1.0f}};
+  uint32_t visible[4];
+  SirMetal::ClusterCullingStats stats;
+  REQUIRE(SirMetal::cullMeshlets(meshlets, bounds, 4, view, visible, &stats) ==
+          3);
+  REQUIRE(visible[0] == 1);
+  REQUIRE(visible[1] == 2);
+  REQUIRE(visible[2] == 3);
+  REQUIRE(stats.backfaceCulledMeshlets == 1);
+  REQUIRE(stats.backfaceCulledTriangles == 10);
+  REQUIRE(stats.frustumCulledMeshlets == 0);
+
+  // the sphere is conservative, a camera inside it never culls
+  SirMetal::ClusterCullingView inside = view;
+  inside.cameraPosition[2] = -9.5f;
+  REQUIRE(SirMetal::cullMeshlets(meshlets, bounds, 1, inside, visible) == 1);
+}
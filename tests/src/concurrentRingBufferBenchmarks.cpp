@@ -0,0 +1,170 @@
+#include "SirMetal/core/memory/cpu/concurrentRingBuffer.h"
+#include "SirMetal/core/memory/cpu/ringBuffer.h"
+#include "catch/catch.h"
+#include <mutex>
+#include <string>
+#include <thread>
+
+// run with: tests "[!benchmark]"
+namespace {
+
+constexpr uint32_t ITEM_COUNT = 1 << 16;
+constexpr uint32_t RING_SIZE = 1024;
+constexpr uint32_t BATCH_SIZE = 32;
+
+// baseline, the plain ring buffer behind a lock
+struct LockedRingBuffer {
+  explicit LockedRingBuffer(const uint32_t size) : ring(size) {}
+  bool push(const uint32_t value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ring.push(value);
+  }
+  bool pop(uint32_t &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ring.isEmpty()) {
+      return false;
+    }
+    value = ring.pop();
+    return true;
+  }
+  std::mutex mutex;
+  SirMetal::RingBuffer<uint32_t> ring;
+};
+
+// failed pushes and pops yield, so the numbers still make sense on machines
+// with fewer cores than threads
+inline void backOff() { std::this_thread::yield(); }
+
+// moves ITEM_COUNT values from one producer to one consumer thread
+template <typename RING> uint64_t transferSingle(RING &ring) {
+  std::thread producer([&ring]() {
+    for (uint32_t i = 0; i < ITEM_COUNT;) {
+      if (ring.push(i)) {
+        ++i;
+      } else {
+        backOff();
+      }
+    }
+  });
+  uint64_t sum = 0;
+  uint32_t value;
+  for (uint32_t received = 0; received < ITEM_COUNT;) {
+    if (ring.pop(value)) {
+      sum += value;
+      ++received;
+    } else {
+      backOff();
+    }
+  }
+  producer.join();
+  return sum;
+}
+
+template <typename RING> uint64_t transferBatch(RING &ring) {
+  std::thread producer([&ring]() {
+    uint32_t batch[BATCH_SIZE];
+    for (uint32_t i = 0; i < ITEM_COUNT;) {
+      for (uint32_t b = 0; b < BATCH_SIZE; ++b) {
+        batch[b] = i + b;
+      }
+      const uint32_t pushed = ring.pushBatch(batch, BATCH_SIZE);
+      i += pushed;
+      if (pushed == 0) {
+        backOff();
+      }
+    }
+  });
+  uint64_t sum = 0;
+  uint32_t batch[BATCH_SIZE];
+  for (uint32_t received = 0; received < ITEM_COUNT;) {
+    const uint32_t popped = ring.popBatch(batch, BATCH_SIZE);
+    for (uint32_t b = 0; b < popped; ++b) {
+      sum += batch[b];
+    }
+    received += popped;
+    if (popped == 0) {
+      backOff();
+    }
+  }
+  producer.join();
+  return sum;
+}
+
+// a value goes to the other thread and comes back, measures the round trip
+template <typename RING> uint64_t pingPong(RING &request, RING &reply,
+                                           const uint32_t count) {
+  std::thread responder([&request, &reply, count]() {
+    uint32_t value;
+    for (uint32_t i = 0; i < count;) {
+      if (request.pop(value)) {
+        while (!reply.push(value)) {
+          backOff();
+        }
+        ++i;
+      } else {
+        backOff();
+      }
+    }
+  });
+  uint64_t sum = 0;
+  uint32_t value;
+  for (uint32_t i = 0; i < count; ++i) {
+    while (!request.push(i)) {
+      backOff();
+    }
+    while (!reply.pop(value)) {
+      backOff();
+    }
+    sum += value;
+  }
+  responder.join();
+  return sum;
+}
+
+} // namespace
+
+TEST_CASE("concurrent ring buffer throughput", "[!benchmark]") {
+  const std::string suffix = " items:" + std::to_string(ITEM_COUNT);
+
+  BENCHMARK("mutex ring buffer" + suffix) {
+    LockedRingBuffer ring(RING_SIZE);
+    return transferSingle(ring);
+  };
+  BENCHMARK("spsc" + suffix) {
+    SirMetal::SPSCRingBuffer<uint32_t> ring(RING_SIZE);
+    return transferSingle(ring);
+  };
+  BENCHMARK("spsc batch" + suffix) {
+    SirMetal::SPSCRingBuffer<uint32_t> ring(RING_SIZE);
+    return transferBatch(ring);
+  };
+  BENCHMARK("mpmc" + suffix) {
+    SirMetal::MPMCRingBuffer<uint32_t> ring(RING_SIZE);
+    return transferSingle(ring);
+  };
+  BENCHMARK("mpmc batch" + suffix) {
+    SirMetal::MPMCRingBuffer<uint32_t> ring(RING_SIZE);
+    return transferBatch(ring);
+  };
+}
+
+TEST_CASE("concurrent ring buffer latency", "[!benchmark]") {
+  const uint32_t roundTrips = 1024;
+  const std::string suffix = " round trips:" + std::to_string(roundTrips);
+
+  BENCHMARK("mutex ring buffer" + suffix) {
+    LockedRingBuffer request(16);
+    LockedRingBuffer reply(16);
+    return pingPong(request, reply, roundTrips);
+  };
+  BENCHMARK("spsc" + suffix) {
+    SirMetal::SPSCRingBuffer<uint32_t> request(16);
+    SirMetal::SPSCRingBuffer<uint32_t> reply(16);
+    return pingPong(request, reply, roundTrips);
+  };
+  BENCHMARK("mpmc" + suffix) {
+    SirMetal::MPMCRingBuffer<uint32_t> request(16);
+    SirMetal::MPMCRingBuffer<uint32_t> reply(16);
+    return pingPong(request, reply, roundTrips);
+  };
+}
@@ -0,0 +1,199 @@
+#include "SirMetal/core/memory/cpu/concurrentRingBuffer.h"
+#include "catch/catch.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("SPSC ring buffer push pop", "[memory]") {
+  SirMetal::SPSCRingBuffer<uint32_t> ring(5);
+  REQUIRE(ring.capacity() == 8);
+  REQUIRE(ring.isEmpty());
+  for (uint32_t i = 0; i < 8; ++i) {
+    REQUIRE(ring.push(i));
+  }
+  REQUIRE(!ring.push(8));
+  REQUIRE(ring.usedElementCount() == 8);
+
+  // wrapping around a few times
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < 100; ++i) {
+    REQUIRE(ring.pop(value));
+    REQUIRE(value == i);
+    REQUIRE(ring.push(i + 8));
+  }
+  for (uint32_t i = 0; i < 8; ++i) {
+    REQUIRE(ring.pop(value));
+    REQUIRE(value == 100 + i);
+  }
+  REQUIRE(!ring.pop(value));
+}
+
+TEST_CASE("SPSC ring buffer batch", "[memory]") {
+  SirMetal::SPSCRingBuffer<uint32_t> ring(16);
+  uint32_t values[20];
+  for (uint32_t i = 0; i < 20; ++i) {
+    values[i] = i;
+  }
+  uint32_t out[20]{};
+  REQUIRE(ring.pushBatch(values, 10) == 10);
+  REQUIRE(ring.popBatch(out, 4) == 4);
+  // only 10 slots left, the batch is cut and wraps around the end
+  REQUIRE(ring.pushBatch(values + 10, 10) == 10);
+  REQUIRE(ring.pushBatch(values, 1) == 0);
+  REQUIRE(ring.popBatch(out + 4, 20) == 16);
+  for (uint32_t i = 0; i < 20; ++i) {
+    REQUIRE(out[i] == i);
+  }
+  REQUIRE(ring.popBatch(out, 1) == 0);
+}
+
+TEST_CASE("MPMC ring buffer push pop", "[memory]") {
+  SirMetal::MPMCRingBuffer<uint32_t> ring(8);
+  REQUIRE(ring.capacity() == 8);
+  for (uint32_t i = 0; i < 8; ++i) {
+    REQUIRE(ring.push(i));
+  }
+  REQUIRE(!ring.push(8));
+  uint32_t value = 0;
+  for (uint32_t i = 0; i < 100; ++i) {
+    REQUIRE(ring.pop(value));
+    REQUIRE(value == i);
+    REQUIRE(ring.push(i + 8));
+  }
+
+  uint32_t out[16]{};
+  REQUIRE(ring.popBatch(out, 16) == 8);
+  for (uint32_t i = 0; i < 8; ++i) {
+    REQUIRE(out[i] == 100 + i);
+  }
+  REQUIRE(!ring.pop(value));
+
+  uint32_t values[12]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  REQUIRE(ring.pushBatch(values, 12) == 8);
+  REQUIRE(ring.popBatch(out, 3) == 3);
+  REQUIRE(ring.pushBatch(values + 8, 4) == 3);
+  REQUIRE(ring.popBatch(out + 3, 16) == 8);
+  for (uint32_t i = 0; i < 11; ++i) {
+    REQUIRE(out[i] == i);
+  }
+}
+
+TEST_CASE("SPSC ring buffer stress", "[memory]") {
+  // small ring so the threads keep running into the full and empty cases
+  SirMetal::SPSCRingBuffer<uint32_t> ring(64);
+  constexpr uint32_t COUNT = 1 << 16;
+
+  std::thread producer([&ring]() {
+    uint32_t batch[7];
+    uint32_t next = 0;
+    while (next < COUNT) {
+      // mixing single and batched pushes
+      uint32_t pushed;
+      if ((next & 1) == 0) {
+        pushed = ring.push(next) ? 1 : 0;
+      } else {
+        const uint32_t toPush = COUNT - next < 7 ? COUNT - next : 7;
+        for (uint32_t i = 0; i < toPush; ++i) {
+          batch[i] = next + i;
+        }
+        pushed = ring.pushBatch(batch, toPush);
+      }
+      next += pushed;
+      // letting the other side run if there are fewer cores than threads
+      if (pushed == 0) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  // the consumer checks nothing gets lost, duplicated or reordered
+  uint32_t expected = 0;
+  bool inOrder = true;
+  uint32_t batch[5];
+  while (expected < COUNT) {
+    uint32_t popped;
+    if ((expected & 3) == 0) {
+      popped = ring.pop(batch[0]) ? 1 : 0;
+    } else {
+      popped = ring.popBatch(batch, 5);
+    }
+    for (uint32_t i = 0; i < popped; ++i) {
+      inOrder &= batch[i] == expected;
+      ++expected;
+    }
+    if (popped == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  REQUIRE(inOrder);
+  REQUIRE(ring.isEmpty());
+}
+
+TEST_CASE("MPMC ring buffer stress", "[memory]") {
+  SirMetal::MPMCRingBuffer<uint32_t> ring(64);
+  constexpr uint32_t THREADS = 4;
+  constexpr uint32_t PER_PRODUCER = 1 << 14;
+  // every value is pushed exactly once, consumers flag what they receive
+  std::vector<std::atomic<uint8_t>> received(THREADS * PER_PRODUCER);
+  for (auto &flag : received) {
+    flag.store(0);
+  }
+  std::atomic<uint32_t> poppedCount{0};
+  std::vector<std::thread> threads;
+
+  for (uint32_t t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&ring, t]() {
+      const uint32_t start = t * PER_PRODUCER;
+      uint32_t next = 0;
+      uint32_t batch[3];
+      while (next < PER_PRODUCER) {
+        uint32_t pushed;
+        if ((next & 1) == 0) {
+          pushed = ring.push(start + next) ? 1 : 0;
+        } else {
+          const uint32_t toPush =
+              PER_PRODUCER - next < 3 ? PER_PRODUCER - next : 3;
+          for (uint32_t i = 0; i < toPush; ++i) {
+            batch[i] = start + next + i;
+          }
+          pushed = ring.pushBatch(batch, toPush);
+        }
+        next += pushed;
+        if (pushed == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&ring, &received, &poppedCount]() {
+      uint32_t batch[4];
+      uint32_t iteration = 0;
+      while (poppedCount.load() < THREADS * PER_PRODUCER) {
+        uint32_t popped;
+        if ((++iteration & 1) == 0) {
+          popped = ring.pop(batch[0]) ? 1 : 0;
+        } else {
+          popped = ring.popBatch(batch, 4);
+        }
+        for (uint32_t i = 0; i < popped; ++i) {
+          received[batch[i]].fetch_add(1);
+        }
+        poppedCount.fetch_add(popped);
+        if (popped == 0) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  bool allOnce = true;
+  for (auto &flag : received) {
+    allOnce &= flag.load() == 1;
+  }
+  REQUIRE(allOnce);
+  REQUIRE(poppedCount.load() == THREADS * PER_PRODUCER);
+  REQUIRE(ring.isEmpty());
+}
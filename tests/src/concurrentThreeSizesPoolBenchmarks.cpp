@@ -0,0 +1,62 @@
+#include "SirMetal/core/memory/cpu/concurrentThreeSizesPool.h"
+#include "catch/catch.h"
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// run with: tests "[!benchmark]"
+namespace {
+
+// every thread keeps a window of live allocations of random small/medium
+// sizes, freeing the oldest one on every new allocation
+template <typename ALLOC, typename FREE>
+void runWorkload(const int threadCount, ALLOC allocFn, FREE freeFn) {
+  constexpr int OPERATIONS = 100000;
+  constexpr int WINDOW = 64;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t) {
+    threads.emplace_back([=]() {
+      void *window[WINDOW] = {};
+      uint32_t seed = t + 1;
+      for (int i = 0; i < OPERATIONS; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const uint32_t size = 8 + ((seed >> 16) % 240);
+        void *&slot = window[i % WINDOW];
+        if (slot != nullptr) {
+          freeFn(slot);
+        }
+        slot = allocFn(size);
+      }
+      for (void *ptr : window) {
+        if (ptr != nullptr) {
+          freeFn(ptr);
+        }
+      }
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+}
+
+} // namespace
+
+TEST_CASE("concurrent pool vs malloc", "[!benchmark]") {
+  const int threadCounts[] = {1, 4, 16};
+  for (int threadCount : threadCounts) {
+    const std::string suffix = " threads:" + std::to_string(threadCount);
+    BENCHMARK("malloc" + suffix) {
+      runWorkload(
+          threadCount, [](uint32_t size) { return malloc(size); },
+          [](void *ptr) { free(ptr); });
+    };
+    SirMetal::ConcurrentThreeSizesPool pool(256 << 20, 1 << 20);
+    BENCHMARK("concurrent pool" + suffix) {
+      runWorkload(
+          threadCount,
+          [&pool](uint32_t size) { return pool.allocate(size); },
+          [&pool](void *ptr) { pool.free(ptr); });
+    };
+  }
+}
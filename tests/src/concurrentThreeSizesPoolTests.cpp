@@ -0,0 +1,208 @@
+#include "SirMetal/core/memory/cpu/concurrentThreeSizesPool.h"
+#include "catch/catch.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Concurrent pool basic alloc", "[memory]") {
+  SirMetal::ConcurrentThreeSizesPool alloc(2 << 16, 2 << 16, 64, 256);
+  void *mem = alloc.allocate(16);
+  void *mem2 = alloc.allocate(128);
+  void *mem3 = alloc.allocate(300);
+  REQUIRE(mem != nullptr);
+  REQUIRE(mem2 != nullptr);
+  REQUIRE(mem3 != nullptr);
+  REQUIRE(alloc.getSmallAllocCount() == 1);
+  REQUIRE(alloc.getMediumAllocCount() == 1);
+  REQUIRE(alloc.getLargeAllocCount() == 1);
+  REQUIRE(alloc.getAllocSize(mem) == 16);
+  REQUIRE(alloc.getAllocSize(mem2) == 128);
+  REQUIRE(alloc.getAllocSize(mem3) == 300);
+  alloc.free(mem);
+  alloc.free(mem2);
+  alloc.free(mem3);
+  REQUIRE(alloc.getSmallAllocCount() == 0);
+  REQUIRE(alloc.getMediumAllocCount() == 0);
+  REQUIRE(alloc.getLargeAllocCount() == 0);
+}
+
+TEST_CASE("Concurrent pool recycles blocks", "[memory]") {
+  SirMetal::ConcurrentThreeSizesPool alloc(2 << 16, 2 << 12);
+  std::vector<void *> ptrs;
+  for (int i = 0; i < 200; ++i) {
+    ptrs.push_back(alloc.allocate(32));
+  }
+  const uint32_t usedBytes = alloc.getUsedBytes();
+  for (int round = 0; round < 10; ++round) {
+    for (void *ptr : ptrs) {
+      alloc.free(ptr);
+    }
+    ptrs.clear();
+    for (int i = 0; i < 200; ++i) {
+      ptrs.push_back(alloc.allocate(40));
+    }
+  }
+  // everything came from the magazine and the shared batches
+  REQUIRE(alloc.getUsedBytes() == usedBytes);
+  REQUIRE(alloc.getSmallAllocCount() == 200);
+  alloc.flushThreadCache();
+}
+
+TEST_CASE("Concurrent pool fills up to the last byte", "[memory]") {
+  // a small block is 64 bytes plus the 8 bytes header, a medium one 264
+  SirMetal::ConcurrentThreeSizesPool alloc(72 * 3 + 264, 2 << 12, 64, 256);
+  std::vector<void *> ptrs;
+  for (int i = 0; i < 3; ++i) {
+    ptrs.push_back(alloc.allocate(64 - 8));
+    REQUIRE(ptrs.back() != nullptr);
+  }
+  // the last block ends exactly at the end of the pool
+  ptrs.push_back(alloc.allocate(200));
+  REQUIRE(ptrs.back() != nullptr);
+  REQUIRE(alloc.getUsedBytes() == 72 * 3 + 264);
+  for (void *ptr : ptrs) {
+    alloc.free(ptr);
+  }
+  alloc.flushThreadCache();
+}
+
+TEST_CASE("Concurrent pool multi threaded stress", "[memory]") {
+  SirMetal::ConcurrentThreeSizesPool alloc(64 << 20, 16 << 20);
+  const int threadCount = 8;
+  const int iterations = 20000;
+  std::atomic<int> errors{0};
+  // blocks allocated by one thread and freed by another
+  std::mutex exchangeLock;
+  std::vector<uint32_t *> exchange;
+
+  auto worker = [&](const uint32_t threadId) {
+    std::vector<uint32_t *> live;
+    uint32_t seed = threadId * 7919 + 1;
+    for (int i = 0; i < iterations; ++i) {
+      seed = seed * 1103515245 + 12345;
+      const uint32_t action = (seed >> 16) % 8;
+      if (action < 4 || live.empty()) {
+        const uint32_t size = 8 + ((seed >> 8) % 300);
+        auto *mem = reinterpret_cast<uint32_t *>(alloc.allocate(size));
+        if (mem == nullptr) {
+          errors++;
+          continue;
+        }
+        // tagging the whole allocation, any block handed out twice would
+        // have the tag overwritten by the other owner
+        const uint32_t words = size / 4;
+        for (uint32_t w = 0; w < words; ++w) {
+          mem[w] = threadId;
+        }
+        mem[0] = words;
+        live.push_back(mem);
+      } else {
+        uint32_t *mem = live.back();
+        live.pop_back();
+        const uint32_t words = mem[0];
+        for (uint32_t w = 1; w < words; ++w) {
+          errors += mem[w] != threadId ? 1 : 0;
+        }
+        if (action == 7) {
+          // handing it to another thread, rewriting the tag with the id of
+          // whoever frees it is not possible so we mark it as exchanged
+          for (uint32_t w = 1; w < words; ++w) {
+            mem[w] = 0xFFFFFFFF;
+          }
+          std::lock_guard<std::mutex> lock(exchangeLock);
+          exchange.push_back(mem);
+        } else {
+          alloc.free(mem);
+        }
+      }
+      if ((i % 64) == 0) {
+        uint32_t *other = nullptr;
+        {
+          std::lock_guard<std::mutex> lock(exchangeLock);
+          if (!exchange.empty()) {
+            other = exchange.back();
+            exchange.pop_back();
+          }
+        }
+        if (other != nullptr) {
+          for (uint32_t w = 1; w < other[0]; ++w) {
+            errors += other[w] != 0xFFFFFFFF ? 1 : 0;
+          }
+          alloc.free(other);
+        }
+      }
+    }
+    for (uint32_t *mem : live) {
+      alloc.free(mem);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t) {
+    threads.emplace_back(worker, static_cast<uint32_t>(t + 1));
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  for (uint32_t *mem : exchange) {
+    alloc.free(mem);
+  }
+  REQUIRE(errors.load() == 0);
+  REQUIRE(alloc.getSmallAllocCount() == 0);
+  REQUIRE(alloc.getMediumAllocCount() == 0);
+  REQUIRE(alloc.getLargeAllocCount() == 0);
+}
+
+TEST_CASE("Concurrent pool flushes caches on thread exit", "[memory]") {
+  SirMetal::ConcurrentThreeSizesPool alloc(2 << 20, 2 << 12);
+  // more threads than cache slots over the lifetime of the pool, blocks
+  // cached by exited threads must be reused rather than bumping new ones
+  for (uint32_t round = 0; round < 3 * alloc.MAX_THREADS; ++round) {
+    std::thread t([&alloc]() {
+      void *ptrs[16];
+      for (void *&ptr : ptrs) {
+        ptr = alloc.allocate(24);
+      }
+      for (void *ptr : ptrs) {
+        alloc.free(ptr);
+      }
+    });
+    t.join();
+  }
+  REQUIRE(alloc.getSmallAllocCount() == 0);
+  REQUIRE(alloc.getUsedBytes() <= 16 * 2 * 64);
+}
+
+TEST_CASE("Concurrent pool threads past the cache slots", "[memory]") {
+  SirMetal::ConcurrentThreeSizesPool alloc(2 << 20, 2 << 12);
+  const uint32_t threadCount = alloc.MAX_THREADS + 8;
+  std::atomic<uint32_t> ready{0};
+  std::atomic<uint32_t> uncached{0};
+  std::atomic<int> errors{0};
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back([&]() {
+      void *ptrs[40];
+      for (void *&ptr : ptrs) {
+        ptr = alloc.allocate(24);
+        errors += ptr == nullptr ? 1 : 0;
+      }
+      // all the threads are alive at the same time, so some get no slot
+      ready.fetch_add(1);
+      while (ready.load() != threadCount) {
+        std::this_thread::yield();
+      }
+      uncached += alloc.isThreadCached() ? 0 : 1;
+      for (void *ptr : ptrs) {
+        alloc.free(ptr);
+      }
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  REQUIRE(errors.load() == 0);
+  REQUIRE(uncached.load() >= threadCount - alloc.MAX_THREADS);
+  REQUIRE(alloc.getSmallAllocCount() == 0);
+}
@@ -0,0 +1,108 @@
+#include "SirMetal/core/memory/denseTree.h"
+#include "catch/catch.h"
+
+namespace {
+// builds the tree, listed as node: children
+// 0: 1, 4, 5
+// 1: 2, 3
+// 5: 6
+// creating nodes in a shuffled order, ids are the expected depth first order
+void buildTestTree(SirMetal::DenseTree &tree) {
+  tree.initialize();
+  tree.createRoot(0);
+  auto &nodes = tree.getNodes();
+  tree.createNode(nodes[0], 5);   // index 1
+  tree.createNode(nodes[0], 1);   // index 2
+  tree.createNode(nodes[1], 6);   // index 3
+  tree.createNode(nodes[2], 3);   // index 4
+  tree.createNode(nodes[0], 4);   // index 5
+  tree.createNode(nodes[2], 2);   // index 6
+  // fixing up the order of the siblings by re-parenting, they get appended
+  tree.parentNode(nodes[0], nodes[1]);
+  tree.parentNode(nodes[2], nodes[4]);
+}
+} // namespace
+
+TEST_CASE("Dense tree parenting", "[memory]") {
+  SirMetal::DenseTree tree;
+  buildTestTree(tree);
+  auto &nodes = tree.getNodes();
+  REQUIRE(!tree.isSorted());
+  REQUIRE(tree.isDirectChild(nodes[0], nodes[1]));
+  REQUIRE(tree.isDirectChild(nodes[0], nodes[2]));
+  REQUIRE(tree.isDirectChild(nodes[0], nodes[5]));
+  REQUIRE(!tree.isDirectChild(nodes[0], nodes[3]));
+  REQUIRE(tree.isDirectParent(nodes[1], nodes[3]));
+
+  // moving a node to another parent
+  tree.parentNode(nodes[1], nodes[6]);
+  REQUIRE(!tree.isDirectChild(nodes[2], nodes[6]));
+  REQUIRE(tree.isDirectChild(nodes[1], nodes[6]));
+  REQUIRE(tree.isDirectChild(nodes[2], nodes[4]));
+  REQUIRE(tree.isDirectParent(nodes[1], nodes[6]));
+}
+
+TEST_CASE("Dense tree depth first sort", "[memory]") {
+  SirMetal::DenseTree tree;
+  buildTestTree(tree);
+  tree.depthFirstSort();
+  REQUIRE(tree.isSorted());
+
+  const auto &nodes = tree.getNodes();
+  REQUIRE(nodes.size() == 7);
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    REQUIRE(nodes[i].id == i);
+    REQUIRE(nodes[i].index == i);
+  }
+  REQUIRE(tree.getRoot() == &nodes[0]);
+  REQUIRE(tree.getRoot()->parentIndex == SirMetal::DenseTreeNode::PARENT_NULL);
+
+  // links got patched to the new indices
+  const uint32_t expectedParents[7]{SirMetal::DenseTreeNode::PARENT_NULL,
+                                    0, 1, 1, 0, 0, 5};
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    REQUIRE(nodes[i].parentIndex == expectedParents[i]);
+    REQUIRE(tree.isDirectChild(nodes[0], nodes[i]) == (expectedParents[i] == 0));
+  }
+  REQUIRE(nodes[0].firstChild == 1);
+  REQUIRE(nodes[1].nextSibling == 4);
+  REQUIRE(nodes[4].nextSibling == 5);
+  REQUIRE(nodes[0].lastChild == 5);
+}
+
+TEST_CASE("Dense tree transform propagation", "[memory]") {
+  SirMetal::DenseTree tree;
+  tree.initialize();
+  tree.createRoot(0);
+
+  // deep chain plus a few siblings for every node, the transform is a
+  // simple offset so the world value of a node is the sum of the locals
+  // of its ancestors
+  const uint32_t depth = 1000;
+  uint32_t parent = 0;
+  for (uint32_t i = 0; i < depth; ++i) {
+    tree.createNode(tree.getNodes()[parent], 0);
+    const uint32_t chainNode = tree.getNodes().back().index;
+    tree.createNode(tree.getNodes()[parent], 0);
+    parent = chainNode;
+  }
+  tree.depthFirstSort();
+
+  const auto &nodes = tree.getNodes();
+  std::vector<float> local(nodes.size(), 1.0f);
+  std::vector<float> world(nodes.size(), 0.0f);
+  tree.propagateTransforms(local.data(), world.data(),
+                           [](float parentWorld, float childLocal) {
+                             return parentWorld + childLocal;
+                           });
+
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    float expected = 1.0f;
+    uint32_t current = nodes[i].parentIndex;
+    while (current != SirMetal::DenseTreeNode::PARENT_NULL) {
+      expected += 1.0f;
+      current = nodes[current].parentIndex;
+    }
+    REQUIRE(world[i] == expected);
+  }
+}
@@ -0,0 +1,172 @@
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+#include "SirMetal/core/memory/cpu/frameArena.h"
+#include "SirMetal/core/memory/cpu/resizableVector.h"
+#include "catch/catch.h"
+
+static bool isAligned(const void *ptr, const uintptr_t alignment) {
+  return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+}
+
+TEST_CASE("Frame arena aligned allocations", "[memory]") {
+  SirMetal::FrameArena arena(1 << 24);
+  void *first = arena.allocate(3);
+  REQUIRE(isAligned(first, SirMetal::FrameArena::DEFAULT_ALIGNMENT));
+  void *second = arena.allocate(5, 256);
+  REQUIRE(isAligned(second, 256));
+  void *third = arena.allocate(1, 4);
+  REQUIRE(static_cast<char *>(third) - static_cast<char *>(second) == 8);
+
+  struct alignas(64) Wide {
+    float values[16];
+  };
+  Wide *wide = arena.allocArray<Wide>(10);
+  REQUIRE(isAligned(wide, 64));
+  float *floats = arena.allocArray<float>(1000);
+  REQUIRE(isAligned(floats, 16));
+  REQUIRE(reinterpret_cast<char *>(floats) >= reinterpret_cast<char *>(wide + 10));
+  for (int i = 0; i < 1000; ++i) {
+    floats[i] = static_cast<float>(i);
+  }
+  REQUIRE(floats[999] == 999.0f);
+}
+
+TEST_CASE("Frame arena scopes", "[memory]") {
+  SirMetal::FrameArena arena(1 << 24);
+  arena.allocate(100);
+  const size_t outerUsed = arena.getUsedBytes();
+  {
+    SirMetal::FrameArenaScope outer(arena);
+    int *a = arena.allocArray<int>(1000);
+    size_t innerUsed;
+    {
+      SirMetal::FrameArenaScope inner(arena);
+      innerUsed = arena.getUsedBytes();
+      arena.allocArray<int>(1 << 20);
+      REQUIRE(arena.getUsedBytes() > innerUsed);
+    }
+    REQUIRE(arena.getUsedBytes() == innerUsed);
+    // memory is reused after the scope
+    int *b = arena.allocArray<int>(10);
+    REQUIRE(reinterpret_cast<char *>(b) >= reinterpret_cast<char *>(a + 1000));
+    REQUIRE(reinterpret_cast<char *>(b) - reinterpret_cast<char *>(a) < 4096);
+  }
+  REQUIRE(arena.getUsedBytes() == outerUsed);
+  REQUIRE(arena.getPeakUsedBytes() > (1 << 22));
+
+  arena.reset();
+  REQUIRE(arena.getUsedBytes() == 0);
+  // peak survives the reset
+  REQUIRE(arena.getPeakUsedBytes() > (1 << 22));
+}
+
+TEST_CASE("Frame arena falls back to the heap when full", "[memory]") {
+  SirMetal::FrameArena arena(1 << 16);
+  float *inArena = arena.allocArray<float>(1024);
+  REQUIRE(arena.getOverflowCount() == 0);
+  {
+    SirMetal::FrameArenaScope scope(arena);
+    // past the reserved range
+    float *big = arena.allocArray<float>(1 << 20);
+    REQUIRE(big != nullptr);
+    REQUIRE(isAligned(big, SirMetal::FrameArena::DEFAULT_ALIGNMENT));
+    REQUIRE(arena.getOverflowCount() == 1);
+    memset(big, 0, sizeof(float) * (1 << 20));
+    // what still fits keeps coming from the arena
+    float *small = arena.allocArray<float>(16);
+    REQUIRE(reinterpret_cast<char *>(small) >=
+            reinterpret_cast<char *>(inArena + 1024));
+    REQUIRE(reinterpret_cast<char *>(small) <
+            reinterpret_cast<char *>(inArena) + (1 << 16));
+  }
+  REQUIRE(arena.getOverflowCount() == 0);
+  arena.allocArray<float>(1 << 20);
+  arena.reset();
+  REQUIRE(arena.getOverflowCount() == 0);
+}
+
+TEST_CASE("Frame arena backs a vector", "[memory]") {
+  SirMetal::FrameArena arena(1 << 26);
+  SirMetal::FrameArenaScope scope(arena);
+  SirMetal::ResizableVector<uint32_t, SirMetal::FrameArena> vec(16, &arena);
+  uint32_t *start = vec.data();
+  for (uint32_t i = 0; i < 100000; ++i) {
+    vec.pushBack(i);
+  }
+  // last allocation in the arena, it always grows where it is
+  REQUIRE(vec.data() == start);
+  REQUIRE(vec[99999] == 99999);
+}
+
+TEST_CASE("Frame arena scope does not cut a vector grown in it", "[memory]") {
+  SirMetal::FrameArena arena(1 << 26);
+  SirMetal::ResizableVector<uint32_t, SirMetal::FrameArena> vec(16, &arena);
+  {
+    // the vector started before the scope, it is not the scope's memory
+    SirMetal::FrameArenaScope scope(arena);
+    for (uint32_t i = 0; i < 10000; ++i) {
+      vec.pushBack(i);
+    }
+  }
+  REQUIRE(arena.getUsedBytes() >= 10000 * sizeof(uint32_t));
+  uint32_t *after = arena.allocArray<uint32_t>(10000);
+  REQUIRE(reinterpret_cast<char *>(after) >=
+          reinterpret_cast<char *>(vec.data() + 10000));
+  memset(after, 0xff, 10000 * sizeof(uint32_t));
+  for (uint32_t i = 0; i < 10000; ++i) {
+    REQUIRE(vec[i] == i);
+  }
+}
+
+TEST_CASE("Frame arena per thread scratch", "[memory]") {
+  SirMetal::FrameArena &mainScratch = SirMetal::getThreadScratchArena();
+  REQUIRE(&mainScratch == &SirMetal::getThreadScratchArena());
+  const uint32_t startCount = SirMetal::getFrameArenasCount();
+
+  SirMetal::FrameArena *workerScratch[4]{};
+  std::thread workers[4];
+  std::atomic<uint32_t> ready{0};
+  std::atomic<bool> done{false};
+  for (int i = 0; i < 4; ++i) {
+    workers[i] = std::thread([&, i]() {
+      SirMetal::FrameArena &scratch = SirMetal::getThreadScratchArena();
+      workerScratch[i] = &scratch;
+      scratch.allocArray<float>(1024);
+      ready.fetch_add(1);
+      while (!done.load()) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  while (ready.load() != 4) {
+    std::this_thread::yield();
+  }
+
+  // every thread got its own arena
+  REQUIRE(SirMetal::getFrameArenasCount() == startCount + 4);
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(workerScratch[i] != &mainScratch);
+    REQUIRE(workerScratch[i]->getUsedBytes() >= 1024 * sizeof(float));
+    for (int j = i + 1; j < 4; ++j) {
+      REQUIRE(workerScratch[i] != workerScratch[j]);
+    }
+  }
+
+  // the workers are idle, as they would be at frame end
+  mainScratch.allocate(64);
+  SirMetal::resetFrameArenas();
+  REQUIRE(mainScratch.getUsedBytes() == 0);
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(workerScratch[i]->getUsedBytes() == 0);
+  }
+
+  done.store(true);
+  for (int i = 0; i < 4; ++i) {
+    workers[i].join();
+  }
+  // arenas go away with their threads
+  REQUIRE(SirMetal::getFrameArenasCount() == startCount);
+}
@@ -0,0 +1,170 @@
+#include "SirMetal/core/frameStats.h"
+#include "catch/catch.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+// frame times in nanoseconds, around 16ms with a long right tail like a real
+// run: most frames close to the target and a few slow ones
+std::vector<uint64_t> generateFrameTimes(const uint32_t count,
+                                         const uint32_t seed) {
+  std::mt19937 generator(seed);
+  std::lognormal_distribution<double> distribution(log(16.0e6), 0.25);
+  std::vector<uint64_t> values(count);
+  for (uint64_t &value : values) {
+    value = static_cast<uint64_t>(distribution(generator));
+  }
+  return values;
+}
+
+uint64_t exactQuantile(std::vector<uint64_t> sorted, const double quantile) {
+  std::sort(sorted.begin(), sorted.end());
+  auto rank = static_cast<size_t>(
+      ceil(quantile * static_cast<double>(sorted.size())));
+  rank = rank == 0 ? 1 : rank;
+  return sorted[rank - 1];
+}
+
+double relativeError(const double value, const double expected) {
+  return fabs(value - expected) / expected;
+}
+}  // namespace
+
+TEST_CASE("Log histogram buckets", "[frameStats]") {
+  using SirMetal::LogHistogram;
+  // small values are exact
+  for (uint64_t v = 0; v < LogHistogram::SUB_BUCKET_COUNT; ++v) {
+    const uint32_t index = LogHistogram::getBucketIndex(v);
+    REQUIRE(LogHistogram::getBucketLowestValue(index) == v);
+    REQUIRE(LogHistogram::getBucketHighestValue(index) == v);
+  }
+  // every value lands in a bucket containing it, with a bounded width
+  std::mt19937_64 generator(42);
+  for (int i = 0; i < 100000; ++i) {
+    const uint64_t v = generator() >> (generator() % 64);
+    const uint32_t index = LogHistogram::getBucketIndex(v);
+    REQUIRE(index < LogHistogram::BUCKET_COUNT);
+    const uint64_t lowest = LogHistogram::getBucketLowestValue(index);
+    const uint64_t highest = LogHistogram::getBucketHighestValue(index);
+    REQUIRE(lowest <= v);
+    REQUIRE(v <= highest);
+    REQUIRE(static_cast<double>(highest - lowest) <=
+            static_cast<double>(lowest) / LogHistogram::SUB_BUCKET_COUNT);
+  }
+  // buckets are contiguous up to the largest value
+  for (uint32_t i = 1; i < LogHistogram::BUCKET_COUNT; ++i) {
+    REQUIRE(LogHistogram::getBucketLowestValue(i) ==
+            LogHistogram::getBucketHighestValue(i - 1) + 1);
+  }
+  REQUIRE(LogHistogram::getBucketIndex(~0ull) == LogHistogram::BUCKET_COUNT - 1);
+  REQUIRE(LogHistogram::getBucketHighestValue(LogHistogram::BUCKET_COUNT - 1) ==
+          ~0ull);
+}
+
+TEST_CASE("Log histogram quantile accuracy", "[frameStats]") {
+  const std::vector<uint64_t> values = generateFrameTimes(100000, 7);
+  SirMetal::LogHistogram histogram;
+  for (uint64_t v : values) {
+    histogram.record(v);
+  }
+  REQUIRE(histogram.getCount() == values.size());
+  REQUIRE(histogram.getMin() == *std::min_element(values.begin(), values.end()));
+  REQUIRE(histogram.getMax() == *std::max_element(values.begin(), values.end()));
+
+  const double quantiles[] = {0.0, 0.1, 0.5, 0.9, 0.95, 0.99, 0.999, 1.0};
+  uint64_t batched[8];
+  histogram.getValuesAtQuantiles(quantiles, 8, batched);
+  for (int i = 0; i < 8; ++i) {
+    const auto expected =
+        static_cast<double>(exactQuantile(values, quantiles[i]));
+    const uint64_t value = histogram.getValueAtQuantile(quantiles[i]);
+    REQUIRE(value == batched[i]);
+    // half a bucket at most
+    REQUIRE(relativeError(static_cast<double>(value), expected) < 0.004);
+  }
+  REQUIRE(histogram.getValueAtQuantile(1.0) == histogram.getMax());
+
+  histogram.reset();
+  REQUIRE(histogram.getCount() == 0);
+  REQUIRE(histogram.getValueAtQuantile(0.5) == 0);
+}
+
+TEST_CASE("Streaming quantile accuracy", "[frameStats]") {
+  const std::vector<uint64_t> values = generateFrameTimes(100000, 11);
+  const double quantiles[] = {0.5, 0.95, 0.99, 0.999};
+  // the tail quantiles see few values around them, they get more slack
+  const double tolerances[] = {0.005, 0.005, 0.01, 0.02};
+  for (int i = 0; i < 4; ++i) {
+    SirMetal::StreamingQuantile sketch(quantiles[i]);
+    for (uint64_t v : values) {
+      sketch.record(static_cast<double>(v));
+    }
+    const auto expected =
+        static_cast<double>(exactQuantile(values, quantiles[i]));
+    REQUIRE(relativeError(sketch.getValue(), expected) < tolerances[i]);
+  }
+
+  // exact while it only has its first values
+  SirMetal::StreamingQuantile median(0.5);
+  REQUIRE(median.getValue() == 0.0);
+  median.record(3.0);
+  median.record(1.0);
+  median.record(2.0);
+  REQUIRE(median.getValue() == 2.0);
+}
+
+TEST_CASE("Frame stats hitches and reports", "[frameStats]") {
+  SirMetal::FrameStats stats;
+  stats.setHitchThreshold(40000000);
+  const std::vector<uint64_t> values = generateFrameTimes(10000, 3);
+  uint64_t expectedHitches = 0;
+  for (uint64_t v : values) {
+    stats.recordFrame(v);
+    expectedHitches += v > 40000000 ? 1 : 0;
+  }
+  // a few stalls well over twice the median
+  for (int i = 0; i < 5; ++i) {
+    stats.recordFrame(100000000);
+  }
+  expectedHitches += 5;
+
+  const SirMetal::FrameStatsSummary summary = stats.getSummary();
+  REQUIRE(summary.frameCount == values.size() + 5);
+  REQUIRE(summary.hitchCount == expectedHitches);
+  REQUIRE(summary.spikeCount >= 5);
+  REQUIRE(summary.maxNS == 100000000);
+  REQUIRE(summary.p50NS <= summary.p95NS);
+  REQUIRE(summary.p95NS <= summary.p99NS);
+  REQUIRE(summary.p99NS <= summary.p999NS);
+  REQUIRE(relativeError(stats.getEstimatedQuantile(0),
+                        static_cast<double>(summary.p50NS)) < 0.02);
+
+  // the recent window only has the last frames
+  const auto recent = stats.getRecentSamples();
+  REQUIRE(recent.count() == SirMetal::FrameStats::RECENT_SAMPLES);
+  const SirMetal::FrameStats::RecentWindow window = stats.getRecentWindow();
+  REQUIRE(window.maxMs == Approx(100.0f));
+  REQUIRE(window.minMs <= window.averageMs);
+  REQUIRE(window.averageMs <= window.maxMs);
+
+  const std::string json = SirMetal::frameStatsToJson(stats);
+  REQUIRE(json.find("\"frameCount\":10005,") != std::string::npos);
+  REQUIRE(json.find("\"hitchCount\":" + std::to_string(expectedHitches)) !=
+          std::string::npos);
+  REQUIRE(json.find("\"histogram\":[") != std::string::npos);
+  REQUIRE(json.substr(json.size() - 4) == "]\n}\n");
+
+  const std::string csv = SirMetal::frameStatsToCsv(stats);
+  REQUIRE(csv.find("lowestNS,highestNS,count,cumulativeFraction\n") == 0);
+  REQUIRE(csv.find(",1.000000\n") == csv.size() - 10);
+
+  stats.reset();
+  REQUIRE(stats.getSummary().frameCount == 0);
+  REQUIRE(stats.getHitchCount() == 0);
+  REQUIRE(stats.getRecentSamples().count() == 0);
+}
@@ -0,0 +1,253 @@
+#include "SirMetal/core/hashing/hashing.h"
+#include "SirMetal/core/memory/cpu/groupHashMap.h"
+#include "catch/catch.h"
+#include <iostream>
+
+using GroupMap32 = SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32,
+                                     SirMetal::HASH_MAP_PROBING::GROUP>;
+using GroupMap64 = SirMetal::HashMap<uint64_t, uint32_t, SirMetal::hashUint64,
+                                     SirMetal::HASH_MAP_PROBING::GROUP>;
+
+TEST_CASE("group hashmap insert ", "[memory]") {
+  GroupMap32 alloc(200);
+  alloc.insert(22, 1024);
+  alloc.insert(99, 2013);
+  alloc.insert(90238409, 21233);
+
+  uint32_t value;
+  REQUIRE(alloc.containsKey(22) == true);
+  REQUIRE(alloc.get(22, value) == true);
+  REQUIRE(value == 1024);
+  REQUIRE(alloc.containsKey(99) == true);
+  REQUIRE(alloc.get(99, value) == true);
+  REQUIRE(value == 2013);
+  REQUIRE(alloc.containsKey(90238409) == true);
+  REQUIRE(alloc.get(90238409, value) == true);
+  REQUIRE(value == 21233);
+  REQUIRE(alloc.getUsedBins() == 3);
+}
+
+TEST_CASE("group hashmap psudo random insert 1000", "[memory]") {
+  GroupMap32 alloc(2000);
+  std::vector<uint32_t> keys;
+  const int count = 1000;
+  keys.reserve(count);
+  std::vector<uint32_t> values;
+  values.reserve(count);
+
+  uint32_t checkValue = 0;
+  for (int i = 0; i < count; ++i) {
+    uint32_t k = rand();
+    uint32_t v = rand();
+    // to avoid duplicates
+    while (alloc.containsKey(k)) {
+      k = rand();
+      v = rand();
+    }
+    alloc.insert(k, v);
+    keys.push_back(k);
+    values.push_back(v);
+    REQUIRE(alloc.containsKey(k) == true);
+    REQUIRE(alloc.get(k, checkValue) == true);
+    REQUIRE(checkValue == v);
+  }
+
+  for (int i = 0; i < count; ++i) {
+
+    CHECKED_ELSE(alloc.containsKey(keys[i]) == true) {
+      std::cout << "failed on index " << i << " key values is: " << keys[i]
+                << std::endl;
+      FAIL();
+    };
+    REQUIRE(alloc.get(keys[i], checkValue) == true);
+    REQUIRE(checkValue == values[i]);
+  }
+
+  REQUIRE(alloc.getUsedBins() == count);
+}
+
+TEST_CASE("group hashmap psudo random insert 1500", "[memory]") {
+  GroupMap32 alloc(2000);
+  std::vector<uint32_t> keys;
+  const int count = 1500;
+  keys.reserve(count);
+  std::vector<uint32_t> values;
+  values.reserve(count);
+
+  uint32_t checkValue = 0;
+  for (int i = 0; i < count; ++i) {
+    uint32_t k = rand();
+    uint32_t v = rand();
+    // to avoid duplicates
+    while (alloc.containsKey(k)) {
+      k = rand();
+      v = rand();
+    }
+    alloc.insert(k, v);
+    keys.push_back(k);
+    values.push_back(v);
+    bool res = alloc.containsKey(k);
+    REQUIRE(res == true);
+    REQUIRE(alloc.get(k, checkValue) == true);
+    REQUIRE(checkValue == v);
+  }
+
+  for (int i = 0; i < count; ++i) {
+
+    CHECKED_ELSE(alloc.containsKey(keys[i]) == true) {
+      std::cout << "failed on index " << i << " key values is: " << keys[i]
+                << std::endl;
+      FAIL();
+    };
+    REQUIRE(alloc.get(keys[i], checkValue) == true);
+    REQUIRE(checkValue == values[i]);
+  }
+
+  REQUIRE(alloc.getUsedBins() == count);
+}
+
+TEST_CASE("group hashmap psudo random insert 1900", "[memory]") {
+  GroupMap32 alloc(2000);
+  std::vector<uint32_t> keys;
+  const int count = 1900;
+  keys.reserve(count);
+  std::vector<uint32_t> values;
+  values.reserve(count);
+
+  uint32_t checkValue = 0;
+  for (int i = 0; i < count; ++i) {
+    uint32_t k = rand();
+    uint32_t v = rand();
+    while (alloc.containsKey(k)) {
+      k = rand();
+      v = rand();
+    }
+    alloc.insert(k, v);
+    keys.push_back(k);
+    values.push_back(v);
+    REQUIRE(alloc.containsKey(k) == true);
+    REQUIRE(alloc.get(k, checkValue) == true);
+    REQUIRE(checkValue == v);
+  }
+
+  for (int i = 0; i < count; ++i) {
+
+    CHECKED_ELSE(alloc.containsKey(keys[i]) == true) {
+      std::cout << "failed on index " << i << " key values is: " << keys[i]
+                << std::endl;
+      FAIL();
+    };
+    REQUIRE(alloc.get(keys[i], checkValue) == true);
+    REQUIRE(checkValue == values[i]);
+  }
+
+  REQUIRE(alloc.getUsedBins() == count);
+}
+
+TEST_CASE("group hashmap remove key", "[memory]") {
+
+  GroupMap32 alloc(200);
+  alloc.insert(22, 1024);
+  alloc.insert(99, 2013);
+  alloc.insert(90238409, 21233);
+
+  REQUIRE(alloc.getUsedBins() == 3);
+  REQUIRE(alloc.remove(99) == true);
+  REQUIRE(alloc.containsKey(99) == false);
+  REQUIRE(alloc.getUsedBins() == 2);
+  REQUIRE(alloc.remove(22) == true);
+  REQUIRE(alloc.containsKey(22) == false);
+  REQUIRE(alloc.getUsedBins() == 1);
+  REQUIRE(alloc.remove(90238409) == true);
+  REQUIRE(alloc.containsKey(90238409) == false);
+  REQUIRE(alloc.getUsedBins() == 0);
+}
+
+TEST_CASE("group hashmap empty 1000", "[memory]") {
+  GroupMap64 alloc(200);
+  const int count = 1000;
+  uint32_t value;
+  for (int i = 0; i < count; ++i) {
+    uint32_t k = rand();
+    REQUIRE(alloc.containsKey(k) == false);
+    REQUIRE(alloc.get(k,value) == false);
+  }
+}
+
+TEST_CASE("group hashmap empty 2000", "[memory]") {
+  GroupMap64 alloc(4600);
+  const int count = 1000;
+  uint32_t value;
+  for (int i = 0; i < count; ++i) {
+    uint32_t k = rand();
+    REQUIRE(alloc.containsKey(k) == false);
+    REQUIRE(alloc.get(k,value) == false);
+  }
+}
+
+TEST_CASE("group hashmap bin count power of two", "[memory]") {
+  GroupMap32 alloc(2000);
+  REQUIRE(alloc.binCount() == 2048);
+  GroupMap32 alloc2(3);
+  REQUIRE(alloc2.binCount() == 16);
+}
+
+TEST_CASE("group hashmap override value", "[memory]") {
+  GroupMap32 alloc(200);
+  alloc.insert(22, 1024);
+  alloc.insert(22, 99);
+  uint32_t value;
+  REQUIRE(alloc.get(22, value) == true);
+  REQUIRE(value == 99);
+  REQUIRE(alloc.getUsedBins() == 1);
+}
+
+TEST_CASE("group hashmap full", "[memory]") {
+  GroupMap32 alloc(16);
+  for (uint32_t i = 0; i < 16; ++i) {
+    REQUIRE(alloc.insert(i, i * 2) == true);
+  }
+  REQUIRE(alloc.insert(9999, 1) == false);
+  REQUIRE(alloc.containsKey(9999) == false);
+  uint32_t value;
+  for (uint32_t i = 0; i < 16; ++i) {
+    REQUIRE(alloc.get(i, value) == true);
+    REQUIRE(value == i * 2);
+  }
+  // freeing a bin makes room for a new key
+  REQUIRE(alloc.remove(3) == true);
+  REQUIRE(alloc.insert(9999, 1) == true);
+  REQUIRE(alloc.get(9999, value) == true);
+  REQUIRE(value == 1);
+  REQUIRE(alloc.containsKey(3) == false);
+}
+
+TEST_CASE("group hashmap remove and reinsert churn", "[memory]") {
+  GroupMap32 alloc(1024);
+  std::vector<uint32_t> keys;
+  const int count = 900;
+  for (int i = 0; i < count; ++i) {
+    keys.push_back(static_cast<uint32_t>(i * 7919 + 13));
+    REQUIRE(alloc.insert(keys[i], i) == true);
+  }
+  // removing every other key and re-inserting it multiple times, this
+  // exercises the probing over deleted bins
+  for (int round = 0; round < 4; ++round) {
+    for (int i = round % 2; i < count; i += 2) {
+      REQUIRE(alloc.remove(keys[i]) == true);
+    }
+    for (int i = round % 2; i < count; i += 2) {
+      REQUIRE(alloc.insert(keys[i], i + round) == true);
+    }
+  }
+  REQUIRE(alloc.getUsedBins() == count);
+  uint32_t value;
+  for (int i = 0; i < count; ++i) {
+    REQUIRE(alloc.get(keys[i], value) == true);
+  }
+  uint32_t usedBins = 0;
+  for (uint32_t i = 0; i < alloc.binCount(); ++i) {
+    usedBins += alloc.isBinUsed(i) ? 1 : 0;
+  }
+  REQUIRE(usedBins == count);
+}
@@ -0,0 +1,87 @@
+#include "SirMetal/core/hashing/hashing.h"
+#include "SirMetal/core/memory/cpu/hashMap.h"
+#include "catch/catch.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// run with: tests "[!benchmark]"
+namespace {
+
+using HandleMap = SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32>;
+
+// builds a query set of the given size where hitRate percent of the keys are
+// in the map
+std::vector<uint32_t> buildQueries(const uint32_t keyCount,
+                                   const uint32_t queryCount,
+                                   const uint32_t hitRate) {
+  std::vector<uint32_t> queries(queryCount);
+  for (uint32_t i = 0; i < queryCount; ++i) {
+    const bool hit = static_cast<uint32_t>(rand() % 100) < hitRate;
+    const uint32_t k = static_cast<uint32_t>(rand()) % keyCount;
+    // keys in the map are even, misses are odd
+    queries[i] = hit ? k * 2 : k * 2 + 1;
+  }
+  return queries;
+}
+
+} // namespace
+
+TEST_CASE("hashmap batch get vs scalar", "[!benchmark]") {
+  const uint32_t tableSizes[] = {1 << 10, 1 << 16, 1 << 20};
+  const uint32_t hitRates[] = {100, 50, 0};
+  const uint32_t queryCount = 1 << 14;
+
+  for (uint32_t keyCount : tableSizes) {
+    HandleMap map(keyCount * 2);
+    for (uint32_t i = 0; i < keyCount; ++i) {
+      map.insert(i * 2, i);
+    }
+    std::vector<uint32_t> out(queryCount);
+    // vector<bool> is packed, getBatch wants a real bool array
+    std::unique_ptr<bool[]> found(new bool[queryCount]());
+
+    for (uint32_t hitRate : hitRates) {
+      const std::vector<uint32_t> queries =
+          buildQueries(keyCount, queryCount, hitRate);
+      const std::string suffix = " keys:" + std::to_string(keyCount) +
+                                 " hit:" + std::to_string(hitRate) + "%";
+
+      BENCHMARK("scalar" + suffix) {
+        uint32_t hits = 0;
+        for (uint32_t i = 0; i < queryCount; ++i) {
+          hits += map.get(queries[i], out[i]) ? 1 : 0;
+        }
+        return hits;
+      };
+      BENCHMARK("batch" + suffix) {
+        map.getBatch(queries.data(), out.data(), found.get(), queryCount);
+        return found[0];
+      };
+    }
+  }
+}
+
+TEST_CASE("hashmap batch insert vs scalar", "[!benchmark]") {
+  const uint32_t tableSizes[] = {1 << 10, 1 << 16, 1 << 20};
+  for (uint32_t keyCount : tableSizes) {
+    std::vector<uint32_t> keys(keyCount);
+    for (uint32_t i = 0; i < keyCount; ++i) {
+      keys[i] = static_cast<uint32_t>(rand());
+    }
+    const std::string suffix = " keys:" + std::to_string(keyCount);
+
+    BENCHMARK("scalar insert" + suffix) {
+      HandleMap map(keyCount * 2);
+      for (uint32_t i = 0; i < keyCount; ++i) {
+        map.insert(keys[i], i);
+      }
+      return map.getUsedBins();
+    };
+    BENCHMARK("batch insert" + suffix) {
+      HandleMap map(keyCount * 2);
+      map.insertBatch(keys.data(), keys.data(), keyCount);
+      return map.getUsedBins();
+    };
+  }
+}
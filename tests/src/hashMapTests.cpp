@@ -179,3 +179,210 @@ TEST_CASE("hashmap empty 2000", "[memory]") {
     REQUIRE(alloc.get(k,value) == false);
   }
 }
+
+TEST_CASE("hashmap lookup past deleted bin", "[memory]") {
+  // all keys land in the same cluster, removing the first must not hide the
+  // ones inserted after it
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(
+      16, SirMetal::HASH_MAP_GROWTH::NONE);
+  for (uint32_t i = 0; i < 12; ++i) {
+    REQUIRE(alloc.insert(i, i + 100) == true);
+  }
+  for (uint32_t i = 0; i < 12; i += 3) {
+    REQUIRE(alloc.remove(i) == true);
+  }
+  uint32_t value;
+  for (uint32_t i = 0; i < 12; ++i) {
+    bool expected = (i % 3) != 0;
+    REQUIRE(alloc.containsKey(i) == expected);
+    REQUIRE(alloc.get(i, value) == expected);
+    if (expected) {
+      REQUIRE(value == i + 100);
+    }
+  }
+  // re-inserting an existing key must not create a duplicate
+  REQUIRE(alloc.insert(11, 5) == true);
+  REQUIRE(alloc.getUsedBins() == 8);
+  REQUIRE(alloc.remove(11) == true);
+  REQUIRE(alloc.containsKey(11) == false);
+}
+
+TEST_CASE("hashmap no growth full", "[memory]") {
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(
+      32, SirMetal::HASH_MAP_GROWTH::NONE);
+  for (uint32_t i = 0; i < 32; ++i) {
+    REQUIRE(alloc.insert(i, i) == true);
+  }
+  REQUIRE(alloc.insert(1000, 1) == false);
+  REQUIRE(alloc.binCount() == 32);
+  REQUIRE(alloc.getRehashCount() == 0);
+}
+
+TEST_CASE("hashmap rehash grow", "[memory]") {
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(16);
+  const uint32_t count = 5000;
+  for (uint32_t i = 0; i < count; ++i) {
+    REQUIRE(alloc.insert(i * 31 + 7, i) == true);
+  }
+  REQUIRE(alloc.getUsedBins() == count);
+  REQUIRE(alloc.getRehashCount() > 0);
+  REQUIRE(alloc.getLoadFactor() <= SirMetal::HashMap<uint32_t, uint32_t,
+              SirMetal::hashUint32>::DEFAULT_MAX_LOAD_FACTOR);
+  uint32_t value;
+  for (uint32_t i = 0; i < count; ++i) {
+    REQUIRE(alloc.get(i * 31 + 7, value) == true);
+    REQUIRE(value == i);
+  }
+}
+
+TEST_CASE("hashmap rehash grows a table too small for its first key",
+          "[memory]") {
+  // a single bin is past the max load with one key, with no tombstones to
+  // drop the table has to double instead of being rebuilt at the same size
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(1);
+  REQUIRE(alloc.insert(7, 70) == true);
+  REQUIRE(alloc.binCount() == 2);
+  REQUIRE(alloc.insert(8, 80) == true);
+  uint32_t value;
+  REQUIRE(alloc.get(7, value) == true);
+  REQUIRE(value == 70);
+  REQUIRE(alloc.get(8, value) == true);
+  REQUIRE(value == 80);
+}
+
+TEST_CASE("hashmap rehash drops tombstones", "[memory]") {
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(1024);
+  // keeping around 300 live keys while churning through many more, the table
+  // should never need to grow and tombstones should stay bounded
+  uint32_t next = 0;
+  for (; next < 300; ++next) {
+    alloc.insert(next, next);
+  }
+  for (uint32_t i = 0; i < 20000; ++i, ++next) {
+    REQUIRE(alloc.remove(next - 300) == true);
+    REQUIRE(alloc.insert(next, next) == true);
+    REQUIRE(alloc.getTombstoneCount() + alloc.getUsedBins() <=
+            alloc.binCount() * 3 / 4);
+  }
+  REQUIRE(alloc.binCount() == 1024);
+  REQUIRE(alloc.getUsedBins() == 300);
+  uint32_t value;
+  for (uint32_t i = next - 300; i < next; ++i) {
+    REQUIRE(alloc.get(i, value) == true);
+    REQUIRE(value == i);
+  }
+  alloc.rehash(1024);
+  REQUIRE(alloc.getTombstoneCount() == 0);
+  REQUIRE(alloc.getUsedBins() == 300);
+}
+
+TEST_CASE("hashmap incremental rehash", "[memory]") {
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(
+      64, SirMetal::HASH_MAP_GROWTH::INCREMENTAL);
+  const uint32_t count = 20000;
+  bool sawMigration = false;
+  uint32_t value;
+  for (uint32_t i = 0; i < count; ++i) {
+    REQUIRE(alloc.insert(i, i * 2) == true);
+    sawMigration |= alloc.isMigrating();
+    // every so often removing and checking keys while a migration might be in
+    // flight, keys must be reachable from either table
+    if ((i % 7) == 0) {
+      REQUIRE(alloc.remove(i / 2) == true);
+      REQUIRE(alloc.containsKey(i / 2) == false);
+      REQUIRE(alloc.insert(i / 2, i) == true);
+      REQUIRE(alloc.get(i / 2, value) == true);
+      REQUIRE(value == i);
+    }
+    REQUIRE(alloc.get(i, value) == true);
+  }
+  REQUIRE(sawMigration == true);
+  REQUIRE(alloc.getUsedBins() == count);
+  alloc.finishMigration();
+  REQUIRE(alloc.isMigrating() == false);
+  uint32_t usedBins = 0;
+  for (uint32_t i = 0; i < alloc.binCount(); ++i) {
+    usedBins += alloc.isBinUsed(i) ? 1 : 0;
+  }
+  REQUIRE(usedBins == count);
+}
+
+// keys land in consecutive bins, which makes the bins the migration moved a
+// single run of tombstones
+inline uint32_t identityHash(const uint32_t &value) { return value; }
+
+TEST_CASE("hashmap incremental remove while migrating", "[memory]") {
+  SirMetal::HashMap<uint32_t, uint32_t, identityHash> alloc(
+      1024, SirMetal::HASH_MAP_GROWTH::INCREMENTAL);
+  uint32_t next = 0;
+  while (!alloc.isMigrating()) {
+    REQUIRE(alloc.insert(next, next) == true);
+    ++next;
+  }
+  // one more insert migrates some bins, which leaves tombstones in the old
+  // table
+  REQUIRE(alloc.insert(next, next) == true);
+  ++next;
+  REQUIRE(alloc.isMigrating() == true);
+  // removing from the top frees the tombstones behind each removed key, the
+  // count must go back down without wrapping
+  for (uint32_t i = next; i > 0; --i) {
+    REQUIRE(alloc.remove(i - 1) == true);
+    REQUIRE(alloc.getTombstoneCount() <= alloc.binCount() + 1024);
+  }
+  REQUIRE(alloc.getUsedBins() == 0);
+  alloc.finishMigration();
+  REQUIRE(alloc.getTombstoneCount() <= alloc.binCount());
+}
+
+TEST_CASE("hashmap probe length histogram", "[memory]") {
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(4096);
+  const uint32_t count = 2000;
+  for (uint32_t i = 0; i < count; ++i) {
+    alloc.insert(i, i);
+  }
+  uint32_t histogram[8];
+  alloc.getProbeLengthHistogram(histogram, 8);
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < 8; ++i) {
+    total += histogram[i];
+  }
+  REQUIRE(total == count);
+  // at less than 50% load most keys should sit in their home bin
+  REQUIRE(histogram[0] > count / 2);
+}
+
+TEST_CASE("hashmap batch insert and get", "[memory]") {
+  SirMetal::HashMap<uint32_t, uint32_t, SirMetal::hashUint32> alloc(64);
+  const uint32_t count = 1000;
+  std::vector<uint32_t> keys(count);
+  std::vector<uint32_t> values(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    keys[i] = i * 13 + 1;
+    values[i] = i;
+  }
+  REQUIRE(alloc.insertBatch(keys.data(), values.data(), count) == true);
+  REQUIRE(alloc.getUsedBins() == count);
+
+  // querying every key plus as many misses, the count is not a multiple of
+  // the batch size on purpose
+  const uint32_t queryCount = count * 2 + 3;
+  std::vector<uint32_t> queries(queryCount);
+  for (uint32_t i = 0; i < queryCount; ++i) {
+    queries[i] = i < count ? keys[i] : (i * 13 + 2);
+  }
+  std::vector<uint32_t> out(queryCount, 0);
+  bool found[queryCount];
+  alloc.getBatch(queries.data(), out.data(), found, queryCount);
+  for (uint32_t i = 0; i < queryCount; ++i) {
+    uint32_t value;
+    REQUIRE(found[i] == alloc.get(queries[i], value));
+    if (found[i]) {
+      REQUIRE(out[i] == value);
+    }
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    REQUIRE(found[i] == true);
+    REQUIRE(out[i] == values[i]);
+  }
+}
@@ -0,0 +1,90 @@
+#include "SirMetal/core/hashing/hashing.h"
+#include "catch/catch.h"
+#include <string>
+#include <vector>
+
+using namespace SirMetal::literals;
+
+// not exposed in farmhash.h, this is the portable variant the constexpr hash
+// is ported from
+namespace farmhashmk {
+uint32_t Hash32(const char *s, size_t len);
+}
+
+namespace {
+constexpr uint32_t GBUFFER_ID = "gbuffer"_sid;
+constexpr SirMetal::HashedString LONG_NAME =
+    SirMetal::hashedString("a much longer shader name, longer than 24 chars");
+static_assert(GBUFFER_ID == SirMetal::hashedString("gbuffer").hash,
+              "literal and hashedString must agree");
+static_assert(LONG_NAME.length == 47, "length computed at compile time");
+
+std::vector<std::string> buildCorpus() {
+  std::vector<std::string> corpus = {"",
+                                     "a",
+                                     "gbuffer",
+                                     "POSITION",
+                                     "NORMAL",
+                                     "TEXCOORD_0",
+                                     "TANGENT",
+                                     "LIGHT_MAP_UPV",
+                                     "jumpFlood",
+                                     "jumpOutline",
+                                     "exactly twelve",
+                                     "thirteen chars",
+                                     "twenty four characters!!",
+                                     "twenty five characters!!!"};
+  // every length up to 200 with pseudo random content, including negative
+  // chars which farmhash sign extends for short strings
+  for (int len = 0; len < 200; ++len) {
+    std::string s(len, ' ');
+    for (int i = 0; i < len; ++i) {
+      s[i] = static_cast<char>(rand() % 256);
+    }
+    corpus.push_back(s);
+  }
+  return corpus;
+}
+} // namespace
+
+TEST_CASE("constexpr hash matches farmhash", "[hashing]") {
+  const std::vector<std::string> corpus = buildCorpus();
+  for (const std::string &s : corpus) {
+    const uint32_t expected = farmhashmk::Hash32(s.data(), s.size());
+    REQUIRE(SirMetal::hashing::farmhash32(s.data(), s.size()) == expected);
+  }
+}
+
+TEST_CASE("hashed strings match farmhash", "[hashing]") {
+  const std::vector<std::string> corpus = buildCorpus();
+  for (const std::string &s : corpus) {
+    // hashString32 stops at the first null, skip strings containing one
+    if (s.find('\0') != std::string::npos) {
+      continue;
+    }
+    const uint32_t expected = farmhashmk::Hash32(s.data(), s.size());
+    const SirMetal::HashedString hashed = SirMetal::hashedString(s.c_str());
+    REQUIRE(hashed.length == s.size());
+    REQUIRE(hashed.hash == expected);
+    REQUIRE(SirMetal::hashString32(s.c_str()) == expected);
+  }
+
+  // known values, in case the reference and the port both change
+  REQUIRE(SirMetal::hashedString("").hash == 0xdc56d17au);
+  REQUIRE(SirMetal::hashedString("a").hash == 0x3c973d4du);
+  REQUIRE(SirMetal::hashedString("gbuffer").hash == 0x59e1e741u);
+  REQUIRE(SirMetal::hashedString("POSITION").hash == 0x327c7ea4u);
+  REQUIRE(SirMetal::hashedString("hello world").hash == 0x19a7581au);
+}
+
+TEST_CASE("string id literals", "[hashing]") {
+  // copies are built at runtime, the literals are folded at compile time
+  const std::string gbuffer = "gbuffer";
+  const std::string position = "POSITION";
+  const std::string longName =
+      "a much longer shader name, longer than 24 chars";
+  REQUIRE(GBUFFER_ID == SirMetal::hashString32(gbuffer.c_str()));
+  REQUIRE("POSITION"_sid == SirMetal::hashString32(position.c_str()));
+  REQUIRE(LONG_NAME.hash == SirMetal::hashString32(longName.c_str()));
+  REQUIRE(""_sid == SirMetal::hashString32(""));
+}
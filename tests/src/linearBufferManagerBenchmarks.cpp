@@ -0,0 +1,161 @@
+#include "SirMetal/core/memory/cpu/linearBufferManager.h"
+#include "catch/catch.h"
+#include <string>
+#include <vector>
+
+// run with: tests "[!benchmark]"
+namespace {
+
+// the tracker as it was before the size classes, free ranges in a list
+// searched first fit, never split nor merged, alignment ignored on reuse
+class FirstFitTracker {
+public:
+  explicit FirstFitTracker(const uint64_t size) : m_bufferSize(size) {}
+
+  uint32_t allocate(const uint64_t size, const uint32_t alignment) {
+    for (uint32_t i = 0; i < m_free.size(); ++i) {
+      if (size <= m_free[i].actualSize) {
+        const uint32_t slot = m_free[i].slot;
+        m_ranges[slot] = m_free[i];
+        m_free[i] = m_free.back();
+        m_free.pop_back();
+        return slot;
+      }
+    }
+    const uint64_t aligned =
+        (m_stackPointer + alignment - 1) / alignment * alignment;
+    if (aligned + size > m_bufferSize) {
+      return INVALID;
+    }
+    m_stackPointer = aligned + size;
+    m_ranges.push_back(Range{aligned, size, static_cast<uint32_t>(m_ranges.size())});
+    return m_ranges.back().slot;
+  }
+  void free(const uint32_t slot) { m_free.push_back(m_ranges[slot]); }
+  uint64_t getStackPointer() const { return m_stackPointer; }
+
+  static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+private:
+  struct Range {
+    uint64_t offset;
+    uint64_t actualSize;
+    uint32_t slot;
+  };
+  uint64_t m_bufferSize;
+  uint64_t m_stackPointer = 0;
+  std::vector<Range> m_ranges;
+  std::vector<Range> m_free;
+};
+
+struct Operation {
+  uint32_t size;  // 0 means free
+  uint32_t alignment;
+  uint32_t liveIndex;
+};
+
+// constant buffer like traffic, mostly small per object buffers and some big
+// per pass ones, a window of live allocations with random ones freed
+std::vector<Operation> buildChurnTrace(const uint32_t operationCount,
+                                       const uint32_t maxLive) {
+  std::vector<Operation> trace;
+  uint32_t live = 0;
+  uint32_t seed = 1;
+  for (uint32_t i = 0; i < operationCount; ++i) {
+    seed = seed * 1103515245 + 12345;
+    const uint32_t random = seed >> 8;
+    if ((live < maxLive / 2) | ((live < maxLive) & ((random & 3) != 0))) {
+      const bool isBig = (random % 16) == 0;
+      const uint32_t size = isBig ? 4096 + (random % 60000)
+                                  : 16 + (random % 1008);
+      trace.push_back(Operation{size, 1u << (4 + (random >> 20) % 5), live++});
+    } else {
+      trace.push_back(Operation{0, 0, (random >> 4) % live});
+      --live;
+    }
+  }
+  return trace;
+}
+
+template <typename ALLOC, typename FREE>
+uint32_t replay(const std::vector<Operation> &trace, ALLOC allocFn,
+                FREE freeFn) {
+  std::vector<uint32_t> live;
+  uint32_t failed = 0;
+  for (const Operation &op : trace) {
+    if (op.size != 0) {
+      const uint32_t handle = allocFn(op.size, op.alignment);
+      if (handle == FirstFitTracker::INVALID) {
+        ++failed;
+        // keeping the trace in sync, a failed allocation still takes a place
+        live.push_back(FirstFitTracker::INVALID);
+      } else {
+        live.push_back(handle);
+      }
+    } else {
+      if (live[op.liveIndex] != FirstFitTracker::INVALID) {
+        freeFn(live[op.liveIndex]);
+      }
+      live[op.liveIndex] = live.back();
+      live.pop_back();
+    }
+  }
+  return failed;
+}
+
+} // namespace
+
+TEST_CASE("linear buffer manager churn trace", "[!benchmark]") {
+  const uint64_t bufferSize = 64ull << 20;
+  const uint32_t liveCounts[] = {256, 4096, 32768};
+  for (uint32_t maxLive : liveCounts) {
+    const std::vector<Operation> trace = buildChurnTrace(200000, maxLive);
+    const std::string suffix = " live:" + std::to_string(maxLive);
+
+    auto runFirstFit = [&trace, bufferSize](uint64_t &stackPointer) {
+      FirstFitTracker tracker(bufferSize);
+      const uint32_t failed = replay(
+          trace,
+          [&tracker](uint64_t size, uint32_t alignment) {
+            return tracker.allocate(size, alignment);
+          },
+          [&tracker](uint32_t slot) { tracker.free(slot); });
+      stackPointer = tracker.getStackPointer();
+      return failed;
+    };
+    auto runSizeClasses = [&trace, bufferSize](uint64_t &stackPointer) {
+      SirMetal::LinearBufferManager manager(bufferSize);
+      const uint32_t failed = replay(
+          trace,
+          [&manager](uint64_t size, uint32_t alignment) {
+            auto handle = manager.allocate(size, alignment);
+            return handle.isHandleValid() ? handle.handle
+                                          : FirstFitTracker::INVALID;
+          },
+          [&manager](uint32_t handle) {
+            manager.free(SirMetal::BufferRangeHandle{handle});
+          });
+      stackPointer = manager.getStackPointer();
+      return failed;
+    };
+
+    // how much of the buffer each one needed for the same trace
+    uint64_t firstFitStack;
+    uint64_t sizeClassesStack;
+    const uint32_t firstFitFailed = runFirstFit(firstFitStack);
+    const uint32_t sizeClassesFailed = runSizeClasses(sizeClassesStack);
+    WARN("live:" << maxLive << " first fit used " << firstFitStack
+                 << " bytes, failed " << firstFitFailed
+                 << " allocations. size classes used " << sizeClassesStack
+                 << " bytes, failed " << sizeClassesFailed);
+
+    BENCHMARK("first fit" + suffix) {
+      uint64_t stackPointer;
+      return runFirstFit(stackPointer);
+    };
+    BENCHMARK("size classes" + suffix) {
+      uint64_t stackPointer;
+      return runSizeClasses(stackPointer);
+    };
+  }
+}
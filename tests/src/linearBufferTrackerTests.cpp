@@ -1,6 +1,8 @@
 #include "SirMetal/core/memory/cpu/linearBufferManager.h"
 #include "SirMetal/core/core.h"
 #include "catch/catch.h"
+#include <algorithm>
+#include <vector>
 
 TEST_CASE("linear buffer manager basic alloc", "[memory]") {
   SirMetal::LinearBufferManager alloc(2 * SirMetal::MB_TO_BYTE);
@@ -114,3 +116,169 @@ TEST_CASE("linear buffer manager basic alloc aligned", "[memory]") {
   REQUIRE(range.m_offset == 320);
   REQUIRE(range.m_size == 256);
 }
+
+TEST_CASE("linear buffer manager split", "[memory]") {
+  SirMetal::LinearBufferManager alloc(2 * SirMetal::MB_TO_BYTE);
+  auto big = alloc.allocate(4096, 1);
+  auto guard = alloc.allocate(64, 1);
+  alloc.free(big);
+
+  // a small request does not waste the big block, the rest is split off
+  auto small = alloc.allocate(16, 1);
+  REQUIRE(alloc.getBufferRange(small).m_offset == 0);
+  REQUIRE(alloc.getFreeAllocationsCount() == 1);
+  REQUIRE(alloc.getFreeBlocksBytes() == 4096 - 16);
+  auto other = alloc.allocate(1000, 1);
+  REQUIRE(alloc.getBufferRange(other).m_offset == 16);
+  REQUIRE(alloc.getStackPointer() == 4096 + 64);
+  (void)guard;
+}
+
+TEST_CASE("linear buffer manager coalesce", "[memory]") {
+  SirMetal::LinearBufferManager alloc(2 * SirMetal::MB_TO_BYTE);
+  auto a = alloc.allocate(100, 1);
+  auto b = alloc.allocate(200, 1);
+  auto c = alloc.allocate(300, 1);
+  auto guard = alloc.allocate(64, 1);
+  alloc.free(a);
+  alloc.free(c);
+  REQUIRE(alloc.getFreeAllocationsCount() == 2);
+  // b merges with both neighbours
+  alloc.free(b);
+  REQUIRE(alloc.getFreeAllocationsCount() == 1);
+  REQUIRE(alloc.getFreeBlocksBytes() == 600);
+
+  auto merged = alloc.allocate(600, 1);
+  REQUIRE(alloc.getBufferRange(merged).m_offset == 0);
+  REQUIRE(alloc.getFreeAllocationsCount() == 0);
+  (void)guard;
+}
+
+TEST_CASE("linear buffer manager best fit", "[memory]") {
+  SirMetal::LinearBufferManager alloc(2 * SirMetal::MB_TO_BYTE);
+  auto large = alloc.allocate(1024, 1);
+  auto guard1 = alloc.allocate(16, 1);
+  auto medium = alloc.allocate(300, 1);
+  auto guard2 = alloc.allocate(16, 1);
+  auto fit = alloc.allocate(260, 1);
+  auto guard3 = alloc.allocate(16, 1);
+  const uint64_t fitOffset = alloc.getBufferRange(fit).m_offset;
+  const uint64_t mediumOffset = alloc.getBufferRange(medium).m_offset;
+  alloc.free(large);
+  alloc.free(medium);
+  alloc.free(fit);
+
+  // 260 is the tightest, then 300
+  auto handle = alloc.allocate(256, 1);
+  REQUIRE(alloc.getBufferRange(handle).m_offset == fitOffset);
+  handle = alloc.allocate(256, 1);
+  REQUIRE(alloc.getBufferRange(handle).m_offset == mediumOffset);
+  handle = alloc.allocate(256, 1);
+  REQUIRE(alloc.getBufferRange(handle).m_offset == 0);
+  (void)guard1;
+  (void)guard2;
+  (void)guard3;
+}
+
+TEST_CASE("linear buffer manager alignment on reuse", "[memory]") {
+  SirMetal::LinearBufferManager alloc(2 * SirMetal::MB_TO_BYTE);
+  auto first = alloc.allocate(13, 1);
+  auto freed = alloc.allocate(1000, 1);
+  auto guard = alloc.allocate(16, 1);
+  alloc.free(freed);
+
+  // the free block starts at 13, the padding in front is split off
+  auto aligned = alloc.allocate(256, 256);
+  auto range = alloc.getBufferRange(aligned);
+  REQUIRE(range.m_offset == 256);
+  REQUIRE(range.m_size == 256);
+  REQUIRE(alloc.getFreeAllocationsCount() == 2);
+
+  // does not fit in what is left once aligned, goes on the stack
+  auto tooAligned = alloc.allocate(512, 512);
+  REQUIRE(alloc.getBufferRange(tooAligned).m_offset == 1536);
+  (void)first;
+  (void)guard;
+}
+
+TEST_CASE("linear buffer manager many allocations", "[memory]") {
+  const uint32_t count = 100000;
+  SirMetal::LinearBufferManager alloc(count * 16);
+  std::vector<SirMetal::BufferRangeHandle> handles(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    handles[i] = alloc.allocate(16, 16);
+    REQUIRE(handles[i].isHandleValid());
+  }
+  REQUIRE(alloc.getAllocationsCount() == count);
+  bool allMatch = true;
+  for (uint32_t i = 0; i < count; ++i) {
+    allMatch &= alloc.getBufferRange(handles[i]).m_offset == i * 16;
+  }
+  REQUIRE(allMatch);
+  REQUIRE(!alloc.allocate(16, 1).isHandleValid());
+
+  // every other first, so there is something to merge with
+  for (uint32_t i = 0; i < count; i += 2) {
+    alloc.free(handles[i]);
+  }
+  REQUIRE(alloc.getFreeAllocationsCount() == count / 2);
+  for (uint32_t i = 1; i < count; i += 2) {
+    alloc.free(handles[i]);
+  }
+  REQUIRE(alloc.getFreeAllocationsCount() == 1);
+  REQUIRE(alloc.getAllocationsCount() == 0);
+
+  // slots are reused with a new magic number
+  auto handle = alloc.allocate(16, 1);
+  REQUIRE(handle.handle != handles[count - 1].handle);
+  REQUIRE((handle.handle & 0xFFFFF) == (handles[count - 1].handle & 0xFFFFF));
+}
+
+TEST_CASE("linear buffer manager churn", "[memory]") {
+  SirMetal::LinearBufferManager alloc(SirMetal::MB_TO_BYTE);
+  std::vector<SirMetal::BufferRangeHandle> live;
+  std::vector<uint32_t> alignments;
+  srand(7);
+  for (uint32_t i = 0; i < 20000; ++i) {
+    if (live.empty() || (rand() % 5 < 3)) {
+      const uint32_t alignment = 1u << (rand() % 9);
+      auto handle = alloc.allocate(1 + rand() % 2000, alignment);
+      if (handle.isHandleValid()) {
+        live.push_back(handle);
+        alignments.push_back(alignment);
+      }
+    } else {
+      const uint32_t index = rand() % live.size();
+      alloc.free(live[index]);
+      live[index] = live.back();
+      alignments[index] = alignments.back();
+      live.pop_back();
+      alignments.pop_back();
+    }
+  }
+  REQUIRE(alloc.getAllocationsCount() == live.size());
+
+  // live ranges are aligned and never overlap
+  std::vector<std::pair<uint64_t, uint64_t>> ranges;
+  bool allAligned = true;
+  for (uint32_t i = 0; i < live.size(); ++i) {
+    auto range = alloc.getBufferRange(live[i]);
+    allAligned &= range.m_offset % alignments[i] == 0;
+    ranges.emplace_back(range.m_offset, range.m_offset + range.m_size);
+  }
+  REQUIRE(allAligned);
+  std::sort(ranges.begin(), ranges.end());
+  bool noOverlap = true;
+  for (uint32_t i = 1; i < ranges.size(); ++i) {
+    noOverlap &= ranges[i - 1].second <= ranges[i].first;
+  }
+  REQUIRE(noOverlap);
+  REQUIRE(ranges.back().second <= alloc.getStackPointer());
+
+  // freeing everything merges back to a single block
+  for (auto handle : live) {
+    alloc.free(handle);
+  }
+  REQUIRE(alloc.getFreeAllocationsCount() == 1);
+  REQUIRE(alloc.getFreeBlocksBytes() == alloc.getStackPointer());
+}
@@ -0,0 +1,142 @@
+#include "SirMetal/io/mappedFile.h"
+#include "SirMetal/resources/meshes/objparser.h"
+#include "catch/catch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+// big enough to not fit any cache, bump it to a few GB for soak numbers. The
+// file is read once before the benchmarks, so every run sees a warm page cache
+constexpr uint64_t OBJ_SIZE = 512ull << 20;
+const char *OBJ_PATH = "./mappedFileBenchmark.obj";
+
+void writeObj(const char *path, const uint64_t size) {
+  FILE *file = fopen(path, "wb");
+  REQUIRE(file != nullptr);
+  char line[128];
+  uint64_t written = 0;
+  uint32_t vertex = 0;
+  while (written < size) {
+    int length;
+    if ((vertex % 4) != 3) {
+      length = snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvn 0 1 0\n",
+                        vertex * 0.001f, vertex * 0.002f, -vertex * 0.003f);
+    } else {
+      length = snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u\n",
+                        vertex - 2, vertex - 2, vertex - 1, vertex - 1, vertex,
+                        vertex);
+    }
+    fwrite(line, 1, length, file);
+    written += length;
+    ++vertex;
+  }
+  fclose(file);
+}
+
+uint64_t checksum(const char *data, const uint64_t size) {
+  // one byte per cache line is enough to touch every page
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < size; i += 64) {
+    sum += static_cast<unsigned char>(data[i]);
+  }
+  return sum;
+}
+
+// what StringPool::loadFilePersistent used to do
+uint64_t loadWithFread(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  fseek(fp, 0L, SEEK_END);
+  const long fileSize = ftell(fp);
+  rewind(fp);
+  char *buffer = static_cast<char *>(malloc(fileSize + 1));
+  fread(buffer, fileSize, 1, fp);
+  buffer[fileSize] = '\0';
+  fclose(fp);
+  const uint64_t sum = checksum(buffer, fileSize);
+  free(buffer);
+  return sum;
+}
+
+// what getJsonObj used to do
+uint64_t loadWithStream(const char *path) {
+  std::ifstream st(path);
+  std::stringstream sBuffer;
+  sBuffer << st.rdbuf();
+  const std::string content = sBuffer.str();
+  return checksum(content.data(), content.size());
+}
+
+// what objParseFile used to do, the file streamed through a 64KB buffer
+bool objParseFileBuffered(ObjFile &result, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return false;
+  static char buffer[65536];
+  size_t size = 0;
+  while (!feof(file)) {
+    size += fread(buffer + size, 1, sizeof(buffer) - size, file);
+    size_t line = 0;
+    while (line < size) {
+      void *eol = memchr(buffer + line, '\n', size - line);
+      if (!eol) break;
+      size_t next = static_cast<char *>(eol) - buffer;
+      buffer[next] = 0;
+      objParseLine(result, buffer + line);
+      line = next + 1;
+    }
+    memmove(buffer, buffer + line, size - line);
+    size -= line;
+  }
+  if (size) {
+    buffer[size] = 0;
+    objParseLine(result, buffer);
+  }
+  fclose(file);
+  return true;
+}
+}  // namespace
+
+// run with: tests "[!benchmark]"
+TEST_CASE("mapped file loading", "[!benchmark]") {
+  writeObj(OBJ_PATH, OBJ_SIZE);
+  const uint64_t expected = loadWithFread(OBJ_PATH);
+  const std::string suffix =
+      " " + std::to_string(OBJ_SIZE >> 20) + "MB";
+
+  BENCHMARK("fread copy" + suffix) { return loadWithFread(OBJ_PATH); };
+  BENCHMARK("ifstream stringstream" + suffix) {
+    return loadWithStream(OBJ_PATH);
+  };
+  BENCHMARK("mapped" + suffix) {
+    const SirMetal::MappedFile file = SirMetal::MappedFile::open(OBJ_PATH);
+    return checksum(file.data(), file.size());
+  };
+  REQUIRE(loadWithStream(OBJ_PATH) == expected);
+
+  BENCHMARK("obj parse buffered" + suffix) {
+    ObjFile file;
+    objParseFileBuffered(file, OBJ_PATH);
+    return file.f_size;
+  };
+  BENCHMARK("obj parse mapped" + suffix) {
+    ObjFile file;
+    objParseFile(file, OBJ_PATH);
+    return file.f_size;
+  };
+
+  // both paths build the same mesh
+  ObjFile buffered;
+  ObjFile mapped;
+  objParseFileBuffered(buffered, OBJ_PATH);
+  objParseFile(mapped, OBJ_PATH);
+  REQUIRE(buffered.v_size == mapped.v_size);
+  REQUIRE(buffered.f_size == mapped.f_size);
+  REQUIRE(memcmp(buffered.v, mapped.v, sizeof(float) * mapped.v_size) == 0);
+  REQUIRE(memcmp(buffered.f, mapped.f, sizeof(int) * mapped.f_size) == 0);
+  remove(OBJ_PATH);
+}
@@ -0,0 +1,113 @@
+#include "SirMetal/core/memory/cpu/stringPool.h"
+#include "SirMetal/io/mappedFile.h"
+#include "SirMetal/resources/meshes/objparser.h"
+#include "catch/catch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+void writeFile(const char *path, const char *content) {
+  FILE *file = fopen(path, "wb");
+  REQUIRE(file != nullptr);
+  fwrite(content, 1, strlen(content), file);
+  fclose(file);
+}
+}  // namespace
+
+TEST_CASE("Mapped file content", "[io]") {
+  const char *fileContent = "just testing the switches of yours.";
+  SirMetal::MappedFile file =
+      SirMetal::MappedFile::open("./testData/fileLoad1.txt");
+  REQUIRE(file.isValid());
+  REQUIRE(file.getReferenceCount() == 1);
+  REQUIRE(file.size() == strlen(fileContent));
+  REQUIRE(memcmp(file.data(), fileContent, file.size()) == 0);
+  const SirMetal::MappedFile::Span span = file.getSpan();
+  REQUIRE(span.data == file.data());
+  REQUIRE(span.size == file.size());
+  file.advise(4, 10, SirMetal::MAPPED_FILE_HINT_RANDOM);
+
+  SirMetal::MappedFile missing =
+      SirMetal::MappedFile::open("./testData/notThere.txt");
+  REQUIRE(!missing.isValid());
+  REQUIRE(missing.data() == nullptr);
+  REQUIRE(missing.size() == 0);
+  REQUIRE(missing.getReferenceCount() == 0);
+
+  const char *emptyPath = "./testData/mappedEmpty.txt";
+  writeFile(emptyPath, "");
+  {
+    SirMetal::MappedFile empty = SirMetal::MappedFile::open(emptyPath);
+    REQUIRE(empty.isValid());
+    REQUIRE(empty.size() == 0);
+  }
+  remove(emptyPath);
+}
+
+TEST_CASE("Mapped file shared lifetime", "[io]") {
+  SirMetal::MappedFile file =
+      SirMetal::MappedFile::open("./testData/fileLoad1.txt");
+  const char *data = file.data();
+  {
+    SirMetal::MappedFile copy = file;
+    REQUIRE(copy.data() == data);
+    REQUIRE(file.getReferenceCount() == 2);
+    SirMetal::MappedFile assigned;
+    assigned = copy;
+    REQUIRE(file.getReferenceCount() == 3);
+    SirMetal::MappedFile moved = std::move(assigned);
+    REQUIRE(!assigned.isValid());
+    REQUIRE(file.getReferenceCount() == 3);
+  }
+  REQUIRE(file.getReferenceCount() == 1);
+
+  // the mapping outlives the first owner
+  SirMetal::MappedFile keeper = file;
+  file.close();
+  REQUIRE(!file.isValid());
+  REQUIRE(keeper.getReferenceCount() == 1);
+  REQUIRE(memcmp(keeper.data(), "just testing", 12) == 0);
+}
+
+TEST_CASE("String pool file load missing file", "[memory]") {
+  SirMetal::StringPool alloc(2 << 16);
+  uint32_t fileSize = 0;
+  REQUIRE(alloc.loadFilePersistent("./testData/notThere.txt", fileSize) ==
+          nullptr);
+}
+
+TEST_CASE("Obj parse from mapped file", "[io]") {
+  // the last line has no new line, usemtl needs a terminated copy
+  const char *path = "./testData/mappedMesh.obj";
+  writeFile(path,
+            "# comment\n"
+            "v 0 0 0\n"
+            "v 1.5 0 -2e1\n"
+            "vt 0.5 1\n"
+            "vn 0 1 0\n"
+            "usemtl stone\n"
+            "f 1/1/1 2/1/1 3/1/1 4/1/1\n"
+            "v 0 1 0");
+  ObjFile file;
+  REQUIRE(objParseFile(file, path));
+  remove(path);
+
+  REQUIRE(file.v_size == 9);
+  REQUIRE(file.v[3] == 1.5f);
+  REQUIRE(file.v[5] == -20.0f);
+  REQUIRE(file.v[7] == 1.0f);
+  REQUIRE(file.vt_size == 3);
+  REQUIRE(file.vt[1] == 1.0f);
+  REQUIRE(file.vt[2] == 0.0f);
+  REQUIRE(file.vn_size == 3);
+  // the quad is split in two triangles
+  REQUIRE(file.f_size == 18);
+  REQUIRE(file.f[9 + 6] == 3);
+  REQUIRE(file.g_size == 1);
+  REQUIRE(strcmp(file.g[0].material, "stone") == 0);
+  REQUIRE(file.g[0].index_count == 6);
+
+  ObjFile missing;
+  REQUIRE(!objParseFile(missing, "./testData/notThere.obj"));
+}
@@ -56,3 +56,54 @@ TEST_CASE("MemoryPool mixed deletion and addition", "[memory]") {
     REQUIRE(idx == indices[5 - i - 1]);
   }
 }
+
+TEST_CASE("MemoryPool growth keeps indices stable", "[memory]") {
+
+  SirMetal::SparseMemoryPool<DummyAlloc> pool(16);
+  REQUIRE(pool.getPoolSize() == 0);
+  DummyAlloc *pointers[100];
+  for (uint32_t i = 0; i < 100; ++i) {
+    uint32_t idx;
+    DummyAlloc &data = pool.getFreeMemoryData(idx);
+    REQUIRE(idx == i);
+    REQUIRE(data.value == 0xBADDCAFE);
+    data.value2 = i;
+    pointers[i] = &data;
+  }
+  REQUIRE(pool.getChunkCount() == 7);
+  REQUIRE(pool.getPoolSize() == 7 * 16);
+  REQUIRE(pool.getAllocatedCount() == 100);
+
+  // growing never moved the data
+  for (uint32_t i = 0; i < 100; ++i) {
+    REQUIRE(&pool[i] == pointers[i]);
+    REQUIRE(pool.getConstRef(i).value2 == i);
+  }
+}
+
+TEST_CASE("MemoryPool clear", "[memory]") {
+
+  SirMetal::SparseMemoryPool<DummyAlloc> pool(20);
+  REQUIRE(pool.getChunkSize() == 32);
+  for (uint32_t i = 0; i < 40; ++i) {
+    uint32_t idx;
+    pool.getFreeMemoryData(idx);
+  }
+  pool.free(5);
+  pool.free(33);
+  REQUIRE(pool.getHighWaterMark() == 40);
+
+  pool.clear();
+  REQUIRE(pool.getAllocatedCount() == 0);
+  REQUIRE(pool.getHighWaterMark() == 0);
+  // chunks are kept around
+  REQUIRE(pool.getPoolSize() == 64);
+
+  // the freed slots are forgotten, allocation starts from scratch
+  for (uint32_t i = 0; i < 64; ++i) {
+    uint32_t idx;
+    pool.getFreeMemoryData(idx);
+    REQUIRE(idx == i);
+  }
+  REQUIRE(pool.getChunkCount() == 2);
+}
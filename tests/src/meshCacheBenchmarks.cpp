@@ -0,0 +1,69 @@
+#include "SirMetal/resources/meshes/meshCache.h"
+#include "SirMetal/resources/meshes/objparser.h"
+#include "catch/catch.h"
+
+#include <stdio.h>
+
+#include <string>
+
+namespace {
+// a few million vertices, bump it for bigger scenes
+constexpr uint32_t VERTEX_COUNT = 2u << 20;
+const char *OBJ_PATH = "./meshCacheBenchmark.obj";
+const char *CACHE_PATH = "./meshCacheBenchmark.smesh";
+
+// the obj and a mesh of the same size as the loader would build from it,
+// positions, normals and uvs as float4, float4 and float2
+void writeSources() {
+  FILE *file = fopen(OBJ_PATH, "wb");
+  REQUIRE(file != nullptr);
+  SirMetal::MeshLoadResult mesh;
+  mesh.vertices.reserve(VERTEX_COUNT * 10);
+  mesh.indices.reserve(VERTEX_COUNT);
+  for (uint32_t v = 0; v < VERTEX_COUNT; ++v) {
+    const float x = v * 0.001f;
+    fprintf(file, "v %.6f %.6f %.6f\nvt %.4f %.4f\nvn 0 1 0\n", x, x * 2.0f,
+            -x, (v % 100) * 0.01f, (v % 7) * 0.1f);
+    if ((v % 3) == 2) {
+      fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", v - 1, v - 1, v - 1, v,
+              v, v, v + 1, v + 1, v + 1);
+    }
+    mesh.vertices.insert(mesh.vertices.end(),
+                         {x, x * 2.0f, -x, 1, 0, 1, 0, 0, 0.5f, 0.5f});
+    mesh.indices.push_back(v);
+  }
+  fclose(file);
+  REQUIRE(SirMetal::writeMeshCache(CACHE_PATH, mesh, 1));
+}
+
+float touch(const float *data, const uint64_t count) {
+  // one float per cache line is enough to read every page
+  float sum = 0;
+  for (uint64_t i = 0; i < count; i += 16) {
+    sum += data[i];
+  }
+  return sum;
+}
+}  // namespace
+
+// run with: tests "[!benchmark]"
+TEST_CASE("mesh cache loading", "[!benchmark]") {
+  writeSources();
+  const std::string suffix = " " + std::to_string(VERTEX_COUNT >> 20) + "M";
+
+  // only the parse, the optimization and the merge the cache also skips are
+  // not in here
+  BENCHMARK("obj parse" + suffix) {
+    ObjFile file;
+    objParseFileParallel(file, OBJ_PATH);
+    return file.f_size;
+  };
+  BENCHMARK("cache read" + suffix) {
+    SirMetal::MeshCacheView view;
+    SirMetal::readMeshCache(CACHE_PATH, 1, view);
+    return touch(view.vertices, view.vertexCount) +
+           static_cast<float>(view.indices[view.indexCount - 1]);
+  };
+  remove(OBJ_PATH);
+  remove(CACHE_PATH);
+}
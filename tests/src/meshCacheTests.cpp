@@ -0,0 +1,134 @@
+#include "SirMetal/resources/meshes/meshCache.h"
+#include "catch/catch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+SirMetal::MeshLoadResult makeMesh() {
+  SirMetal::MeshLoadResult mesh;
+  for (uint32_t i = 0; i < 1124; ++i) {
+    mesh.vertices.push_back(static_cast<float>(i) * 0.5f);
+  }
+  for (uint32_t i = 0; i < 333; ++i) {
+    mesh.indices.push_back(i * 3 % 250);
+  }
+  mesh.ranges[0] = {0, 1600};
+  mesh.ranges[1] = {1792, 1600};
+  mesh.ranges[4] = {3584, 400};
+  mesh.clusterRanges[0] = {4096, 32};
+  mesh.clusterRanges[1] = {4352, 64};
+  mesh.clusterRanges[2] = {4416, 12};
+  mesh.clusterRanges[3] = {4428, 64};
+  mesh.meshletCount = 2;
+  for (int i = 0; i < 6; ++i) {
+    mesh.m_boundingBox[i] = static_cast<float>(i) - 3.0f;
+  }
+  mesh.name = "cachedMesh";
+  return mesh;
+}
+
+void corrupt(const char *path, const long offset, const uint32_t value) {
+  FILE *file = fopen(path, "r+b");
+  REQUIRE(file != nullptr);
+  fseek(file, offset, SEEK_SET);
+  fwrite(&value, sizeof(value), 1, file);
+  fclose(file);
+}
+}  // namespace
+
+TEST_CASE("Mesh cache round trip", "[io]") {
+  const SirMetal::MeshLoadResult mesh = makeMesh();
+  const char source[] = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  const uint64_t hash = SirMetal::hashMeshSource(source, sizeof(source),
+                                                 SirMetal::MESH_CACHE_SEED_OBJ);
+  const std::string path = SirMetal::getMeshCachePath("./testData", hash);
+  REQUIRE(path.size() == strlen("./testData/") + 16 + 6);
+  REQUIRE(SirMetal::writeMeshCache(path.c_str(), mesh, hash));
+
+  {
+    SirMetal::MeshCacheView view;
+    REQUIRE(SirMetal::readMeshCache(path.c_str(), hash, view));
+    REQUIRE(view.file.isValid());
+    // the data is used in place, straight from the mapping
+    REQUIRE(reinterpret_cast<const char *>(view.vertices) >= view.file.data());
+    REQUIRE(reinterpret_cast<uintptr_t>(view.vertices) %
+                SirMetal::MESH_CACHE_ALIGNMENT ==
+            0);
+    REQUIRE(reinterpret_cast<uintptr_t>(view.indices) %
+                SirMetal::MESH_CACHE_ALIGNMENT ==
+            0);
+    REQUIRE(view.vertexCount == mesh.vertices.size());
+    REQUIRE(memcmp(view.vertices, mesh.vertices.data(),
+                   mesh.vertices.size() * sizeof(float)) == 0);
+    REQUIRE(view.indexCount == mesh.indices.size());
+    REQUIRE(memcmp(view.indices, mesh.indices.data(),
+                   mesh.indices.size() * sizeof(uint32_t)) == 0);
+    REQUIRE(memcmp(view.ranges, mesh.ranges, sizeof(mesh.ranges)) == 0);
+    REQUIRE(memcmp(view.clusterRanges, mesh.clusterRanges,
+                   sizeof(mesh.clusterRanges)) == 0);
+    REQUIRE(view.meshletCount == mesh.meshletCount);
+    REQUIRE(memcmp(view.boundingBox, mesh.m_boundingBox,
+                   sizeof(mesh.m_boundingBox)) == 0);
+    REQUIRE(std::string(view.name, view.nameLength) == mesh.name);
+  }
+
+  // any change in the source or in the options gives a new key
+  const char changed[] = "v 0 0 0\nv 1 0 0\nv 0 2 0\nf 1 2 3\n";
+  const uint64_t changedHash = SirMetal::hashMeshSource(
+      changed, sizeof(changed), SirMetal::MESH_CACHE_SEED_OBJ);
+  REQUIRE(changedHash != hash);
+  REQUIRE(SirMetal::hashMeshSource(source, sizeof(source),
+                                   SirMetal::MESH_CACHE_SEED_GLTF) != hash);
+  REQUIRE(SirMetal::getMeshCachePath("./testData", changedHash) != path);
+  SirMetal::MeshCacheView stale;
+  REQUIRE(!SirMetal::readMeshCache(path.c_str(), changedHash, stale));
+  REQUIRE(!stale.file.isValid());
+  remove(path.c_str());
+}
+
+TEST_CASE("Mesh cache rejects bad files", "[io]") {
+  const SirMetal::MeshLoadResult mesh = makeMesh();
+  const uint64_t hash = 42;
+  const char *path = "./testData/badMesh.smesh";
+  SirMetal::MeshCacheView view;
+  REQUIRE(!SirMetal::readMeshCache("./testData/notThere.smesh", hash, view));
+
+  // written by another version
+  REQUIRE(SirMetal::writeMeshCache(path, mesh, hash));
+  corrupt(path, offsetof(SirMetal::MeshCacheHeader, version),
+          SirMetal::MESH_CACHE_VERSION + 1);
+  REQUIRE(!SirMetal::readMeshCache(path, hash, view));
+
+  // not a mesh cache at all
+  REQUIRE(SirMetal::writeMeshCache(path, mesh, hash));
+  corrupt(path, offsetof(SirMetal::MeshCacheHeader, magic), 0);
+  REQUIRE(!SirMetal::readMeshCache(path, hash, view));
+
+  // sections past the end of the file
+  REQUIRE(SirMetal::writeMeshCache(path, mesh, hash));
+  corrupt(path, offsetof(SirMetal::MeshCacheHeader, indexCount), 1u << 30);
+  REQUIRE(!SirMetal::readMeshCache(path, hash, view));
+
+  // more meshlets than the cluster ranges hold
+  REQUIRE(SirMetal::writeMeshCache(path, mesh, hash));
+  corrupt(path, offsetof(SirMetal::MeshCacheHeader, meshletCount), 3);
+  REQUIRE(!SirMetal::readMeshCache(path, hash, view));
+
+  // truncated
+  FILE *file = fopen(path, "wb");
+  REQUIRE(file != nullptr);
+  fwrite("SMSH", 1, 4, file);
+  fclose(file);
+  REQUIRE(!SirMetal::readMeshCache(path, hash, view));
+  REQUIRE(!view.file.isValid());
+
+  // an empty mesh is still a valid cache
+  SirMetal::MeshLoadResult empty;
+  REQUIRE(SirMetal::writeMeshCache(path, empty, hash));
+  REQUIRE(SirMetal::readMeshCache(path, hash, view));
+  REQUIRE(view.vertexCount == 0);
+  REQUIRE(view.indexCount == 0);
+  REQUIRE(view.nameLength == 0);
+  remove(path);
+}
@@ -0,0 +1,163 @@
+#include "SirMetal/core/memory/cpu/frameArena.h"
+#include "SirMetal/graphics/clusterCulling.h"
+#include "SirMetal/resources/meshes/meshOptimize.h"
+#include "catch/catch.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace {
+// a grid of quads in the xy plane facing +z, merged as the loaders do
+SirMetal::MeshLoadResult makeGrid(const uint32_t quads) {
+  const uint32_t side = quads + 1;
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> uvs;
+  std::vector<float> tangents;
+  for (uint32_t y = 0; y < side; ++y) {
+    for (uint32_t x = 0; x < side; ++x) {
+      positions.insert(positions.end(), {float(x), float(y), 0.0f, 1.0f});
+      normals.insert(normals.end(), {0.0f, 0.0f, 1.0f, 0.0f});
+      uvs.insert(uvs.end(), {float(x) / side, float(y) / side});
+      tangents.insert(tangents.end(), {1.0f, 0.0f, 0.0f, 0.0f});
+    }
+  }
+  SirMetal::MeshLoadResult mesh;
+  for (uint32_t y = 0; y < quads; ++y) {
+    for (uint32_t x = 0; x < quads; ++x) {
+      const uint32_t v = y * side + x;
+      mesh.indices.insert(mesh.indices.end(),
+                          {v, v + 1, v + side + 1, v, v + side + 1, v + side});
+    }
+  }
+  const uint64_t vertexCount = side * side;
+  SirMetal::MeshAttribute attributes[4] = {{positions.data(), vertexCount * 4},
+                                           {normals.data(), vertexCount * 4},
+                                           {uvs.data(), vertexCount * 2},
+                                           {tangents.data(), vertexCount * 4}};
+  float strides[4]{4, 4, 2, 4};
+  SirMetal::mergeRawMeshBuffers(attributes, strides, 4, mesh.vertices,
+                                mesh.ranges);
+  return mesh;
+}
+
+template <typename T>
+const T *getSection(const SirMetal::MeshLoadResult &mesh,
+                    const SirMetal::MemoryRange &range) {
+  return reinterpret_cast<const T *>(
+      reinterpret_cast<const char *>(mesh.vertices.data()) + range.m_offset);
+}
+
+// same winding, starting from the smallest index
+std::array<uint32_t, 3> canonical(const uint32_t a, const uint32_t b,
+                                  const uint32_t c) {
+  if ((a < b) & (a < c)) return {a, b, c};
+  if (b < c) return {b, c, a};
+  return {c, a, b};
+}
+}  // namespace
+
+TEST_CASE("Meshlets cover the mesh", "[meshlets]") {
+  SirMetal::MeshLoadResult mesh = makeGrid(40);
+  const SirMetal::MeshLoadResult source = mesh;
+  SirMetal::buildMeshlets(mesh, SirMetal::getThreadScratchArena());
+  REQUIRE(mesh.meshletCount > 1);
+
+  // appended after the attributes, which are untouched
+  const SirMetal::MemoryRange &tangents =
+      mesh.ranges[SirMetal::MESH_ATTRIBUTE_TYPE_TANGENT];
+  REQUIRE(memcmp(mesh.vertices.data(), source.vertices.data(),
+                 source.vertices.size() * sizeof(float)) == 0);
+  REQUIRE(mesh.indices == source.indices);
+  uint64_t previousEnd = tangents.m_offset + tangents.m_size;
+  for (const SirMetal::MemoryRange &range : mesh.clusterRanges) {
+    REQUIRE(range.m_offset % 256 == 0);
+    REQUIRE(range.m_offset >= previousEnd);
+    previousEnd = range.m_offset + range.m_size;
+  }
+  REQUIRE(previousEnd == mesh.vertices.size() * sizeof(float));
+
+  const auto *meshlets = getSection<SirMetal::Meshlet>(
+      mesh, mesh.clusterRanges[SirMetal::MESH_CLUSTER_DATA_TYPE_MESHLETS]);
+  const auto *meshletVertices = getSection<uint32_t>(
+      mesh, mesh.clusterRanges[SirMetal::MESH_CLUSTER_DATA_TYPE_VERTICES]);
+  const auto *meshletTriangles = getSection<uint8_t>(
+      mesh, mesh.clusterRanges[SirMetal::MESH_CLUSTER_DATA_TYPE_TRIANGLES]);
+  const auto *bounds = getSection<SirMetal::MeshletBounds>(
+      mesh, mesh.clusterRanges[SirMetal::MESH_CLUSTER_DATA_TYPE_BOUNDS]);
+  const auto *positions = getSection<float>(
+      mesh, mesh.ranges[SirMetal::MESH_ATTRIBUTE_TYPE_POSITION]);
+  REQUIRE(
+      mesh.clusterRanges[SirMetal::MESH_CLUSTER_DATA_TYPE_MESHLETS].m_size ==
+      mesh.meshletCount * sizeof(SirMetal::Meshlet));
+  REQUIRE(mesh.clusterRanges[SirMetal::MESH_CLUSTER_DATA_TYPE_BOUNDS].m_size ==
+          mesh.meshletCount * sizeof(SirMetal::MeshletBounds));
+
+  // every triangle ends up in exactly one meshlet, with its winding, and
+  // every meshlet is inside its sphere
+  std::vector<std::array<uint32_t, 3>> expected;
+  for (size_t i = 0; i < source.indices.size(); i += 3) {
+    expected.push_back(canonical(source.indices[i], source.indices[i + 1],
+                                 source.indices[i + 2]));
+  }
+  std::vector<std::array<uint32_t, 3>> found;
+  for (uint32_t m = 0; m < mesh.meshletCount; ++m) {
+    const SirMetal::Meshlet &meshlet = meshlets[m];
+    REQUIRE(meshlet.vertexCount <= SirMetal::MESHLET_MAX_VERTICES);
+    REQUIRE(meshlet.triangleCount <= SirMetal::MESHLET_MAX_TRIANGLES);
+    REQUIRE(meshlet.triangleOffset % 4 == 0);
+    const uint32_t *vertices = meshletVertices + meshlet.vertexOffset;
+    const uint8_t *triangles = meshletTriangles + meshlet.triangleOffset;
+    for (uint32_t t = 0; t < meshlet.triangleCount; ++t) {
+      REQUIRE(triangles[t * 3 + 0] < meshlet.vertexCount);
+      REQUIRE(triangles[t * 3 + 1] < meshlet.vertexCount);
+      REQUIRE(triangles[t * 3 + 2] < meshlet.vertexCount);
+      found.push_back(canonical(vertices[triangles[t * 3 + 0]],
+                                vertices[triangles[t * 3 + 1]],
+                                vertices[triangles[t * 3 + 2]]));
+    }
+    const SirMetal::MeshletBounds &meshletBounds = bounds[m];
+    for (uint32_t v = 0; v < meshlet.vertexCount; ++v) {
+      const float *position = positions + vertices[v] * 4;
+      const float dx = position[0] - meshletBounds.center[0];
+      const float dy = position[1] - meshletBounds.center[1];
+      const float dz = position[2] - meshletBounds.center[2];
+      REQUIRE(sqrtf(dx * dx + dy * dy + dz * dz) <=
+              meshletBounds.radius * 1.001f + 1e-4f);
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+  std::sort(found.begin(), found.end());
+  REQUIRE(found == expected);
+
+  // flat and facing +z, every meshlet is back facing from below and none
+  // from above, the planes are wide open to only test the cones
+  SirMetal::ClusterCullingView view{};
+  for (float *plane : view.planes) {
+    plane[3] = 1.0f;
+  }
+  std::vector<uint32_t> visible(mesh.meshletCount);
+  view.cameraPosition[0] = 20.0f;
+  view.cameraPosition[1] = 20.0f;
+  view.cameraPosition[2] = -30.0f;
+  REQUIRE(SirMetal::cullMeshlets(meshlets, bounds, mesh.meshletCount, view,
+                                 visible.data()) == 0);
+  view.cameraPosition[2] = 30.0f;
+  REQUIRE(SirMetal::cullMeshlets(meshlets, bounds, mesh.meshletCount, view,
+                                 visible.data()) == mesh.meshletCount);
+}
+
+TEST_CASE("Meshlets of an empty mesh", "[meshlets]") {
+  SirMetal::MeshLoadResult mesh = makeGrid(0);
+  const size_t size = mesh.vertices.size();
+  SirMetal::buildMeshlets(mesh, SirMetal::getThreadScratchArena());
+  REQUIRE(mesh.meshletCount == 0);
+  REQUIRE(mesh.vertices.size() == size);
+  for (const SirMetal::MemoryRange &range : mesh.clusterRanges) {
+    REQUIRE(range.m_size == 0);
+  }
+}
@@ -0,0 +1,88 @@
+#include "SirMetal/io/numberParsing.h"
+#include "catch/catch.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+namespace {
+// enough numbers to be out of the caches, written like obj vertices
+constexpr uint32_t NUMBER_COUNT = 4u << 20;
+
+std::string makeFloats(const char *format) {
+  std::string text;
+  char buffer[32];
+  for (uint32_t i = 0; i < NUMBER_COUNT; ++i) {
+    snprintf(buffer, sizeof(buffer), format,
+             (i * 7919 % 200000) * 0.0137f - 1000.0f);
+    text += buffer;
+  }
+  return text;
+}
+
+// what the obj parser used, the digits accumulated in a double, not exactly
+// rounded
+float parseFloatDouble(const char *s, const char **end) {
+  static const double powers[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  while (*s == ' ' || *s == '\t') s++;
+  const double sign = (*s == '-') ? -1 : 1;
+  s += (*s == '-' || *s == '+');
+  double result = 0;
+  int power = 0;
+  while (unsigned(*s - '0') < 10) {
+    result = result * 10 + (*s - '0');
+    s++;
+  }
+  if (*s == '.') {
+    s++;
+    while (unsigned(*s - '0') < 10) {
+      result = result * 10 + (*s - '0');
+      s++;
+      power--;
+    }
+  }
+  if ((*s | ' ') == 'e') {
+    s++;
+    const int exponentSign = (*s == '-') ? -1 : 1;
+    s += (*s == '-' || *s == '+');
+    int exponent = 0;
+    while (unsigned(*s - '0') < 10) {
+      exponent = exponent * 10 + (*s - '0');
+      s++;
+    }
+    power += exponentSign * exponent;
+  }
+  *end = s;
+  if (unsigned(-power) < 23) return float(sign * result / powers[-power]);
+  if (unsigned(power) < 23) return float(sign * result * powers[power]);
+  return float(sign * result * pow(10.0, power));
+}
+
+template <typename F> float parseAll(const std::string &text, const F &parse) {
+  float sum = 0;
+  const char *s = text.c_str();
+  for (uint32_t i = 0; i < NUMBER_COUNT; ++i) {
+    sum += parse(s, &s);
+  }
+  return sum;
+}
+}  // namespace
+
+// run with: tests "[!benchmark]"
+TEST_CASE("number parsing", "[!benchmark]") {
+  const std::string suffix = " " + std::to_string(NUMBER_COUNT >> 20) + "M";
+  for (const char *format : {"%.6f ", "%.9g "}) {
+    const std::string floats = makeFloats(format);
+    const std::string name = std::string(format, strlen(format) - 1) + suffix;
+    BENCHMARK("double accumulation " + name) {
+      return parseAll(floats, parseFloatDouble);
+    };
+    BENCHMARK("exact " + name) {
+      return parseAll(floats, SirMetal::parseFloat);
+    };
+  }
+}
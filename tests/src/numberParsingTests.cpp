@@ -0,0 +1,136 @@
+#include "SirMetal/io/numberParsing.h"
+#include "catch/catch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+
+namespace {
+uint32_t floatBits(const float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(float));
+  return bits;
+}
+
+// same value, same sign and same end as the c library
+void requireSameAsStrtof(const std::string &text) {
+  char *expectedEnd = nullptr;
+  const float expected = strtof(text.c_str(), &expectedEnd);
+  const char *end = nullptr;
+  const float value = SirMetal::parseFloat(text.c_str(), &end);
+  INFO(text);
+  REQUIRE(floatBits(value) == floatBits(expected));
+  REQUIRE(end == expectedEnd);
+}
+
+class Generator {
+public:
+  explicit Generator(const uint32_t seed) : m_engine(seed) {}
+  uint32_t operator()(const uint32_t range) {
+    return static_cast<uint32_t>(m_engine()) % range;
+  }
+  std::string digits(const uint32_t count) {
+    std::string result;
+    for (uint32_t i = 0; i < count; ++i) {
+      result += static_cast<char>('0' + (*this)(10));
+    }
+    return result;
+  }
+
+private:
+  std::mt19937 m_engine;
+};
+}  // namespace
+
+TEST_CASE("Parse float matches strtof on simple values", "[io]") {
+  for (const char *text :
+       {"0", "-0", "+0", "0.0", "1", "-1", "1.5", "0.1", "0.2", "0.3",
+        "3.14159265", "-2e1", "1e-3", "1E+3", "1.e2", ".5", "-.25",
+        "123456789012345678", "0.000000000000000000000000000000000000011754944",
+        "3.4028235e38", "3.4028236e38", "1e39", "-1e39", "1e-46", "1.4e-45",
+        "16777217", "16777216.5", "33554434.99999999999999999",
+        "00000000000000000000000000000001.5", "1.00000005960464477539062501",
+        "1.000000059604644775390625", "7.038531e-26", "5e-324",
+        "0.000000000000000000000000000000000000000000001"}) {
+    requireSameAsStrtof(text);
+  }
+  // the parser stops at the first character that can't be part of the number
+  for (const char *text : {"1.5/2", "-3 4", "2.5e3x", "7\n", "42\r\n", "9#"}) {
+    requireSameAsStrtof(text);
+  }
+}
+
+TEST_CASE("Parse float matches strtof on random values", "[io]") {
+  Generator generator(1234);
+  char buffer[128];
+  for (uint32_t i = 0; i < 200000; ++i) {
+    std::string text;
+    switch (generator(4)) {
+    case 0: {
+      // a random float printed with a random number of digits, mostly round
+      // trips, short prints round to something in between
+      uint32_t bits = generator(0xFFFFFFFFu);
+      float value;
+      memcpy(&value, &bits, sizeof(float));
+      if (value != value) {
+        continue;
+      }
+      snprintf(buffer, sizeof(buffer), "%.*g", 1 + generator(12),
+               static_cast<double>(value));
+      text = buffer;
+      break;
+    }
+    case 1: {
+      // what meshes look like, a few digits both sides of the dot
+      text = (generator(2) ? "-" : "") + generator.digits(1 + generator(6)) +
+             "." + generator.digits(1 + generator(8));
+      break;
+    }
+    case 2: {
+      // long mantissas, leading zeros and exponents around the fast path
+      text = std::string(generator(4), '0') +
+             generator.digits(1 + generator(30));
+      if (generator(2)) {
+        text += "." + generator.digits(generator(30));
+      }
+      const int exponent = static_cast<int>(generator(100)) - 50;
+      text += (generator(2) ? "e" : "E") + std::to_string(exponent);
+      break;
+    }
+    default: {
+      // values exactly between two floats and their neighbours, printed in
+      // full from the double
+      uint32_t bits = generator(0x7F000000u) + 0x00800000u;
+      float value;
+      memcpy(&value, &bits, sizeof(float));
+      double midpoint = static_cast<double>(value) * (1.0 + 0x1p-24);
+      snprintf(buffer, sizeof(buffer), "%.*g", 15 + generator(25), midpoint);
+      text = buffer;
+      break;
+    }
+    }
+    requireSameAsStrtof(text);
+  }
+}
+
+TEST_CASE("Parse int matches strtol", "[io]") {
+  Generator generator(4321);
+  for (uint32_t i = 0; i < 100000; ++i) {
+    const std::string text = std::string(generator(2) ? "-" : "") +
+                             generator.digits(1 + generator(9)) + "/";
+    char *expectedEnd = nullptr;
+    const long expected = strtol(text.c_str(), &expectedEnd, 10);
+    const char *end = nullptr;
+    INFO(text);
+    REQUIRE(SirMetal::parseInt(text.c_str(), &end) == expected);
+    REQUIRE(end == expectedEnd);
+  }
+  const char *end = nullptr;
+  REQUIRE(SirMetal::parseInt("  12//3", &end) == 12);
+  REQUIRE(*end == '/');
+  REQUIRE(SirMetal::parseInt("x", &end) == 0);
+  REQUIRE(*end == 'x');
+}
@@ -0,0 +1,74 @@
+#include "SirMetal/resources/meshes/objparser.h"
+#include "catch/catch.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+
+namespace {
+// bump it to a few GB for numbers close to the scanned assets
+constexpr uint64_t OBJ_SIZE = 256ull << 20;
+const char *OBJ_PATH = "./objParserBenchmark.obj";
+
+void writeObj(const char *path, const uint64_t size) {
+  FILE *file = fopen(path, "wb");
+  REQUIRE(file != nullptr);
+  char line[128];
+  uint64_t written = 0;
+  uint32_t vertex = 0;
+  while (written < size) {
+    int length;
+    if ((vertex % 4) != 3) {
+      length = snprintf(line, sizeof(line),
+                        "v %.6f %.6f %.6f\nvt %.4f %.4f\nvn 0 1 0\n",
+                        vertex * 0.001f, vertex * 0.002f, -vertex * 0.003f,
+                        (vertex % 100) * 0.01f, (vertex % 7) * 0.1f);
+    } else {
+      length = snprintf(line, sizeof(line), "f %u/%u/%u -2/-2/-2 -1/-1/-1\n",
+                        vertex - 2, vertex - 2, vertex - 2);
+    }
+    fwrite(line, 1, length, file);
+    written += length;
+    ++vertex;
+  }
+  fclose(file);
+}
+}  // namespace
+
+// run with: tests "[!benchmark]"
+TEST_CASE("obj parallel parse", "[!benchmark]") {
+  writeObj(OBJ_PATH, OBJ_SIZE);
+  const std::string suffix = " " + std::to_string(OBJ_SIZE >> 20) + "MB";
+  const double sizeInMB = static_cast<double>(OBJ_SIZE >> 20);
+
+  // one timed run per thread count for the throughput, the page cache is warm
+  // after the first parse
+  {
+    ObjFile warm;
+    objParseFile(warm, OBJ_PATH);
+  }
+  for (const unsigned int threads : {1u, 2u, 4u, 8u}) {
+    const auto start = std::chrono::steady_clock::now();
+    ObjFile file;
+    objParseFileParallel(file, OBJ_PATH, threads);
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    WARN(threads << " threads: " << sizeInMB / seconds << " MB/s");
+  }
+
+  BENCHMARK("serial" + suffix) {
+    ObjFile file;
+    objParseFile(file, OBJ_PATH);
+    return file.f_size;
+  };
+  for (const unsigned int threads : {2u, 4u, 8u}) {
+    BENCHMARK(std::to_string(threads) + " threads" + suffix) {
+      ObjFile file;
+      objParseFileParallel(file, OBJ_PATH, threads);
+      return file.f_size;
+    };
+  }
+  remove(OBJ_PATH);
+}
@@ -0,0 +1,173 @@
+#include "SirMetal/resources/meshes/objparser.h"
+#include "catch/catch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+
+namespace {
+// a few MB of every kind of line the parser knows, so the parallel parser
+// splits it in several chunks
+void writeTestObj(const char *path, const bool withGroups,
+                  const uint32_t seed) {
+  std::mt19937 engine(seed);
+  const auto generator = [&engine]() {
+    return static_cast<uint32_t>(engine());
+  };
+  std::string content;
+  content.reserve(8 << 20);
+  char line[256];
+  uint32_t vertices = 0;
+  uint32_t uvs = 0;
+  uint32_t normals = 0;
+  while (content.size() < (6u << 20)) {
+    const uint32_t kind = generator() % 16;
+    if (kind < 5) {
+      snprintf(line, sizeof(line), "v %.5f %d.%03u %ge-2\n",
+               (generator() % 100000) * 0.01f - 500.0f,
+               static_cast<int>(generator() % 100) - 50, generator() % 1000,
+               static_cast<double>(generator() % 1000));
+      ++vertices;
+    } else if (kind < 7) {
+      snprintf(line, sizeof(line), "vt 0.%u 0.%u\n", generator() % 1000,
+               generator() % 1000);
+      ++uvs;
+    } else if (kind < 9) {
+      snprintf(line, sizeof(line), "vn 0 %s1 0\r\n",
+               (generator() % 2) ? "-" : "");
+      ++normals;
+    } else if ((kind < 15) && (vertices > 4) && (uvs > 4) && (normals > 4)) {
+      // absolute and relative indices, triangles and polygons
+      std::string face = "f";
+      const uint32_t corners = 3 + generator() % 3;
+      const uint32_t format = generator() % 4;
+      for (uint32_t c = 0; c < corners; ++c) {
+        const bool relative = (generator() % 3) == 0;
+        const uint32_t back = 1 + generator() % 4;
+        const auto index = [&](const uint32_t count) {
+          return relative ? std::to_string(-static_cast<int>(back))
+                          : std::to_string(count - back + 1);
+        };
+        face += " " + index(vertices);
+        if (format == 1) {
+          face += "/" + index(uvs);
+        } else if (format == 2) {
+          face += "//" + index(normals);
+        } else if (format == 3) {
+          face += "/" + index(uvs) + "/" + index(normals);
+        }
+      }
+      snprintf(line, sizeof(line), "%s\n", face.c_str());
+    } else if (withGroups && (generator() % 8) == 0) {
+      snprintf(line, sizeof(line), "usemtl material_%u\n", generator() % 10);
+    } else {
+      snprintf(line, sizeof(line), "%s\n",
+               (generator() % 2) ? "# comment" : "");
+    }
+    content += line;
+  }
+  // no new line at the end
+  content += "v 1 2 3";
+
+  FILE *file = fopen(path, "wb");
+  REQUIRE(file != nullptr);
+  fwrite(content.data(), 1, content.size(), file);
+  fclose(file);
+}
+
+template <typename T>
+void requireSameArray(const T *a, const size_t aSize, const T *b,
+                      const size_t bSize) {
+  REQUIRE(aSize == bSize);
+  REQUIRE((a == nullptr) == (b == nullptr));
+  if (aSize != 0) {
+    REQUIRE(memcmp(a, b, sizeof(T) * aSize) == 0);
+  }
+}
+
+void requireSameObj(const ObjFile &a, const ObjFile &b) {
+  requireSameArray(a.v, a.v_size, b.v, b.v_size);
+  requireSameArray(a.vt, a.vt_size, b.vt, b.vt_size);
+  requireSameArray(a.vn, a.vn_size, b.vn, b.vn_size);
+  requireSameArray(a.f, a.f_size, b.f, b.f_size);
+  REQUIRE(a.g_size == b.g_size);
+  for (size_t i = 0; i < a.g_size; ++i) {
+    REQUIRE(strcmp(a.g[i].material, b.g[i].material) == 0);
+    REQUIRE(a.g[i].index_offset == b.g[i].index_offset);
+    REQUIRE(a.g[i].index_count == b.g[i].index_count);
+  }
+}
+}  // namespace
+
+TEST_CASE("Obj parallel parse is identical to serial", "[io]") {
+  const char *path = "./testData/parallelParse.obj";
+  for (const bool withGroups : {true, false}) {
+    writeTestObj(path, withGroups, withGroups ? 1 : 2);
+    ObjFile serial;
+    REQUIRE(objParseFile(serial, path));
+    REQUIRE(objValidate(serial));
+    REQUIRE(serial.g_size >= 1);
+
+    for (const unsigned int threads : {1u, 2u, 3u, 8u}) {
+      ObjFile parallel;
+      REQUIRE(objParseFileParallel(parallel, path, threads));
+      requireSameObj(serial, parallel);
+    }
+  }
+  remove(path);
+}
+
+TEST_CASE("Obj parallel parse without faces", "[io]") {
+  const char *path = "./testData/parallelPoints.obj";
+  std::string content;
+  for (uint32_t i = 0; content.size() < (3u << 20); ++i) {
+    content += "v " + std::to_string(i) + " 0 0\n";
+  }
+  FILE *file = fopen(path, "wb");
+  REQUIRE(file != nullptr);
+  fwrite(content.data(), 1, content.size(), file);
+  fclose(file);
+
+  ObjFile serial;
+  ObjFile parallel;
+  REQUIRE(objParseFile(serial, path));
+  REQUIRE(objParseFileParallel(parallel, path, 4));
+  remove(path);
+  requireSameObj(serial, parallel);
+  // nothing is allocated for what the file doesn't have
+  REQUIRE(parallel.f == nullptr);
+  REQUIRE(parallel.g == nullptr);
+  REQUIRE(parallel.vn == nullptr);
+
+  ObjFile missing;
+  REQUIRE(!objParseFileParallel(missing, "./testData/notThere.obj", 4));
+}
+
+TEST_CASE("Obj parse lines longer than the line buffer", "[io]") {
+  const char *path = "./testData/longLines.obj";
+  const std::string padding(200000, 'x');
+  std::string content = "# " + padding + "\n";
+  content += "mtllib " + padding + ".mtl\n";
+  content += "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+  content += "usemtl " + padding + "\n";
+  // the last line has no new line, and is longer than the buffer as well
+  content += "f 1 2 3" + std::string(100000, ' ');
+  FILE *file = fopen(path, "wb");
+  REQUIRE(file != nullptr);
+  fwrite(content.data(), 1, content.size(), file);
+  fclose(file);
+
+  ObjFile serial;
+  REQUIRE(objParseFile(serial, path));
+  REQUIRE(serial.v_size == 9);
+  REQUIRE(serial.f_size == 9);
+  REQUIRE(serial.g_size == 1);
+  // truncated to what the group can hold
+  REQUIRE(strlen(serial.g[0].material) == sizeof(serial.g[0].material) - 1);
+  ObjFile parallel;
+  REQUIRE(objParseFileParallel(parallel, path, 4));
+  remove(path);
+  requireSameObj(serial, parallel);
+}
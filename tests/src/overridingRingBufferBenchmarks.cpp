@@ -0,0 +1,54 @@
+#include "SirMetal/core/memory/cpu/overridingRingBuffer.h"
+#include "catch/catch.h"
+#include <string>
+#include <vector>
+
+// run with: tests "[!benchmark]"
+TEST_CASE("overriding ring buffer telemetry window", "[!benchmark]") {
+  const uint32_t windowSize = 1 << 20;
+  const uint32_t sampleCount = 3 * windowSize + 123;
+  const uint32_t batchSize = 4096;
+  std::vector<float> samples(sampleCount);
+  for (uint32_t i = 0; i < sampleCount; ++i) {
+    samples[i] = static_cast<float>(rand() % 1000);
+  }
+  SirMetal::OverridingRingBuffer<float> ring(windowSize);
+  const std::string suffix = " window:" + std::to_string(windowSize);
+
+  BENCHMARK("push one by one" + suffix) {
+    for (uint32_t i = 0; i < sampleCount; ++i) {
+      ring.push(samples[i]);
+    }
+    return ring.usedElementCount();
+  };
+  BENCHMARK("push range" + suffix) {
+    for (uint32_t i = 0; i < sampleCount; i += batchSize) {
+      const uint32_t count =
+          sampleCount - i < batchSize ? sampleCount - i : batchSize;
+      ring.pushRange(samples.data() + i, count);
+    }
+    return ring.usedElementCount();
+  };
+
+  // reducing the window, walking the ring with indices against the spans
+  BENCHMARK("average with indices" + suffix) {
+    const uint32_t start = ring.getFirstElementIndex();
+    const uint32_t count = ring.usedElementCount();
+    const float *data = ring.getData();
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < count; ++i) {
+      sum += data[(start + i) % windowSize];
+    }
+    return sum / count;
+  };
+  BENCHMARK("average with view" + suffix) {
+    const auto view = ring.getView();
+    float sum = 0.0f;
+    for (const auto &span : {view.first, view.second}) {
+      for (uint32_t i = 0; i < span.count; ++i) {
+        sum += span.data[i];
+      }
+    }
+    return sum / view.count();
+  };
+}
@@ -144,3 +144,130 @@ TEST_CASE("overriding ring buffer destructor callback 2", "[memory]") {
   }
   REQUIRE(CALLBACK2_SENTINEL == 20);
 }
+
+TEST_CASE("overriding ring buffer push range", "[memory]") {
+  SirMetal::OverridingRingBuffer<uint32_t> ring(8);
+  uint32_t values[20];
+  for (uint32_t i = 0; i < 20; ++i) {
+    values[i] = i;
+  }
+  ring.pushRange(values, 5);
+  REQUIRE(ring.usedElementCount() == 5);
+  REQUIRE(ring.front() == 0);
+  REQUIRE(ring.back() == 4);
+
+  // wraps around the end and overrides the 3 oldest
+  ring.pushRange(values + 5, 6);
+  REQUIRE(ring.isFull());
+  REQUIRE(ring.front() == 3);
+  REQUIRE(ring.back() == 10);
+
+  // more than the size, only the last 8 survive
+  ring.pushRange(values, 20);
+  REQUIRE(ring.isFull());
+  for (uint32_t i = 0; i < 8; ++i) {
+    REQUIRE(ring.pop() == 12 + i);
+  }
+  REQUIRE(ring.isEmpty());
+}
+
+TEST_CASE("overriding ring buffer push range callback", "[memory]") {
+  CALLBACK2_SENTINEL = 0;
+  {
+    SirMetal::OverridingRingBuffer<uint32_t> ring(10);
+    ring.registerDestroyCallback(callback2);
+    uint32_t values[25]{};
+    ring.pushRange(values, 7);
+    REQUIRE(CALLBACK2_SENTINEL == 0);
+    ring.pushRange(values, 5);
+    REQUIRE(CALLBACK2_SENTINEL == 2);
+    // 15 values skipped and 10 overridden, same as pushing one by one
+    ring.pushRange(values, 25);
+    REQUIRE(CALLBACK2_SENTINEL == 27);
+  }
+  // the destructor frees what is left
+  REQUIRE(CALLBACK2_SENTINEL == 37);
+}
+
+TEST_CASE("overriding ring buffer pop range", "[memory]") {
+  SirMetal::OverridingRingBuffer<uint32_t> ring(8);
+  for (uint32_t i = 0; i < 13; ++i) {
+    ring.push(i);
+  }
+  uint32_t out[10]{};
+  REQUIRE(ring.popRange(out, 3) == 3);
+  REQUIRE(out[0] == 5);
+  REQUIRE(out[2] == 7);
+  // the rest wraps around the end of the buffer
+  REQUIRE(ring.popRange(out, 10) == 5);
+  for (uint32_t i = 0; i < 5; ++i) {
+    REQUIRE(out[i] == 8 + i);
+  }
+  REQUIRE(ring.isEmpty());
+  REQUIRE(ring.popRange(out, 10) == 0);
+}
+
+TEST_CASE("overriding ring buffer view", "[memory]") {
+  SirMetal::OverridingRingBuffer<float> ring(16);
+  auto view = ring.getView();
+  REQUIRE(view.count() == 0);
+
+  for (uint32_t i = 0; i < 10; ++i) {
+    ring.push(static_cast<float>(i));
+  }
+  view = ring.getView();
+  REQUIRE(view.first.count == 10);
+  REQUIRE(view.second.count == 0);
+  REQUIRE(view.first.data[0] == 0.0f);
+
+  for (uint32_t i = 10; i < 30; ++i) {
+    ring.push(static_cast<float>(i));
+  }
+  view = ring.getView();
+  REQUIRE(view.count() == 16);
+  REQUIRE(view.first.count == 2);
+  REQUIRE(view.second.count == 14);
+
+  // reduction over the two spans, the window holds 14 to 29
+  float minValue = view.first.data[0];
+  float maxValue = view.first.data[0];
+  float sum = 0.0f;
+  for (const auto &span : {view.first, view.second}) {
+    for (uint32_t i = 0; i < span.count; ++i) {
+      minValue = span.data[i] < minValue ? span.data[i] : minValue;
+      maxValue = span.data[i] > maxValue ? span.data[i] : maxValue;
+      sum += span.data[i];
+    }
+  }
+  REQUIRE(minValue == 14.0f);
+  REQUIRE(maxValue == 29.0f);
+  REQUIRE(sum / view.count() == 21.5f);
+}
+
+TEST_CASE("overriding ring buffer ranges match single ops", "[memory]") {
+  SirMetal::OverridingRingBuffer<uint32_t> single(37);
+  SirMetal::OverridingRingBuffer<uint32_t> ranged(37);
+  uint32_t values[100];
+  uint32_t out[100];
+  uint32_t next = 0;
+  srand(42);
+  for (uint32_t iteration = 0; iteration < 500; ++iteration) {
+    const uint32_t count = static_cast<uint32_t>(rand()) % 100;
+    if (rand() % 3 != 0) {
+      for (uint32_t i = 0; i < count; ++i) {
+        values[i] = next++;
+        single.push(values[i]);
+      }
+      ranged.pushRange(values, count);
+    } else {
+      const uint32_t popped = ranged.popRange(out, count);
+      REQUIRE(popped == (count < static_cast<uint32_t>(single.usedElementCount())
+                             ? count
+                             : single.usedElementCount()));
+      for (uint32_t i = 0; i < popped; ++i) {
+        REQUIRE(out[i] == single.pop());
+      }
+    }
+    REQUIRE(single.usedElementCount() == ranged.usedElementCount());
+  }
+}
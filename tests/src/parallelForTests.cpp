@@ -0,0 +1,60 @@
+#include "SirMetal/core/parallelFor.h"
+#include "catch/catch.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Parallel for visits every index once", "[parallel]") {
+  const uint32_t threadCounts[] = {1, 2, 4, 16};
+  const size_t counts[] = {0, 1, 3, 1000};
+  for (const uint32_t threadCount : threadCounts) {
+    for (const size_t count : counts) {
+      std::vector<std::atomic<uint32_t>> visits(count);
+      for (auto &visit : visits) {
+        visit = 0;
+      }
+      SirMetal::parallelFor(threadCount, count,
+                            [&](const size_t i) { visits[i]++; });
+      for (size_t i = 0; i < count; ++i) {
+        REQUIRE(visits[i] == 1);
+      }
+    }
+  }
+}
+
+TEST_CASE("Parallel for one thread runs on the caller", "[parallel]") {
+  const std::thread::id caller = std::this_thread::get_id();
+  std::vector<size_t> order;
+  SirMetal::parallelFor(1, 10, [&](const size_t i) {
+    REQUIRE(std::this_thread::get_id() == caller);
+    order.push_back(i);
+  });
+  // no other thread, the indices come in order
+  REQUIRE(order.size() == 10);
+  for (size_t i = 0; i < order.size(); ++i) {
+    REQUIRE(order[i] == i);
+  }
+}
+
+TEST_CASE("Parallel for results written by index are deterministic",
+          "[parallel]") {
+  // uneven work, the threads finish out of order but every result lands in
+  // its own slot, the same way the gltf loader prepares its meshes
+  const size_t count = 64;
+  std::vector<uint64_t> results(count);
+  SirMetal::parallelFor(4, count, [&](const size_t i) {
+    uint64_t value = i;
+    for (size_t step = 0; step < (count - i) * 1000; ++step) {
+      value = value * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    results[i] = value;
+  });
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t value = i;
+    for (size_t step = 0; step < (count - i) * 1000; ++step) {
+      value = value * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    REQUIRE(results[i] == value);
+  }
+}
@@ -0,0 +1,47 @@
+#include "SirMetal/core/profiler.h"
+#include "catch/catch.h"
+
+// the profiler is only built with SE_PROFILING on
+#if SE_PROFILING
+
+// run with: tests "[!benchmark]"
+TEST_CASE("profiler zone overhead", "[!benchmark]") {
+  SirMetal::profilerClear();
+  // the ring is drained every batch, as profilerNewFrame() would do, so no
+  // zone gets dropped
+  constexpr uint32_t ZONES = 1000;
+
+  BENCHMARK("1000 empty zones") {
+    for (uint32_t i = 0; i < ZONES; ++i) {
+      SM_PROFILE_SCOPE("empty");
+    }
+    SirMetal::profilerCollect();
+    return ZONES;
+  };
+  BENCHMARK("1000 nested zones") {
+    for (uint32_t i = 0; i < ZONES / 4; ++i) {
+      SM_PROFILE_SCOPE("a");
+      {
+        SM_PROFILE_SCOPE("b");
+        {
+          SM_PROFILE_SCOPE("c");
+          { SM_PROFILE_SCOPE("d"); }
+        }
+      }
+    }
+    SirMetal::profilerCollect();
+    return ZONES;
+  };
+  // the same loop with the time reads only, what the clock costs
+  BENCHMARK("1000 timestamp pairs") {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < ZONES; ++i) {
+      const uint64_t start = SirMetal::profilerInternal::getTimestamp();
+      total += SirMetal::profilerInternal::getTimestamp() - start;
+    }
+    return total;
+  };
+  SirMetal::profilerClear();
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include "SirMetal/core/profiler.h"
+#include "catch/catch.h"
+
+// the profiler is only built with SE_PROFILING on
+#if SE_PROFILING
+
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+const SirMetal::ProfileZone *findZone(
+    const std::vector<SirMetal::ProfileZone> &zones, const char *name) {
+  for (const SirMetal::ProfileZone &zone : zones) {
+    if (strcmp(zone.name, name) == 0) {
+      return &zone;
+    }
+  }
+  return nullptr;
+}
+
+void profiledLeaf() { SM_PROFILE_SCOPE("leaf"); }
+}  // namespace
+
+TEST_CASE("Profiler nested zones", "[profiler]") {
+  SirMetal::profilerClear();
+  const uint32_t frame = SirMetal::profilerGetFrameIndex();
+  {
+    SM_PROFILE_SCOPE("outer");
+    {
+      SM_PROFILE_SCOPE("inner");
+      profiledLeaf();
+    }
+  }
+  SirMetal::profilerNewFrame();
+  REQUIRE(SirMetal::profilerGetFrameIndex() == frame + 1);
+
+  std::vector<SirMetal::ProfileZone> zones;
+  SirMetal::profilerGetZones(zones);
+  const SirMetal::ProfileZone *outer = findZone(zones, "outer");
+  const SirMetal::ProfileZone *inner = findZone(zones, "inner");
+  const SirMetal::ProfileZone *leaf = findZone(zones, "leaf");
+  const SirMetal::ProfileZone *frameZone = findZone(zones, "frame");
+  REQUIRE(outer != nullptr);
+  REQUIRE(inner != nullptr);
+  REQUIRE(leaf != nullptr);
+  REQUIRE(frameZone != nullptr);
+
+  REQUIRE(outer->depth + 1 == inner->depth);
+  REQUIRE(inner->depth + 1 == leaf->depth);
+  REQUIRE(outer->startNS <= inner->startNS);
+  REQUIRE(inner->startNS <= leaf->startNS);
+  REQUIRE(leaf->endNS <= inner->endNS);
+  REQUIRE(inner->endNS <= outer->endNS);
+  REQUIRE(outer->frame == frame);
+  REQUIRE(leaf->frame == frame);
+  REQUIRE(outer->threadIndex == leaf->threadIndex);
+  REQUIRE(frameZone->frame == frame);
+  REQUIRE(frameZone->endNS >= outer->endNS);
+  REQUIRE(SirMetal::profilerGetDroppedZonesCount() == 0);
+}
+
+TEST_CASE("Profiler zones from other threads", "[profiler]") {
+  SirMetal::profilerClear();
+  std::thread worker([]() {
+    SM_PROFILE_THREAD_NAME("worker \"0\"");
+    for (int i = 0; i < 100; ++i) {
+      SM_PROFILE_SCOPE("job");
+    }
+  });
+  worker.join();
+  // the thread is gone, its zones were moved in the history when it exited
+  { SM_PROFILE_SCOPE("main zone"); }
+  SirMetal::profilerCollect();
+
+  std::vector<SirMetal::ProfileZone> zones;
+  SirMetal::profilerGetZones(zones);
+  uint32_t jobs = 0;
+  for (const SirMetal::ProfileZone &zone : zones) {
+    jobs += strcmp(zone.name, "job") == 0 ? 1 : 0;
+  }
+  REQUIRE(jobs == 100);
+  const SirMetal::ProfileZone *job = findZone(zones, "job");
+  const SirMetal::ProfileZone *mainZone = findZone(zones, "main zone");
+  REQUIRE(mainZone != nullptr);
+  REQUIRE(job->threadIndex != mainZone->threadIndex);
+
+  const std::string trace = SirMetal::profilerToChromeTrace();
+  REQUIRE(trace.find("\"traceEvents\":[") != std::string::npos);
+  REQUIRE(trace.find("\"name\":\"job\",\"cat\":\"cpu\",\"ph\":\"X\"") !=
+          std::string::npos);
+  REQUIRE(trace.find("\"name\":\"main zone\"") != std::string::npos);
+  // thread names are escaped
+  REQUIRE(trace.find("\"args\":{\"name\":\"worker \\\"0\\\"\"}") !=
+          std::string::npos);
+  REQUIRE(trace.substr(trace.size() - 4) == "\n]}\n");
+}
+
+TEST_CASE("Profiler reuses the profiles of exited threads", "[profiler]") {
+  SirMetal::profilerClear();
+  // threads started one after the other take over the same profile
+  for (int i = 0; i < 4; ++i) {
+    std::thread worker([]() { SM_PROFILE_SCOPE("short lived"); });
+    worker.join();
+  }
+  SirMetal::profilerCollect();
+  std::vector<SirMetal::ProfileZone> zones;
+  SirMetal::profilerGetZones(zones);
+  const SirMetal::ProfileZone *first = findZone(zones, "short lived");
+  REQUIRE(first != nullptr);
+  uint32_t count = 0;
+  for (const SirMetal::ProfileZone &zone : zones) {
+    if (strcmp(zone.name, "short lived") == 0) {
+      REQUIRE(zone.threadIndex == first->threadIndex);
+      ++count;
+    }
+  }
+  REQUIRE(count == 4);
+}
+
+TEST_CASE("Profiler drops zones when the ring is full", "[profiler]") {
+  SirMetal::profilerClear();
+  const uint32_t count = SirMetal::profilerInternal::THREAD_RING_SIZE + 10;
+  for (uint32_t i = 0; i < count; ++i) {
+    SM_PROFILE_SCOPE("spam");
+  }
+  REQUIRE(SirMetal::profilerGetDroppedZonesCount() == 10);
+  SirMetal::profilerCollect();
+  std::vector<SirMetal::ProfileZone> zones;
+  SirMetal::profilerGetZones(zones);
+  REQUIRE(zones.size() == SirMetal::profilerInternal::THREAD_RING_SIZE);
+  SirMetal::profilerClear();
+  REQUIRE(SirMetal::profilerGetDroppedZonesCount() == 0);
+}
+
+#endif
@@ -0,0 +1,209 @@
+#include "SirMetal/core/memory/cpu/randomSizeAllocator.h"
+#include "catch/catch.h"
+#include <string>
+#include <vector>
+
+// run with: tests "[!benchmark]"
+namespace {
+
+// the allocator as it was before the tracker, freed blocks in a list searched
+// first fit, never split nor merged
+class LinearScanAllocator {
+public:
+  explicit LinearScanAllocator(const uint32_t size) : m_size(size) {}
+
+  uint32_t allocate(const uint32_t size) {
+    for (uint32_t i = 0; i < m_free.size(); ++i) {
+      if (size <= m_free[i].allocSize) {
+        const uint32_t slot = m_free[i].slot;
+        m_blocks[slot] = m_free[i];
+        m_free[i] = m_free.back();
+        m_free.pop_back();
+        return slot;
+      }
+    }
+    if (m_unfragmented + size > m_size) {
+      return INVALID;
+    }
+    m_blocks.push_back(
+        Block{m_unfragmented, size, static_cast<uint32_t>(m_blocks.size())});
+    m_unfragmented += size;
+    return m_blocks.back().slot;
+  }
+  void free(const uint32_t slot) { m_free.push_back(m_blocks[slot]); }
+  uint32_t getUnfragmented() const { return m_unfragmented; }
+  uint32_t getFreeBlocksCount() const {
+    return static_cast<uint32_t>(m_free.size());
+  }
+
+  static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+private:
+  struct Block {
+    uint32_t offset;
+    uint32_t allocSize;
+    uint32_t slot;
+  };
+  uint32_t m_size;
+  uint32_t m_unfragmented = 0;
+  std::vector<Block> m_blocks;
+  std::vector<Block> m_free;
+};
+
+struct Operation {
+  uint32_t size;  // 0 means free
+  uint32_t liveIndex;
+};
+
+// mostly small allocations, strings and small arrays, some medium buffers and
+// a few big ones. A loading phase builds up the live set, then objects come
+// and go, short lived ones more often, and at the end half of the level is
+// unloaded and a new one streamed in
+uint32_t randomSize(const uint32_t random) {
+  const uint32_t bucket = random % 100;
+  if (bucket < 70) {
+    return 8 + (random >> 7) % 120;
+  }
+  if (bucket < 95) {
+    return 128 + (random >> 7) % 1920;
+  }
+  return 4096 + (random >> 7) % 57344;
+}
+
+std::vector<Operation> buildLevelTrace(const uint32_t maxLive) {
+  std::vector<Operation> trace;
+  uint32_t live = 0;
+  uint32_t seed = 3;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 4;
+  };
+  // loading
+  for (uint32_t i = 0; i < maxLive; ++i) {
+    trace.push_back(Operation{randomSize(next()), live++});
+  }
+  // gameplay, the newest allocations are the most likely to go away
+  for (uint32_t i = 0; i < maxLive * 20; ++i) {
+    const uint32_t random = next();
+    if ((random & 1) & (live < maxLive)) {
+      trace.push_back(Operation{randomSize(next()), live++});
+    } else if (live != 0) {
+      const uint32_t recent = live < 64 ? live : 64;
+      const bool young = (random & 6) != 0;
+      const uint32_t index =
+          young ? live - 1 - (next() % recent) : next() % live;
+      trace.push_back(Operation{0, index});
+      --live;
+    }
+  }
+  // unloading half and streaming in as much
+  for (uint32_t i = 0; i < maxLive / 2; ++i) {
+    trace.push_back(Operation{0, next() % live});
+    --live;
+  }
+  for (uint32_t i = 0; i < maxLive / 2; ++i) {
+    trace.push_back(Operation{randomSize(next()), live++});
+  }
+  return trace;
+}
+
+// free operations remove the live entry by patching from the last, so the
+// trace indices match the replay
+template <typename ALLOC, typename FREE>
+uint32_t replay(const std::vector<Operation> &trace, ALLOC allocFn,
+                FREE freeFn) {
+  std::vector<uint32_t> live;
+  uint32_t failed = 0;
+  for (const Operation &op : trace) {
+    if (op.size != 0) {
+      const uint32_t handle = allocFn(op.size);
+      failed += handle == LinearScanAllocator::INVALID ? 1 : 0;
+      live.push_back(handle);
+    } else {
+      if (live[op.liveIndex] != LinearScanAllocator::INVALID) {
+        freeFn(live[op.liveIndex]);
+      }
+      live[op.liveIndex] = live.back();
+      live.pop_back();
+    }
+  }
+  return failed;
+}
+
+} // namespace
+
+TEST_CASE("random size allocator fragmentation", "[!benchmark]") {
+  const uint32_t memorySize = 256u << 20;
+  const uint32_t liveCounts[] = {1024, 8192};
+  for (uint32_t maxLive : liveCounts) {
+    const std::vector<Operation> trace = buildLevelTrace(maxLive);
+    const std::string suffix = " live:" + std::to_string(maxLive);
+
+    auto runLinearScan = [&trace, memorySize](uint32_t &used,
+                                              uint32_t &freeBlocks) {
+      LinearScanAllocator alloc(memorySize);
+      const uint32_t failed = replay(
+          trace, [&alloc](uint32_t size) { return alloc.allocate(size); },
+          [&alloc](uint32_t slot) { alloc.free(slot); });
+      used = alloc.getUnfragmented();
+      freeBlocks = alloc.getFreeBlocksCount();
+      return failed;
+    };
+    // the allocator hands out handles as values, we keep them aside and
+    // replay with their index
+    auto runSizeClasses = [&trace, memorySize](uint32_t &used,
+                                               uint32_t &freeBlocks) {
+      SirMetal::RandomSizeAllocator alloc;
+      alloc.initialize(memorySize);
+      std::vector<SirMetal::RandomSizeAllocationHandle> handles;
+      std::vector<uint32_t> freeSlots;
+      const uint32_t failed = replay(
+          trace,
+          [&](uint32_t size) {
+            const SirMetal::RandomSizeAllocationHandle handle =
+                alloc.allocate(size);
+            if (!handle.isHandleValid()) {
+              return LinearScanAllocator::INVALID;
+            }
+            if (freeSlots.empty()) {
+              handles.push_back(handle);
+              return static_cast<uint32_t>(handles.size() - 1);
+            }
+            const uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+            handles[slot] = handle;
+            return slot;
+          },
+          [&](uint32_t slot) {
+            alloc.freeAllocation(handles[slot]);
+            freeSlots.push_back(slot);
+          });
+      used = static_cast<uint32_t>(alloc.getUnfragmentedPtr() -
+                                   alloc.getStartPtr());
+      freeBlocks = static_cast<uint32_t>(alloc.getFreeBlocksCount());
+      return failed;
+    };
+
+    // how much memory each one needed for the same trace, and how many holes
+    // were left behind
+    uint32_t linearUsed, linearFreeBlocks;
+    uint32_t classesUsed, classesFreeBlocks;
+    const uint32_t linearFailed = runLinearScan(linearUsed, linearFreeBlocks);
+    const uint32_t classesFailed =
+        runSizeClasses(classesUsed, classesFreeBlocks);
+    WARN("live:" << maxLive << " linear scan used " << linearUsed
+                 << " bytes, " << linearFreeBlocks << " free blocks, failed "
+                 << linearFailed << ". size classes used " << classesUsed
+                 << " bytes, " << classesFreeBlocks << " free blocks, failed "
+                 << classesFailed);
+
+    BENCHMARK("linear scan" + suffix) {
+      uint32_t used, freeBlocks;
+      return runLinearScan(used, freeBlocks);
+    };
+    BENCHMARK("size classes" + suffix) {
+      uint32_t used, freeBlocks;
+      return runSizeClasses(used, freeBlocks);
+    };
+  }
+}
@@ -1,6 +1,8 @@
 #include "SirMetal/core/memory/cpu/randomSizeAllocator.h"
 #include "catch/catch.h"
 
+#include <vector>
+
 TEST_CASE("Random size allocator simple allocation", "[memory]") {
 
   SirMetal::RandomSizeAllocator alloc;
@@ -45,39 +47,105 @@ TEST_CASE("Random size allocator multiple allocations", "[memory]") {
   REQUIRE(newMem2.allocSize == 24);
   REQUIRE(newMem2.dataSize == 12);
 
-  // do a couple more de-alloc
+  // do a couple more de-alloc, mem3, mem4 and mem5 are next to each other so
+  // they get merged in a single block
   char *mem3ptr = alloc.getPointer(mem3);
   alloc.freeAllocation(mem3);
   REQUIRE(alloc.getStartPtr() + (112) == alloc.getUnfragmentedPtr());
+  REQUIRE(alloc.getFreeBlocksCount() == 1);
   char *mem5ptr = alloc.getPointer(mem5);
   alloc.freeAllocation(mem5);
   REQUIRE(alloc.getStartPtr() + (112) == alloc.getUnfragmentedPtr());
+  REQUIRE(alloc.getFreeBlocksCount() == 2);
   char *mem4ptr = alloc.getPointer(mem4);
   alloc.freeAllocation(mem4);
   REQUIRE(alloc.getStartPtr() + (112) == alloc.getUnfragmentedPtr());
+  REQUIRE(alloc.getFreeBlocksCount() == 1);
+  REQUIRE(alloc.getFreeBlocksBytes() == 72);
 
-  REQUIRE(alloc.getFreeBlocksCount() == 3);
+  // sizes are rounded to 4 bytes, what is left of the block is split off
   SirMetal::RandomSizeAllocationHandle newMem3 = alloc.allocate(18);
   REQUIRE(alloc.getPointer(newMem3) == mem3ptr);
-  REQUIRE(alloc.getFreeBlocksCount() == 2);
+  REQUIRE(alloc.getFreeBlocksCount() == 1);
   REQUIRE(alloc.getStartPtr() + (112) == alloc.getUnfragmentedPtr());
-  REQUIRE(newMem3.allocSize == 48);
-  REQUIRE(newMem3.dataSize== 18);
+  REQUIRE(newMem3.allocSize == 20);
+  REQUIRE(newMem3.dataSize == 18);
+  REQUIRE(alloc.getFreeBlocksBytes() == 52);
 
   SirMetal::RandomSizeAllocationHandle newMem5 = alloc.allocate(16);
-  REQUIRE(alloc.getPointer(newMem5) == mem5ptr);
+  REQUIRE(alloc.getPointer(newMem5) == mem3ptr + 20);
   REQUIRE(alloc.getFreeBlocksCount() == 1);
-  REQUIRE(alloc.getStartPtr() + (112) == alloc.getUnfragmentedPtr());
   REQUIRE(newMem5.allocSize == 16);
-  REQUIRE(newMem5.dataSize== 16);
+  REQUIRE(newMem5.dataSize == 16);
 
-  // now we have one slot free, but we will ask for a bigger memory alloction
-  // than the one we have, original mem4 was 8 bytes, so we should see the frag
-  // pointer move and number of free block to not decrease
-  SirMetal::RandomSizeAllocationHandle newMem4 = alloc.allocate(12);
-  REQUIRE(alloc.getPointer(newMem4) != mem4ptr);
-  REQUIRE(alloc.getFreeBlocksCount() == 1);
+  // a leftover smaller than 16 bytes is not worth a block, it stays with the
+  // allocation
+  SirMetal::RandomSizeAllocationHandle newMem4 = alloc.allocate(28);
+  REQUIRE(alloc.getPointer(newMem4) == mem3ptr + 36);
+  REQUIRE(alloc.getFreeBlocksCount() == 0);
+  REQUIRE(alloc.getStartPtr() + (112) == alloc.getUnfragmentedPtr());
+  REQUIRE(newMem4.allocSize == 36);
+  REQUIRE(newMem4.dataSize == 28);
+  REQUIRE(alloc.getPointer(newMem4) + newMem4.allocSize == mem5ptr + 16);
+  REQUIRE(mem4ptr < mem5ptr);
+
+  // nothing free left, the unfragmented pointer moves
+  SirMetal::RandomSizeAllocationHandle newMem6 = alloc.allocate(12);
+  REQUIRE(alloc.getPointer(newMem6) == alloc.getStartPtr() + 112);
   REQUIRE(alloc.getStartPtr() + (124) == alloc.getUnfragmentedPtr());
-  REQUIRE(newMem4.allocSize == 12);
-  REQUIRE(newMem4.dataSize== 12);
+  REQUIRE(newMem6.allocSize == 12);
+  REQUIRE(newMem6.dataSize == 12);
+}
+
+TEST_CASE("Random size allocator large allocations", "[memory]") {
+
+  SirMetal::RandomSizeAllocator alloc;
+  alloc.initialize(1 << 20);
+  // sizes are not limited to 16 bits anymore
+  SirMetal::RandomSizeAllocationHandle big = alloc.allocate(300000);
+  REQUIRE(big.isHandleValid());
+  REQUIRE(big.dataSize == 300000);
+  memset(alloc.getPointer(big), 1, big.dataSize);
+  SirMetal::RandomSizeAllocationHandle small = alloc.allocate(4);
+  memset(alloc.getPointer(small), 1, small.dataSize);
+  alloc.freeAllocation(big);
+
+  // a small request only takes what it needs from the big hole
+  SirMetal::RandomSizeAllocationHandle reused = alloc.allocate(4);
+  REQUIRE(alloc.getPointer(reused) == alloc.getStartPtr());
+  REQUIRE(reused.allocSize == 4);
+  REQUIRE(alloc.getFreeBlocksBytes() == 300000 - 4);
+
+  // the rest of the hole is still usable
+  SirMetal::RandomSizeAllocationHandle second = alloc.allocate(200000);
+  REQUIRE(alloc.getPointer(second) == alloc.getStartPtr() + 4);
+  REQUIRE(alloc.getStartPtr() + 300004 == alloc.getUnfragmentedPtr());
+
+  // running out of memory gives back an invalid handle
+  SirMetal::RandomSizeAllocationHandle tooBig = alloc.allocate(1 << 20);
+  REQUIRE(!tooBig.isHandleValid());
+}
+
+TEST_CASE("Random size allocator free everything", "[memory]") {
+
+  SirMetal::RandomSizeAllocator alloc;
+  alloc.initialize(1 << 20);
+  std::vector<SirMetal::RandomSizeAllocationHandle> handles;
+  uint32_t seed = 7;
+  for (int i = 0; i < 2000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    handles.push_back(alloc.allocate(1 + (seed >> 8) % 300));
+    memset(alloc.getPointer(handles.back()), 0, handles.back().dataSize);
+  }
+  const char *used = alloc.getUnfragmentedPtr();
+  // freeing in a scrambled order, everything needs to end up in one block
+  for (size_t i = 0; i < handles.size(); i += 2) {
+    alloc.freeAllocation(handles[i]);
+  }
+  for (size_t i = 1; i < handles.size(); i += 2) {
+    alloc.freeAllocation(handles[i]);
+  }
+  REQUIRE(alloc.getFreeBlocksCount() == 1);
+  REQUIRE(alloc.getFreeBlocksBytes() ==
+          static_cast<uint64_t>(used - alloc.getStartPtr()));
 }
@@ -0,0 +1,46 @@
+#include "SirMetal/core/memory/cpu/resizableVector.h"
+#include "SirMetal/core/memory/cpu/virtualMemoryArena.h"
+#include "catch/catch.h"
+#include <string>
+#include <vector>
+
+// run with: tests "[!benchmark]"
+TEST_CASE("resizable vector push back", "[!benchmark]") {
+  const uint32_t counts[] = {1000, 100000, 10000000, 100000000};
+
+  for (uint32_t count : counts) {
+    const std::string suffix = " elements:" + std::to_string(count);
+
+    // all of them grow from empty, no reserve
+    BENCHMARK("std::vector" + suffix) {
+      std::vector<uint32_t> vec;
+      for (uint32_t i = 0; i < count; ++i) {
+        vec.push_back(i);
+      }
+      return vec[count - 1];
+    };
+    BENCHMARK("resizable vector" + suffix) {
+      SirMetal::ResizableVector<uint32_t> vec;
+      for (uint32_t i = 0; i < count; ++i) {
+        vec.pushBack(i);
+      }
+      return vec[count - 1];
+    };
+    BENCHMARK_ADVANCED("resizable vector arena" + suffix)
+    (Catch::Benchmark::Chronometer meter) {
+      // the reservation is only address space, committed pages are kept
+      // between runs like in a long lived arena
+      SirMetal::VirtualMemoryArena arena(
+          static_cast<size_t>(count) * sizeof(uint32_t) * 2 + (1 << 20));
+      meter.measure([&arena, count]() {
+        arena.reset();
+        SirMetal::ResizableVector<uint32_t, SirMetal::VirtualMemoryArena> vec(
+            0, &arena);
+        for (uint32_t i = 0; i < count; ++i) {
+          vec.pushBack(i);
+        }
+        return vec[count - 1];
+      });
+    };
+  }
+}
@@ -1,5 +1,7 @@
 #include "SirMetal/core/memory/cpu/resizableVector.h"
+#include "SirMetal/core/memory/cpu/stackAllocator.h"
 #include "SirMetal/core/memory/cpu/threeSizesPool.h"
+#include "SirMetal/core/memory/cpu/virtualMemoryArena.h"
 #include "catch/catch.h"
 
 TEST_CASE("Vector reserve size", "[memory]") {
@@ -308,3 +310,153 @@ TEST_CASE("Vector remove by patching", "[memory]") {
   REQUIRE(value == 6.0f);
 
 }
+
+TEST_CASE("Vector push back with no initialization", "[memory]") {
+  SirMetal::ResizableVector<uint32_t> vec;
+  for (uint32_t i = 0; i < 100; ++i) {
+    vec.pushBack(i);
+  }
+  REQUIRE(vec.size() == 100);
+  REQUIRE(vec.reservedSize() == 128);
+  for (uint32_t i = 0; i < 100; ++i) {
+    REQUIRE(vec[i] == i);
+  }
+}
+
+template <typename VECTOR> static bool isAligned(const VECTOR &vec, uint32_t alignment) {
+  return (reinterpret_cast<uintptr_t>(vec.data()) & (alignment - 1)) == 0;
+}
+
+TEST_CASE("Vector alignment", "[memory]") {
+  SirMetal::ThreeSizesPool pool(4096);
+  SirMetal::ResizableVector<float> vec16(10);
+  SirMetal::ResizableVector<float, SirMetal::ThreeSizesPool, 32> vec32(3, &pool);
+  SirMetal::ResizableVector<float, SirMetal::ThreeSizesPool, 64> vec64(5, &pool);
+  REQUIRE(isAligned(vec16, 16));
+  REQUIRE(isAligned(vec32, 32));
+  REQUIRE(isAligned(vec64, 64));
+  REQUIRE(pool.getUsedBytes() != 0);
+  // alignment survives re-allocations
+  for (uint32_t i = 0; i < 50; ++i) {
+    vec32.pushBack(static_cast<float>(i));
+    vec64.pushBack(static_cast<float>(i));
+    REQUIRE(isAligned(vec32, 32));
+    REQUIRE(isAligned(vec64, 64));
+  }
+  for (uint32_t i = 0; i < 50; ++i) {
+    REQUIRE(vec32[i] == static_cast<float>(i));
+    REQUIRE(vec64[i] == static_cast<float>(i));
+  }
+}
+
+TEST_CASE("Vector pool allocator", "[memory]") {
+  SirMetal::ThreeSizesPool pool(4096);
+  {
+    SirMetal::ResizableVector<uint32_t> vec(4, &pool);
+    for (uint32_t i = 0; i < 200; ++i) {
+      vec.pushBack(i);
+    }
+    REQUIRE(vec[199] == 199);
+    REQUIRE(pool.getUsedBytes() >= 256 * sizeof(uint32_t));
+  }
+  // everything went back to the pool
+  REQUIRE(pool.getUsedBytes() == 0);
+}
+
+TEST_CASE("Vector pool allocator past the biggest pool block", "[memory]") {
+  SirMetal::ThreeSizesPool pool(4 << 20);
+  {
+    SirMetal::ResizableVector<uint32_t> vec(4, &pool);
+    const uint32_t count = SirMetal::ThreeSizesPool::getMaxAllocSize() / 2;
+    for (uint32_t i = 0; i < count; ++i) {
+      vec.pushBack(i);
+    }
+    // the last growth did not fit in a pool block and went to the heap
+    REQUIRE(pool.getUsedBytes() == 0);
+    for (uint32_t i = 0; i < count; ++i) {
+      REQUIRE(vec[i] == i);
+    }
+  }
+  REQUIRE(pool.getUsedBytes() == 0);
+  REQUIRE(pool.getSmallAllocCount() + pool.getMediumAllocCount() +
+              pool.getLargeAllocCount() ==
+          0);
+}
+
+TEST_CASE("Vector stack allocator grows in place", "[memory]") {
+  SirMetal::StackAllocator stack;
+  stack.initialize(1 << 16);
+  SirMetal::ResizableVector<uint32_t, SirMetal::StackAllocator, 32> vec(4, &stack);
+  const uint32_t *start = vec.data();
+  for (uint32_t i = 0; i < 1000; ++i) {
+    vec.pushBack(i);
+  }
+  REQUIRE(vec.data() == start);
+  REQUIRE(vec[999] == 999);
+
+  // something else on the stack, the vector has to move
+  stack.allocate(16);
+  for (uint32_t i = 1000; i < 1100; ++i) {
+    vec.pushBack(i);
+  }
+  REQUIRE(vec.data() != start);
+  REQUIRE(isAligned(vec, 32));
+  for (uint32_t i = 0; i < 1100; ++i) {
+    REQUIRE(vec[i] == i);
+  }
+}
+
+TEST_CASE("Stack allocator grows up to the end", "[memory]") {
+  SirMetal::StackAllocator stack;
+  stack.initialize(256);
+  void *first = stack.allocate(64);
+  // the last allocation can fill the stack exactly, not more
+  REQUIRE(stack.growInPlace(first, 256));
+  REQUIRE(!stack.growInPlace(first, 257));
+}
+
+TEST_CASE("Vector virtual memory arena never copies", "[memory]") {
+  SirMetal::VirtualMemoryArena arena(1ull << 30);
+  SirMetal::ResizableVector<uint32_t, SirMetal::VirtualMemoryArena, 64> vec(0, &arena);
+  vec.pushBack(0);
+  const uint32_t *start = vec.data();
+  const uint32_t count = 1 << 20;
+  for (uint32_t i = 1; i < count; ++i) {
+    vec.pushBack(i);
+  }
+  REQUIRE(vec.data() == start);
+  REQUIRE(isAligned(vec, 64));
+  REQUIRE(arena.getCommittedBytes() >= count * sizeof(uint32_t));
+  REQUIRE(arena.getCommittedBytes() < arena.getReservedBytes());
+  bool allMatch = true;
+  for (uint32_t i = 0; i < count; ++i) {
+    allMatch &= vec[i] == i;
+  }
+  REQUIRE(allMatch);
+}
+
+TEST_CASE("Virtual memory arena", "[memory]") {
+  SirMetal::VirtualMemoryArena arena(1 << 24);
+  REQUIRE(arena.getReservedBytes() == 1 << 24);
+  REQUIRE(arena.getCommittedBytes() == 0);
+
+  auto *first = static_cast<char *>(arena.allocate(100));
+  auto *second = static_cast<char *>(arena.allocate(10));
+  REQUIRE(second - first == 128);
+  memset(first, 1, 100);
+  memset(second, 2, 10);
+  // only the last allocation can grow
+  REQUIRE(!arena.growInPlace(first, 1000));
+  REQUIRE(arena.growInPlace(second, 1 << 20));
+  memset(second, 2, 1 << 20);
+  REQUIRE(arena.getUsedBytes() == 128 + (1 << 20));
+  REQUIRE(!arena.growInPlace(second, 1 << 25));
+
+  arena.free(second);
+  REQUIRE(arena.getUsedBytes() == 128);
+  arena.trim();
+  REQUIRE(arena.getCommittedBytes() < 1 << 20);
+  arena.reset();
+  REQUIRE(arena.getUsedBytes() == 0);
+  REQUIRE(arena.allocate(64) == first);
+}
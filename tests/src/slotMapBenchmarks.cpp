@@ -0,0 +1,61 @@
+#include "SirMetal/core/memory/cpu/slotMap.h"
+#include "catch/catch.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// run with: tests "[!benchmark]"
+namespace {
+
+// roughly the size of the data the resource managers keep per entry
+struct ResourceData {
+  void *native;
+  uint32_t size;
+  uint32_t flags;
+  float boundingBox[6];
+};
+
+} // namespace
+
+TEST_CASE("slot map vs unordered map handle resolution", "[!benchmark]") {
+  const uint32_t entryCounts[] = {64, 1024, 16384};
+  const uint32_t queryCount = 1 << 14;
+
+  for (uint32_t entryCount : entryCounts) {
+    // what the managers used to do, a counter as key in an unordered map
+    std::unordered_map<uint32_t, ResourceData> unorderedMap;
+    SirMetal::SlotMap<ResourceData> slotMap(entryCount);
+    std::vector<uint32_t> counterKeys(entryCount);
+    std::vector<uint32_t> slotKeys(entryCount);
+    for (uint32_t i = 0; i < entryCount; ++i) {
+      const ResourceData data{nullptr, i, 0, {}};
+      counterKeys[i] = i + 1;
+      unorderedMap[counterKeys[i]] = data;
+      slotKeys[i] = slotMap.insert(data);
+    }
+
+    // same random sequence of resources resolved by both
+    std::vector<uint32_t> queries(queryCount);
+    for (uint32_t i = 0; i < queryCount; ++i) {
+      queries[i] = static_cast<uint32_t>(rand()) % entryCount;
+    }
+    const std::string suffix = " entries:" + std::to_string(entryCount);
+
+    BENCHMARK("unordered_map" + suffix) {
+      uint32_t sum = 0;
+      for (uint32_t i = 0; i < queryCount; ++i) {
+        auto found = unorderedMap.find(counterKeys[queries[i]]);
+        sum += found != unorderedMap.end() ? found->second.size : 0;
+      }
+      return sum;
+    };
+    BENCHMARK("slot map" + suffix) {
+      uint32_t sum = 0;
+      for (uint32_t i = 0; i < queryCount; ++i) {
+        const ResourceData *found = slotMap.get(slotKeys[queries[i]]);
+        sum += found != nullptr ? found->size : 0;
+      }
+      return sum;
+    };
+  }
+}
@@ -0,0 +1,121 @@
+#include "SirMetal/core/memory/cpu/slotMap.h"
+#include "catch/catch.h"
+#include <string>
+
+TEST_CASE("Slot map insert and get", "[memory]") {
+  SirMetal::SlotMap<std::string> map;
+  const uint32_t key1 = map.insert("hello");
+  const uint32_t key2 = map.insert("world");
+  REQUIRE(key1 != key2);
+  REQUIRE(map.size() == 2);
+  REQUIRE(map.contains(key1));
+  REQUIRE(map.contains(key2));
+  REQUIRE(*map.get(key1) == "hello");
+  REQUIRE(*map.get(key2) == "world");
+  // keys fit in the 24 bits left by the handle type
+  REQUIRE(key1 < (1 << 24));
+  REQUIRE(key2 < (1 << 24));
+}
+
+TEST_CASE("Slot map stale keys", "[memory]") {
+  SirMetal::SlotMap<uint32_t> map;
+  const uint32_t key1 = map.insert(10);
+  REQUIRE(map.remove(key1));
+  REQUIRE(!map.contains(key1));
+  REQUIRE(map.get(key1) == nullptr);
+  REQUIRE(!map.remove(key1));
+
+  // the slot is reused, but with a new generation
+  const uint32_t key2 = map.insert(20);
+  REQUIRE(SirMetal::SlotMap<uint32_t>::getSlotFromKey(key1) ==
+          SirMetal::SlotMap<uint32_t>::getSlotFromKey(key2));
+  REQUIRE(key1 != key2);
+  REQUIRE(map.get(key1) == nullptr);
+  REQUIRE(*map.get(key2) == 20);
+
+  // out of range keys don't resolve either
+  REQUIRE(map.get(1234) == nullptr);
+}
+
+TEST_CASE("Slot map generation wrap", "[memory]") {
+  using Map = SirMetal::SlotMap<uint32_t>;
+  Map map;
+  const uint32_t first = map.insert(0);
+  map.remove(first);
+  // the slot goes through all of its 256 generations
+  uint32_t key = first;
+  for (uint32_t i = 1; i < 256; ++i) {
+    key = map.insert(i);
+    REQUIRE(Map::getSlotFromKey(key) == Map::getSlotFromKey(first));
+    REQUIRE(Map::getGenerationFromKey(key) == i);
+    map.remove(key);
+  }
+  // the slot is retired, instead of wrapping the generation, so none of the
+  // old keys resolve ever again
+  const uint32_t next = map.insert(256);
+  REQUIRE(next != Map::INVALID_KEY);
+  REQUIRE(Map::getSlotFromKey(next) != Map::getSlotFromKey(first));
+  REQUIRE(!map.contains(first));
+  REQUIRE(!map.contains(key));
+  REQUIRE(map.get(first) == nullptr);
+  REQUIRE(*map.get(next) == 256);
+  REQUIRE(!map.remove(key));
+  REQUIRE(map.size() == 1);
+}
+
+TEST_CASE("Slot map full", "[memory]") {
+  using Map = SirMetal::SlotMap<uint32_t>;
+  Map map;
+  uint32_t last = 0;
+  for (uint32_t i = 0; i < (1 << 16) - 1; ++i) {
+    last = map.insert(i);
+    REQUIRE(last != Map::INVALID_KEY);
+  }
+  // no slot left, the next key would spill in the generation bits
+  REQUIRE(map.insert(1) == Map::INVALID_KEY);
+  REQUIRE(map.insert(2) == Map::INVALID_KEY);
+  REQUIRE(map.size() == (1 << 16) - 1);
+  REQUIRE(!map.contains(Map::INVALID_KEY));
+  REQUIRE(map.get(Map::INVALID_KEY) == nullptr);
+  REQUIRE(*map.get(map.getKeyAtDenseIndex(0)) == 0);
+  REQUIRE(*map.get(last) == (1 << 16) - 2);
+
+  // a freed slot can be used again
+  REQUIRE(map.remove(last));
+  const uint32_t reused = map.insert(42);
+  REQUIRE(reused != Map::INVALID_KEY);
+  REQUIRE(!map.contains(last));
+  REQUIRE(*map.get(reused) == 42);
+}
+
+TEST_CASE("Slot map dense iteration", "[memory]") {
+  SirMetal::SlotMap<uint32_t> map;
+  uint32_t keys[100];
+  for (uint32_t i = 0; i < 100; ++i) {
+    keys[i] = map.insert(i);
+  }
+  // removing all the odd values, the holes get patched with the last entries
+  for (uint32_t i = 1; i < 100; i += 2) {
+    REQUIRE(map.remove(keys[i]));
+  }
+  REQUIRE(map.size() == 50);
+
+  uint32_t sum = 0;
+  uint32_t count = 0;
+  for (const uint32_t &value : map) {
+    REQUIRE(value % 2 == 0);
+    sum += value;
+    ++count;
+  }
+  REQUIRE(count == 50);
+  REQUIRE(sum == 2450);
+
+  // every key still points to its value, and dense positions map back to
+  // the right keys
+  for (uint32_t i = 0; i < 100; i += 2) {
+    REQUIRE(*map.get(keys[i]) == i);
+  }
+  for (uint32_t i = 0; i < map.size(); ++i) {
+    REQUIRE(*map.get(map.getKeyAtDenseIndex(i)) == map.data()[i]);
+  }
+}
@@ -0,0 +1,104 @@
+#include "SirMetal/core/hashing/hashing.h"
+#include "SirMetal/core/memory/cpu/stringHashMap.h"
+#include "catch/catch.h"
+#include <string>
+#include <vector>
+
+using StringMap =
+    SirMetal::HashMap<const char *, uint32_t, SirMetal::hashString32>;
+
+TEST_CASE("string hashmap insert", "[memory]") {
+  StringMap alloc(200);
+  alloc.insert("gbuffer", 1024);
+  alloc.insert("shadows", 2013);
+  alloc.insert("lightmap", 21233);
+
+  uint32_t value;
+  REQUIRE(alloc.containsKey("gbuffer") == true);
+  REQUIRE(alloc.get("gbuffer", value) == true);
+  REQUIRE(value == 1024);
+  REQUIRE(alloc.get("shadows", value) == true);
+  REQUIRE(value == 2013);
+  REQUIRE(alloc.get("lightmap", value) == true);
+  REQUIRE(value == 21233);
+  REQUIRE(alloc.containsKey("gbuff") == false);
+  REQUIRE(alloc.getUsedBins() == 3);
+}
+
+TEST_CASE("string hashmap hashed key", "[memory]") {
+  StringMap alloc(200);
+  const SirMetal::HashedString key = SirMetal::hashedString("gbuffer");
+  REQUIRE(key.length == 7);
+  REQUIRE(key.hash == SirMetal::hashString32("gbuffer"));
+
+  alloc.insert(key, 10);
+  uint32_t value;
+  REQUIRE(alloc.get("gbuffer", value) == true);
+  REQUIRE(value == 10);
+  // the same key from a different pointer must match
+  std::string copy = "gbuffer";
+  REQUIRE(alloc.get(SirMetal::hashedString(copy.c_str()), value) == true);
+  REQUIRE(value == 10);
+  alloc.insert(copy.c_str(), 11);
+  REQUIRE(alloc.get(key, value) == true);
+  REQUIRE(value == 11);
+  REQUIRE(alloc.getUsedBins() == 1);
+  REQUIRE(alloc.remove(key) == true);
+  REQUIRE(alloc.containsKey(key) == false);
+}
+
+TEST_CASE("string hashmap hash collision", "[memory]") {
+  StringMap alloc(200);
+  alloc.insert("gbuffer", 1);
+  // same hash, the length or the bytes tell the keys apart
+  const uint32_t hash = SirMetal::hashString32("gbuffer");
+  uint32_t value;
+  REQUIRE(alloc.get(SirMetal::HashedString{"gbuffer2", 8, hash}, value) ==
+          false);
+  REQUIRE(alloc.get(SirMetal::HashedString{"gbuffe", 6, hash}, value) ==
+          false);
+  REQUIRE(alloc.get(SirMetal::HashedString{"gbuffex", 7, hash}, value) ==
+          false);
+  REQUIRE(alloc.get(SirMetal::HashedString{"gbuffer", 7, hash}, value) ==
+          true);
+  REQUIRE(value == 1);
+}
+
+TEST_CASE("string hashmap pool interning", "[memory]") {
+  SirMetal::StringPool pool(2 << 16);
+  StringMap alloc(200, &pool);
+  std::string name = "material_01";
+  alloc.insert(name.c_str(), 1);
+  // the map owns a copy of the key, changing the source must not matter
+  name[0] = 'X';
+  uint32_t value;
+  REQUIRE(alloc.get("material_01", value) == true);
+  REQUIRE(value == 1);
+  REQUIRE(alloc.containsKey(name.c_str()) == false);
+  REQUIRE(alloc.remove("material_01") == true);
+  REQUIRE(alloc.getUsedBins() == 0);
+}
+
+TEST_CASE("string hashmap psudo random insert and remove", "[memory]") {
+  SirMetal::StringPool pool(2 << 20);
+  StringMap alloc(2000, &pool);
+  std::vector<std::string> keys;
+  const int count = 1500;
+  for (int i = 0; i < count; ++i) {
+    keys.push_back("key_" + std::to_string(rand()) + "_" + std::to_string(i));
+    REQUIRE(alloc.insert(keys[i].c_str(), i) == true);
+  }
+  REQUIRE(alloc.getUsedBins() == count);
+  for (int i = 0; i < count; i += 2) {
+    REQUIRE(alloc.remove(keys[i].c_str()) == true);
+  }
+  uint32_t value;
+  for (int i = 0; i < count; ++i) {
+    const bool expected = (i % 2) != 0;
+    REQUIRE(alloc.get(keys[i].c_str(), value) == expected);
+    if (expected) {
+      REQUIRE(value == static_cast<uint32_t>(i));
+    }
+  }
+  REQUIRE(alloc.getUsedBins() == count / 2);
+}
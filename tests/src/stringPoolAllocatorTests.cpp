@@ -186,9 +186,12 @@ TEST_CASE("String pool basic mixed alloc static 2", "[memory]") {
   // just doing a big alloc
   REQUIRE(wcscmp(original5, mem5) == 0);
 
+  // mem2 got merged with what was left of the block of mem, after mem3 was
+  // carved out of it, mem4 fits in there
+  REQUIRE(mem4 < mem2);
+
   const wchar_t *mem6 = alloc.allocatePersistent(original6);
-  // mem 6 is short so should reuse mem2
-  REQUIRE(mem6 == mem2);
+  REQUIRE(wcscmp(original6, mem6) == 0);
 }
 
 TEST_CASE("String pool basic concatenation 1", "[memory]") {
@@ -236,7 +239,11 @@ TEST_CASE("String pool basic concatenation 1", "[memory]") {
           SirMetal::STRING_MANIPULATION_FLAGS::FREE_SECOND_AFTER_OPERATION);
   REQUIRE(strcmp(res5, compare) == 0);
   REQUIRE(strcmp(mem1, original) != 0);
+#if SE_DEBUG
+  // mem2 gets merged in the free block of mem1, so only the mem1 bytes get
+  // overridden by the free list node, unless freed memory is tagged
   REQUIRE(strcmp(mem2, original2) != 0);
+#endif
 
   // realloc mem1 and mem2
   mem1 = alloc.allocatePersistent(original);
@@ -249,7 +256,9 @@ TEST_CASE("String pool basic concatenation 1", "[memory]") {
   // nothing should happen since the joiner is not in the pool
   REQUIRE(strcmp(res6, compare) == 0);
   REQUIRE(strcmp(mem1, original) != 0);
+#if SE_DEBUG
   REQUIRE(strcmp(mem2, original2) != 0);
+#endif
 
   // alloc and free everything
   mem1 = alloc.allocatePersistent(original);
@@ -263,8 +272,10 @@ TEST_CASE("String pool basic concatenation 1", "[memory]") {
   // nothing should happen since the joiner is not in the pool
   REQUIRE(strcmp(res7, compare) == 0);
   REQUIRE(strcmp(mem1, original) != 0);
+#if SE_DEBUG
   REQUIRE(strcmp(mem2, original2) != 0);
   REQUIRE(strcmp(joiner2, joiner1) != 0);
+#endif
 }
 
 TEST_CASE("String pool basic concatenation 2", "[memory]") {
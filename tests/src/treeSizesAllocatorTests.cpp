@@ -95,7 +95,8 @@ TEST_CASE("Tree sizes pool delete alloc 1", "[memory]") {
   }
 
 #if SE_DEBUG
-  for (int i = 120; i < 128; ++i) {
+  // the last 4 bytes held the footer of the free block, the size of it
+  for (int i = 120; i < 124; ++i) {
     REQUIRE(bytePtr[i] == 0xff);
   }
 #endif
@@ -123,26 +124,25 @@ TEST_CASE("Tree sizes pool delete alloc 2", "[memory]") {
   alloc.free(mem2);
   REQUIRE(alloc.getMediumAllocCount() == 2);
 
+  // mem2 and mem3 got merged in a single free block, the allocation is carved
+  // from the start of it and the rest goes back to the free lists
+  REQUIRE(alloc.getFreeListBytes() == 2 * alloc.getRawAllocSize(mem1));
   void *mem5 = alloc.allocate(120);
   REQUIRE(alloc.getMediumAllocCount() == 3);
   REQUIRE(mem5 == mem2);
   // checking memory is properly written and not overrun
   uint32_t memSizeInBtye = alloc.getAllocSize(mem5);
+  REQUIRE(memSizeInBtye == 120);
   memset(mem5, 5, memSizeInBtye);
   auto *bytePtr = reinterpret_cast<unsigned char *>(mem5);
   for (uint32_t i = 0; i < memSizeInBtye; ++i) {
     REQUIRE(bytePtr[i] == 5);
   }
 
-#if SE_DEBUG
-  for (uint32_t i = memSizeInBtye; i < 128; ++i) {
-    REQUIRE(bytePtr[i] == 0xff);
-  }
-#endif
-
   void *mem6 = alloc.allocate(70);
   REQUIRE(alloc.getMediumAllocCount() == 4);
-  REQUIRE(mem6 == mem3);
+  REQUIRE(mem6 == reinterpret_cast<char *>(mem5) + alloc.getRawAllocSize(mem5));
+  REQUIRE(reinterpret_cast<char *>(mem6) < reinterpret_cast<char *>(mem4));
   // checking memory is properly written and not overrun
   memSizeInBtye = alloc.getAllocSize(mem6);
   memset(mem6, 6, memSizeInBtye);
@@ -150,13 +150,97 @@ TEST_CASE("Tree sizes pool delete alloc 2", "[memory]") {
   for (uint32_t i = 0; i < memSizeInBtye; ++i) {
     REQUIRE(bytePtr[i] == 6);
   }
-
-#if SE_DEBUG
-  for (int i = memSizeInBtye; i < 128; ++i) {
-    REQUIRE(bytePtr[i] == 0xff);
+  // the data of the neighbours is untouched
+  bytePtr = reinterpret_cast<unsigned char *>(mem4);
+  for (uint32_t i = 0; i < 128; ++i) {
+    REQUIRE(bytePtr[i] == 4);
   }
-#endif
 
   alloc.allocate(200);
   REQUIRE(alloc.getMediumAllocCount() == 5);
 }
+
+TEST_CASE("Tree sizes pool coalesce", "[memory]") {
+  SirMetal::ThreeSizesPool alloc(2 << 16);
+  void *mem1 = alloc.allocate(100);
+  void *mem2 = alloc.allocate(100);
+  void *mem3 = alloc.allocate(100);
+  void *mem4 = alloc.allocate(100);
+  const uint32_t rawSize = alloc.getRawAllocSize(mem1);
+
+  // freeing in an order that merges both with the previous and the next block
+  alloc.free(mem1);
+  alloc.free(mem3);
+  REQUIRE(alloc.getFreeListBytes() == 2 * rawSize);
+  REQUIRE(alloc.getLargestFreeBlock() == rawSize);
+  REQUIRE(alloc.getFragmentation() == Approx(0.5f));
+  alloc.free(mem2);
+  REQUIRE(alloc.getFreeListBytes() == 3 * rawSize);
+  REQUIRE(alloc.getLargestFreeBlock() == 3 * rawSize);
+  REQUIRE(alloc.getFragmentation() == Approx(0.0f));
+
+  // an allocation that does not fit in any of the original blocks
+  void *mem5 = alloc.allocate(3 * rawSize - 4);
+  REQUIRE(mem5 == mem1);
+  REQUIRE(alloc.getFreeListBytes() == 0);
+  REQUIRE(alloc.getFootprint() == 4 * rawSize);
+
+  alloc.free(mem5);
+  alloc.free(mem4);
+  // everything is merged back in a single block
+  REQUIRE(alloc.getFootprint() == 4 * rawSize);
+  REQUIRE(alloc.getFreeListBytes() == 4 * rawSize);
+  REQUIRE(alloc.getLargestFreeBlock() == 4 * rawSize);
+  REQUIRE(alloc.getUsedBytes() == 0);
+  REQUIRE(alloc.getPeakFootprint() == 4 * rawSize);
+  REQUIRE(alloc.getPeakUsedBytes() == 4 * rawSize);
+}
+
+TEST_CASE("Tree sizes pool bounded overhead", "[memory]") {
+  SirMetal::ThreeSizesPool alloc(2 << 20);
+  constexpr uint32_t SLOTS = 512;
+  void *ptrs[SLOTS]{};
+  uint32_t sizes[SLOTS]{};
+  uint32_t seed = 12345;
+  auto random = [&seed]() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+  };
+
+  // random churn of mixed sizes, every live allocation is checked to not
+  // have been stomped on by the others
+  for (uint32_t i = 0; i < 20000; ++i) {
+    const uint32_t slot = random() % SLOTS;
+    if (ptrs[slot] != nullptr) {
+      auto *bytePtr = reinterpret_cast<unsigned char *>(ptrs[slot]);
+      REQUIRE(bytePtr[0] == static_cast<unsigned char>(slot));
+      REQUIRE(bytePtr[sizes[slot] - 1] == static_cast<unsigned char>(slot));
+      alloc.free(ptrs[slot]);
+      ptrs[slot] = nullptr;
+    } else {
+      sizes[slot] = 1 + random() % 2000;
+      ptrs[slot] = alloc.allocate(sizes[slot]);
+      REQUIRE(alloc.getAllocSize(ptrs[slot]) >= sizes[slot]);
+      memset(ptrs[slot], static_cast<int>(slot), sizes[slot]);
+    }
+  }
+
+  // the pool never touched much more memory than what was live at its peak
+  REQUIRE(alloc.getPeakFootprint() <
+          static_cast<uint32_t>(alloc.getPeakUsedBytes() * 1.5f));
+  REQUIRE(alloc.getFootprint() ==
+          alloc.getUsedBytes() + alloc.getFreeListBytes());
+
+  for (uint32_t i = 0; i < SLOTS; ++i) {
+    if (ptrs[i] != nullptr) {
+      alloc.free(ptrs[i]);
+    }
+  }
+  // with everything freed the pool is back to a single free block
+  REQUIRE(alloc.getUsedBytes() == 0);
+  REQUIRE(alloc.getFreeListBytes() == alloc.getFootprint());
+  REQUIRE(alloc.getFragmentation() == Approx(0.0f));
+  REQUIRE(alloc.getSmallAllocCount() == 0);
+  REQUIRE(alloc.getMediumAllocCount() == 0);
+  REQUIRE(alloc.getLargeAllocCount() == 0);
+}